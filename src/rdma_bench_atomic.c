@@ -0,0 +1,299 @@
+/**
+ * @file rdma_bench_atomic.c
+ * @brief 远端原子操作基准测试：共享计数器与自旋锁
+ *
+ * 服务端只提供缓冲区末尾的两个原子槽位，CPU不参与：
+ * - 计数器：客户端每个QP循环对同一个槽位做FETCH_AND_ADD(+1)
+ * - 自旋锁：每个QP扮演一个加锁者，CMP_AND_SWP(0 -> id)加锁，
+ *   失败立即重试，成功后CMP_AND_SWP(id -> 0)解锁
+ *
+ * 每个QP同时只有一个未完成的原子操作，QP数就是争用同一个64位字的
+ * 并发度。输出总吞吐(Mops/s)和单次操作延迟分布：计数器统计一次FAA的
+ * 往返时间，自旋锁统计从第一次尝试到加锁成功的时间（含重试）。
+ * 结束后客户端用FAA(+0)读回计数器，检查等于QP数×迭代次数。
+ * -x qp（默认）时QP数从1按2倍递增到-q，观察争用对吞吐和延迟的影响。
+ *
+ * @see rdma_common_atomic.h, rdma_bench_common.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_bench_hist.h"
+#include "rdma_common_atomic.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+
+#define ATOM_BUF_SIZE   4096                 /* 两端缓冲区大小，槽位从末尾划出 */
+#define ATOM_COUNTER    0                    /* 计数器槽位 */
+#define ATOM_LOCK       1                    /* 自旋锁槽位 */
+#define ATOM_RESULT     2                    /* QP[i]的原值槽位为ATOM_RESULT + i */
+#define ATOM_MAX_QP     64                   /* 所有QP争用同一个槽位，更多QP没有意义 */
+#define ATOM_NSLOTS     (ATOM_RESULT + ATOM_MAX_QP)
+
+enum atom_mode { ATOM_MODE_COUNTER, ATOM_MODE_LOCK };
+enum atom_phase { ATOM_ACQUIRE, ATOM_RELEASE, ATOM_FINISHED };
+
+/* 每个QP的进度 */
+struct atom_qp {
+    enum atom_phase phase;             /* 下一个/当前操作的类型 */
+    int inflight;                      /* 已投递、尚未处理结果 */
+    int completed;                     /* 完成事件已到达，由处理函数置位 */
+    uint32_t done;                     /* 已完成的计数/加解锁次数 */
+    uint64_t t_start;                  /* 本次操作（加锁含重试）的开始时间 */
+};
+
+struct atom_state {
+    struct atom_qp qp[ATOM_MAX_QP];
+    uint32_t base;                     /* 本地槽位起始偏移 */
+    uint32_t remote_base;              /* 远端槽位起始偏移 */
+    uint64_t retries;                  /* 加锁失败重试次数 */
+    struct bench_hist *h;
+};
+
+static int atom_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                           const struct ibv_wc *wc, void *arg) {
+    struct atom_state *st = arg;
+
+    (void)res;
+    if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: QP[%u]原子操作失败: %s\n",
+                qp_idx, ibv_wc_status_str(wc->status));
+        return -1;
+    }
+    st->qp[qp_idx].completed = 1;
+    return 0;
+}
+
+/* 投递QP q的下一个操作，发送队列满时留到下一轮 */
+static int atom_post(struct bench_ctx *ctx, struct atom_state *st,
+                     enum atom_mode mode, uint32_t q) {
+    struct atomic_op op;
+    int rc;
+
+    op.local_off = atomic_slot_off(st->base, ATOM_RESULT + q);
+    op.remote_off = atomic_slot_off(st->remote_base,
+                                    mode == ATOM_MODE_COUNTER ? ATOM_COUNTER : ATOM_LOCK);
+    if (mode == ATOM_MODE_COUNTER) {
+        rc = post_fetch_add_qp(&ctx->res, q, op.local_off, op.remote_off, 1);
+    } else {
+        /* 锁的持有者标识为q+1，0表示空闲 */
+        op.compare_add = st->qp[q].phase == ATOM_ACQUIRE ? 0 : q + 1;
+        op.swap = st->qp[q].phase == ATOM_ACQUIRE ? q + 1 : 0;
+        rc = post_cmp_swap_qp(&ctx->res, q, &op);
+    }
+    if (rc == -EAGAIN) {
+        return 0;
+    }
+    if (rc) {
+        fprintf(stderr, "错误: QP[%u]投递原子操作失败: %s\n", q, strerror(-rc));
+        return -1;
+    }
+    st->qp[q].inflight = 1;
+    return 0;
+}
+
+/* 根据QP q刚完成的操作的原值决定下一步，返回1表示该QP已跑完 */
+static int atom_step(struct bench_ctx *ctx, struct atom_state *st,
+                     enum atom_mode mode, uint32_t q) {
+    struct atom_qp *p = &st->qp[q];
+    uint64_t old = *(volatile uint64_t *)(ctx->res.buf +
+                                          atomic_slot_off(st->base, ATOM_RESULT + q));
+    uint64_t now = monotonic_ns();
+
+    p->inflight = 0;
+    p->completed = 0;
+    if (mode == ATOM_MODE_COUNTER || p->phase == ATOM_RELEASE) {
+        if (mode == ATOM_MODE_COUNTER) {
+            hist_record(st->h, now - p->t_start);
+        } else if (old != q + 1) {
+            fprintf(stderr, "错误: QP[%u]解锁时锁被%llu持有，互斥被破坏\n",
+                    q, (unsigned long long)old);
+            return -1;
+        }
+        p->done++;
+        p->phase = p->done >= ctx->opts.iters ? ATOM_FINISHED : ATOM_ACQUIRE;
+        p->t_start = now;
+    } else if (old == 0) {
+        hist_record(st->h, now - p->t_start);
+        p->phase = ATOM_RELEASE;
+    } else {
+        st->retries++;
+    }
+    return p->phase == ATOM_FINISHED;
+}
+
+/* 客户端在前qps个QP上跑完一种模式，返回耗时(纳秒)，失败返回-1 */
+static int64_t atom_drive(struct bench_ctx *ctx, struct atom_state *st,
+                          enum atom_mode mode, uint32_t qps) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint64_t deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    uint64_t t0 = monotonic_ns();
+    uint32_t finished = 0;
+    uint32_t q;
+    int rc;
+    int n;
+
+    memset(st->qp, 0, sizeof(st->qp));
+    st->retries = 0;
+    for (q = 0; q < qps; q++) {
+        st->qp[q].t_start = t0;
+    }
+    while (finished < qps) {
+        for (q = 0; q < qps; q++) {
+            if (!st->qp[q].inflight && st->qp[q].phase != ATOM_FINISHED &&
+                atom_post(ctx, st, mode, q)) {
+                return -1;
+            }
+        }
+
+        n = poll_cq_batch(res, wc, POLL_BATCH_SIZE);
+        if (n < 0) {
+            return -1;
+        }
+        if (n > 0) {
+            deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+        } else if (monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 原子操作超时\n");
+            return -1;
+        }
+
+        for (q = 0; q < qps; q++) {
+            rc = st->qp[q].completed ? atom_step(ctx, st, mode, q) : 0;
+            if (rc < 0) {
+                return -1;
+            }
+            finished += (uint32_t)rc;
+        }
+    }
+    return (int64_t)(monotonic_ns() - t0);
+}
+
+/* 用FAA(+0)读回远端计数器当前值 */
+static int atom_read_counter(struct bench_ctx *ctx, struct atom_state *st,
+                             uint64_t *value) {
+    struct ibv_wc wc;
+
+    if (post_fetch_add_qp(&ctx->res, 0, atomic_slot_off(st->base, ATOM_RESULT),
+                          atomic_slot_off(st->remote_base, ATOM_COUNTER), 0) ||
+        poll_completion_batch(&ctx->res, 1, &wc, 1) != 1) {
+        return -1;
+    }
+    *value = *(volatile uint64_t *)(ctx->res.buf + atomic_slot_off(st->base, ATOM_RESULT));
+    return 0;
+}
+
+static void atom_report(const char *mode, uint32_t qps, int64_t ns,
+                        const struct atom_state *st) {
+    const struct bench_hist *h = st->h;
+
+    printf("%-8s %5u %10llu %10.3f %9.2f %9.2f %9.2f %9.2f %10llu\n",
+           mode, qps, (unsigned long long)h->total,
+           (double)h->total * 1000.0 / (double)ns,
+           hist_mean(h) / 1000.0, hist_percentile(h, 50.0) / 1000.0,
+           hist_percentile(h, 99.0) / 1000.0, h->max / 1000.0,
+           (unsigned long long)st->retries);
+}
+
+/* 运行一个(模式, QP数)组合：服务端清零槽位，客户端计时并校验 */
+static int atom_run(struct bench_ctx *ctx, struct atom_state *st,
+                    enum atom_mode mode, uint32_t qps) {
+    uint64_t counter;
+    int64_t ns;
+
+    if (bench_is_server(ctx)) {
+        memset(ctx->res.buf + st->base, 0, ATOM_NSLOTS * ATOMIC_SLOT_SIZE);
+        return bench_sync(ctx) || bench_sync(ctx) ? -1 : 0;
+    }
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+
+    hist_reset(st->h);
+    ns = atom_drive(ctx, st, mode, qps);
+    if (ns <= 0) {
+        return -1;
+    }
+    if (mode == ATOM_MODE_COUNTER) {
+        if (atom_read_counter(ctx, st, &counter)) {
+            return -1;
+        }
+        if (counter != (uint64_t)qps * ctx->opts.iters) {
+            fprintf(stderr, "错误: 计数器为%llu，期望%llu\n", (unsigned long long)counter,
+                    (unsigned long long)qps * ctx->opts.iters);
+            return -1;
+        }
+    }
+    atom_report(mode == ATOM_MODE_COUNTER ? "counter" : "lock", qps, ns, st);
+    return bench_sync(ctx);
+}
+
+static int atom_sweep(struct bench_ctx *ctx, struct atom_state *st, enum atom_mode mode) {
+    uint32_t qps = (ctx->opts.sweep & BENCH_SWEEP_QP) ? 1 : ctx->opts.num_qp;
+
+    for (;;) {
+        if (atom_run(ctx, st, mode, qps)) {
+            return -1;
+        }
+        if (qps >= ctx->opts.num_qp) {
+            return 0;
+        }
+        qps = qps * 2 > ctx->opts.num_qp ? ctx->opts.num_qp : qps * 2;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct atom_state st;
+    int rc = 1;
+    uint32_t i;
+
+    bench_opts_init(&ctx.opts);
+    ctx.opts.num_qp = DEFAULT_NUM_QP;
+    ctx.opts.sweep = BENCH_SWEEP_QP;
+    if (bench_parse_args(&ctx.opts, argc, argv) || ctx.opts.num_qp > ATOM_MAX_QP) {
+        bench_usage(argv[0]);
+        fprintf(stderr, "  (原子测试默认: -q %d -x qp，只使用-n与-q，QP数不超过%d)\n",
+                DEFAULT_NUM_QP, ATOM_MAX_QP);
+        return 1;
+    }
+
+    memset(&st, 0, sizeof(st));
+    st.h = malloc(sizeof(*st.h));
+    if (!st.h) {
+        fprintf(stderr, "错误: 分配直方图失败\n");
+        return 1;
+    }
+
+    if (bench_setup(&ctx, ATOM_BUF_SIZE)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    if (atomic_slots_carve(ctx.res.buf_size, ATOM_NSLOTS, &st.base) ||
+        atomic_slots_carve(ctx.res.qp_ctx[0].remote_len, ATOM_NSLOTS, &st.remote_base)) {
+        fprintf(stderr, "错误: 缓冲区放不下%d个原子槽位\n", ATOM_NSLOTS);
+        goto out;
+    }
+    /* 每个原子操作都要读原值，必须逐个signaled */
+    if (set_signal_interval(&ctx.res, 1)) {
+        goto out;
+    }
+    for (i = 0; i < ctx.res.num_qp; i++) {
+        if (register_wc_handler(&ctx.res, i, atom_wc_handler, &st)) {
+            goto out;
+        }
+    }
+
+    if (!bench_is_server(&ctx)) {
+        printf("\n%-8s %5s %10s %10s %9s %9s %9s %9s %10s\n", "mode", "qps", "ops",
+               "Mops/s", "avg(us)", "p50(us)", "p99(us)", "max(us)", "retries");
+    }
+    if (atom_sweep(&ctx, &st, ATOM_MODE_COUNTER) || atom_sweep(&ctx, &st, ATOM_MODE_LOCK)) {
+        goto out;
+    }
+    rc = 0;
+
+out:
+    bench_teardown(&ctx);
+    free(st.h);
+    return rc;
+}
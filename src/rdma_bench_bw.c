@@ -0,0 +1,165 @@
+/**
+ * @file rdma_bench_bw.c
+ * @brief 带宽/消息速率基准测试：多QP、多深度、多消息大小扫描
+ *
+ * 客户端在前qps个QP上持续投递消息，每个QP保持depth个未完成WR，
+ * 服务端只负责接收（READ时由客户端从服务端拉取）。对每个(操作, QP数, 深度, 消息大小)组合：
+ * 1. TCP同步，SEND模式下服务端先为每个QP预投递depth个RECV
+ * 2. 客户端轮流给每个QP补满depth个WR（单次门铃链式投递），并批量轮询CQ
+ * 3. 所有WR完成后计时结束，输出Gb/s与Mmsg/s
+ *
+ * -x选择扫描的维度，未扫描的维度固定取最大值（-q、-D、-S）。
+ * -j把所有结果另存为JSON数组，便于脚本比较不同版本的结果。
+ * READ的吞吐受-R协商出的未完成READ深度限制，depth超过它的部分在网卡内排队。
+ * -T启用工作线程，每个线程在自己的核上驱动一部分QP并轮询自己的CQ，
+ * -C指定绑定的CPU（numa表示网卡所在节点的CPU）。
+ *
+ * 所有WR共用同一块缓冲区，数据内容不做校验。
+ *
+ * @see rdma_bench_common.h, rdma_bench_bw_run.c
+ */
+
+#include "rdma_bench_bw.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+
+#define BW_DEFAULT_ITERS   1000                 /* 默认每个QP的消息数 */
+#define BW_DEFAULT_MAX     (8u << 20)           /* 默认最大消息大小8MB */
+#define BW_BYTES_PER_QP    (256ull << 20)       /* 每个组合每个QP最多传输的字节数 */
+#define BW_MIN_ITERS       16                   /* 大消息时每个QP的最少消息数 */
+
+/* 扫描序列的下一个值：按2倍递增，最后一个值固定为max，结束返回0 */
+static uint32_t sweep_next(uint32_t v, uint32_t max) {
+    if (v >= max) {
+        return 0;
+    }
+    return v > max / 2 ? max : v * 2;
+}
+
+/* 大消息按字节预算减少消息数，避免单个组合在rxe上运行过久 */
+static uint32_t bw_iters(const struct bench_opts *opts, uint32_t size) {
+    uint64_t budget = BW_BYTES_PER_QP / size;
+
+    if (budget < BW_MIN_ITERS) {
+        budget = BW_MIN_ITERS;
+    }
+    return budget < opts->iters ? (uint32_t)budget : opts->iters;
+}
+
+static void bw_report(const struct bw_conf *c, uint64_t ns, FILE *json, int *first) {
+    double msgs = (double)c->qps * c->iters;
+    double gbps = msgs * c->size * 8.0 / (double)ns;
+    double mmps = msgs * 1000.0 / (double)ns;
+    const char *op = c->op == BENCH_OP_SEND ? "send" :
+                     c->op == BENCH_OP_READ ? "read" : "write";
+
+    printf("%-6s %5u %6u %9u %8u %10.2f %10.3f\n",
+           op, c->qps, c->depth, c->size, c->iters, gbps, mmps);
+    if (json) {
+        fprintf(json, "%s  {\"op\": \"%s\", \"qps\": %u, \"depth\": %u, \"size\": %u, "
+                "\"iters\": %u, \"ns\": %llu, \"gbps\": %.4f, \"mmsgs\": %.4f}",
+                *first ? "" : ",\n", op, c->qps, c->depth, c->size, c->iters,
+                (unsigned long long)ns, gbps, mmps);
+        *first = 0;
+    }
+}
+
+/* 按-x选择的维度扫描一种操作的所有组合 */
+static int bw_sweep(struct bench_ctx *ctx, uint32_t op, struct bw_state *st,
+                    FILE *json, int *first) {
+    const struct bench_opts *o = &ctx->opts;
+    struct bw_conf c;
+    int64_t ns;
+
+    c.op = op;
+    for (c.qps = (o->sweep & BENCH_SWEEP_QP) ? 1 : o->num_qp; c.qps;
+         c.qps = sweep_next(c.qps, o->num_qp)) {
+        for (c.depth = (o->sweep & BENCH_SWEEP_DEPTH) ? 1 : o->depth; c.depth;
+             c.depth = sweep_next(c.depth, o->depth)) {
+            for (c.size = (o->sweep & BENCH_SWEEP_SIZE) ? o->min_size : o->max_size; c.size;
+                 c.size = sweep_next(c.size, o->max_size)) {
+                c.iters = bw_iters(o, c.size);
+                /* 选择性signaling间隔不超过深度的一半，保证窗口内总有可回收的CQE */
+                if (set_signal_interval(&ctx->res, c.depth > 1 ? c.depth / 2 : 1)) {
+                    return -1;
+                }
+                ns = bw_run(ctx, &c, st);
+                if (ns < 0) {
+                    return -1;
+                }
+                if (ns > 0) {
+                    bw_report(&c, (uint64_t)ns, json, first);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct bw_state *st = NULL;
+    FILE *json = NULL;
+    int first = 1;
+    int rc = 1;
+    uint32_t i;
+
+    bench_opts_init(&ctx.opts);
+    ctx.opts.num_qp = DEFAULT_NUM_QP;
+    ctx.opts.iters = BW_DEFAULT_ITERS;
+    ctx.opts.max_size = BW_DEFAULT_MAX;
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        fprintf(stderr, "  (带宽测试默认: -q %d -n %d -S %u)\n",
+                DEFAULT_NUM_QP, BW_DEFAULT_ITERS, BW_DEFAULT_MAX);
+        return 1;
+    }
+
+    if (bench_setup(&ctx, ctx.opts.max_size)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    st = bw_lanes_alloc(&ctx.res);
+    if (!st) {
+        goto out;
+    }
+    /* 每个QP的RECV计数记在所属线程的通道里 */
+    for (i = 0; i < ctx.res.num_qp; i++) {
+        if (register_wc_handler(&ctx.res, i, bw_wc_handler, &st[worker_of_qp(&ctx.res, i)])) {
+            goto out;
+        }
+    }
+
+    if (!bench_is_server(&ctx)) {
+        if (ctx.opts.json_path) {
+            json = fopen(ctx.opts.json_path, "w");
+            if (!json) {
+                fprintf(stderr, "错误: 无法创建%s: %s\n", ctx.opts.json_path, strerror(errno));
+                goto out;
+            }
+            fprintf(json, "[\n");
+        }
+        printf("\n%-6s %5s %6s %9s %8s %10s %10s\n",
+               "op", "qps", "depth", "bytes", "iters", "Gb/s", "Mmsg/s");
+    }
+
+    if ((ctx.opts.ops & BENCH_OP_SEND) && bw_sweep(&ctx, BENCH_OP_SEND, st, json, &first)) {
+        goto out;
+    }
+    if ((ctx.opts.ops & BENCH_OP_WRITE) && bw_sweep(&ctx, BENCH_OP_WRITE, st, json, &first)) {
+        goto out;
+    }
+    if ((ctx.opts.ops & BENCH_OP_READ) && bw_sweep(&ctx, BENCH_OP_READ, st, json, &first)) {
+        goto out;
+    }
+    rc = 0;
+
+out:
+    if (json) {
+        fprintf(json, "\n]\n");
+        fclose(json);
+    }
+    bw_lanes_free(&ctx.res, st);
+    bench_teardown(&ctx);
+    return rc;
+}
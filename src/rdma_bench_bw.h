@@ -0,0 +1,85 @@
+/**
+ * @file rdma_bench_bw.h
+ * @brief 带宽基准测试内部接口 - 单个测试组合的描述与执行
+ *
+ * 只被rdma_bench_bw.c和rdma_bench_bw_run.c使用。
+ *
+ * @see rdma_bench_bw_run.c
+ */
+
+#ifndef RDMA_BENCH_BW_H
+#define RDMA_BENCH_BW_H
+
+#include "rdma_bench_common.h"
+#include "rdma_common_worker.h"
+
+/* 一个测试组合 */
+struct bw_conf {
+    uint32_t op;                       /* BENCH_OP_SEND/WRITE/READ之一 */
+    uint32_t qps;                      /* 使用的QP数 */
+    uint32_t depth;                    /* 每个QP的未完成WR数上限 */
+    uint32_t size;                     /* 消息大小 */
+    uint32_t iters;                    /* 每个QP的消息数 */
+};
+
+/*
+ * 一个执行通道的状态：单线程时只有一个通道覆盖所有QP，
+ * 启用工作线程（-T）时每个线程一个通道，只访问自己的QP和CQ。
+ * 按缓存行对齐，各线程的计数不落在同一缓存行上。
+ * recvs/posted只覆盖本通道的QP，下标为QP索引 - qp_first。
+ */
+struct bw_state {
+    uint64_t *recvs;                   /* 各QP累计收到的RECV数，由完成事件处理函数累加 */
+    uint32_t *posted;                  /* 各QP已投递的WR数（发送端为SEND/WRITE/READ，接收端为RECV） */
+    uint32_t qp_first;                 /* 通道的第一个QP */
+    uint32_t qp_count;                 /* 通道的QP数 */
+    struct ibv_cq *cq;                 /* 通道轮询的CQ */
+    uint64_t t_start;                  /* 通道开始投递的时间(纳秒) */
+    uint64_t t_end;                    /* 通道全部完成的时间，0表示本组合中没有QP */
+} __attribute__((aligned(64)));
+
+/**
+ * 执行通道数：工作线程数，未启用时为1
+ */
+static inline uint32_t bw_lane_count(const struct rdma_resources *res) {
+    return res->workers ? res->workers->count : 1;
+}
+
+/**
+ * 分配所有通道并按工作线程划分QP
+ *
+ * @return    bw_lane_count()个通道，失败返回NULL
+ */
+struct bw_state *bw_lanes_alloc(const struct rdma_resources *res);
+
+/**
+ * 释放bw_lanes_alloc()分配的通道，st可为NULL
+ */
+void bw_lanes_free(const struct rdma_resources *res, struct bw_state *st);
+
+/**
+ * 完成事件处理函数：检查状态并按QP累计RECV数
+ *
+ * @param[in] arg  QP所属通道的struct bw_state指针
+ */
+int bw_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                  const struct ibv_wc *wc, void *arg);
+
+/**
+ * 运行一个测试组合
+ *
+ * 发送端在前c->qps个QP上各投递c->iters条消息，保持最多c->depth个未完成WR；
+ * SEND模式下接收端预投递并持续补投RECV；WRITE/READ模式下对端CPU不参与，
+ * READ由客户端从服务端缓冲区拉取数据。开始和结束各做一次TCP同步。
+ *
+ * 启用工作线程时各通道在自己的线程上并行执行，耗时为最早开始到最晚结束。
+ *
+ * @param[in,out] ctx  基准测试上下文
+ * @param[in]     c    测试组合
+ * @param[out]    st   通道数组（bw_lane_count()个），计数在开始时清零
+ *
+ * @return    发送端返回耗时(纳秒)，接收端返回0，失败或超时返回-1
+ */
+int64_t bw_run(struct bench_ctx *ctx, const struct bw_conf *c, struct bw_state *st);
+
+#endif /* RDMA_BENCH_BW_H */
@@ -0,0 +1,298 @@
+/**
+ * @file rdma_bench_bw_run.c
+ * @brief 带宽基准测试的单组合执行：补满发送窗口、补投RECV、批量轮询
+ *
+ * 每个QP的未完成WR数由qp_ctx中的发送队列计数得到，
+ * 每次补窗口最多POST_BATCH_MAX个WR，一次门铃投递。
+ * 启用工作线程时每个线程在自己的QP和CQ上执行同一个循环。
+ */
+
+#include "rdma_bench_bw.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+#include "rdma_common_srq.h"
+
+int bw_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                  const struct ibv_wc *wc, void *arg) {
+    struct bw_state *st = arg;
+
+    (void)res;
+    if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: QP[%u]完成状态异常: %s\n",
+                qp_idx, ibv_wc_status_str(wc->status));
+        return -1;
+    }
+    if (wc->opcode & IBV_WC_RECV) {
+        st->recvs[qp_idx - st->qp_first]++;
+    }
+    return 0;
+}
+
+static uint32_t bw_outstanding(const struct rdma_resources *res, uint32_t qp) {
+    return res->qp_ctx[qp].sq_posted - res->qp_ctx[qp].sq_completed;
+}
+
+static enum ibv_wr_opcode bw_opcode(uint32_t op) {
+    if (op == BENCH_OP_SEND) {
+        return IBV_WR_SEND;
+    }
+    return op == BENCH_OP_READ ? IBV_WR_RDMA_READ : IBV_WR_RDMA_WRITE;
+}
+
+/* 给一个QP补满未完成WR，每个QP的最后一个WR强制signaled以便确认全部完成 */
+static int bw_fill_qp(struct bench_ctx *ctx, const struct bw_conf *c,
+                      struct bw_state *st, uint32_t qp) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_send_wr wrs[POST_BATCH_MAX];
+    struct ibv_sge sge;
+    uint32_t *posted = &st->posted[qp - st->qp_first];
+    uint32_t room = c->depth - bw_outstanding(res, qp);
+    uint32_t n = c->iters - *posted;
+    uint32_t i;
+    int rc;
+
+    if (n > room) {
+        n = room;
+    }
+    if (n > POST_BATCH_MAX) {
+        n = POST_BATCH_MAX;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    sge.addr = (uintptr_t)res->buf;
+    sge.length = c->size;
+    sge.lkey = res->mr->lkey;
+
+    memset(wrs, 0, sizeof(wrs[0]) * n);
+    for (i = 0; i < n; i++) {
+        wrs[i].wr_id = WR_ID_MAKE(qp, *posted + i);
+        wrs[i].opcode = bw_opcode(c->op);
+        wrs[i].sg_list = &sge;
+        wrs[i].num_sge = 1;
+        wrs[i].wr.rdma.remote_addr = res->qp_ctx[qp].remote_addr;
+        wrs[i].wr.rdma.rkey = res->qp_ctx[qp].remote_rkey;
+        if (*posted + i + 1 == c->iters) {
+            wrs[i].send_flags = IBV_SEND_SIGNALED;
+        }
+    }
+
+    rc = post_send_chain(res, qp, wrs, n, NULL);
+    if (rc == -EAGAIN) {
+        return 0;
+    }
+    if (rc) {
+        fprintf(stderr, "错误: QP[%u]投递失败: %s\n", qp, strerror(-rc));
+        return -1;
+    }
+    *posted += n;
+    return 0;
+}
+
+/*
+ * 给一个QP补投RECV，保证未完成RECV不超过depth且总数不超过iters；
+ * 使用SRQ时RECV由低水位事件统一补投，这里什么也不做
+ */
+static int bw_refill_recv(struct bench_ctx *ctx, const struct bw_conf *c,
+                          struct bw_state *st, uint32_t qp) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_recv_wr wrs[POST_BATCH_MAX];
+    struct ibv_sge sge;
+    uint32_t *posted = &st->posted[qp - st->qp_first];
+    uint32_t room = c->depth - (*posted - (uint32_t)st->recvs[qp - st->qp_first]);
+    uint32_t n = c->iters - *posted;
+    uint32_t i;
+
+    if (res->srq) {
+        return 0;
+    }
+    if (n > room) {
+        n = room;
+    }
+    if (n > POST_BATCH_MAX) {
+        n = POST_BATCH_MAX;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    sge.addr = (uintptr_t)res->buf;
+    sge.length = c->size;
+    sge.lkey = res->mr->lkey;
+
+    memset(wrs, 0, sizeof(wrs[0]) * n);
+    for (i = 0; i < n; i++) {
+        wrs[i].wr_id = WR_ID_MAKE(qp, *posted + i);
+        wrs[i].sg_list = &sge;
+        wrs[i].num_sge = 1;
+    }
+    if (post_recv_chain(res, qp, wrs, n, NULL)) {
+        fprintf(stderr, "错误: QP[%u]投递RECV失败\n", qp);
+        return -1;
+    }
+    *posted += n;
+    return 0;
+}
+
+/* 通道在本组合中使用的QP区间[first, end) */
+static uint32_t bw_lane_end(const struct bw_conf *c, const struct bw_state *st) {
+    uint32_t end = st->qp_first + st->qp_count;
+
+    return end < c->qps ? end : c->qps;
+}
+
+/* 在一个通道上跑完所有消息；双方都在poll_timeout_ms内没有任何进展时判定超时 */
+static int bw_lane(struct bench_ctx *ctx, const struct bw_conf *c, struct bw_state *st) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint32_t end = bw_lane_end(c, st);
+    int sender = !bench_is_server(ctx);
+    uint64_t deadline;
+    int busy;
+    int n;
+    uint32_t q;
+
+    if (st->qp_first >= end) {
+        return 0;
+    }
+    st->t_start = monotonic_ns();
+    deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    do {
+        busy = 0;
+        for (q = st->qp_first; q < end; q++) {
+            if (sender) {
+                if (bw_fill_qp(ctx, c, st, q)) {
+                    return -1;
+                }
+                busy |= st->posted[q - st->qp_first] < c->iters ||
+                        bw_outstanding(res, q) > 0;
+            } else {
+                if (bw_refill_recv(ctx, c, st, q)) {
+                    return -1;
+                }
+                busy |= st->recvs[q - st->qp_first] < c->iters;
+            }
+        }
+
+        n = poll_cq_batch_on(res, st->cq, wc, POLL_BATCH_SIZE);
+        if (n < 0) {
+            return -1;
+        }
+        if (n > 0) {
+            deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+        } else if (res->srq && srq_poll_events(res) < 0) {
+            return -1;
+        } else if (busy && monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 组合(qps=%u depth=%u size=%u)超时\n",
+                    c->qps, c->depth, c->size);
+            return -1;
+        }
+    } while (busy);
+
+    st->t_end = monotonic_ns();
+    return 0;
+}
+
+/* 工作线程的一次组合 */
+struct bw_task {
+    struct bench_ctx *ctx;
+    const struct bw_conf *c;
+    struct bw_state *st;
+};
+
+static int bw_worker(struct rdma_resources *res, struct rdma_worker *w, void *arg) {
+    struct bw_task *t = arg;
+
+    (void)res;
+    return bw_lane(t->ctx, t->c, &t->st[w->id]);
+}
+
+struct bw_state *bw_lanes_alloc(const struct rdma_resources *res) {
+    struct bw_state *st;
+    uint32_t l;
+
+    if (posix_memalign((void **)&st, 64, sizeof(*st) * bw_lane_count(res))) {
+        return NULL;
+    }
+    memset(st, 0, sizeof(*st) * bw_lane_count(res));
+    for (l = 0; l < bw_lane_count(res); l++) {
+        if (res->workers) {
+            st[l].qp_first = res->workers->workers[l].qp_first;
+            st[l].qp_count = res->workers->workers[l].qp_count;
+            st[l].cq = res->workers->workers[l].cq;
+        } else {
+            st[l].qp_count = res->num_qp;
+            st[l].cq = res->cq;
+        }
+        st[l].recvs = calloc(st[l].qp_count, sizeof(st[l].recvs[0]));
+        st[l].posted = calloc(st[l].qp_count, sizeof(st[l].posted[0]));
+        if (!st[l].recvs || !st[l].posted) {
+            bw_lanes_free(res, st);
+            return NULL;
+        }
+    }
+    return st;
+}
+
+void bw_lanes_free(const struct rdma_resources *res, struct bw_state *st) {
+    uint32_t l;
+
+    for (l = 0; st && l < bw_lane_count(res); l++) {
+        free(st[l].recvs);
+        free(st[l].posted);
+    }
+    free(st);
+}
+
+/* 清零各通道的计数 */
+static void bw_lanes_reset(struct rdma_resources *res, struct bw_state *st) {
+    uint32_t l;
+
+    for (l = 0; l < bw_lane_count(res); l++) {
+        memset(st[l].recvs, 0, st[l].qp_count * sizeof(st[l].recvs[0]));
+        memset(st[l].posted, 0, st[l].qp_count * sizeof(st[l].posted[0]));
+        st[l].t_start = 0;
+        st[l].t_end = 0;
+    }
+}
+
+int64_t bw_run(struct bench_ctx *ctx, const struct bw_conf *c, struct bw_state *st) {
+    struct rdma_resources *res = &ctx->res;
+    struct bw_task task = { ctx, c, st };
+    int sender = !bench_is_server(ctx);
+    uint64_t t0 = UINT64_MAX;
+    uint64_t t1 = 0;
+    uint32_t l;
+    uint32_t q;
+
+    bw_lanes_reset(res, st);
+    for (l = 0; !sender && c->op == BENCH_OP_SEND && l < bw_lane_count(res); l++) {
+        for (q = st[l].qp_first; q < bw_lane_end(c, &st[l]); q++) {
+            if (bw_refill_recv(ctx, c, &st[l], q)) {
+                return -1;
+            }
+        }
+    }
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+    if (!sender && c->op != BENCH_OP_SEND) {
+        return bench_sync(ctx) ? -1 : 0;
+    }
+
+    if (res->workers ? worker_run(res, bw_worker, &task) : bw_lane(ctx, c, st)) {
+        return -1;
+    }
+    for (l = 0; l < bw_lane_count(res); l++) {
+        if (st[l].t_end) {
+            t0 = st[l].t_start < t0 ? st[l].t_start : t0;
+            t1 = st[l].t_end > t1 ? st[l].t_end : t1;
+        }
+    }
+
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+    return sender ? (int64_t)(t1 - t0) : 0;
+}
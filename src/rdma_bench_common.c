@@ -0,0 +1,195 @@
+/**
+ * @file rdma_bench_common.c
+ * @brief 基准测试公共框架实现：TCP建链、QP信息交换
+ *
+ * 建链流程与rdma_server.c/rdma_client.c相同，只是去掉了逐步打印。
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_common_srq.h"
+#include "rdma_common_worker.h"
+#include "rdma_common_bringup.h"
+#include "rdma_common_cm.h"
+#include "rdma_common_async.h"
+
+/* 打印并行建链的耗时统计 */
+static void bench_print_bringup(const struct qp_bringup_stats *st, uint32_t num_qp) {
+    static const char *names[QP_STEP_COUNT] = {"创建QP", "RESET->INIT", "INIT->RTR", "RTR->RTS"};
+    uint64_t sum = 0;
+    int s;
+
+    printf("建链耗时: %.2f ms (%u个线程)\n", st->total_ns / 1e6, st->threads);
+    printf("  - 本端全部到INIT并发出连接信息: %.2f ms\n", st->local_done_ns / 1e6);
+    printf("  - 收齐对端连接信息: %.2f ms\n", st->remote_done_ns / 1e6);
+    for (s = 0; s < QP_STEP_COUNT; s++) {
+        sum += st->step_ns[s];
+        printf("  - %-12s 累计%8.2f ms, 平均每QP %7.1f us\n", names[s],
+               st->step_ns[s] / 1e6, num_qp ? st->step_ns[s] / 1e3 / num_qp : 0.0);
+    }
+    if (st->total_ns) {
+        printf("  - 并行度: %.1f (各步骤累计耗时 / 总耗时)\n", (double)sum / st->total_ns);
+    }
+}
+
+/* 服务端监听并接受一个连接，客户端主动连接，返回已连接的socket */
+static int bench_tcp_connect(const struct bench_opts *opts) {
+    struct sockaddr_in sin;
+    int optval = 1;
+    int listen_sock;
+    int sock;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(opts->port);
+
+    if (opts->server_ip) {
+        if (inet_pton(AF_INET, opts->server_ip, &sin.sin_addr) <= 0) {
+            fprintf(stderr, "错误: 无效的服务端IP: %s\n", opts->server_ip);
+            return -1;
+        }
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0 || connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+            fprintf(stderr, "错误: 连接服务端失败: %s\n", strerror(errno));
+            if (sock >= 0) {
+                close(sock);
+            }
+            return -1;
+        }
+        return sock;
+    }
+
+    listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_sock < 0) {
+        fprintf(stderr, "错误: 创建socket失败\n");
+        return -1;
+    }
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    sin.sin_addr.s_addr = INADDR_ANY;
+    if (bind(listen_sock, (struct sockaddr *)&sin, sizeof(sin)) < 0 ||
+        listen(listen_sock, 1) < 0) {
+        fprintf(stderr, "错误: 监听端口%d失败: %s\n", opts->port, strerror(errno));
+        close(listen_sock);
+        return -1;
+    }
+
+    printf("等待客户端连接 (端口: %d)...\n", opts->port);
+    sock = accept(listen_sock, NULL, NULL);
+    close(listen_sock);
+    if (sock < 0) {
+        fprintf(stderr, "错误: 接受连接失败\n");
+        return -1;
+    }
+    return sock;
+}
+
+/* 交换所有QP的连接信息并把QP转到RTS */
+static int bench_connect_qps(struct bench_ctx *ctx) {
+    struct rdma_resources *res = &ctx->res;
+    struct cm_con_data_t *local = malloc(res->num_qp * sizeof(*local));
+    struct cm_con_data_t *remote = NULL;
+    uint32_t remote_num_qp = 0;
+    int rc = -1;
+
+    if (!local || fill_local_con_data(res, local) ||
+        sock_exchange_con_data(ctx->sock, local, res->num_qp, &remote, &remote_num_qp)) {
+        goto out;
+    }
+    if (remote_num_qp != res->num_qp) {
+        fprintf(stderr, "错误: 远端QP数量(%u)与本端(%u)不一致\n",
+                remote_num_qp, res->num_qp);
+        goto out;
+    }
+    if (modify_qp_list_to_rtr(res, remote) == 0 && modify_qp_list_to_rts(res) == 0) {
+        rc = 0;
+    }
+out:
+    free(local);
+    free(remote);
+    return rc;
+}
+
+int bench_setup(struct bench_ctx *ctx, uint32_t buf_size) {
+    struct qp_bringup_stats st;
+    struct rdma_config cfg;
+
+    memset(&ctx->res, 0, sizeof(ctx->res));
+    memset(&ctx->cm, 0, sizeof(ctx->cm));
+    ctx->sock = -1;
+
+    rdma_config_init(&cfg);
+    cfg.dev_name = ctx->opts.dev_name;
+    cfg.ib_port = ctx->opts.ib_port;
+    cfg.gid_idx = ctx->opts.gid_idx;
+    cfg.num_qp = ctx->opts.num_qp;
+    cfg.buf_size = buf_size + srq_region_size(ctx->opts.srq_depth, ctx->opts.max_size);
+    cfg.rd_atomic = ctx->opts.rd_atomic;
+    cfg.buf_page = ctx->opts.buf_page;
+
+    if (init_rdma_resources_cfg(&ctx->res, &cfg)) {
+        return -1;
+    }
+    if (ctx->opts.srq_depth &&
+        srq_init(&ctx->res, buf_size, ctx->opts.srq_depth, ctx->opts.max_size)) {
+        return -1;
+    }
+    ctx->res.sq_depth = ctx->opts.depth;
+    ctx->res.rq_depth = ctx->opts.depth;
+    if (ctx->opts.threads && worker_init(&ctx->res, ctx->opts.threads, ctx->opts.cpus)) {
+        return -1;
+    }
+    /* 串行建链先在本地把QP准备到INIT，并行建链在连上对端后一边创建一边交换 */
+    if (!ctx->opts.bringup && (create_qp_list(&ctx->res) || modify_qp_list_to_init(&ctx->res))) {
+        return -1;
+    }
+
+    /* rdma_cm先于TCP监听，客户端连上TCP时服务端一定已在等待连接请求 */
+    if (ctx->opts.conn_mode == BENCH_CONN_CM && bench_is_server(ctx) &&
+        cm_link_listen(&ctx->cm, ctx->opts.port + 1)) {
+        return -1;
+    }
+    ctx->sock = bench_tcp_connect(&ctx->opts);
+    if (ctx->sock < 0) {
+        return -1;
+    }
+
+    if (ctx->opts.conn_mode == BENCH_CONN_CM) {
+        if (bench_is_server(ctx) ? cm_link_accept(&ctx->cm, &ctx->res)
+                                 : cm_link_connect(&ctx->cm, &ctx->res, ctx->opts.server_ip,
+                                                   ctx->opts.port + 1)) {
+            return -1;
+        }
+    } else if (ctx->opts.bringup) {
+        if (qp_bringup(&ctx->res, ctx->sock, ctx->opts.bringup, &st)) {
+            return -1;
+        }
+        bench_print_bringup(&st, ctx->res.num_qp);
+    } else if (bench_connect_qps(ctx)) {
+        return -1;
+    }
+    /* QP全部就绪后再监视，故障事件让等待中的轮询立即返回而不是等到超时 */
+    if (async_monitor_start(&ctx->res, NULL, NULL)) {
+        return -1;
+    }
+    return bench_sync(ctx);
+}
+
+int bench_sync(struct bench_ctx *ctx) {
+    char out = 'S';
+    char in;
+
+    if (write(ctx->sock, &out, 1) != 1 || recv(ctx->sock, &in, 1, MSG_WAITALL) != 1) {
+        fprintf(stderr, "错误: TCP同步失败\n");
+        return -1;
+    }
+    return 0;
+}
+
+void bench_teardown(struct bench_ctx *ctx) {
+    if (ctx->sock >= 0) {
+        close(ctx->sock);
+        ctx->sock = -1;
+    }
+    /* cm_id要在QP所在的资源释放前销毁 */
+    cm_link_destroy(&ctx->cm);
+    cleanup_rdma_resources(&ctx->res);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file rdma_bench_common.h
+ * @brief 基准测试公共框架 - 参数解析、连接建立、TCP屏障、计时
+ *
+ * 所有rdma_bench_*程序共用同一套命令行参数和建链流程：
+ * 1. 按参数初始化RDMA资源（缓冲区大小由具体测试决定）
+ * 2. 创建QP并转到INIT
+ * 3. 服务端监听/客户端连接TCP，交换QP信息（含单边访问用的addr/rkey/len）
+ * 4. QP转到RTR、RTS
+ *
+ * -m cm时第3、4步的QP建链改用rdma_cm（见rdma_common_cm.h），TCP连接只用于同步。
+ * 不带服务端IP参数运行即为服务端，带IP参数运行即为客户端。
+ *
+ * @see rdma_bench_common.c, rdma_bench_opts.c
+ */
+
+#ifndef RDMA_BENCH_COMMON_H
+#define RDMA_BENCH_COMMON_H
+
+#include "rdma_common.h"
+#include "rdma_common_cm.h"
+#include "rdma_common_poll.h"
+
+#define BENCH_OP_SEND         0x1          /* SEND/RECV */
+#define BENCH_OP_WRITE        0x2          /* RDMA WRITE */
+#define BENCH_OP_READ         0x4          /* RDMA READ，只有带宽测试支持 */
+#define BENCH_OP_ALL          (BENCH_OP_SEND | BENCH_OP_WRITE | BENCH_OP_READ)
+
+#define BENCH_SWEEP_SIZE      0x1          /* 扫描消息大小 */
+#define BENCH_SWEEP_QP        0x2          /* 扫描QP数量 */
+#define BENCH_SWEEP_DEPTH     0x4          /* 扫描队列深度 */
+#define BENCH_SWEEP_ALL       (BENCH_SWEEP_SIZE | BENCH_SWEEP_QP | BENCH_SWEEP_DEPTH)
+
+#define BENCH_DEFAULT_ITERS   10000        /* 默认每个消息大小的测量次数 */
+#define BENCH_DEFAULT_WARMUP  100          /* 默认预热次数，不计入统计 */
+#define BENCH_DEFAULT_MIN     2            /* 默认最小消息大小(字节) */
+#define BENCH_DEFAULT_MAX     4096         /* 默认最大消息大小(字节) */
+
+/**
+ * QP建链方式
+ */
+enum bench_conn_mode {
+    BENCH_CONN_TCP = 0,                /* TCP交换连接信息，手工填写路径参数 */
+    BENCH_CONN_CM                      /* rdma_cm解析路径并交换连接信息 */
+};
+
+/**
+ * 基准测试命令行参数
+ */
+struct bench_opts {
+    const char *server_ip;             /* 服务端IP，NULL表示本端是服务端 */
+    const char *dev_name;              /* RDMA设备名，NULL表示第一个设备 */
+    int port;                          /* TCP端口 */
+    int gid_idx;                       /* GID索引 */
+    uint8_t ib_port;                   /* IB端口号 */
+    uint32_t num_qp;                   /* QP数量 */
+    uint32_t iters;                    /* 每个消息大小的测量次数 */
+    uint32_t warmup;                   /* 预热次数 */
+    uint32_t min_size;                 /* 最小消息大小 */
+    uint32_t max_size;                 /* 最大消息大小 */
+    uint32_t ops;                      /* 测试的操作，BENCH_OP_*的组合 */
+    uint32_t depth;                    /* 每个QP的发送/接收队列深度 */
+    uint32_t sweep;                    /* 扫描的维度，BENCH_SWEEP_*的组合 */
+    const char *json_path;             /* JSON结果输出文件，NULL表示不输出 */
+    uint32_t rd_atomic;                /* 每个QP的READ/原子深度，按设备上限裁剪 */
+    uint32_t srq_depth;                /* 共享接收队列深度，0表示每个QP独立接收 */
+    enum buf_page_mode buf_page;       /* 数据缓冲区页大小 */
+    uint32_t threads;                  /* 工作线程数，0表示单线程共享一个CQ */
+    const char *cpus;                  /* 工作线程绑定的CPU列表或"numa"，NULL表示不绑定 */
+    uint32_t bringup;                  /* 并行建链线程数，0表示串行建链 */
+    enum bench_conn_mode conn_mode;    /* QP建链方式 */
+};
+
+/**
+ * 基准测试运行上下文
+ */
+struct bench_ctx {
+    struct rdma_resources res;         /* RDMA资源 */
+    struct bench_opts opts;            /* 命令行参数 */
+    int sock;                          /* 与对端的TCP连接，-1表示未连接 */
+    struct cm_link cm;                 /* conn_mode为BENCH_CONN_CM时的rdma_cm连接 */
+};
+
+/**
+ * 判断本端是否为服务端
+ */
+static inline int bench_is_server(const struct bench_ctx *ctx) {
+    return ctx->opts.server_ip == NULL;
+}
+
+/**
+ * 用默认值填充参数
+ *
+ * @param[out] opts  参数结构体指针，必须非NULL
+ */
+void bench_opts_init(struct bench_opts *opts);
+
+/**
+ * 解析公共命令行参数
+ *
+ * 支持的选项：-d 设备 -p TCP端口 -g GID索引 -i IB端口 -q QP数量
+ * -n 迭代次数 -w 预热次数 -s 最小大小 -S 最大大小 -t send|write|read|all
+ * -D 队列深度 -x 扫描维度(size,qp,depth,all) -j JSON输出文件 -R READ深度
+ * -r SRQ深度 -H 缓冲区页大小(4k,2m,1g,auto) -T 工作线程数 -C 绑定的CPU列表或numa
+ * -B 并行建链线程数 -m 建链方式(tcp,cm)，最后一个非选项参数为服务端IP。
+ *
+ * @param[in,out] opts  参数结构体，调用前应先bench_opts_init()
+ * @param[in]     argc  参数个数
+ * @param[in]     argv  参数数组
+ *
+ * @return    成功返回0，参数错误返回-1
+ */
+int bench_parse_args(struct bench_opts *opts, int argc, char *argv[]);
+
+/**
+ * 打印公共参数用法
+ *
+ * @param[in] prog  程序名
+ */
+void bench_usage(const char *prog);
+
+/**
+ * 建立基准测试连接
+ *
+ * @param[in,out] ctx       上下文，opts必须已填充
+ * @param[in]     buf_size  数据缓冲区大小
+ *
+ * @return    成功返回0，失败返回-1（已建立的资源由bench_teardown()释放）
+ *
+ * @post      所有QP处于RTS状态，res.qp_ctx[i].remote_*保存对端缓冲区信息
+ * @note      QP的发送/接收队列深度取opts.depth，READ深度取opts.rd_atomic
+ * @note      opts.srq_depth非0时在buf_size之后追加SRQ缓冲区（每个opts.max_size字节），
+ *            所有QP共享一个SRQ，见rdma_common_srq.h
+ * @note      opts.threads非0时创建QP前调用worker_init()，每个线程一个CQ，
+ *            见rdma_common_worker.h
+ * @note      opts.bringup非0时连上对端后用qp_bringup()并行建链并打印各阶段耗时，
+ *            见rdma_common_bringup.h
+ * @note      opts.conn_mode为BENCH_CONN_CM时服务端在TCP端口+1上监听rdma_cm，
+ *            客户端连上TCP后逐个QP发起rdma_cm连接
+ */
+int bench_setup(struct bench_ctx *ctx, uint32_t buf_size);
+
+/**
+ * TCP屏障：双方各发送一个字节并等待对端的字节
+ *
+ * @param[in] ctx  上下文，必须已连接
+ * @return    成功返回0，失败返回-1
+ */
+int bench_sync(struct bench_ctx *ctx);
+
+/**
+ * 释放基准测试的所有资源
+ *
+ * @param[in,out] ctx  上下文
+ */
+void bench_teardown(struct bench_ctx *ctx);
+
+#endif /* RDMA_BENCH_COMMON_H */
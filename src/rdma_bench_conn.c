@@ -0,0 +1,233 @@
+/**
+ * @file rdma_bench_conn.c
+ * @brief 建链速率基准测试：比较TCP交换和rdma_cm两种QP建链方式的每秒连接数
+ *
+ * 先按-m指定的方式建立一次控制连接（TCP socket用于同步），然后对每种建链方式
+ * 重复-n次（另有-w次预热）：
+ * 1. 双方把-q个QP复位到INIT（RESET -> INIT）并TCP同步
+ * 2. 建立一条新连接并把所有QP迁移到RTS：
+ *    - tcp: 新建TCP连接，交换num_qp+连接信息，手工填写路径参数迁移QP，
+ *           服务端发就绪字节后双方关闭socket
+ *    - cm:  每个QP一次rdma_resolve_addr/rdma_resolve_route/rdma_connect，
+ *           双方rdma_disconnect并等待断开事件
+ *
+ * cm_link_connect()逐个QP串行建链，cm方式测到的是串行往返的速率，
+ * 不代表同时发出所有连接请求的流水线速率。
+ *
+ * 计时包括QP复位、每次的TCP同步和断开，两种方式的固定开销相同。
+ * 未用make RDMACM=1编译时只测试tcp方式。
+ *
+ * 用法: 服务端 rdma_bench_conn -d rxe0 [-q 4] [-n 200]
+ *       客户端 rdma_bench_conn -d rxe0 [-q 4] [-n 200] 服务端IP
+ * 被测连接使用TCP端口+2和rdma_cm端口+3。
+ *
+ * @see rdma_common_cm.h, rdma_bench_common.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_common_bringup.h"
+
+#define CONN_DEFAULT_ITERS    200
+#define CONN_DEFAULT_WARMUP   10
+#define CONN_TCP_PORT_OFFSET  2
+#define CONN_CM_PORT_OFFSET   3
+
+/* 把所有QP复位并重新迁移到INIT，供下一次建链使用 */
+static int conn_reset_qps(struct rdma_resources *res) {
+    struct ibv_qp_attr attr;
+    uint32_t i;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_RESET;
+    for (i = 0; i < res->num_qp; i++) {
+        if (ibv_modify_qp(res->qp_list[i], &attr, IBV_QP_STATE) || qp_modify_init(res, i)) {
+            fprintf(stderr, "错误: 复位QP[%u]失败\n", i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 服务端每次accept一条连接，客户端每次新建一条连接 */
+static int conn_tcp_open(struct bench_ctx *ctx, int listen_sock) {
+    struct sockaddr_in sin;
+    int sock;
+
+    if (bench_is_server(ctx)) {
+        return accept(listen_sock, NULL, NULL);
+    }
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(ctx->opts.port + CONN_TCP_PORT_OFFSET);
+    inet_pton(AF_INET, ctx->opts.server_ip, &sin.sin_addr);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock >= 0 && connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* TCP方式建立一次连接：交换连接信息、迁移QP、就绪字节确认对端已RTR */
+static int conn_tcp_once(struct bench_ctx *ctx, int listen_sock, struct cm_con_data_t *local) {
+    struct rdma_resources *res = &ctx->res;
+    struct cm_con_data_t *remote = NULL;
+    uint32_t remote_num = 0;
+    uint32_t i;
+    char ready = 'R';
+    int sock = conn_tcp_open(ctx, listen_sock);
+    int rc = -1;
+
+    if (sock < 0 || fill_local_con_data(res, local) ||
+        sock_exchange_con_data(sock, local, res->num_qp, &remote, &remote_num) ||
+        remote_num != res->num_qp) {
+        goto out;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        if (qp_modify_rtr(res, i, &remote[i]) || qp_modify_rts(res, i)) {
+            goto out;
+        }
+    }
+    if (bench_is_server(ctx) ? sock_write_full(sock, &ready, 1) : sock_read_full(sock, &ready, 1)) {
+        goto out;
+    }
+    rc = 0;
+out:
+    free(remote);
+    if (sock >= 0) {
+        close(sock);
+    }
+    return rc;
+}
+
+/* rdma_cm方式建立一次连接并断开；客户端每次新建事件通道，服务端复用监听 */
+static int conn_cm_once(struct bench_ctx *ctx, struct cm_link *l) {
+    int rc;
+
+    if (bench_is_server(ctx)) {
+        rc = cm_link_accept(l, &ctx->res);
+        return cm_link_close(l, &ctx->res) || rc ? -1 : 0;
+    }
+    rc = cm_link_connect(l, &ctx->res, ctx->opts.server_ip,
+                         ctx->opts.port + CONN_CM_PORT_OFFSET);
+    if (rc == 0) {
+        rc = cm_link_close(l, &ctx->res);
+    }
+    cm_link_destroy(l);
+    return rc;
+}
+
+/* 服务端准备被测方式的监听 */
+static int conn_listen(struct bench_ctx *ctx, enum bench_conn_mode mode, struct cm_link *l) {
+    struct sockaddr_in sin;
+    int optval = 1;
+    int sock;
+
+    if (!bench_is_server(ctx)) {
+        return 0;
+    }
+    if (mode == BENCH_CONN_CM) {
+        return cm_link_listen(l, ctx->opts.port + CONN_CM_PORT_OFFSET);
+    }
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = INADDR_ANY;
+    sin.sin_port = htons(ctx->opts.port + CONN_TCP_PORT_OFFSET);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    if (bind(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0 || listen(sock, SOMAXCONN) < 0) {
+        fprintf(stderr, "错误: 监听端口%d失败: %s\n", ntohs(sin.sin_port), strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static int conn_run_mode(struct bench_ctx *ctx, enum bench_conn_mode mode,
+                         struct cm_con_data_t *local) {
+    uint32_t total = ctx->opts.warmup + ctx->opts.iters;
+    uint64_t t0 = 0;
+    uint64_t ns;
+    struct cm_link l;
+    uint32_t it;
+    int listen_sock;
+    int rc = 0;
+
+    memset(&l, 0, sizeof(l));
+    listen_sock = conn_listen(ctx, mode, &l);
+    if (listen_sock < 0) {
+        cm_link_destroy(&l);
+        return -1;
+    }
+    for (it = 0; it < total && rc == 0; it++) {
+        if (it == ctx->opts.warmup) {
+            t0 = monotonic_ns();
+        }
+        /* 同步保证服务端已复位QP并在等待，上一条连接的断开事件也已处理完 */
+        rc = conn_reset_qps(&ctx->res) || bench_sync(ctx);
+        if (rc == 0) {
+            rc = mode == BENCH_CONN_CM ? conn_cm_once(ctx, &l)
+                                       : conn_tcp_once(ctx, listen_sock, local);
+        }
+    }
+    ns = monotonic_ns() - t0;
+    if (listen_sock > 0) {
+        close(listen_sock);
+    }
+    cm_link_destroy(&l);
+    if (rc) {
+        fprintf(stderr, "错误: 第%u次%s建链失败\n", it, mode == BENCH_CONN_CM ? "cm" : "tcp");
+        return -1;
+    }
+    printf("%6s %8u %6u %12.1f %12.1f %12.1f\n", mode == BENCH_CONN_CM ? "cm" : "tcp",
+           ctx->opts.iters, ctx->res.num_qp, (double)ctx->opts.iters * 1e9 / (double)ns,
+           (double)ctx->opts.iters * ctx->res.num_qp * 1e9 / (double)ns,
+           (double)ns / 1000.0 / ctx->opts.iters);
+    return bench_sync(ctx);
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct cm_con_data_t *local = NULL;
+    int rc = 1;
+
+    bench_opts_init(&ctx.opts);
+    ctx.opts.iters = CONN_DEFAULT_ITERS;
+    ctx.opts.warmup = CONN_DEFAULT_WARMUP;
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        fprintf(stderr, "  (建链测试默认: -n %d -w %d，-q为每条连接的QP数)\n",
+                CONN_DEFAULT_ITERS, CONN_DEFAULT_WARMUP);
+        return 1;
+    }
+    if (bench_setup(&ctx, DEFAULT_MSG_SIZE)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    local = malloc(ctx.res.num_qp * sizeof(*local));
+    if (!local) {
+        goto out;
+    }
+
+    printf("\n%s: 每条连接%u个QP，%u次预热，%u次测量\n", bench_is_server(&ctx) ? "被动端" : "主动端",
+           ctx.res.num_qp, ctx.opts.warmup, ctx.opts.iters);
+    printf("%6s %8s %6s %12s %12s %12s\n", "mode", "#conns", "#qp", "conn/s", "qp/s", "us/conn");
+    if (conn_run_mode(&ctx, BENCH_CONN_TCP, local)) {
+        goto out;
+    }
+    if (cm_supported() && conn_run_mode(&ctx, BENCH_CONN_CM, local)) {
+        goto out;
+    }
+    if (!cm_supported()) {
+        printf("%6s 未编译rdma_cm支持（make RDMACM=1），跳过\n", "cm");
+    }
+    rc = 0;
+
+out:
+    free(local);
+    bench_teardown(&ctx);
+    return rc;
+}
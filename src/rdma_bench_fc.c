@@ -0,0 +1,186 @@
+/**
+ * @file rdma_bench_fc.c
+ * @brief credit流控基准测试：多QP突发SEND，验证稳态下没有RNR
+ *
+ * 双方用rdma_common_fc建立流控通道（每个QP预投递-D个RECV）。
+ * 对每个消息大小，客户端在所有QP上轮流突发发送，每个QP共-n条，
+ * credit不足时跳到下一个QP并轮询CQ等待对端捎带或纯credit消息；
+ * 服务端只轮询CQ，收到的消息在回调里计数后立即补投。
+ *
+ * 输出消息速率、发送端因credit不足等待的次数和双方的纯credit消息数。
+ * 发生RNR时发送完成状态为IBV_WC_RNR_RETRY_EXC_ERR，测试直接失败。
+ *
+ * @see rdma_common_fc.h, rdma_bench_common.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_common_fc.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+
+/* 所有QP的累计值 */
+struct fc_totals {
+    uint64_t sent;
+    uint64_t received;
+    uint64_t stalls;
+    uint64_t credit_msgs;
+};
+
+static void fc_sum(const struct fc_channel *ch, uint32_t num_qp, struct fc_totals *t) {
+    uint32_t i;
+
+    memset(t, 0, sizeof(*t));
+    for (i = 0; i < num_qp; i++) {
+        t->sent += ch->qp[i].sent;
+        t->received += ch->qp[i].received;
+        t->stalls += ch->qp[i].stalls;
+        t->credit_msgs += ch->qp[i].credit_msgs;
+    }
+}
+
+/* 客户端：所有QP各发iters条，credit不足的QP本轮跳过 */
+static int fc_client_burst(struct bench_ctx *ctx, struct fc_channel *ch,
+                           uint32_t src_off, uint32_t size) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint64_t target = ch->qp[0].sent + ctx->opts.iters;
+    uint64_t deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    uint32_t busy;
+    uint32_t i;
+    int rc;
+
+    do {
+        busy = 0;
+        for (i = 0; i < res->num_qp; i++) {
+            if (ch->qp[i].sent >= target) {
+                continue;
+            }
+            busy++;
+            rc = fc_send(ch, i, src_off, size);
+            if (rc && rc != -EAGAIN) {
+                fprintf(stderr, "错误: QP[%u]发送失败: %s\n", i, strerror(-rc));
+                return -1;
+            }
+        }
+        rc = poll_cq_batch(res, wc, POLL_BATCH_SIZE);
+        if (rc < 0) {
+            return -1;
+        }
+        if (rc > 0) {
+            deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+        } else if (monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 等待credit超时\n");
+            return -1;
+        }
+    } while (busy);
+    return 0;
+}
+
+/* 服务端：轮询直到每个QP都收到iters条 */
+static int fc_server_drain(struct bench_ctx *ctx, struct fc_channel *ch, uint64_t target) {
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    struct fc_totals t;
+    uint64_t deadline = monotonic_coarse_ms() + ctx->res.poll_timeout_ms;
+    int n;
+
+    for (fc_sum(ch, ctx->res.num_qp, &t); t.received < target;
+         fc_sum(ch, ctx->res.num_qp, &t)) {
+        n = poll_cq_batch(&ctx->res, wc, POLL_BATCH_SIZE);
+        if (n < 0) {
+            return -1;
+        }
+        if (n > 0) {
+            deadline = monotonic_coarse_ms() + ctx->res.poll_timeout_ms;
+        } else if (monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 接收超时 (%llu/%llu)\n",
+                    (unsigned long long)t.received, (unsigned long long)target);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int fc_run_size(struct bench_ctx *ctx, struct fc_channel *ch,
+                       uint32_t src_off, uint32_t size) {
+    struct fc_totals before;
+    struct fc_totals after;
+    uint64_t t0;
+    uint64_t ns;
+    uint64_t msgs = (uint64_t)ctx->opts.iters * ctx->res.num_qp;
+
+    fc_sum(ch, ctx->res.num_qp, &before);
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+    t0 = monotonic_ns();
+    if (bench_is_server(ctx) ? fc_server_drain(ctx, ch, before.received + msgs)
+                             : fc_client_burst(ctx, ch, src_off, size)) {
+        return -1;
+    }
+    ns = monotonic_ns() - t0;
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+
+    fc_sum(ch, ctx->res.num_qp, &after);
+    printf("%10u %10llu %10.3f %10.2f %10llu %12llu\n", size, (unsigned long long)msgs,
+           (double)msgs * 1000.0 / (double)ns, (double)msgs * size * 8.0 / (double)ns,
+           (unsigned long long)(after.stalls - before.stalls),
+           (unsigned long long)(after.credit_msgs - before.credit_msgs));
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct fc_channel *ch;
+    uint32_t region;
+    uint32_t size;
+    int rc = 1;
+
+    bench_opts_init(&ctx.opts);
+    ctx.opts.num_qp = DEFAULT_NUM_QP;
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        fprintf(stderr, "  (流控测试默认: -q %d，-D为每个QP的RECV数即初始credit)\n",
+                DEFAULT_NUM_QP);
+        return 1;
+    }
+    if (ctx.opts.depth <= FC_RESERVED_CREDITS) {
+        fprintf(stderr, "错误: 队列深度必须大于%d\n", FC_RESERVED_CREDITS);
+        return 1;
+    }
+    ch = calloc(1, sizeof(*ch));
+    if (!ch) {
+        fprintf(stderr, "错误: 分配流控通道失败\n");
+        return 1;
+    }
+    region = fc_region_size(ctx.opts.num_qp, ctx.opts.depth, ctx.opts.max_size);
+    if (bench_setup(&ctx, region + ctx.opts.max_size)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    if (set_signal_interval(&ctx.res, ctx.res.sq_depth / 2 ? ctx.res.sq_depth / 2 : 1) ||
+        fc_channel_init(ch, &ctx.res, 0, ctx.opts.depth, ctx.opts.max_size)) {
+        goto out;
+    }
+
+    printf("\n%s: %u个QP，每个QP %u个credit\n", bench_is_server(&ctx) ? "接收端" : "发送端",
+           ctx.res.num_qp, ctx.opts.depth);
+    printf("%10s %10s %10s %10s %10s %12s\n", "#bytes", "#msgs", "Mmsg/s", "Gb/s",
+           "stalls", "credit_msgs");
+    for (size = ctx.opts.min_size; size <= ctx.opts.max_size; size *= 2) {
+        if (fc_run_size(&ctx, ch, region, size)) {
+            goto out;
+        }
+        if (size > ctx.opts.max_size / 2) {
+            break;
+        }
+    }
+    rc = 0;
+
+out:
+    bench_teardown(&ctx);
+    fc_channel_destroy(ch);
+    free(ch);
+    return rc;
+}
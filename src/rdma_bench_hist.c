@@ -0,0 +1,119 @@
+/**
+ * @file rdma_bench_hist.c
+ * @brief 对数分桶延迟直方图实现
+ *
+ * 记录只做一次前导零计数和移位，不做除法和浮点运算，
+ * 可以在每次迭代之间直接调用而不明显影响测量结果。
+ */
+
+#include "rdma_bench_hist.h"
+
+#include <string.h>
+
+void hist_reset(struct bench_hist *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+uint32_t hist_bucket_index(uint64_t v) {
+    uint32_t e;
+    uint32_t sub;
+
+    if (v < HIST_EXACT) {
+        return (uint32_t)v;
+    }
+
+    /* e为最高有效位，v >> (e - SUB_BITS) 落在[SUB_COUNT, 2*SUB_COUNT) */
+    e = 63 - (uint32_t)__builtin_clzll(v);
+    sub = (uint32_t)(v >> (e - HIST_SUB_BITS)) - HIST_SUB_COUNT;
+    return HIST_EXACT + (e - HIST_SUB_BITS - 1) * HIST_SUB_COUNT + sub;
+}
+
+uint64_t hist_bucket_lower(uint32_t idx) {
+    uint32_t e;
+    uint32_t sub;
+
+    if (idx < HIST_EXACT) {
+        return idx;
+    }
+
+    e = (idx - HIST_EXACT) / HIST_SUB_COUNT + HIST_SUB_BITS + 1;
+    sub = (idx - HIST_EXACT) % HIST_SUB_COUNT;
+    return (uint64_t)(HIST_SUB_COUNT + sub) << (e - HIST_SUB_BITS);
+}
+
+void hist_record(struct bench_hist *h, uint64_t v) {
+    h->counts[hist_bucket_index(v)]++;
+    h->total++;
+    h->sum += v;
+    if (v < h->min) {
+        h->min = v;
+    }
+    if (v > h->max) {
+        h->max = v;
+    }
+}
+
+/* 桶中点：精确桶就是值本身，对数桶取[下界, 下一桶下界)的中间 */
+static uint64_t bucket_mid(uint32_t idx) {
+    uint64_t lo = hist_bucket_lower(idx);
+    uint64_t width;
+
+    if (idx < HIST_EXACT) {
+        return lo;
+    }
+    width = lo >> HIST_SUB_BITS;
+    return lo + width / 2;
+}
+
+uint64_t hist_percentile(const struct bench_hist *h, double p) {
+    uint64_t rank;
+    uint64_t seen = 0;
+    uint64_t v;
+    uint32_t i;
+
+    if (h->total == 0) {
+        return 0;
+    }
+    if (p <= 0.0) {
+        return h->min;
+    }
+    if (p >= 100.0) {
+        return h->max;
+    }
+
+    /* 向上取整的名次，至少为1 */
+    rank = (uint64_t)(p / 100.0 * (double)h->total);
+    if ((double)rank < p / 100.0 * (double)h->total) {
+        rank++;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    if (i == HIST_BUCKETS) {
+        return h->max;
+    }
+
+    v = bucket_mid(i);
+    if (v < h->min) {
+        v = h->min;
+    }
+    if (v > h->max) {
+        v = h->max;
+    }
+    return v;
+}
+
+double hist_mean(const struct bench_hist *h) {
+    if (h->total == 0) {
+        return 0.0;
+    }
+    return (double)h->sum / (double)h->total;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file rdma_bench_hist.h
+ * @brief 对数分桶延迟直方图 - HDR风格的固定内存、有界相对误差统计
+ *
+ * 桶布局（记录单位为纳秒）：
+ * - [0, 2*HIST_SUB_COUNT) 内每个值一个桶，精确记录
+ * - 之后每个2的幂区间[2^e, 2^(e+1))等分为HIST_SUB_COUNT个子桶
+ *
+ * 因此任意值的量化相对误差不超过1/HIST_SUB_COUNT，
+ * 覆盖完整的uint64_t范围只需要HIST_BUCKETS个计数器。
+ *
+ * @note 本模块不依赖libibverbs，可以单独做单元测试
+ * @see rdma_bench_hist.c
+ */
+
+#ifndef RDMA_BENCH_HIST_H
+#define RDMA_BENCH_HIST_H
+
+#include <stdint.h>
+
+#define HIST_SUB_BITS   6                          /* 每个2的幂区间的子桶位数 */
+#define HIST_SUB_COUNT  (1u << HIST_SUB_BITS)      /* 每个2的幂区间的子桶数 */
+#define HIST_EXACT      (2u * HIST_SUB_COUNT)      /* 精确记录的值上界 */
+#define HIST_BUCKETS    (HIST_EXACT + (63 - HIST_SUB_BITS) * HIST_SUB_COUNT)
+
+/**
+ * 延迟直方图
+ * 约30KB，建议静态分配或堆分配，不要放在热路径函数的栈上
+ */
+struct bench_hist {
+    uint64_t counts[HIST_BUCKETS];     /* 各桶计数 */
+    uint64_t total;                    /* 样本总数 */
+    uint64_t sum;                      /* 样本总和，用于计算平均值 */
+    uint64_t min;                      /* 最小样本（精确值） */
+    uint64_t max;                      /* 最大样本（精确值） */
+};
+
+/**
+ * 清空直方图
+ *
+ * @param[out] h  直方图指针，必须非NULL
+ */
+void hist_reset(struct bench_hist *h);
+
+/**
+ * 计算值所在的桶下标
+ *
+ * @param[in] v  样本值
+ * @return    桶下标，范围[0, HIST_BUCKETS)
+ */
+uint32_t hist_bucket_index(uint64_t v);
+
+/**
+ * 返回桶覆盖的最小值
+ *
+ * @param[in] idx  桶下标，必须 < HIST_BUCKETS
+ * @return    该桶的下界
+ */
+uint64_t hist_bucket_lower(uint32_t idx);
+
+/**
+ * 记录一个样本
+ *
+ * @param[in,out] h  直方图指针，必须非NULL
+ * @param[in]     v  样本值
+ */
+void hist_record(struct bench_hist *h, uint64_t v);
+
+/**
+ * 查询百分位数
+ *
+ * 返回累计计数首次达到ceil(p% * total)的桶的中点，并限制在[min, max]内。
+ *
+ * @param[in] h  直方图指针，必须非NULL
+ * @param[in] p  百分位，范围[0, 100]
+ *
+ * @return    百分位对应的值，直方图为空时返回0
+ */
+uint64_t hist_percentile(const struct bench_hist *h, double p);
+
+/**
+ * 计算平均值
+ *
+ * @param[in] h  直方图指针，必须非NULL
+ * @return    平均值，直方图为空时返回0
+ */
+double hist_mean(const struct bench_hist *h);
+
+#endif /* RDMA_BENCH_HIST_H */
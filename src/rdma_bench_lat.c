@@ -0,0 +1,299 @@
+/**
+ * @file rdma_bench_lat.c
+ * @brief 乒乓延迟基准测试：SEND/RECV与RDMA WRITE
+ *
+ * 客户端发出一条消息，服务端收到后立即回一条同样大小的消息，
+ * 客户端用CLOCK_MONOTONIC_RAW记录每次往返时间，取RTT/2作为单向延迟，
+ * 按消息大小（min_size到max_size之间的2的幂）分别统计
+ * min/avg/p50/p99/p99.9/max。
+ *
+ * - SEND：接收端靠RECV完成事件感知消息到达，每消费一个RECV立即补投一个
+ * - WRITE：接收端自旋检查缓冲区最后一个字节，等待发送端写入本轮标记值
+ *
+ * 缓冲区布局：[0, max_size)为接收区，[max_size, 2*max_size)为发送区。
+ * 只使用QP[0]，CQ始终忙轮询。-t read在延迟测试中被忽略。
+ *
+ * @see rdma_bench_common.h, rdma_bench_hist.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_bench_hist.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+#include "rdma_common_rdma.h"
+
+#define LAT_QP        0               /* 延迟测试使用的QP */
+#define LAT_CQ_SPINS  256             /* WRITE自旋等待时每多少次检查一次CQ */
+
+/* 已收到的RECV完成数，由完成事件处理函数累加 */
+struct lat_state {
+    uint64_t recvs;
+};
+
+static int lat_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                          const struct ibv_wc *wc, void *arg) {
+    struct lat_state *st = arg;
+
+    (void)res;
+    if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: QP[%u]完成状态异常: %s\n",
+                qp_idx, ibv_wc_status_str(wc->status));
+        return -1;
+    }
+    if (wc->opcode & IBV_WC_RECV) {
+        st->recvs++;
+    }
+    return 0;
+}
+
+/* 在接收区投递一个RECV */
+static int lat_post_recv(struct bench_ctx *ctx) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_recv_wr wr;
+    struct ibv_sge sge;
+
+    sge.addr = (uintptr_t)res->buf;
+    sge.length = ctx->opts.max_size;
+    sge.lkey = res->mr->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(LAT_QP, 0);
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    return post_recv_chain(res, LAT_QP, &wr, 1, NULL);
+}
+
+/* 从发送区发出size字节，WRITE写到对端接收区，发送队列满时轮询CQ回收后重试 */
+static int lat_post_send(struct bench_ctx *ctx, enum ibv_wr_opcode opcode,
+                         uint32_t size) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+    int rc;
+
+    sge.addr = (uintptr_t)(res->buf + ctx->opts.max_size);
+    sge.length = size;
+    sge.lkey = res->mr->lkey;
+
+    for (;;) {
+        if (opcode == IBV_WR_RDMA_WRITE) {
+            rc = post_write_qp(res, LAT_QP, ctx->opts.max_size, 0, size);
+        } else {
+            memset(&wr, 0, sizeof(wr));
+            wr.wr_id = WR_ID_MAKE(LAT_QP, 0);
+            wr.opcode = opcode;
+            wr.sg_list = &sge;
+            wr.num_sge = 1;
+            rc = post_send_chain(res, LAT_QP, &wr, 1, NULL);
+        }
+        if (rc != -EAGAIN) {
+            return rc;
+        }
+        if (poll_cq_batch(res, wc, POLL_BATCH_SIZE) < 0) {
+            return -1;
+        }
+    }
+}
+
+/* 忙轮询CQ直到累计收到target个RECV */
+static int lat_wait_recv(struct bench_ctx *ctx, struct lat_state *st,
+                         uint64_t target) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint64_t deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    uint32_t empty = 0;
+    int n;
+
+    while (st->recvs < target) {
+        n = poll_cq_batch(res, wc, POLL_BATCH_SIZE);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0 && ++empty % res->poll_check_interval == 0 &&
+            monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 等待RECV超时\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 自旋等待对端RDMA WRITE把*p写成marker，期间低频轮询CQ回收发送槽位 */
+static int lat_wait_byte(struct bench_ctx *ctx, volatile uint8_t *p,
+                         uint8_t marker) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint64_t deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    uint32_t spins = 0;
+
+    while (*p != marker) {
+        if (++spins % LAT_CQ_SPINS) {
+            continue;
+        }
+        if (poll_cq_batch(res, wc, POLL_BATCH_SIZE) < 0) {
+            return -1;
+        }
+        if (monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 等待RDMA WRITE超时\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 等待对端的一条消息：SEND等RECV完成事件，WRITE等最后一个字节变成marker */
+static int lat_wait_peer(struct bench_ctx *ctx, struct lat_state *st, uint32_t op,
+                         uint32_t size, uint8_t marker) {
+    if (op == BENCH_OP_SEND) {
+        return lat_wait_recv(ctx, st, st->recvs + 1);
+    }
+    return lat_wait_byte(ctx, (volatile uint8_t *)ctx->res.buf + size - 1, marker);
+}
+
+/*
+ * 单个消息大小的乒乓，只有客户端记录延迟。
+ * 每轮把发送区最后一个字节写成1~255循环的标记值，供WRITE接收端检测；
+ * SEND接收端每消费一个RECV补投一个，补投放在计时之外。
+ */
+static int lat_run_size(struct bench_ctx *ctx, struct lat_state *st, uint32_t op,
+                        uint32_t size, struct bench_hist *h) {
+    enum ibv_wr_opcode opcode = op == BENCH_OP_SEND ? IBV_WR_SEND : IBV_WR_RDMA_WRITE;
+    uint8_t *tx_last = (uint8_t *)ctx->res.buf + ctx->opts.max_size + size - 1;
+    uint32_t total = ctx->opts.warmup + ctx->opts.iters;
+    uint8_t marker;
+    uint64_t t0;
+    uint64_t t1;
+    uint32_t i;
+
+    for (i = 0; i < total; i++) {
+        marker = (uint8_t)(i % 255 + 1);
+        *tx_last = marker;
+
+        if (bench_is_server(ctx)) {
+            if (lat_wait_peer(ctx, st, op, size, marker) ||
+                (op == BENCH_OP_SEND && lat_post_recv(ctx)) ||
+                lat_post_send(ctx, opcode, size)) {
+                return -1;
+            }
+            continue;
+        }
+
+        t0 = monotonic_ns();
+        if (lat_post_send(ctx, opcode, size) || lat_wait_peer(ctx, st, op, size, marker)) {
+            return -1;
+        }
+        t1 = monotonic_ns();
+        /* 对端下一条消息要等本端再次发送后才会发出，此时补投RECV来得及 */
+        if (op == BENCH_OP_SEND && lat_post_recv(ctx)) {
+            return -1;
+        }
+        if (i >= ctx->opts.warmup) {
+            hist_record(h, (t1 - t0) / 2);
+        }
+    }
+    return 0;
+}
+
+static void lat_print_header(const char *op) {
+    printf("\n---------------- %s 乒乓延迟 (RTT/2, 微秒) ----------------\n", op);
+    printf("%10s %10s %9s %9s %9s %9s %9s %9s\n",
+           "#bytes", "#iters", "min", "avg", "p50", "p99", "p99.9", "max");
+}
+
+static void lat_print_row(uint32_t size, const struct bench_hist *h) {
+    printf("%10u %10llu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+           size, (unsigned long long)h->total,
+           h->min / 1000.0, hist_mean(h) / 1000.0,
+           hist_percentile(h, 50.0) / 1000.0,
+           hist_percentile(h, 99.0) / 1000.0,
+           hist_percentile(h, 99.9) / 1000.0,
+           h->max / 1000.0);
+}
+
+/* 对min_size到max_size之间的每个2的幂大小跑一种操作 */
+static int lat_run_op(struct bench_ctx *ctx, struct lat_state *st,
+                      uint32_t op, struct bench_hist *h) {
+    uint32_t size;
+
+    if (!bench_is_server(ctx)) {
+        lat_print_header(op == BENCH_OP_SEND ? "SEND" : "RDMA WRITE");
+    }
+
+    for (size = ctx->opts.min_size; size <= ctx->opts.max_size; size *= 2) {
+        /* 清空缓冲区并同步，保证WRITE标记不会残留上一个大小的值 */
+        memset(ctx->res.buf, 0, ctx->res.buf_size);
+        if (bench_sync(ctx)) {
+            return -1;
+        }
+
+        hist_reset(h);
+        if (lat_run_size(ctx, st, op, size, h)) {
+            fprintf(stderr, "错误: %u字节测试失败\n", size);
+            return -1;
+        }
+
+        if (!bench_is_server(ctx)) {
+            lat_print_row(size, h);
+        }
+        if (size > ctx->opts.max_size / 2) {
+            break;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct lat_state st;
+    struct bench_hist *h;
+    uint32_t i;
+    int rc = 1;
+
+    bench_opts_init(&ctx.opts);
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    h = malloc(sizeof(*h));
+    if (!h) {
+        fprintf(stderr, "错误: 分配直方图失败\n");
+        return 1;
+    }
+
+    if (bench_setup(&ctx, ctx.opts.max_size * 2)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+
+    memset(&st, 0, sizeof(st));
+    if (register_wc_handler(&ctx.res, LAT_QP, lat_wc_handler, &st) ||
+        set_signal_interval(&ctx.res, ctx.res.sq_depth / 2 ? ctx.res.sq_depth / 2 : 1)) {
+        goto out;
+    }
+
+    /* 预先填满接收队列，之后每消费一个RECV补投一个 */
+    for (i = 0; i < ctx.res.rq_depth; i++) {
+        if (lat_post_recv(&ctx)) {
+            fprintf(stderr, "错误: 预投递RECV失败\n");
+            goto out;
+        }
+    }
+
+    if ((ctx.opts.ops & BENCH_OP_SEND) && lat_run_op(&ctx, &st, BENCH_OP_SEND, h)) {
+        goto out;
+    }
+    if ((ctx.opts.ops & BENCH_OP_WRITE) && lat_run_op(&ctx, &st, BENCH_OP_WRITE, h)) {
+        goto out;
+    }
+    if (bench_sync(&ctx)) {
+        goto out;
+    }
+    rc = 0;
+
+out:
+    bench_teardown(&ctx);
+    free(h);
+    return rc;
+}
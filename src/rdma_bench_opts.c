@@ -0,0 +1,173 @@
+/**
+ * @file rdma_bench_opts.c
+ * @brief 基准测试公共命令行参数：默认值、用法说明和解析
+ */
+
+#include "rdma_bench_common.h"
+
+#include <getopt.h>
+
+void bench_opts_init(struct bench_opts *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->port = DEFAULT_PORT;
+    opts->gid_idx = 1;
+    opts->ib_port = 1;
+    opts->num_qp = 1;
+    opts->iters = BENCH_DEFAULT_ITERS;
+    opts->warmup = BENCH_DEFAULT_WARMUP;
+    opts->min_size = BENCH_DEFAULT_MIN;
+    opts->max_size = BENCH_DEFAULT_MAX;
+    opts->ops = BENCH_OP_ALL;
+    opts->depth = MAX_WR;
+    opts->sweep = BENCH_SWEEP_SIZE;
+    opts->rd_atomic = DEFAULT_RD_ATOMIC;
+}
+
+void bench_usage(const char *prog) {
+    fprintf(stderr, "用法: %s [选项] [服务端IP]\n", prog);
+    fprintf(stderr, "  不指定服务端IP时作为服务端运行\n");
+    fprintf(stderr, "  -d <设备>    RDMA设备名，默认第一个设备\n");
+    fprintf(stderr, "  -p <端口>    TCP端口，默认%d\n", DEFAULT_PORT);
+    fprintf(stderr, "  -g <索引>    GID索引，默认1\n");
+    fprintf(stderr, "  -i <端口>    IB端口号，默认1\n");
+    fprintf(stderr, "  -q <数量>    QP数量，默认1\n");
+    fprintf(stderr, "  -n <次数>    每个消息大小的迭代次数，默认%d\n", BENCH_DEFAULT_ITERS);
+    fprintf(stderr, "  -w <次数>    预热次数，默认%d\n", BENCH_DEFAULT_WARMUP);
+    fprintf(stderr, "  -s <字节>    最小消息大小，默认%d\n", BENCH_DEFAULT_MIN);
+    fprintf(stderr, "  -S <字节>    最大消息大小，默认%d\n", BENCH_DEFAULT_MAX);
+    fprintf(stderr, "  -t <操作>    send|write|read|all，默认all\n");
+    fprintf(stderr, "  -D <深度>    每个QP的队列深度，默认%d\n", MAX_WR);
+    fprintf(stderr, "  -x <维度>    带宽测试扫描维度: size,qp,depth或all，默认size\n");
+    fprintf(stderr, "  -j <文件>    带宽测试结果另存为JSON\n");
+    fprintf(stderr, "  -R <深度>    每个QP未完成READ数上限，默认%d\n", DEFAULT_RD_ATOMIC);
+    fprintf(stderr, "  -r <深度>    所有QP共享一个该深度的SRQ，默认不使用\n");
+    fprintf(stderr, "  -H <页>      缓冲区页大小: 4k|2m|1g|auto，大页不可用时降级，默认4k\n");
+    fprintf(stderr, "  -T <线程>    工作线程数，每个线程独占一部分QP和一个CQ，默认单线程\n");
+    fprintf(stderr, "  -C <CPU>     工作线程绑定的CPU列表(如2-5,8)或numa(网卡所在节点)\n");
+    fprintf(stderr, "  -B <线程>    用该数量的线程并行建链并与TCP交换重叠，默认串行建链\n");
+    fprintf(stderr, "  -m <方式>    QP建链方式: tcp|cm，cm使用rdma_cm的端口+1，默认tcp\n");
+}
+
+/* 解析-t参数 */
+static int parse_ops(const char *str, uint32_t *ops) {
+    if (!strcmp(str, "send")) {
+        *ops = BENCH_OP_SEND;
+    } else if (!strcmp(str, "write")) {
+        *ops = BENCH_OP_WRITE;
+    } else if (!strcmp(str, "read")) {
+        *ops = BENCH_OP_READ;
+    } else if (!strcmp(str, "all")) {
+        *ops = BENCH_OP_ALL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* 解析-m参数 */
+static int parse_conn_mode(const char *str, enum bench_conn_mode *mode) {
+    if (!strcmp(str, "tcp")) {
+        *mode = BENCH_CONN_TCP;
+    } else if (!strcmp(str, "cm")) {
+        *mode = BENCH_CONN_CM;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* 解析-x参数，逗号分隔的维度列表 */
+static int parse_sweep(const char *str, uint32_t *sweep) {
+    char buf[64];
+    char *save = NULL;
+    char *tok;
+
+    snprintf(buf, sizeof(buf), "%s", str);
+    *sweep = 0;
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (!strcmp(tok, "size")) {
+            *sweep |= BENCH_SWEEP_SIZE;
+        } else if (!strcmp(tok, "qp")) {
+            *sweep |= BENCH_SWEEP_QP;
+        } else if (!strcmp(tok, "depth")) {
+            *sweep |= BENCH_SWEEP_DEPTH;
+        } else if (!strcmp(tok, "all")) {
+            *sweep |= BENCH_SWEEP_ALL;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bench_parse_args(struct bench_opts *opts, int argc, char *argv[]) {
+    int c;
+
+    while ((c = getopt(argc, argv, "d:p:g:i:q:n:w:s:S:t:D:x:j:R:r:H:T:C:B:m:h")) != -1) {
+        switch (c) {
+            case 'd': opts->dev_name = optarg; break;
+            case 'p': opts->port = atoi(optarg); break;
+            case 'g': opts->gid_idx = atoi(optarg); break;
+            case 'i': opts->ib_port = (uint8_t)atoi(optarg); break;
+            case 'q': opts->num_qp = (uint32_t)atoi(optarg); break;
+            case 'n': opts->iters = (uint32_t)atoi(optarg); break;
+            case 'w': opts->warmup = (uint32_t)atoi(optarg); break;
+            case 's': opts->min_size = (uint32_t)atoi(optarg); break;
+            case 'S': opts->max_size = (uint32_t)atoi(optarg); break;
+            case 'D': opts->depth = (uint32_t)atoi(optarg); break;
+            case 'j': opts->json_path = optarg; break;
+            case 'R': opts->rd_atomic = (uint32_t)atoi(optarg); break;
+            case 'r': opts->srq_depth = (uint32_t)atoi(optarg); break;
+            case 'T': opts->threads = (uint32_t)atoi(optarg); break;
+            case 'C': opts->cpus = optarg; break;
+            case 'B': opts->bringup = (uint32_t)atoi(optarg); break;
+            case 't':
+                if (parse_ops(optarg, &opts->ops)) {
+                    fprintf(stderr, "错误: 无效的操作类型: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'H':
+                if (parse_buf_page_mode(optarg, &opts->buf_page)) {
+                    fprintf(stderr, "错误: 无效的页大小: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'x':
+                if (parse_sweep(optarg, &opts->sweep)) {
+                    fprintf(stderr, "错误: 无效的扫描维度: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 'm':
+                if (parse_conn_mode(optarg, &opts->conn_mode)) {
+                    fprintf(stderr, "错误: 无效的建链方式: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+        }
+    }
+    if (optind < argc) {
+        opts->server_ip = argv[optind];
+    }
+
+    if (opts->num_qp == 0 || opts->num_qp > MAX_QP) {
+        fprintf(stderr, "错误: QP数量%u超出范围[1-%d]\n", opts->num_qp, MAX_QP);
+        return -1;
+    }
+    if (opts->depth == 0 || opts->rd_atomic == 0) {
+        fprintf(stderr, "错误: 队列深度和READ深度必须大于0\n");
+        return -1;
+    }
+    if (opts->iters == 0 || opts->min_size == 0 || opts->min_size > opts->max_size) {
+        fprintf(stderr, "错误: 迭代次数或消息大小范围无效\n");
+        return -1;
+    }
+    if (opts->conn_mode == BENCH_CONN_CM && opts->bringup) {
+        fprintf(stderr, "错误: 并行建链(-B)只支持TCP建链方式\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file rdma_bench_recover.c
+ * @brief QP原地恢复测试：逐个QP注入错误并恢复，验证其他QP和MR不受影响
+ *
+ * 共-n轮，第r轮的出错QP为 r % QP数：
+ * 1. 服务端在所有QP上各投递一个RECV，TCP同步
+ * 2. 客户端用错误的rkey发RDMA WRITE，对端返回远端访问错误，本端QP进入ERR
+ * 3. TCP同步后双方对该QP调用qp_recover()：冲刷、复位、交换新PSN、重新建链
+ * 4. 服务端为该QP补投RECV，客户端在所有QP上各SEND一条，双方确认全部成功
+ *
+ * 输出每轮的冲刷数、丢失的发送WR数和两个阶段的耗时，最后与重新注册
+ * 整个缓冲区的耗时对比（用-S放大缓冲区可观察大内存下的差距）。
+ *
+ * 用法: 服务端 rdma_bench_recover -d rxe0 [-q 4] [-n 20]
+ *       客户端 rdma_bench_recover -d rxe0 [-q 4] [-n 20] 服务端IP
+ *
+ * @see rdma_common_recover.h, rdma_bench_common.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_common_recover.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+#include "rdma_common_rdma.h"
+
+#define REC_DEFAULT_ROUNDS  20
+#define REC_MSG_SIZE        64
+
+/* 失败的完成事件由轮询引擎记入wc_error，这里不中止轮询 */
+static int rec_on_wc(struct rdma_resources *res, uint32_t qp_idx,
+                     const struct ibv_wc *wc, void *arg) {
+    (void)res;
+    (void)qp_idx;
+    (void)wc;
+    (void)arg;
+    return 0;
+}
+
+/* 客户端：用错误的rkey写对端，使QP v进入ERR */
+static int rec_inject(struct bench_ctx *ctx, uint32_t v) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc;
+    uint32_t rkey = res->qp_ctx[v].remote_rkey;
+    int rc;
+
+    res->qp_ctx[v].remote_rkey = rkey ^ 0x5a5a;
+    rc = post_write_qp(res, v, 0, 0, REC_MSG_SIZE);
+    res->qp_ctx[v].remote_rkey = rkey;
+    if (rc || poll_completion_batch(res, 1, &wc, 1) != 1) {
+        fprintf(stderr, "错误: 在QP[%u]上注入错误失败\n", v);
+        return -1;
+    }
+    if (qp_in_error(res, v) != 1) {
+        fprintf(stderr, "错误: QP[%u]未进入ERR (完成状态: %s)\n", v, ibv_wc_status_str(wc.status));
+        return -1;
+    }
+    return 0;
+}
+
+/* 所有QP各收发一条消息，确认恢复的QP和其他QP都正常 */
+static int rec_check_all(struct bench_ctx *ctx) {
+    struct rdma_resources *res = &ctx->res;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint32_t i;
+
+    if (bench_sync(ctx)) {
+        return -1;
+    }
+    for (i = 0; !bench_is_server(ctx) && i < res->num_qp; i++) {
+        if (post_send_qp_len(res, i, IBV_WR_SEND, REC_MSG_SIZE)) {
+            fprintf(stderr, "错误: QP[%u]发送失败\n", i);
+            return -1;
+        }
+    }
+    if (poll_completion_batch(res, (int)res->num_qp, wc, POLL_BATCH_SIZE) < 0) {
+        return -1;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        if (res->qp_ctx[i].wc_error != IBV_WC_SUCCESS) {
+            fprintf(stderr, "错误: 恢复后QP[%u]收发失败: %s\n",
+                    i, ibv_wc_status_str(res->qp_ctx[i].wc_error));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int rec_round(struct bench_ctx *ctx, uint32_t round, struct qp_recover_stats *total) {
+    struct rdma_resources *res = &ctx->res;
+    struct qp_recover_stats st;
+    uint32_t v = round % res->num_qp;
+
+    memset(&st, 0, sizeof(st));
+    if (bench_is_server(ctx) && post_receive_all(res)) {
+        return -1;
+    }
+    if (bench_sync(ctx) || (!bench_is_server(ctx) && rec_inject(ctx, v)) || bench_sync(ctx)) {
+        return -1;
+    }
+    if (qp_recover(res, v, ctx->sock, &st)) {
+        return -1;
+    }
+    /* 恢复后RQ为空，出错QP上被冲刷的RECV需要补投 */
+    if (bench_is_server(ctx) && post_receive_qp(res, v)) {
+        return -1;
+    }
+    if (rec_check_all(ctx)) {
+        return -1;
+    }
+
+    printf("%6u %4u %8u %10u %12llu %14llu\n", round, v, st.flushed, st.send_lost,
+           (unsigned long long)st.flush_us, (unsigned long long)st.reconnect_us);
+    total->flushed += st.flushed;
+    total->send_lost += st.send_lost;
+    total->other_wc += st.other_wc;
+    total->flush_us += st.flush_us;
+    total->reconnect_us += st.reconnect_us;
+    return 0;
+}
+
+/* 重新注册整个缓冲区的耗时，即整体重建时至少要付出的代价 */
+static double rec_reg_cost_us(struct rdma_resources *res) {
+    struct ibv_mr *mr;
+    uint64_t t0 = monotonic_ns();
+
+    mr = ibv_reg_mr(res->pd, res->buf, res->buf_size,
+                    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE);
+    if (!mr) {
+        return -1.0;
+    }
+    ibv_dereg_mr(mr);
+    return (double)(monotonic_ns() - t0) / 1000.0;
+}
+
+/* 每个QP的恢复次数等于它被选为出错QP的轮数，MR始终是同一个 */
+static int rec_verify(struct bench_ctx *ctx, const struct ibv_mr *mr, uint32_t lkey) {
+    struct rdma_resources *res = &ctx->res;
+    uint32_t rounds = ctx->opts.iters;
+    uint32_t want;
+    uint32_t i;
+
+    for (i = 0; i < res->num_qp; i++) {
+        want = rounds / res->num_qp + (i < rounds % res->num_qp ? 1 : 0);
+        if (res->qp_ctx[i].recoveries != want) {
+            fprintf(stderr, "错误: QP[%u]恢复了%u次，应为%u次\n",
+                    i, res->qp_ctx[i].recoveries, want);
+            return -1;
+        }
+    }
+    if (res->mr != mr || res->mr->lkey != lkey) {
+        fprintf(stderr, "错误: MR被重新注册\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct qp_recover_stats total;
+    struct ibv_mr *mr;
+    uint32_t lkey;
+    uint32_t r;
+    uint32_t i;
+    int rc = 1;
+
+    bench_opts_init(&ctx.opts);
+    ctx.opts.num_qp = DEFAULT_NUM_QP;
+    ctx.opts.iters = REC_DEFAULT_ROUNDS;
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        fprintf(stderr, "  (恢复测试默认: -q %d -n %d，-S为缓冲区大小)\n",
+                DEFAULT_NUM_QP, REC_DEFAULT_ROUNDS);
+        return 1;
+    }
+    if (ctx.opts.threads || ctx.opts.srq_depth) {
+        fprintf(stderr, "错误: 恢复测试不支持-T和-r\n");
+        return 1;
+    }
+    if (ctx.opts.max_size < REC_MSG_SIZE) {
+        ctx.opts.max_size = REC_MSG_SIZE;
+    }
+    if (bench_setup(&ctx, ctx.opts.max_size)) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    for (i = 0; i < ctx.res.num_qp; i++) {
+        register_wc_handler(&ctx.res, i, rec_on_wc, NULL);
+    }
+    mr = ctx.res.mr;
+    lkey = mr->lkey;
+
+    printf("\n%s: %u个QP，%u轮，缓冲区%zu字节\n", bench_is_server(&ctx) ? "服务端" : "客户端",
+           ctx.res.num_qp, ctx.opts.iters, ctx.res.buf_size);
+    printf("%6s %4s %8s %10s %12s %14s\n", "round", "qp", "flushed", "send_lost",
+           "flush_us", "reconnect_us");
+    memset(&total, 0, sizeof(total));
+    for (r = 0; r < ctx.opts.iters; r++) {
+        if (rec_round(&ctx, r, &total)) {
+            goto out;
+        }
+    }
+    if (rec_verify(&ctx, mr, lkey)) {
+        goto out;
+    }
+
+    printf("\n平均每次恢复: 冲刷%.1f us + 重连%.1f us，冲刷%u个WR，丢失发送WR %u个\n",
+           (double)total.flush_us / ctx.opts.iters, (double)total.reconnect_us / ctx.opts.iters,
+           total.flushed, total.send_lost);
+    printf("对比: 重新注册%zu字节缓冲区 %.1f us（整体重建还需重建PD/CQ/所有QP）\n",
+           ctx.res.buf_size, rec_reg_cost_us(&ctx.res));
+    rc = 0;
+
+out:
+    bench_teardown(&ctx);
+    return rc;
+}
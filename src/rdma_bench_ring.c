@@ -0,0 +1,201 @@
+/**
+ * @file rdma_bench_ring.c
+ * @brief 远端环形缓冲区基准测试：乒乓延迟与单向消息速率
+ *
+ * 在QP[0]上建立一个ring_channel，对min_size到max_size之间的每个2的幂：
+ * 1. 乒乓：客户端ring_send()一条记录，服务端收到后回一条同样大小的记录，
+ *    客户端记录RTT/2；双方都只自旋检查内存，不等待接收完成事件
+ * 2. 单向流：客户端连续发送iters条记录，服务端全部消费后回一条确认，
+ *    客户端据此计算Mmsg/s和Gb/s；消费位置由credit WRITE懒惰返还
+ *
+ * 环大小至少为64KB，并保证能容纳4条最大记录。
+ *
+ * @see rdma_common_ring.h, rdma_bench_common.h
+ */
+
+#include "rdma_bench_common.h"
+#include "rdma_bench_hist.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+#include "rdma_common_ring.h"
+
+#define RING_QP         0                    /* 使用的QP */
+#define RING_MIN_BYTES  (64u << 10)          /* 最小环大小 */
+#define RING_SPIN_CHECK 4096                 /* 自旋多少次检查一次超时 */
+
+/* 能容纳4条max_size记录的最小2的幂环大小 */
+static uint32_t ring_bench_size(uint32_t max_size) {
+    uint32_t need = 4 * ring_record_size(max_size);
+    uint32_t size = RING_MIN_BYTES;
+
+    while (size < need) {
+        size *= 2;
+    }
+    return size;
+}
+
+/* 发送一条记录，环满或发送队列满时自旋重试 */
+static int ring_bench_send(struct bench_ctx *ctx, struct ring_channel *ch,
+                           const void *data, uint32_t len) {
+    uint64_t deadline = monotonic_coarse_ms() + ctx->res.poll_timeout_ms;
+    uint32_t spins = 0;
+    int rc;
+
+    while ((rc = ring_send(ch, data, len)) == -EAGAIN) {
+        if (++spins % RING_SPIN_CHECK == 0 && monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 环形通道发送超时\n");
+            return -1;
+        }
+    }
+    if (rc) {
+        fprintf(stderr, "错误: 环形通道发送失败: %s\n", strerror(-rc));
+        return -1;
+    }
+    return 0;
+}
+
+/* 自旋等待并消费一条记录 */
+static int ring_bench_recv(struct bench_ctx *ctx, struct ring_channel *ch) {
+    uint64_t deadline = monotonic_coarse_ms() + ctx->res.poll_timeout_ms;
+    const void *data;
+    uint32_t spins = 0;
+    uint32_t len;
+    int rc;
+
+    while ((rc = ring_peek(ch, &data, &len)) == 0) {
+        if (++spins % RING_SPIN_CHECK == 0 && monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: 环形通道接收超时\n");
+            return -1;
+        }
+    }
+    if (rc < 0) {
+        return -1;
+    }
+    return ring_release(ch) ? -1 : 0;
+}
+
+/* 乒乓测试，只有客户端记录延迟 */
+static int ring_pingpong(struct bench_ctx *ctx, struct ring_channel *ch,
+                         const void *payload, uint32_t size, struct bench_hist *h) {
+    uint32_t total = ctx->opts.warmup + ctx->opts.iters;
+    uint64_t t0;
+    uint32_t i;
+
+    for (i = 0; i < total; i++) {
+        if (bench_is_server(ctx)) {
+            if (ring_bench_recv(ctx, ch) || ring_bench_send(ctx, ch, payload, size)) {
+                return -1;
+            }
+            continue;
+        }
+        t0 = monotonic_ns();
+        if (ring_bench_send(ctx, ch, payload, size) || ring_bench_recv(ctx, ch)) {
+            return -1;
+        }
+        if (i >= ctx->opts.warmup) {
+            hist_record(h, (monotonic_ns() - t0) / 2);
+        }
+    }
+    return 0;
+}
+
+/* 单向流测试，客户端返回耗时(纳秒)，服务端返回0，失败返回-1 */
+static int64_t ring_stream(struct bench_ctx *ctx, struct ring_channel *ch,
+                           const void *payload, uint32_t size) {
+    uint64_t t0 = monotonic_ns();
+    uint32_t i;
+
+    for (i = 0; i < ctx->opts.iters; i++) {
+        if (bench_is_server(ctx) ? ring_bench_recv(ctx, ch)
+                                 : ring_bench_send(ctx, ch, payload, size)) {
+            return -1;
+        }
+    }
+    if (bench_is_server(ctx)) {
+        return ring_bench_send(ctx, ch, payload, 0) ? -1 : 0;
+    }
+    if (ring_bench_recv(ctx, ch)) {
+        return -1;
+    }
+    return (int64_t)(monotonic_ns() - t0);
+}
+
+static int ring_run_sizes(struct bench_ctx *ctx, struct ring_channel *ch,
+                          const void *payload, struct bench_hist *h) {
+    uint32_t size;
+    int64_t ns;
+
+    for (size = ctx->opts.min_size; size <= ctx->opts.max_size; size *= 2) {
+        hist_reset(h);
+        if (bench_sync(ctx) || ring_pingpong(ctx, ch, payload, size, h) ||
+            bench_sync(ctx)) {
+            return -1;
+        }
+        ns = ring_stream(ctx, ch, payload, size);
+        if (ns < 0) {
+            return -1;
+        }
+        if (!bench_is_server(ctx)) {
+            printf("%10u %9.2f %9.2f %9.2f %9.2f %10.3f %10.2f\n", size,
+                   h->min / 1000.0, hist_percentile(h, 50.0) / 1000.0,
+                   hist_percentile(h, 99.0) / 1000.0, h->max / 1000.0,
+                   (double)ctx->opts.iters * 1000.0 / (double)ns,
+                   (double)ctx->opts.iters * size * 8.0 / (double)ns);
+        }
+        if (size > ctx->opts.max_size / 2) {
+            break;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct bench_ctx ctx;
+    struct ring_channel ch;
+    struct bench_hist *h;
+    uint32_t ring_size;
+    void *payload;
+    int rc = 1;
+
+    bench_opts_init(&ctx.opts);
+    if (bench_parse_args(&ctx.opts, argc, argv)) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    ring_size = ring_bench_size(ctx.opts.max_size);
+    h = malloc(sizeof(*h));
+    payload = calloc(1, ctx.opts.max_size);
+    if (!h || !payload) {
+        fprintf(stderr, "错误: 分配内存失败\n");
+        free(payload);
+        free(h);
+        return 1;
+    }
+
+    if (bench_setup(&ctx, ring_region_size(ring_size))) {
+        fprintf(stderr, "错误: 建立基准测试连接失败\n");
+        goto out;
+    }
+    if (set_signal_interval(&ctx.res, ctx.res.sq_depth / 2 ? ctx.res.sq_depth / 2 : 1) ||
+        ring_channel_init(&ch, &ctx.res, RING_QP, 0, ring_size) ||
+        bench_sync(&ctx)) {
+        goto out;
+    }
+
+    if (!bench_is_server(&ctx)) {
+        printf("\n环大小: %u 字节\n", ring_size);
+        printf("%10s %9s %9s %9s %9s %10s %10s\n", "#bytes", "min(us)", "p50(us)",
+               "p99(us)", "max(us)", "Mmsg/s", "Gb/s");
+    }
+    if (ring_run_sizes(&ctx, &ch, payload, h) || bench_sync(&ctx)) {
+        goto out;
+    }
+    rc = 0;
+
+out:
+    bench_teardown(&ctx);
+    free(payload);
+    free(h);
+    return rc;
+}
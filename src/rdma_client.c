@@ -5,7 +5,7 @@
  * 本程序实现RDMA通信的客户端，主要功能包括：
  * - 初始化RDMA资源（设备、PD、CQ、QP列表、MR）
  * - 建立TCP连接到服务端
- * - 与服务端交换QP连接信息（QP号、LID、GID）
+ * - 与服务端交换QP连接信息（QP号、LID、GID、addr/rkey/len）
  * - 转移QP状态（INIT → RTR → RTS）
  * - 投递接收请求到RQ
  * - 投递发送请求到SQ
@@ -31,11 +31,12 @@
  */
 
 #include "rdma_common.h"
+#include "rdma_common_post.h"
 
 int main(int argc, char *argv[]) {
     struct rdma_resources res;
-    struct cm_con_data_t *local_con_data;
-    struct cm_con_data_t *remote_con_data;
+    struct cm_con_data_t *local_con_data = NULL;
+    struct cm_con_data_t *remote_con_data = NULL;
     union ibv_gid my_gid;
     int rc = 0;
     int sock = -1;
@@ -104,33 +105,30 @@ int main(int argc, char *argv[]) {
 
     /* 分配本地和远端连接信息数组 */
     local_con_data = malloc(sizeof(struct cm_con_data_t) * num_qp);
-    remote_con_data = malloc(sizeof(struct cm_con_data_t) * MAX_QP);
-    if (!local_con_data || !remote_con_data) {
+    remote_con_data = NULL;
+    if (!local_con_data) {
         fprintf(stderr, "分配连接信息数组失败\n");
         rc = 1;
         goto cleanup;
     }
 
-    /* 获取本地GID */
-    if (ibv_query_gid(res.context, res.ib_port, gid_idx, &my_gid)) {
-        fprintf(stderr, "查询GID失败\n");
+    /* 填充所有本地QP的连接信息（含单边访问用的addr/rkey/len） */
+    if (fill_local_con_data(&res, local_con_data)) {
         rc = 1;
         goto cleanup;
     }
 
-    /* 填充所有本地QP的连接信息 */
     for (i = 0; i < res.num_qp; i++) {
-        memset(&local_con_data[i], 0, sizeof(struct cm_con_data_t));
-        local_con_data[i].qp_num = res.qp_list[i]->qp_num;
-        local_con_data[i].lid = res.port_attr.lid;
-        memcpy(local_con_data[i].gid, &my_gid, 16);
-
+        memcpy(&my_gid, local_con_data[i].gid, 16);
         printf("本地QP[%u]连接信息:\n", i);
         printf("  - QP号: 0x%06x\n", local_con_data[i].qp_num);
         printf("  - LID: 0x%04x\n", local_con_data[i].lid);
         printf("  - GID: ");
         print_gid(&my_gid);
         printf("\n");
+        printf("  - 缓冲区: addr=0x%llx rkey=0x%x len=%u\n",
+               (unsigned long long)local_con_data[i].addr,
+               local_con_data[i].rkey, local_con_data[i].len);
     }
 
     /* ===== 第三阶段: TCP连接，交换多QP信息 ===== */
@@ -165,16 +163,17 @@ int main(int argc, char *argv[]) {
 
     /* 通过TCP交换多QP连接信息 */
     printf("\n========== 交换多QP连接信息 ==========\n");
-    if (sock_sync_data_multi(sock, local_con_data, res.num_qp,
-                             remote_con_data, &remote_num_qp)) {
+    if (sock_exchange_con_data(sock, local_con_data, res.num_qp,
+                               &remote_con_data, &remote_num_qp)) {
         fprintf(stderr, "交换连接信息失败\n");
         rc = 1;
         goto cleanup;
     }
 
-    if (remote_num_qp != res.num_qp) {
-        fprintf(stderr, "警告: 远端QP数量(%u)与本端不匹配(%u)\n",
-                remote_num_qp, res.num_qp);
+    if (remote_num_qp < res.num_qp) {
+        fprintf(stderr, "错误: 远端QP数量(%u)少于本端(%u)\n", remote_num_qp, res.num_qp);
+        rc = 1;
+        goto cleanup;
     }
 
     for (i = 0; i < remote_num_qp; i++) {
@@ -233,8 +232,9 @@ int main(int argc, char *argv[]) {
 
     /* 发送数据到所有QP */
     printf("\n投递所有QP的Send请求...\n");
+    /* 只发送字符串实际长度（含结尾\0），不超过内联阈值时走内联路径 */
     for (i = 0; i < res.num_qp; i++) {
-        if (post_send_qp(&res, i, IBV_WR_SEND)) {
+        if (post_send_qp_len(&res, i, IBV_WR_SEND, strlen(res.buf) + 1)) {
             fprintf(stderr, "Post Send到QP[%u]失败\n", i);
             rc = 1;
             goto cleanup;
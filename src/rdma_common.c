@@ -23,23 +23,63 @@
  */
 
 #include "rdma_common.h"
+#include "rdma_common_rdma.h"
+#include "rdma_common_srq.h"
+#include "rdma_common_worker.h"
+#include "rdma_common_async.h"
 
+#include <fcntl.h>
 
 
+
+void rdma_config_init(struct rdma_config *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->ib_port = 1;
+    cfg->gid_idx = 1;
+    cfg->num_qp = DEFAULT_NUM_QP;
+    cfg->buf_size = DEFAULT_MSG_SIZE;
+    cfg->rd_atomic = DEFAULT_RD_ATOMIC;
+}
+
 int init_rdma_resources(struct rdma_resources *res,
                         const char *dev_name,
                         uint8_t ib_port,
                         int gid_idx,
                         uint32_t num_qp) {
+    struct rdma_config cfg;
+
+    rdma_config_init(&cfg);
+    cfg.dev_name = dev_name;
+    cfg.ib_port = ib_port;
+    cfg.gid_idx = gid_idx;
+    cfg.num_qp = num_qp;
+    return init_rdma_resources_cfg(res, &cfg);
+}
+
+int init_rdma_resources_cfg(struct rdma_resources *res,
+                            const struct rdma_config *cfg) {
+    const char *dev_name = cfg->dev_name;
+    int gid_idx = cfg->gid_idx;
     int num_devices;
+    struct timeval reg_t0, reg_t1;
+    int access;
     int i;
     union ibv_gid gid;
 
     memset(res, 0, sizeof(*res));
-    res->ib_port = ib_port;
+    res->ib_port = cfg->ib_port;
     res->gid_idx = gid_idx;
-    res->buf_size = DEFAULT_MSG_SIZE;
-    res->num_qp = num_qp > 0 ? num_qp : DEFAULT_NUM_QP;
+    res->buf_size = cfg->buf_size > 0 ? cfg->buf_size : DEFAULT_MSG_SIZE;
+    res->num_qp = cfg->num_qp > 0 ? cfg->num_qp : DEFAULT_NUM_QP;
+    res->sq_depth = MAX_WR;
+    res->rq_depth = MAX_WR;
+    res->signal_interval = DEFAULT_SIGNAL_INTERVAL;
+    res->max_inline_req = DEFAULT_MAX_INLINE;
+    res->max_sge = cfg->max_sge > 0 ? cfg->max_sge : DEFAULT_MAX_SGE;
+    res->poll_timeout_ms = POLL_TIMEOUT_MS;
+    res->poll_check_interval = POLL_CHECK_INTERVAL;
+    res->poll_mode = POLL_MODE_BUSY;
+    res->spin_budget_us = DEFAULT_SPIN_BUDGET_US;
 
     if (res->num_qp > MAX_QP) {
         fprintf(stderr, "错误: QP数量(%u)超过最大限制(%u)\n", res->num_qp, MAX_QP);
@@ -82,6 +122,14 @@ int init_rdma_resources(struct rdma_resources *res,
     }
     printf("成功打开设备上下文\n");
 
+    if (ibv_query_device(res->context, &res->dev_attr)) {
+        fprintf(stderr, "错误: 查询设备能力失败\n");
+        return -1;
+    }
+    if (set_rd_atomic_depth(res, cfg->rd_atomic > 0 ? cfg->rd_atomic : DEFAULT_RD_ATOMIC)) {
+        return -1;
+    }
+
     /* 4. 查询端口属性 */
     printf("\n========== 步骤4: 查询端口属性 ==========\n");
     if (ibv_query_port(res->context, res->ib_port, &res->port_attr)) {
@@ -111,38 +159,53 @@ int init_rdma_resources(struct rdma_resources *res,
     }
     printf("成功分配PD\n");
 
-    /* 7. 分配数据缓冲区 */
+    /* 7. 分配数据缓冲区，按配置使用大页以减少网卡MTT表项和TLB缺失 */
     printf("\n========== 步骤6: 分配并注册内存缓冲区 ==========\n");
-    res->buf = malloc(res->buf_size);
+    res->buf = rdma_buf_alloc(res->buf_size, cfg->buf_page, &res->buf_page_size);
     if (!res->buf) {
         fprintf(stderr, "错误: 分配缓冲区失败\n");
         return -1;
     }
-    memset(res->buf, 0, res->buf_size);
-    printf("分配缓冲区: %u 字节\n", res->buf_size);
+    printf("分配缓冲区: %zu 字节 (页大小: %s)\n", res->buf_size,
+           buf_page_size_str(res->buf_page_size));
 
-    /* 8. 注册Memory Region (MR) */
-    res->mr = ibv_reg_mr(res->pd, res->buf, res->buf_size,
-                         IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ |
-                         IBV_ACCESS_REMOTE_WRITE);
+    /* 8. 注册Memory Region (MR)，设备支持原子操作时开放远端原子访问 */
+    access = rdma_access_flags(res->dev_attr.atomic_cap);
+    gettimeofday(&reg_t0, NULL);
+    res->mr = ibv_reg_mr(res->pd, res->buf, res->buf_size, access);
+    gettimeofday(&reg_t1, NULL);
     if (!res->mr) {
         fprintf(stderr, "错误: 注册MR失败\n");
         return -1;
     }
     printf("成功注册MR\n");
     printf("  - MR地址: %p\n", res->buf);
-    printf("  - MR长度: %u\n", res->buf_size);
+    printf("  - MR长度: %zu\n", res->buf_size);
     printf("  - MR lkey: 0x%x\n", res->mr->lkey);
     printf("  - MR rkey: 0x%x\n", res->mr->rkey);
+    printf("  - 注册耗时: %ld us\n", (long)((reg_t1.tv_sec - reg_t0.tv_sec) * 1000000L +
+                                           (reg_t1.tv_usec - reg_t0.tv_usec)));
 
     /* 9. 创建Completion Queue (CQ) - 多QP共享一个CQ */
     printf("\n========== 步骤7: 创建Completion Queue (多QP共享) ==========\n");
-    res->cq = ibv_create_cq(res->context, CQ_SIZE, NULL, NULL, 0);
+    res->comp_channel = ibv_create_comp_channel(res->context);
+    if (!res->comp_channel) {
+        fprintf(stderr, "错误: 创建Completion Channel失败\n");
+        return -1;
+    }
+    /* 非阻塞fd既可放入epoll，也便于带超时地等待CQ事件 */
+    if (fcntl(res->comp_channel->fd, F_SETFL,
+              fcntl(res->comp_channel->fd, F_GETFL) | O_NONBLOCK) < 0) {
+        fprintf(stderr, "错误: 设置Completion Channel为非阻塞失败\n");
+        return -1;
+    }
+
+    res->cq = ibv_create_cq(res->context, CQ_SIZE, NULL, res->comp_channel, 0);
     if (!res->cq) {
         fprintf(stderr, "错误: 创建CQ失败\n");
         return -1;
     }
-    printf("成功创建CQ (大小: %d)\n", CQ_SIZE);
+    printf("成功创建CQ (大小: %d, 事件通道fd: %d)\n", CQ_SIZE, res->comp_channel->fd);
 
     /* 10. 分配QP列表 */
     printf("\n========== 步骤8: 分配QP列表 ==========\n");
@@ -152,6 +215,12 @@ int init_rdma_resources(struct rdma_resources *res,
         return -1;
     }
     memset(res->qp_list, 0, sizeof(struct ibv_qp *) * res->num_qp);
+
+    res->qp_ctx = qp_ctx_alloc(res->num_qp);
+    if (!res->qp_ctx) {
+        fprintf(stderr, "错误: 分配QP上下文失败\n");
+        return -1;
+    }
     printf("分配QP列表: %u个QP\n", res->num_qp);
 
     return 0;
@@ -161,13 +230,18 @@ int init_rdma_resources(struct rdma_resources *res,
 
 /* Network functions moved to rdma_common_net.c */
 
-/* Work request and polling functions moved to rdma_common_net.c */
+/* Work request functions moved to rdma_common_net.c */
+
+/* Completion polling functions moved to rdma_common_poll.c */
 
 /* Utility functions moved to rdma_common_utils.c */
 
 void cleanup_rdma_resources(struct rdma_resources *res) {
     printf("\n========== 清理RDMA资源 ==========\n");
 
+    /* 监视线程会访问QP列表，必须最先停止 */
+    async_monitor_stop(res);
+
     if (res->qp_list) {
         for (uint32_t i = 0; i < res->num_qp; i++) {
             if (res->qp_list[i]) {
@@ -178,17 +252,32 @@ void cleanup_rdma_resources(struct rdma_resources *res) {
         free(res->qp_list);
         printf("释放QP列表\n");
     }
+    if (res->qp_ctx) {
+        for (uint32_t i = 0; i < res->num_qp; i++) {
+            free(res->qp_ctx[i].sig_ring);
+        }
+        free(res->qp_ctx);
+        res->qp_ctx = NULL;
+    }
+    /* SRQ和每线程CQ必须在挂在其上的QP全部销毁之后才能销毁 */
+    srq_destroy(res);
+    worker_destroy(res);
 
     if (res->cq) {
         ibv_destroy_cq(res->cq);
         printf("销毁CQ\n");
     }
+    /* 必须在CQ销毁之后才能销毁其关联的channel */
+    if (res->comp_channel) {
+        ibv_destroy_comp_channel(res->comp_channel);
+        printf("销毁Completion Channel\n");
+    }
     if (res->mr) {
         ibv_dereg_mr(res->mr);
         printf("注销MR\n");
     }
     if (res->buf) {
-        free(res->buf);
+        rdma_buf_free(res->buf, res->buf_size, res->buf_page_size);
         printf("释放缓冲区\n");
     }
     if (res->pd) {
@@ -37,10 +37,24 @@
 #define DEFAULT_PORT 18515
 #define DEFAULT_MSG_SIZE 4096
 #define DEFAULT_NUM_QP 4  /* 默认QP数量 */
-#define MAX_QP 16  /* 最大QP数量 */
+#define MAX_QP 65536  /* 每进程QP数上限，只用于参数和对端数据校验，QP相关数组均按实际数量分配 */
 #define MAX_WR 16  /* 最大Work Request数量 */
-#define MAX_SGE 1  /* 每个WR的Scatter-Gather Element数量 */
-#define CQ_SIZE 256 /* Completion Queue大小 (扩大以支持多QP) */
+#define DEFAULT_SIGNAL_INTERVAL 1  /* 每N个发送WR产生一个CQE，1表示全部signaled */
+#define DEFAULT_MAX_INLINE 64  /* 创建QP时请求的内联数据容量(字节) */
+#define MAX_SGE 1  /* 单SGE接口（旧接口、SRQ）每个WR的Scatter-Gather Element数量 */
+#define DEFAULT_MAX_SGE 4  /* 创建QP时请求的每WR SGE数，按设备max_sge裁剪 */
+#define MAX_SGE_LIMIT 16  /* 多SGE投递接口支持的SGE上限 */
+#define CQ_SIZE 256 /* CQ的最小容量，create_qp_list()按QP数×队列深度扩容 */
+#define DEFAULT_RD_ATOMIC 16  /* 请求的每QP未完成RDMA READ/原子操作深度 */
+
+/* 完成队列轮询参数 */
+#define POLL_BATCH_SIZE 32        /* 单次ibv_poll_cq最多取出的WC数量 */
+#define POLL_CHECK_INTERVAL 1024  /* 连续空轮询多少次才检查一次超时 */
+#define POLL_TIMEOUT_MS 5000      /* 阻塞式轮询的默认超时(毫秒) */
+#define DEFAULT_SPIN_BUDGET_US 50 /* 混合模式下睡眠前的自旋预算(微秒) */
+
+#include "rdma_common_ctx.h"
+#include "rdma_common_mem.h"
 
 /**
  * RDMA资源结构体
@@ -53,12 +67,34 @@ struct rdma_resources {
     struct ibv_device *ib_dev;         /* 选择的IB设备 */
     struct ibv_context *context;       /* 设备上下文 */
     struct ibv_pd *pd;                 /* Protection Domain (保护域) */
+    struct ibv_device_attr dev_attr;   /* 设备能力，打开设备后查询一次 */
 
     /* 通信相关 */
     struct ibv_mr *mr;                 /* Memory Region (内存区域) */
     struct ibv_cq *cq;                 /* Completion Queue (完成队列，多QP共享) */
+    struct ibv_comp_channel *comp_channel; /* CQ的完成事件通道，fd可放入epoll */
+    int cq_armed;                      /* 是否已调用ibv_req_notify_cq且事件尚未取走 */
     struct ibv_qp **qp_list;           /* Queue Pair数组 */
+    struct qp_ctx *qp_ctx;             /* 每个QP的运行时上下文，与qp_list对应 */
+    struct srq_ctx *srq;               /* 共享接收队列，NULL表示每个QP独立接收 */
+    struct worker_group *workers;      /* 工作线程组（每线程一个CQ），NULL表示单线程 */
+    struct async_monitor *async;       /* 异步事件监视线程，NULL表示未启动 */
+    uint32_t fault_gen;                /* 监视线程收到的故障事件数（原子访问） */
     uint32_t num_qp;                   /* QP数量 */
+    uint32_t sq_depth;                 /* 每个QP发送队列深度(max_send_wr) */
+    uint32_t rq_depth;                 /* 每个QP接收队列深度(max_recv_wr) */
+    uint32_t signal_interval;          /* 选择性signaling间隔，1表示每个WR都signaled */
+    uint32_t max_inline_req;           /* 创建QP时请求的内联容量，0表示不使用内联 */
+    uint32_t max_inline_data;          /* 设备实际授予的内联容量（所有QP的最小值） */
+    uint32_t max_sge;                  /* 每个WR的SGE数上限（已按设备上限裁剪） */
+    uint8_t max_rd_atomic;             /* 本端发起端READ/原子深度（已按设备上限裁剪） */
+    uint8_t max_dest_rd_atomic;        /* 本端响应端READ/原子资源（已按设备上限裁剪） */
+
+    /* 轮询参数 */
+    uint32_t poll_timeout_ms;          /* 阻塞式轮询超时(毫秒) */
+    uint32_t poll_check_interval;      /* 每多少次空轮询检查一次超时 */
+    enum poll_mode poll_mode;          /* CQ为空时的等待方式 */
+    uint32_t spin_budget_us;           /* 混合模式的自旋预算(微秒) */
 
     /* 端口信息 */
     struct ibv_port_attr port_attr;    /* 端口属性 */
@@ -67,9 +103,28 @@ struct rdma_resources {
 
     /* 缓冲区 */
     char *buf;                         /* 数据缓冲区 */
-    uint32_t buf_size;                 /* 缓冲区大小 */
+    size_t buf_size;                   /* 缓冲区大小，可超过4GB，单个WR只能访问前4GB */
+    uint32_t buf_page_size;            /* 缓冲区页大小，0为malloc，BUF_PAGE_THP为透明大页 */
+
+    /* 资源统计 */
+    size_t qp_mem_bytes;               /* create_qp_list()前后的常驻内存增量 */
 };
 
+/**
+ * MR和QP(INIT)共用的访问权限：本地写、远端读写，设备支持原子操作时加远端原子
+ *
+ * 响应端的MR和QP都必须带IBV_ACCESS_REMOTE_ATOMIC，缺任何一个原子操作都会
+ * 以远端访问错误完成。
+ */
+static inline int rdma_access_flags(enum ibv_atomic_cap atomic_cap) {
+    int access = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+
+    if (atomic_cap != IBV_ATOMIC_NONE) {
+        access |= IBV_ACCESS_REMOTE_ATOMIC;
+    }
+    return access;
+}
+
 /**
  * 连接信息结构体
  * 用于在客户端和服务端之间交换QP连接所需的信息
@@ -79,16 +134,26 @@ struct cm_con_data_t {
     uint32_t qp_num;                   /* QP号 */
     uint16_t lid;                      /* Local ID */
     uint8_t gid[16];                   /* GID (全局ID) */
+    uint64_t addr;                     /* 该QP可供远端访问的缓冲区地址 */
+    uint32_t rkey;                     /* 缓冲区所在MR的rkey */
+    uint32_t len;                      /* 可访问的长度，0表示不开放单边访问 */
+    uint8_t rd_atomic;                 /* 本端作为响应方能接受的未完成READ/原子数 */
 } __attribute__((packed));
 
 /**
- * 多QP连接信息结构体
- * 包含所有QP的连接信息
+ * RDMA资源初始化配置
+ * 参数多于init_rdma_resources()能容纳的数量时使用，见init_rdma_resources_cfg()
  */
-struct cm_con_data_multi_t {
-    uint32_t num_qp;                   /* QP数量 */
-    struct cm_con_data_t qp_data[MAX_QP];  /* 多个QP的连接信息 */
-} __attribute__((packed));
+struct rdma_config {
+    const char *dev_name;              /* 设备名称，NULL表示使用第一个设备 */
+    uint8_t ib_port;                   /* IB端口号 */
+    int gid_idx;                       /* GID索引 */
+    uint32_t num_qp;                   /* QP数量，0表示DEFAULT_NUM_QP */
+    size_t buf_size;                   /* 数据缓冲区大小，0表示DEFAULT_MSG_SIZE */
+    uint32_t rd_atomic;                /* 请求的READ/原子深度，0表示DEFAULT_RD_ATOMIC */
+    enum buf_page_mode buf_page;       /* 缓冲区页大小，默认malloc，见rdma_common_mem.h */
+    uint32_t max_sge;                  /* 每个WR的SGE数，0表示DEFAULT_MAX_SGE */
+};
 
 /* 函数声明 */
 
@@ -112,7 +177,7 @@ void print_gid(union ibv_gid *gid);
  * 2. 打开指定的RDMA设备
  * 3. 分配Protection Domain (PD)
  * 4. 分配Memory Region (MR)
- * 5. 创建Completion Queue (CQ)
+ * 5. 创建Completion Channel和Completion Queue (CQ)
  * 6. 创建多个Queue Pair (QP)
  * 7. 修改QP状态到INIT
  *
@@ -127,7 +192,7 @@ void print_gid(union ibv_gid *gid);
  * @pre       res指针必须指向有效的rdma_resources结构
  * @post      res结构包含初始化的RDMA资源，QP处于INIT状态
  *
- * @note      num_qp不能超过MAX_QP (16)
+ * @note      num_qp不能超过MAX_QP
  * @note      此函数内部调用create_qp_list()和modify_qp_list_to_init()
  *
  * @see       cleanup_rdma_resources() 对应的清理函数
@@ -139,6 +204,31 @@ int init_rdma_resources(struct rdma_resources *res,
                         int gid_idx,
                         uint32_t num_qp);
 
+/**
+ * 用默认值填充初始化配置
+ *
+ * @param[out] cfg  配置结构体指针，必须非NULL
+ *
+ * @note      默认值：第一个设备、端口1、GID索引1、DEFAULT_NUM_QP个QP、
+ *            DEFAULT_MSG_SIZE字节缓冲区
+ */
+void rdma_config_init(struct rdma_config *cfg);
+
+/**
+ * 按配置结构体初始化RDMA资源
+ *
+ * 与init_rdma_resources()执行相同的步骤，额外支持指定缓冲区大小等参数。
+ *
+ * @param[out] res  RDMA资源结构体指针，必须非NULL
+ * @param[in]  cfg  初始化配置，必须非NULL，可先用rdma_config_init()填充默认值
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @see       init_rdma_resources()
+ */
+int init_rdma_resources_cfg(struct rdma_resources *res,
+                            const struct rdma_config *cfg);
+
 /**
  * 创建多个Queue Pair (QP)
  *
@@ -154,7 +244,15 @@ int init_rdma_resources(struct rdma_resources *res,
  * @post      res->qp_list数组分配并初始化，各QP处于RESET状态
  *
  * @note      此函数必须在init_rdma_resources()内部调用
- * @note      QP初始参数：max_send_wr/max_recv_wr=MAX_WR, max_sge=MAX_SGE
+ * @note      QP初始参数：max_send_wr=res->sq_depth, max_recv_wr=res->rq_depth,
+ *            max_sge=res->max_sge（深度默认为MAX_WR）
+ * @note      res->max_sge按设备max_sge和MAX_SGE_LIMIT裁剪，实际值写回res->max_sge
+ * @note      sq_sig_all=0，是否产生CQE由每个WR的IBV_SEND_SIGNALED决定，
+ *            见set_signal_interval()
+ * @note      按res->max_inline_req请求内联容量，设备拒绝时退回到不使用内联，
+ *            实际授予值写回res->max_inline_data
+ * @note      res->cq容量不足num_qp×(sq_depth + rq_depth)时用ibv_resize_cq扩容，
+ *            按设备max_cqe裁剪；创建前后的常驻内存增量记录在res->qp_mem_bytes
  *
  * @see       modify_qp_list_to_init() 转移QP到INIT状态
  */
@@ -200,6 +298,8 @@ int modify_qp_list_to_init(struct rdma_resources *res);
  *
  * @note      RoCEv2模式下必须设置GRH (Global Routing Header)
  * @note      此函数配置remote_ah, rq_psn, path_mtu等关键属性
+ * @note      同时把远端addr/rkey/len保存到res->qp_ctx，供单边操作使用
+ * @note      max_dest_rd_atomic取res->max_dest_rd_atomic
  *
  * @see       modify_qp_list_to_rts() 下一步状态转移
  */
@@ -221,55 +321,14 @@ int modify_qp_list_to_rtr(struct rdma_resources *res,
  * @post      所有QP转移到RTS状态
  *
  * @note      此函数配置sq_psn等发送相关属性
+ * @note      max_rd_atomic取本端发起端深度与对端响应资源的较小值，
+ *            结果记录在res->qp_ctx[i].rd_atomic
  * @note      只有处于RTS状态的QP才能投递发送请求
  *
  * @see       post_send_qp() 投递发送请求
  */
 int modify_qp_list_to_rts(struct rdma_resources *res);
 
-/**
- * 修改QP状态：RTR → RTS (Ready to Send)
- *
- * 将单个QP从Ready-To-Receive状态转移到Ready-To-Send状态。
- * 此函数是modify_qp_list_to_rts()的单QP版本。
- *
- * @param[in,out] res  RDMA资源结构体指针，必须非NULL
- *
- * @return    成功返回0，失败返回-1
- *
- * @pre       QP处于RTR状态
- * @post      QP转移到RTS状态
- *
- * @deprecated  建议使用modify_qp_list_to_rts()处理多QP
- * @see       modify_qp_list_to_rts()
- */
-int modify_qp_to_rts(struct rdma_resources *res);
-
-/**
- * 通过TCP socket交换多QP连接信息
- *
- * 在TCP连接上同步本地和远端QP的连接信息。
- * 首先发送本地连接信息，然后接收远端连接信息。
- *
- * @param[in]  sock              TCP socket文件描述符，必须已连接
- * @param[in]  local_con_data    本地QP连接信息数组，包含local_num_qp个元素
- * @param[in]  local_num_qp      本地QP数量
- * @param[out] remote_con_data   接收远端连接信息的缓冲区，必须足够容纳
- * @param[out] remote_num_qp     接收远端QP数量的指针，必须非NULL
- *
- * @return    成功返回0，失败返回-1
- *
- * @note      发送格式：num_qp (uint32_t) + qp_data[num_qp]
- * @note      接收格式同上
- *
- * @see       修改QP状态前必须调用此函数获取远端QP信息
- */
-int sock_sync_data_multi(int sock,
-                         struct cm_con_data_t *local_con_data,
-                         uint32_t local_num_qp,
-                         struct cm_con_data_t *remote_con_data,
-                         uint32_t *remote_num_qp);
-
 /**
  * 投递接收请求到指定QP
  *
@@ -309,6 +368,7 @@ int post_receive_qp(struct rdma_resources *res, uint32_t qp_idx);
  * @note      此函数内部循环调用post_receive_qp()
  *
  * @see       post_receive_qp() 投递单个QP
+ * @see       post_receive_batch() 单QP一次投递多个接收WR
  */
 int post_receive_all(struct rdma_resources *res);
 
@@ -331,6 +391,7 @@ int post_receive_all(struct rdma_resources *res);
  * @note      RDMA WRITE: 需要远端的RKEY和虚拟地址
  *
  * @see       post_receive_qp() 接收端必须先投递接收请求
+ * @see       post_send_batch() 链式投递多个WR，只敲一次门铃
  */
 int post_send_qp(struct rdma_resources *res, uint32_t qp_idx, enum ibv_wr_opcode opcode);
 
@@ -339,19 +400,23 @@ int post_send_qp(struct rdma_resources *res, uint32_t qp_idx, enum ibv_wr_opcode
  *
  * 阻塞式轮询多QP共享的完成队列(CQ)，等待指定数量的完成事件。
  * 可以获取发送完成和接收完成事件。
+ * 内部基于poll_completion_batch()实现，每次批量取出多个WC。
  *
  * @param[in]  res                   RDMA资源结构体指针，必须非NULL
  * @param[in]  expected_completions  期望的完成事件数量
- * @param[out] qp_idx                QP索引数组指针，接收每个完成事件对应的QP索引
- *                                   必须非NULL且包含sufficient空间
+ * @param[out] qp_idx                最后一个完成事件所属的QP索引，可为NULL
  *
- * @return    成功返回实际获取的完成事件数量，失败返回-1
+ * @return    成功返回0，失败返回-1
  *
  * @note      此函数会阻塞直到获取足够的完成事件或出错
  * @note      多QP场景：一个CQ可能接收来自多个QP的完成事件
- * @note      qp_idx数组使用工作请求ID(WR ID)的低位字节来推断QP索引
+ * @note      qp_idx使用工作请求ID(WR ID)的低32位推断QP索引，见WR_ID_QP()
  *
  * @see       投递请求后调用此函数等待完成
+ * @note      因完成事件失败而返回-1时，出错QP的qp_ctx[i].wc_error记录了失败状态，
+ *            可用qp_recover()只恢复该QP而不必释放全部资源，见rdma_common_recover.h
+ *
+ * @see       poll_completion_batch() 批量轮询接口
  */
 int poll_completion(struct rdma_resources *res, int expected_completions, int *qp_idx);
 
@@ -397,4 +462,7 @@ void cleanup_rdma_resources(struct rdma_resources *res);
  */
 int print_qp_state(struct rdma_resources *res, uint32_t qp_idx, const char *title);
 
+#include "rdma_common_net.h"
+#include "rdma_common_legacy.h"
+
 #endif /* RDMA_COMMON_H */
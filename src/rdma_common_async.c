@@ -0,0 +1,203 @@
+/**
+ * @file rdma_common_async.c
+ * @brief 异步事件监视线程实现：事件分发、健康状态更新、唤醒睡眠的轮询者
+ */
+
+#include "rdma_common_async.h"
+#include "rdma_common_srq.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+struct async_monitor {
+    struct rdma_resources *res;        /* 启动者，拥有context */
+    async_handler_t handler;           /* NULL时故障事件打印警告 */
+    void *arg;
+    pthread_t thread;
+    int stop_fd;                       /* eventfd，可读时线程退出 */
+    int wake_fd;                       /* eventfd，收到故障事件时写入 */
+    uint64_t events;                   /* 收到的事件总数 */
+};
+
+/* QP i是否受事件影响 */
+static int async_hits_qp(const struct rdma_resources *res, const struct ibv_async_event *ev,
+                         uint32_t i) {
+    struct ibv_cq *cq = res->qp_ctx[i].cq ? res->qp_ctx[i].cq : res->cq;
+
+    switch (async_event_scope(ev->event_type)) {
+        case ASYNC_SCOPE_QP:
+            return res->qp_list[i] == ev->element.qp;
+        case ASYNC_SCOPE_CQ:
+            return cq == ev->element.cq;
+        case ASYNC_SCOPE_SRQ:
+            return res->srq && res->srq->srq == ev->element.srq;
+        case ASYNC_SCOPE_PORT:
+            return ev->element.port_num == res->ib_port;
+        default:
+            return 1;
+    }
+}
+
+/*
+ * 更新res中受影响QP的健康状态
+ *
+ * @return  命中的QP数；*qp_idx为QP事件命中的下标，其他为-1
+ */
+static uint32_t async_apply(struct rdma_resources *res, const struct ibv_async_event *ev,
+                            int *qp_idx) {
+    uint32_t set = async_event_health(ev->event_type);
+    uint32_t hits = 0;
+    uint32_t i;
+
+    *qp_idx = -1;
+    for (i = 0; res->qp_list && i < res->num_qp; i++) {
+        if (!res->qp_list[i] || !async_hits_qp(res, ev, i)) {
+            continue;
+        }
+        hits++;
+        if (async_event_scope(ev->event_type) == ASYNC_SCOPE_QP) {
+            *qp_idx = (int)i;
+        }
+        if (ev->event_type == IBV_EVENT_PORT_ACTIVE) {
+            __atomic_and_fetch(&res->qp_ctx[i].health, ~QP_HEALTH_PORT_DOWN, __ATOMIC_RELEASE);
+        } else if (set) {
+            __atomic_or_fetch(&res->qp_ctx[i].health, set, __ATOMIC_RELEASE);
+        }
+    }
+    /* 补投由数据路径线程做，这里只转交事件；低水位事件只需处理一次 */
+    if (ev->event_type == IBV_EVENT_SRQ_LIMIT_REACHED && res->srq &&
+        res->srq->srq == ev->element.srq) {
+        __atomic_add_fetch(&res->srq->limit_pending, 1, __ATOMIC_RELEASE);
+        hits++;
+    }
+    if (hits && (set & QP_HEALTH_FAULT_MASK)) {
+        __atomic_add_fetch(&res->fault_gen, 1, __ATOMIC_RELEASE);
+    }
+    return hits;
+}
+
+/* 更新健康状态并调用处理函数，返回是否为故障事件 */
+static int async_dispatch(struct async_monitor *m, const struct ibv_async_event *ev) {
+    int fault = (async_event_health(ev->event_type) & QP_HEALTH_FAULT_MASK) != 0;
+    int qp_idx;
+
+    if (async_apply(m->res, ev, &qp_idx) == 0) {
+        fprintf(stderr, "警告: 异步事件: %s (不属于本资源的QP)\n",
+                ibv_event_type_str(ev->event_type));
+        return 0;
+    }
+    if (m->handler) {
+        m->handler(m->res, qp_idx, ev, m->arg);
+    } else if (fault) {
+        fprintf(stderr, "警告: 异步事件: %s (QP[%d])\n",
+                ibv_event_type_str(ev->event_type), qp_idx);
+    }
+    return fault;
+}
+
+static void *async_thread(void *arg) {
+    struct async_monitor *m = arg;
+    struct ibv_async_event ev;
+    struct pollfd pfd[2];
+    uint64_t one = 1;
+    int faults;
+
+    pfd[0].fd = m->res->context->async_fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = m->stop_fd;
+    pfd[1].events = POLLIN;
+    for (;;) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "错误: 等待异步事件失败: %s\n", strerror(errno));
+            break;
+        }
+        if (pfd[1].revents) {
+            break;
+        }
+        faults = 0;
+        /* async_fd为非阻塞，一次取完所有已到达的事件 */
+        while (pfd[0].revents && ibv_get_async_event(m->res->context, &ev) == 0) {
+            m->events++;
+            faults += async_dispatch(m, &ev);
+            ibv_ack_async_event(&ev);
+        }
+        if (faults && write(m->wake_fd, &one, sizeof(one)) < 0) {
+            fprintf(stderr, "警告: 唤醒轮询线程失败: %s\n", strerror(errno));
+        }
+    }
+    return NULL;
+}
+
+int async_monitor_start(struct rdma_resources *res, async_handler_t handler, void *arg) {
+    struct async_monitor *m;
+    int flags;
+
+    if (!res || !res->context || res->async) {
+        fprintf(stderr, "错误: 设备未打开或异步事件监视已启动\n");
+        return -1;
+    }
+    m = calloc(1, sizeof(*m));
+    if (!m) {
+        fprintf(stderr, "错误: 分配异步事件监视状态失败\n");
+        return -1;
+    }
+    m->res = res;
+    m->handler = handler;
+    m->arg = arg;
+    m->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m->stop_fd < 0 || m->wake_fd < 0) {
+        fprintf(stderr, "错误: 创建eventfd失败: %s\n", strerror(errno));
+        goto err;
+    }
+    flags = fcntl(res->context->async_fd, F_GETFL);
+    if (flags < 0 || fcntl(res->context->async_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        fprintf(stderr, "错误: 设置async_fd为非阻塞失败\n");
+        goto err;
+    }
+    if (pthread_create(&m->thread, NULL, async_thread, m)) {
+        fprintf(stderr, "错误: 创建异步事件监视线程失败\n");
+        goto err;
+    }
+    res->async = m;
+    printf("异步事件监视线程已启动\n");
+    return 0;
+
+err:
+    if (m->stop_fd >= 0) {
+        close(m->stop_fd);
+    }
+    if (m->wake_fd >= 0) {
+        close(m->wake_fd);
+    }
+    free(m);
+    return -1;
+}
+
+void async_monitor_stop(struct rdma_resources *res) {
+    struct async_monitor *m = res ? res->async : NULL;
+    uint64_t one = 1;
+
+    if (!m) {
+        return;
+    }
+    if (write(m->stop_fd, &one, sizeof(one)) < 0) {
+        fprintf(stderr, "警告: 通知异步事件监视线程退出失败: %s\n", strerror(errno));
+    }
+    pthread_join(m->thread, NULL);
+    res->async = NULL;
+    close(m->stop_fd);
+    close(m->wake_fd);
+    printf("停止异步事件监视线程 (收到%llu个事件, 故障%u次)\n",
+           (unsigned long long)m->events, async_fault_gen(res));
+    free(m);
+}
+
+int async_wake_fd(const struct rdma_resources *res) {
+    return res && res->async ? res->async->wake_fd : -1;
+}
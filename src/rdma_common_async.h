@@ -0,0 +1,155 @@
+/**
+ * @file rdma_common_async.h
+ * @brief 异步事件监视线程：把设备异步事件实时转成每QP健康状态
+ *
+ * 端口down、QP致命错误、CQ溢出等故障由设备通过async_fd上报，
+ * 不读取时数据路径只能等到poll_completion_batch()超时（默认5秒）才发现。
+ * async_monitor_start()为设备上下文启动一个线程阻塞在async_fd上：
+ *
+ * - 每个事件按类型找到受影响的QP（QP事件按QP指针，CQ事件按QP绑定的CQ，
+ *   SRQ事件按res->srq，端口事件按res->ib_port，设备致命错误影响全部QP），
+ *   原子地置位qp_ctx[i].health中的QP_HEALTH_*位
+ * - 故障事件（QP_HEALTH_FAULT_MASK）递增res->fault_gen并唤醒睡眠在
+ *   completion channel上的轮询者；poll_completion_batch()发现fault_gen
+ *   在等待期间变化即返回-1，故障在事件到达后立即上报而不是等到超时
+ * - 调用启动时传入的处理函数
+ *
+ * 数据路径用qp_health()读取状态，只是一次原子load，没有锁和系统调用。
+ *
+ * @note 启动后async_fd由监视线程独占。SRQ低水位事件只记入
+ *       res->srq->limit_pending，补投仍由数据路径线程的srq_poll_events()完成
+ *       （SRQ槽位表不加锁）
+ * @see rdma_common_async.c, rdma_common_recover.h
+ */
+
+#ifndef RDMA_COMMON_ASYNC_H
+#define RDMA_COMMON_ASYNC_H
+
+#include "rdma_common.h"
+
+/* qp_ctx.health的状态位 */
+#define QP_HEALTH_QP_FATAL   (1u << 0)     /* QP_FATAL/QP_REQ_ERR/QP_ACCESS_ERR，QP已进入ERR */
+#define QP_HEALTH_LAST_WQE   (1u << 1)     /* 挂在SRQ上的QP出错后不再消费RECV */
+#define QP_HEALTH_PORT_DOWN  (1u << 2)     /* 所在端口down，PORT_ACTIVE时清除 */
+#define QP_HEALTH_CQ_ERR     (1u << 3)     /* QP绑定的CQ溢出或出错，只能重建 */
+#define QP_HEALTH_SRQ_ERR    (1u << 4)     /* QP使用的SRQ出错，只能重建 */
+#define QP_HEALTH_DEV_FATAL  (1u << 5)     /* 设备致命错误，只能重建 */
+
+/* 会中止等待的故障位；LAST_WQE是QP已出错后的附带通知，不再计一次故障 */
+#define QP_HEALTH_FAULT_MASK (QP_HEALTH_QP_FATAL | QP_HEALTH_PORT_DOWN | QP_HEALTH_CQ_ERR | \
+                              QP_HEALTH_SRQ_ERR | QP_HEALTH_DEV_FATAL)
+/* qp_reconnect()成功后清除的位 */
+#define QP_HEALTH_RECOVERABLE (QP_HEALTH_QP_FATAL | QP_HEALTH_LAST_WQE)
+
+/**
+ * 异步事件处理函数，在监视线程上调用（健康状态已更新）
+ *
+ * @param res     受影响的rdma_resources
+ * @param qp_idx  QP事件为QP下标，CQ/SRQ/端口/设备事件为-1
+ * @param ev      事件，返回后由监视线程ack
+ * @param arg     async_monitor_start()传入的用户参数
+ *
+ * @note 不能在处理函数中调用async_monitor_*()；访问数据路径状态需自行同步
+ */
+typedef void (*async_handler_t)(struct rdma_resources *res, int qp_idx,
+                                const struct ibv_async_event *ev, void *arg);
+
+/**
+ * 事件类型对应的健康状态位，不影响健康状态的事件返回0
+ */
+static inline uint32_t async_event_health(enum ibv_event_type type) {
+    switch (type) {
+        case IBV_EVENT_QP_FATAL:
+        case IBV_EVENT_QP_REQ_ERR:
+        case IBV_EVENT_QP_ACCESS_ERR:
+            return QP_HEALTH_QP_FATAL;
+        case IBV_EVENT_QP_LAST_WQE_REACHED:
+            return QP_HEALTH_LAST_WQE;
+        case IBV_EVENT_PORT_ERR:
+            return QP_HEALTH_PORT_DOWN;
+        case IBV_EVENT_CQ_ERR:
+            return QP_HEALTH_CQ_ERR;
+        case IBV_EVENT_SRQ_ERR:
+            return QP_HEALTH_SRQ_ERR;
+        case IBV_EVENT_DEVICE_FATAL:
+            return QP_HEALTH_DEV_FATAL;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * 事件的作用范围，决定按哪个对象匹配受影响的QP
+ */
+enum async_scope {
+    ASYNC_SCOPE_QP = 0,                /* element.qp，只影响这一个QP */
+    ASYNC_SCOPE_CQ,                    /* element.cq，影响绑定到该CQ的QP */
+    ASYNC_SCOPE_SRQ,                   /* element.srq，影响挂在该SRQ上的QP */
+    ASYNC_SCOPE_PORT,                  /* element.port_num，影响该端口上的QP */
+    ASYNC_SCOPE_DEVICE,                /* 影响设备上的全部QP */
+};
+
+/**
+ * 事件类型的作用范围，未列出的类型都是QP事件
+ */
+static inline enum async_scope async_event_scope(enum ibv_event_type type) {
+    switch (type) {
+        case IBV_EVENT_CQ_ERR:
+            return ASYNC_SCOPE_CQ;
+        case IBV_EVENT_SRQ_ERR:
+        case IBV_EVENT_SRQ_LIMIT_REACHED:
+            return ASYNC_SCOPE_SRQ;
+        case IBV_EVENT_PORT_ACTIVE:
+        case IBV_EVENT_PORT_ERR:
+        case IBV_EVENT_LID_CHANGE:
+        case IBV_EVENT_PKEY_CHANGE:
+        case IBV_EVENT_SM_CHANGE:
+        case IBV_EVENT_CLIENT_REREGISTER:
+        case IBV_EVENT_GID_CHANGE:
+            return ASYNC_SCOPE_PORT;
+        case IBV_EVENT_DEVICE_FATAL:
+            return ASYNC_SCOPE_DEVICE;
+        default:
+            return ASYNC_SCOPE_QP;
+    }
+}
+
+/**
+ * 读取QP i的健康状态位，0表示监视线程未收到任何异常
+ */
+static inline uint32_t qp_health(const struct rdma_resources *res, uint32_t i) {
+    return __atomic_load_n(&res->qp_ctx[i].health, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * 读取故障计数，前后两次读取不同说明期间收到了故障事件
+ */
+static inline uint32_t async_fault_gen(const struct rdma_resources *res) {
+    return __atomic_load_n(&res->fault_gen, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * 为res->context启动监视线程
+ *
+ * @param[in] handler  res的事件处理函数，NULL时故障事件打印警告
+ * @param[in] arg      处理函数的用户参数
+ *
+ * @return    成功返回0，已启动或创建线程失败返回-1
+ * @pre       QP已全部创建（监视线程只读res->qp_list，不与建链并发修改）
+ * @post      res->async非NULL；cleanup_rdma_resources()会停止线程
+ */
+int async_monitor_start(struct rdma_resources *res, async_handler_t handler, void *arg);
+
+/**
+ * 停止监视线程，未启动监视时什么都不做
+ */
+void async_monitor_stop(struct rdma_resources *res);
+
+/**
+ * 唤醒睡眠中轮询者的fd（eventfd），未启动监视时返回-1
+ *
+ * 可读说明有新的故障事件；读出8字节计数即可清除。
+ */
+int async_wake_fd(const struct rdma_resources *res);
+
+#endif /* RDMA_COMMON_ASYNC_H */
@@ -0,0 +1,104 @@
+/**
+ * @file rdma_common_atomic.h
+ * @brief RDMA原子操作接口 - 远端8字节槽位上的FETCH_AND_ADD与CMP_AND_SWP
+ *
+ * 原子操作是一种特殊的单边操作：
+ * - 目标必须是对端MR中8字节对齐的64位整数
+ * - 操作前的原值写回本地缓冲区的一个8字节槽位
+ * - 与READ一样占用max_rd_atomic/max_dest_rd_atomic资源
+ * - 设备必须支持原子操作(ibv_device_attr.atomic_cap != IBV_ATOMIC_NONE)，
+ *   MR注册时带IBV_ACCESS_REMOTE_ATOMIC
+ *
+ * 槽位从缓冲区末尾划出，两端缓冲区大小相同时槽位偏移也相同，
+ * 因此不需要额外交换槽位地址。
+ *
+ * @see rdma_common_atomic.c, rdma_common_rdma.h
+ */
+
+#ifndef RDMA_COMMON_ATOMIC_H
+#define RDMA_COMMON_ATOMIC_H
+
+#include "rdma_common.h"
+
+#define ATOMIC_SLOT_SIZE  8            /* 原子槽位大小，也是对齐要求 */
+
+/**
+ * 一次原子操作的参数
+ */
+struct atomic_op {
+    uint32_t local_off;                /* 本地res->buf中接收原值的槽位偏移 */
+    uint32_t remote_off;               /* 远端缓冲区中的目标槽位偏移 */
+    uint64_t compare_add;              /* CAS的比较值，或FAA的加数 */
+    uint64_t swap;                     /* CAS的交换值，FAA忽略 */
+};
+
+/**
+ * 从缓冲区末尾划出nslots个原子槽位
+ *
+ * @param[in]  buf_size  缓冲区大小，超过4GB时从前4GB的末尾划出
+ * @param[in]  nslots    槽位数，必须 > 0
+ * @param[out] base_off  第一个槽位的偏移，8字节对齐
+ *
+ * @return    成功返回0，缓冲区放不下返回-1
+ */
+static inline int atomic_slots_carve(size_t buf_size, uint32_t nslots,
+                                     uint32_t *base_off) {
+    uint64_t need = (uint64_t)nslots * ATOMIC_SLOT_SIZE;
+    uint32_t window = buf_window(buf_size);
+
+    if (nslots == 0 || need > window) {
+        return -1;
+    }
+    *base_off = (uint32_t)((window - need) & ~(uint64_t)(ATOMIC_SLOT_SIZE - 1));
+    return 0;
+}
+
+/**
+ * 第idx个槽位的偏移
+ */
+static inline uint32_t atomic_slot_off(uint32_t base_off, uint32_t idx) {
+    return base_off + idx * ATOMIC_SLOT_SIZE;
+}
+
+/**
+ * 投递一个原子操作
+ *
+ * @param[in] res     RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx  QP索引，必须 < res->num_qp
+ * @param[in] opcode  IBV_WR_ATOMIC_FETCH_AND_ADD或IBV_WR_ATOMIC_CMP_AND_SWP
+ * @param[in] op      操作参数
+ *
+ * @return    成功返回0，失败返回负错误码
+ * @retval -EOPNOTSUPP  设备不支持原子操作
+ * @retval -EINVAL      参数无效、槽位未8字节对齐或对端未开放单边访问
+ * @retval -ERANGE      本地或远端槽位越界
+ * @retval -EAGAIN      发送队列已满，需先轮询CQ回收
+ *
+ * @pre       QP已处于RTS状态
+ * @note      原值在CQE到达后才写入本地槽位；需要读取原值时应使
+ *            set_signal_interval(res, 1)，保证每个原子操作都有CQE
+ */
+int post_atomic_qp(struct rdma_resources *res, uint32_t qp_idx,
+                   enum ibv_wr_opcode opcode, const struct atomic_op *op);
+
+/**
+ * 远端FETCH_AND_ADD：*remote += add，原值写入本地槽位
+ *
+ * @return    同post_atomic_qp()
+ */
+int post_fetch_add_qp(struct rdma_resources *res, uint32_t qp_idx,
+                      uint32_t local_off, uint32_t remote_off, uint64_t add);
+
+/**
+ * 远端CMP_AND_SWP：若*remote == compare则写入swap，原值写入本地槽位
+ *
+ * 调用方比较本地槽位中的原值与compare判断交换是否成功。
+ *
+ * @param[in] op  compare_add为比较值，swap为交换值
+ *
+ * @return    同post_atomic_qp()
+ */
+int post_cmp_swap_qp(struct rdma_resources *res, uint32_t qp_idx,
+                     const struct atomic_op *op);
+
+#endif /* RDMA_COMMON_ATOMIC_H */
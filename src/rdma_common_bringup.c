@@ -0,0 +1,283 @@
+/**
+ * @file rdma_common_bringup.c
+ * @brief 并行建链实现：按块分发的线程池、逐块发送和接收连接信息、步骤计时
+ *
+ * 块的状态只用原子变量同步：next_local/next_remote是任务计数器，
+ * local_done[c]标记块c已到INIT，remote_ready是已收到的对端QP数（按块递增）。
+ * 等待方用sched_yield()自旋，同时检查failed，任何一方失败都不会卡住其他线程。
+ */
+
+#include "rdma_common_bringup.h"
+#include "rdma_common_poll.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+struct bringup_job {
+    struct rdma_resources *res;
+    int sock;
+    uint32_t nchunks;
+    uint32_t next_local;               /* 下一个待创建的块 */
+    uint32_t next_remote;              /* 下一个待迁移到RTS的块 */
+    uint32_t remote_ready;             /* 已收到的对端QP数 */
+    uint32_t inline_cap;               /* 所有QP授予的内联容量的最小值 */
+    int failed;
+    uint32_t *local_done;              /* 每块一个标志，块内QP都已到INIT */
+    union ibv_gid gid;
+    struct cm_con_data_t *local;
+    struct cm_con_data_t *remote;
+    uint64_t t0;
+    uint64_t step_ns[QP_STEP_COUNT];
+    uint64_t remote_done_ns;
+};
+
+/* 记录失败；第一个失败者关闭socket，唤醒阻塞在read上的接收线程并通知对端 */
+static void bringup_fail(struct bringup_job *job) {
+    if (__atomic_exchange_n(&job->failed, 1, __ATOMIC_ACQ_REL) == 0) {
+        shutdown(job->sock, SHUT_RDWR);
+    }
+}
+
+/* 等待*p达到v，期间有人失败则返回-1 */
+static int bringup_wait(const struct bringup_job *job, const uint32_t *p, uint32_t v) {
+    while (__atomic_load_n(p, __ATOMIC_ACQUIRE) < v) {
+        if (__atomic_load_n(&job->failed, __ATOMIC_ACQUIRE)) {
+            return -1;
+        }
+        sched_yield();
+    }
+    return 0;
+}
+
+/* 累加从*t到现在的耗时并把*t推进到现在 */
+static void bringup_tick(uint64_t *ns, enum qp_bringup_step step, uint64_t *t) {
+    uint64_t now = monotonic_ns();
+
+    ns[step] += now - *t;
+    *t = now;
+}
+
+/* 块c：创建 → INIT，填好连接信息后标记完成 */
+static int bringup_local_chunk(struct bringup_job *job, uint32_t c, uint64_t *ns) {
+    struct rdma_resources *res = job->res;
+    uint32_t first, n, i, cap, cur;
+    uint64_t t;
+
+    qp_bringup_chunk(res->num_qp, c, &first, &n);
+    for (i = first; i < first + n; i++) {
+        t = monotonic_ns();
+        if (qp_create_one(res, i, &cap)) {
+            return -1;
+        }
+        bringup_tick(ns, QP_STEP_CREATE, &t);
+        if (qp_modify_init(res, i)) {
+            return -1;
+        }
+        bringup_tick(ns, QP_STEP_INIT, &t);
+
+        cur = __atomic_load_n(&job->inline_cap, __ATOMIC_RELAXED);
+        while (cap < cur && !__atomic_compare_exchange_n(&job->inline_cap, &cur, cap, 0,
+                                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        con_data_fill_qp(res, i, &job->gid, &job->local[i]);
+    }
+    __atomic_store_n(&job->local_done[c], 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* 块c：等本端INIT和对端信息都就绪后 RTR → RTS */
+static int bringup_remote_chunk(struct bringup_job *job, uint32_t c, uint64_t *ns) {
+    struct rdma_resources *res = job->res;
+    uint32_t first, n, i;
+    uint64_t t;
+
+    qp_bringup_chunk(res->num_qp, c, &first, &n);
+    if (bringup_wait(job, &job->local_done[c], 1) ||
+        bringup_wait(job, &job->remote_ready, first + n)) {
+        return -1;
+    }
+    for (i = first; i < first + n; i++) {
+        t = monotonic_ns();
+        if (qp_modify_rtr(res, i, &job->remote[i])) {
+            return -1;
+        }
+        bringup_tick(ns, QP_STEP_RTR, &t);
+        if (qp_modify_rts(res, i)) {
+            return -1;
+        }
+        bringup_tick(ns, QP_STEP_RTS, &t);
+    }
+    return 0;
+}
+
+/* 线程池成员：先领取所有创建任务，再领取迁移任务 */
+static void *bringup_thread(void *arg) {
+    struct bringup_job *job = arg;
+    uint64_t ns[QP_STEP_COUNT] = {0};
+    uint32_t c;
+    int s;
+
+    while (!__atomic_load_n(&job->failed, __ATOMIC_ACQUIRE) &&
+           (c = __atomic_fetch_add(&job->next_local, 1, __ATOMIC_RELAXED)) < job->nchunks) {
+        if (bringup_local_chunk(job, c, ns)) {
+            bringup_fail(job);
+        }
+    }
+    while (!__atomic_load_n(&job->failed, __ATOMIC_ACQUIRE) &&
+           (c = __atomic_fetch_add(&job->next_remote, 1, __ATOMIC_RELAXED)) < job->nchunks) {
+        if (bringup_remote_chunk(job, c, ns)) {
+            bringup_fail(job);
+        }
+    }
+    for (s = 0; s < QP_STEP_COUNT; s++) {
+        __atomic_fetch_add(&job->step_ns[s], ns[s], __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/* 接收线程：读出对端QP数，之后每收到一块就推进remote_ready */
+static void *bringup_recv_thread(void *arg) {
+    struct bringup_job *job = arg;
+    uint32_t num_qp = job->res->num_qp;
+    uint32_t remote_num;
+    uint32_t first, n, c;
+
+    if (sock_read_full(job->sock, &remote_num, sizeof(remote_num))) {
+        fprintf(stderr, "错误: 接收远端QP数量失败\n");
+        bringup_fail(job);
+        return NULL;
+    }
+    if (remote_num != num_qp) {
+        fprintf(stderr, "错误: 远端QP数量(%u)与本端(%u)不一致\n", remote_num, num_qp);
+        bringup_fail(job);
+        return NULL;
+    }
+    for (c = 0; c < job->nchunks; c++) {
+        qp_bringup_chunk(num_qp, c, &first, &n);
+        if (sock_read_full(job->sock, &job->remote[first], n * sizeof(struct cm_con_data_t))) {
+            if (!__atomic_load_n(&job->failed, __ATOMIC_ACQUIRE)) {
+                fprintf(stderr, "错误: 接收远端QP[%u-%u]的连接信息失败\n", first, first + n - 1);
+            }
+            bringup_fail(job);
+            return NULL;
+        }
+        __atomic_store_n(&job->remote_ready, first + n, __ATOMIC_RELEASE);
+    }
+    job->remote_done_ns = monotonic_ns() - job->t0;
+    return NULL;
+}
+
+/* 主线程：先发QP数，再按块顺序发送已到INIT的块 */
+static int bringup_send(struct bringup_job *job) {
+    uint32_t num_qp = job->res->num_qp;
+    uint32_t first, n, c;
+
+    if (sock_write_full(job->sock, &num_qp, sizeof(num_qp))) {
+        fprintf(stderr, "错误: 发送QP数量失败\n");
+        return -1;
+    }
+    for (c = 0; c < job->nchunks; c++) {
+        if (bringup_wait(job, &job->local_done[c], 1)) {
+            return -1;
+        }
+        qp_bringup_chunk(num_qp, c, &first, &n);
+        if (sock_write_full(job->sock, &job->local[first], n * sizeof(struct cm_con_data_t))) {
+            fprintf(stderr, "错误: 发送QP[%u-%u]的连接信息失败\n", first, first + n - 1);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* 线程数：0表示取块数和在线CPU数的较小值，多于块数的线程没有任务 */
+static uint32_t bringup_threads(uint32_t threads, uint32_t nchunks) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (threads == 0) {
+        threads = cpus > 0 ? (uint32_t)cpus : 1;
+    }
+    if (threads > QP_BRINGUP_MAX_THREADS) {
+        threads = QP_BRINGUP_MAX_THREADS;
+    }
+    return threads < nchunks ? threads : nchunks;
+}
+
+int qp_bringup(struct rdma_resources *res, int sock, uint32_t threads,
+               struct qp_bringup_stats *st) {
+    pthread_t tids[QP_BRINGUP_MAX_THREADS];
+    pthread_t rx;
+    struct bringup_job job;
+    size_t rss0 = mem_rss_bytes();
+    size_t rss1;
+    uint32_t started = 0;
+    uint32_t i;
+    int rc = -1;
+
+    memset(&job, 0, sizeof(job));
+    job.res = res;
+    job.sock = sock;
+    job.nchunks = qp_bringup_chunks(res->num_qp);
+    threads = bringup_threads(threads, job.nchunks);
+
+    printf("\n========== 并行建链: %u个QP, %u个线程, 每块%u个 ==========\n",
+           res->num_qp, threads, QP_BRINGUP_CHUNK);
+    if (ibv_query_gid(res->context, res->ib_port, res->gid_idx, &job.gid)) {
+        fprintf(stderr, "错误: 查询GID失败\n");
+        return -1;
+    }
+    if (qp_list_prepare(res)) {
+        return -1;
+    }
+    job.inline_cap = res->max_inline_data;
+    job.local = malloc(res->num_qp * sizeof(struct cm_con_data_t));
+    job.remote = malloc(res->num_qp * sizeof(struct cm_con_data_t));
+    job.local_done = calloc(job.nchunks, sizeof(uint32_t));
+    if (!job.local || !job.remote || !job.local_done) {
+        fprintf(stderr, "错误: 分配建链状态失败\n");
+        goto out;
+    }
+
+    job.t0 = monotonic_ns();
+    if (pthread_create(&rx, NULL, bringup_recv_thread, &job)) {
+        fprintf(stderr, "错误: 创建接收线程失败\n");
+        goto out;
+    }
+    for (started = 0; started < threads; started++) {
+        if (pthread_create(&tids[started], NULL, bringup_thread, &job)) {
+            fprintf(stderr, "错误: 创建建链线程[%u]失败\n", started);
+            bringup_fail(&job);
+            break;
+        }
+    }
+    if (bringup_send(&job)) {
+        bringup_fail(&job);
+    }
+    if (st) {
+        memset(st, 0, sizeof(*st));
+        st->local_done_ns = monotonic_ns() - job.t0;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_join(rx, NULL);
+
+    res->max_inline_data = job.inline_cap;
+    rss1 = mem_rss_bytes();
+    res->qp_mem_bytes = rss1 > rss0 ? rss1 - rss0 : 0;
+    if (st) {
+        st->threads = started;
+        st->remote_done_ns = job.remote_done_ns;
+        st->total_ns = monotonic_ns() - job.t0;
+        memcpy(st->step_ns, job.step_ns, sizeof(st->step_ns));
+    }
+    rc = job.failed ? -1 : 0;
+    if (rc == 0) {
+        printf("成功建立 %u 个QP到RTS状态 (内联数据%u字节, 常驻内存增加%zu KB)\n",
+               res->num_qp, res->max_inline_data, res->qp_mem_bytes >> 10);
+    }
+out:
+    free(job.local);
+    free(job.remote);
+    free(job.local_done);
+    return rc;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file rdma_common_bringup.h
+ * @brief 并行、流水线式的QP建链：线程池创建和迁移QP，与TCP交换重叠
+ *
+ * create_qp_list()、modify_qp_list_to_*()逐个QP调用ibv_create_qp/ibv_modify_qp，
+ * 每次都是一次内核往返，几百个QP时建链要数秒，对端重启后的重连时间也随之拉长。
+ * qp_bringup()把QP按QP_BRINGUP_CHUNK个一块：
+ * - 线程池按块领取任务，对块内QP执行 创建 → INIT，完成后标记该块
+ * - 主线程按块顺序发送已就绪块的连接信息，接收线程同时读取对端的连接信息
+ * - 本端所有块创建完后，线程池再按块领取，对端信息到达的块立即执行 RTR → RTS
+ *
+ * 于是本端创建后面的QP、对端创建它的QP、双方交换前面块的信息这三件事同时进行。
+ * 线路格式与sock_exchange_con_data()相同（num_qp + cm_con_data_t[num_qp]），
+ * 对端用串行流程建链也能互通。
+ *
+ * 任一步骤失败时shutdown socket，让本端接收线程和对端都尽快退出等待。
+ *
+ * 调用顺序：init_rdma_resources_cfg() → [srq_init() / worker_init()] →
+ * 设置sq_depth/rq_depth → 建立TCP连接 → qp_bringup()。
+ *
+ * @see rdma_common_bringup.c, rdma_common_qp.c
+ */
+
+#ifndef RDMA_COMMON_BRINGUP_H
+#define RDMA_COMMON_BRINGUP_H
+
+#include "rdma_common.h"
+
+#define QP_BRINGUP_CHUNK        32     /* 每块的QP数，也是连接信息的发送粒度 */
+#define QP_BRINGUP_MAX_THREADS  64     /* 建链线程数上限 */
+
+/**
+ * 建链的各个verbs步骤
+ */
+enum qp_bringup_step {
+    QP_STEP_CREATE = 0,                /* ibv_create_qp */
+    QP_STEP_INIT,                      /* RESET -> INIT */
+    QP_STEP_RTR,                       /* INIT -> RTR */
+    QP_STEP_RTS,                       /* RTR -> RTS */
+    QP_STEP_COUNT
+};
+
+/**
+ * 建链耗时统计（纳秒）
+ *
+ * 各步骤在多个线程上重叠执行，step_ns是所有线程耗时之和，
+ * 除以QP数得到单次verbs调用的平均耗时；*_done_ns是从开始到该阶段全部完成的墙钟时间。
+ */
+struct qp_bringup_stats {
+    uint32_t threads;                  /* 实际使用的线程数 */
+    uint64_t step_ns[QP_STEP_COUNT];   /* 各步骤累计耗时 */
+    uint64_t local_done_ns;            /* 本端所有QP到INIT且连接信息已发出 */
+    uint64_t remote_done_ns;           /* 收齐对端连接信息 */
+    uint64_t total_ns;                 /* 所有QP到RTS */
+};
+
+/**
+ * 块数，最后一块可能不满
+ */
+static inline uint32_t qp_bringup_chunks(uint32_t num_qp) {
+    return (num_qp + QP_BRINGUP_CHUNK - 1) / QP_BRINGUP_CHUNK;
+}
+
+/**
+ * 块c包含的QP区间[*first, *first + *n)
+ */
+static inline void qp_bringup_chunk(uint32_t num_qp, uint32_t c, uint32_t *first, uint32_t *n) {
+    *first = c * QP_BRINGUP_CHUNK;
+    *n = num_qp - *first < QP_BRINGUP_CHUNK ? num_qp - *first : QP_BRINGUP_CHUNK;
+}
+
+/**
+ * 并行建链：创建所有QP并迁移到RTS，同时与对端交换连接信息
+ *
+ * @param[in,out] res      RDMA资源，QP尚未创建，sq_depth/rq_depth已确定
+ * @param[in]     sock     已连接的TCP socket
+ * @param[in]     threads  线程数，0表示按块数自动选择（不超过在线CPU数）
+ * @param[out]    st       耗时统计，可为NULL
+ *
+ * @return    成功返回0，失败返回-1（已创建的QP由cleanup_rdma_resources()释放）
+ *
+ * @post      与create_qp_list() + modify_qp_list_to_init/rtr/rts()的结果相同：
+ *            所有QP处于RTS，res->qp_ctx[i].remote_*保存对端缓冲区信息
+ * @note      对端QP数必须与本端相同
+ */
+int qp_bringup(struct rdma_resources *res, int sock, uint32_t threads,
+               struct qp_bringup_stats *st);
+
+/* ========== 单QP步骤（rdma_common_qp.c），串行和并行建链共用 ========== */
+
+/**
+ * 创建QP前的准备：裁剪SGE数、按QP数扩容共享CQ、重置内联阈值
+ *
+ * @return    成功返回0，CQ扩容失败返回-1
+ */
+int qp_list_prepare(struct rdma_resources *res);
+
+/**
+ * 创建QP i并分配其signaling记录
+ *
+ * @param[out] inline_cap  设备实际授予的内联容量，调用者取所有QP的最小值
+ *
+ * @return    成功返回0，失败返回-1
+ * @note      可在多个线程上对不同的i并发调用
+ */
+int qp_create_one(struct rdma_resources *res, uint32_t i, uint32_t *inline_cap);
+
+/**
+ * QP i: RESET -> INIT
+ */
+int qp_modify_init(struct rdma_resources *res, uint32_t i);
+
+/**
+ * QP i: INIT -> RTR，并记录对端缓冲区信息到res->qp_ctx[i]
+ *
+ * @param[in] remote  与QP i配对的对端连接信息
+ */
+int qp_modify_rtr(struct rdma_resources *res, uint32_t i, const struct cm_con_data_t *remote);
+
+/**
+ * QP i: RTR -> RTS，READ/原子深度取本端上限与对端响应能力的较小值
+ */
+int qp_modify_rts(struct rdma_resources *res, uint32_t i);
+
+#endif /* RDMA_COMMON_BRINGUP_H */
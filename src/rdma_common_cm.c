@@ -0,0 +1,239 @@
+/**
+ * @file rdma_common_cm.c
+ * @brief 基于librdmacm的QP建链实现（外部QP模式）
+ *
+ * 包括各建链步骤、被动端和断开；主动端见rdma_common_cm_connect.c。
+ * 只在make RDMACM=1时编译，否则编译rdma_common_cm_stub.c。
+ */
+
+#include "rdma_common_cm.h"
+
+#include <poll.h>
+#include <rdma/rdma_cma.h>
+
+#define CM_LISTEN_BACKLOG   1024
+#define CM_CLOSE_WAIT_MS    5000  /* 等待断开事件的上限，对端已消失时不无限等待 */
+
+int cm_check_device(const struct rdma_cm_id *id, const struct rdma_resources *res) {
+    const char *cm_dev = ibv_get_device_name(id->verbs->device);
+    const char *qp_dev = ibv_get_device_name(res->ib_dev);
+
+    if (strcmp(cm_dev, qp_dev) || id->port_num != res->ib_port) {
+        fprintf(stderr, "错误: 地址属于设备%s端口%u，QP在设备%s端口%u上，请用-d/-i指定\n",
+                cm_dev, id->port_num, qp_dev, res->ib_port);
+        return -1;
+    }
+    return 0;
+}
+
+int cm_qp_to_rts(struct rdma_cm_id *id, struct rdma_resources *res, uint32_t i,
+                 const struct cm_con_data_t *remote) {
+    static const enum ibv_qp_state states[] = { IBV_QPS_RTR, IBV_QPS_RTS };
+    static const char *names[] = { "RTR", "RTS" };
+    struct ibv_qp_attr attr;
+    uint32_t s;
+    int mask;
+
+    res->qp_ctx[i].remote_addr = remote->addr;
+    res->qp_ctx[i].remote_rkey = remote->rkey;
+    res->qp_ctx[i].remote_len = remote->len;
+    res->qp_ctx[i].remote_rd_atomic = remote->rd_atomic;
+    res->qp_ctx[i].rd_atomic = res->max_rd_atomic < remote->rd_atomic ? res->max_rd_atomic
+                                                                       : remote->rd_atomic;
+    for (s = 0; s < 2; s++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.qp_state = states[s];
+        if (rdma_init_qp_attr(id, &attr, &mask)) {
+            fprintf(stderr, "错误: 获取QP[%u]的%s属性失败\n", i, names[s]);
+            return -1;
+        }
+        /* rdma_cm按CM报文里的深度填写，这里换成双方协商后的值 */
+        if (states[s] == IBV_QPS_RTR) {
+            attr.max_dest_rd_atomic = res->max_dest_rd_atomic;
+        } else {
+            attr.max_rd_atomic = res->qp_ctx[i].rd_atomic;
+        }
+        if (ibv_modify_qp(res->qp_list[i], &attr, mask)) {
+            fprintf(stderr, "错误: 修改QP[%u]到%s状态失败\n", i, names[s]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int cm_fill_param(struct rdma_resources *res, uint32_t i, struct cm_con_data_t *local,
+                  struct rdma_conn_param *param) {
+    union ibv_gid gid;
+
+    if (ibv_query_gid(res->context, res->ib_port, res->gid_idx, &gid)) {
+        fprintf(stderr, "错误: 查询GID失败\n");
+        return -1;
+    }
+    con_data_fill_qp(res, i, &gid, local);
+
+    memset(param, 0, sizeof(*param));
+    param->private_data = local;
+    param->private_data_len = sizeof(*local);
+    param->responder_resources = res->max_dest_rd_atomic;
+    param->initiator_depth = res->max_rd_atomic;
+    param->retry_count = CM_RETRY_COUNT;
+    param->rnr_retry_count = CM_RNR_RETRY_COUNT;
+    param->srq = res->srq ? 1 : 0;
+    param->qp_num = res->qp_list[i]->qp_num;
+    return 0;
+}
+
+/* 私有数据可能被CM补齐到报文字段长度，只要求不短于连接信息 */
+int cm_read_private(const struct rdma_cm_event *ev, struct cm_con_data_t *remote) {
+    if (!ev->param.conn.private_data || ev->param.conn.private_data_len < sizeof(*remote)) {
+        fprintf(stderr, "错误: rdma_cm私有数据过短(%u字节)\n", ev->param.conn.private_data_len);
+        return -1;
+    }
+    memcpy(remote, ev->param.conn.private_data, sizeof(*remote));
+    return 0;
+}
+
+int cm_alloc_ids(struct cm_link *l, uint32_t num) {
+    if (l->ids && l->num_ids == num) {
+        return 0;
+    }
+    free(l->ids);
+    l->ids = calloc(num, sizeof(*l->ids));
+    l->num_ids = l->ids ? num : 0;
+    return l->ids ? 0 : -1;
+}
+
+int cm_link_listen(struct cm_link *l, int port) {
+    struct sockaddr_in sin;
+
+    memset(l, 0, sizeof(*l));
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = INADDR_ANY;
+    sin.sin_port = htons(port);
+
+    l->channel = rdma_create_event_channel();
+    if (!l->channel || rdma_create_id(l->channel, &l->listen_id, NULL, RDMA_PS_TCP) ||
+        rdma_bind_addr(l->listen_id, (struct sockaddr *)&sin) ||
+        rdma_listen(l->listen_id, CM_LISTEN_BACKLOG)) {
+        fprintf(stderr, "错误: rdma_cm监听端口%d失败: %s\n", port, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* 处理一个连接请求：迁移QP[i]并接受 */
+static int cm_accept_one(struct cm_link *l, struct rdma_resources *res,
+                         struct rdma_cm_event *ev, uint32_t i) {
+    struct rdma_conn_param param;
+    struct cm_con_data_t local;
+    struct cm_con_data_t remote;
+
+    l->ids[i] = ev->id;
+    if (cm_check_device(ev->id, res) || cm_read_private(ev, &remote) ||
+        cm_qp_to_rts(ev->id, res, i, &remote) || cm_fill_param(res, i, &local, &param)) {
+        rdma_reject(ev->id, NULL, 0);
+        return -1;
+    }
+    if (rdma_accept(ev->id, &param)) {
+        fprintf(stderr, "错误: rdma_accept QP[%u]失败: %s\n", i, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int cm_link_accept(struct cm_link *l, struct rdma_resources *res) {
+    struct rdma_cm_event *ev;
+    struct rdma_cm_id *extra;
+    uint32_t requested = 0;
+    uint32_t established = 0;
+    int rc = 0;
+
+    if (cm_alloc_ids(l, res->num_qp)) {
+        return -1;
+    }
+    /* 请求和上一条连接的ESTABLISHED可能交错到达，统一在一个循环里处理 */
+    while (rc == 0 && established < res->num_qp) {
+        if (rdma_get_cm_event(l->channel, &ev)) {
+            fprintf(stderr, "错误: 获取rdma_cm事件失败: %s\n", strerror(errno));
+            return -1;
+        }
+        extra = NULL;
+        if (ev->event == RDMA_CM_EVENT_CONNECT_REQUEST && requested < res->num_qp) {
+            rc = cm_accept_one(l, res, ev, requested++);
+        } else if (ev->event == RDMA_CM_EVENT_CONNECT_REQUEST) {
+            extra = ev->id;
+            rdma_reject(extra, NULL, 0);
+        } else if (ev->event == RDMA_CM_EVENT_ESTABLISHED) {
+            established++;
+        } else if (ev->event != RDMA_CM_EVENT_TIMEWAIT_EXIT) {
+            fprintf(stderr, "错误: 等待连接时收到rdma_cm事件%s (status=%d)\n",
+                    rdma_event_str(ev->event), ev->status);
+            rc = -1;
+        }
+        rdma_ack_cm_event(ev);
+        /* 请求事件确认之后才能销毁其cm_id，否则rdma_destroy_id()会一直等待 */
+        if (extra) {
+            rdma_destroy_id(extra);
+        }
+    }
+    return rc;
+}
+
+int cm_link_close(struct cm_link *l, struct rdma_resources *res) {
+    struct ibv_qp_attr attr;
+    struct pollfd pfd;
+    struct rdma_cm_event *ev;
+    uint32_t pending = 0;
+    uint32_t i;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_ERR;
+    pfd.fd = l->channel ? l->channel->fd : -1;
+    pfd.events = POLLIN;
+    for (i = 0; i < l->num_ids; i++) {
+        if (l->ids[i]) {
+            /* 外部QP不随cm_id迁移状态，先转ERR让未完成的WR冲刷出来 */
+            ibv_modify_qp(res->qp_list[i], &attr, IBV_QP_STATE);
+            rdma_disconnect(l->ids[i]);
+            pending++;
+        }
+    }
+    /* 每条连接恰好一个DISCONNECTED，不论哪一端先发起 */
+    while (pending > 0 && poll(&pfd, 1, CM_CLOSE_WAIT_MS) > 0 &&
+           rdma_get_cm_event(l->channel, &ev) == 0) {
+        if (ev->event == RDMA_CM_EVENT_DISCONNECTED) {
+            pending--;
+        }
+        rdma_ack_cm_event(ev);
+    }
+    for (i = 0; i < l->num_ids; i++) {
+        if (l->ids[i]) {
+            rdma_destroy_id(l->ids[i]);
+            l->ids[i] = NULL;
+        }
+    }
+    if (pending > 0) {
+        fprintf(stderr, "警告: %u条rdma_cm连接未收到断开事件\n", pending);
+        return -1;
+    }
+    return 0;
+}
+
+void cm_link_destroy(struct cm_link *l) {
+    uint32_t i;
+
+    for (i = 0; l->ids && i < l->num_ids; i++) {
+        if (l->ids[i]) {
+            rdma_destroy_id(l->ids[i]);
+        }
+    }
+    free(l->ids);
+    if (l->listen_id) {
+        rdma_destroy_id(l->listen_id);
+    }
+    if (l->channel) {
+        rdma_destroy_event_channel(l->channel);
+    }
+    memset(l, 0, sizeof(*l));
+}
@@ -0,0 +1,140 @@
+/**
+ * @file rdma_common_cm.h
+ * @brief 基于librdmacm的QP建链：用rdma_cm代替TCP交换连接信息和手工填写路径参数
+ *
+ * TCP建链需要应用自己交换QP号/GID，再在RTR阶段手工填写GRH、GID索引和路径MTU。
+ * rdma_cm按IP地址解析出设备、端口和路由，用CM协议的REQ/REP报文交换QP号和PSN，
+ * RTR/RTS的属性由rdma_init_qp_attr()给出，应用只需提供IP地址。
+ *
+ * 本模块使用"外部QP"模式：QP仍由create_qp_list()在res->pd上创建，cm_id不绑定QP，
+ * 本模块按rdma_init_qp_attr()的结果自己迁移QP状态，因此SRQ、工作线程CQ等
+ * 已有的QP配置保持不变。每个QP对应一个cm_id（一条CM连接），
+ * 单边访问用的addr/rkey/len放在REQ/REP的私有数据里，写入res->qp_ctx[i].remote_*。
+ *
+ * 限制：
+ * - 本端设备必须与IP地址所在的设备一致（-d指定的设备与rdma_cm解析出的设备相同）
+ * - 编译时需要librdmacm（make RDMACM=1），否则所有接口返回-1并提示
+ *
+ * @see rdma_common_cm.c, rdma_common_cm_connect.c, rdma_bench_conn.c
+ */
+
+#ifndef RDMA_COMMON_CM_H
+#define RDMA_COMMON_CM_H
+
+#include "rdma_common.h"
+
+#define CM_REQ_PRIVATE_MAX   56            /* REQ报文私有数据上限(字节)，REP为196 */
+#define CM_TIMEOUT_MS        2000          /* 地址和路由解析超时 */
+#define CM_RETRY_COUNT       7             /* 传输重试次数 */
+#define CM_RNR_RETRY_COUNT   7             /* RNR重试次数，7表示无限 */
+
+struct rdma_event_channel;
+struct rdma_cm_id;
+struct rdma_cm_event;
+struct rdma_conn_param;
+
+/**
+ * 一组rdma_cm连接，每个QP一个cm_id
+ */
+struct cm_link {
+    struct rdma_event_channel *channel;  /* 所有cm_id共用的事件通道 */
+    struct rdma_cm_id *listen_id;        /* 被动端的监听id，主动端为NULL */
+    struct rdma_cm_id **ids;             /* 已连接的cm_id，下标即QP下标 */
+    uint32_t num_ids;                    /* ids数组大小 */
+};
+
+/**
+ * 是否编译了rdma_cm支持
+ */
+static inline int cm_supported(void) {
+#ifdef HAVE_RDMACM
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * 被动端：创建事件通道并在所有地址的port上监听
+ *
+ * @param[out] l     连接组，函数内清零
+ * @param[in]  port  rdma_cm端口（与TCP端口是独立的空间）
+ *
+ * @return    成功返回0，失败返回-1（已创建的部分由cm_link_destroy()释放）
+ */
+int cm_link_listen(struct cm_link *l, int port);
+
+/**
+ * 被动端：接受res->num_qp条连接，按请求到达顺序依次对应QP[0..num_qp-1]
+ *
+ * 对每个CONNECT_REQUEST：检查设备和端口，按请求中的QP号和PSN把QP迁移到RTR、RTS，
+ * 保存对端私有数据中的addr/rkey/len，然后rdma_accept()回复本端连接信息。
+ * 所有连接都收到ESTABLISHED后返回。
+ *
+ * @pre       QP处于INIT状态，l已由cm_link_listen()初始化且没有未关闭的连接
+ * @return    成功返回0，失败返回-1
+ */
+int cm_link_accept(struct cm_link *l, struct rdma_resources *res);
+
+/**
+ * 主动端：为每个QP解析地址和路由并依次连接
+ *
+ * QP之间串行：上一个QP进入RTS后才为下一个QP解析地址，耗时约为num_qp次CM往返。
+ * 被动端按请求到达顺序分配QP下标，串行连接保证两端的QP下标一一对应。
+ *
+ * @param[out] l          连接组，函数内清零
+ * @param[in]  res        QP处于INIT状态的资源
+ * @param[in]  server_ip  被动端IPv4地址
+ * @param[in]  port       被动端监听的rdma_cm端口
+ *
+ * @return    成功返回0（所有QP处于RTS），失败返回-1（由cm_link_destroy()释放）
+ */
+int cm_link_connect(struct cm_link *l, struct rdma_resources *res, const char *server_ip, int port);
+
+/**
+ * 断开所有连接：QP转到ERR，rdma_disconnect()并等待DISCONNECTED后销毁cm_id
+ *
+ * @note      监听id和事件通道保留，被动端可以再次cm_link_accept()
+ * @return    成功返回0，等待断开事件失败返回-1
+ */
+int cm_link_close(struct cm_link *l, struct rdma_resources *res);
+
+/**
+ * 释放连接组的全部资源（含监听id和事件通道），可对部分初始化的连接组调用
+ */
+void cm_link_destroy(struct cm_link *l);
+
+/* ========== 建链步骤（主动端和被动端共用） ========== */
+
+/**
+ * 检查rdma_cm按IP解析出的设备和端口就是QP所在的设备和端口
+ */
+int cm_check_device(const struct rdma_cm_id *id, const struct rdma_resources *res);
+
+/**
+ * 用rdma_init_qp_attr()给出的路径属性把QP[i]迁移到RTR、RTS
+ *
+ * READ/原子深度按双方私有数据中的能力协商，对端缓冲区信息写入res->qp_ctx[i]。
+ */
+int cm_qp_to_rts(struct rdma_cm_id *id, struct rdma_resources *res, uint32_t i,
+                 const struct cm_con_data_t *remote);
+
+/**
+ * 填充连接参数：本端连接信息作为私有数据，QP号写入param供CM报文使用
+ *
+ * @param[out] local  私有数据的存储，须在rdma_connect()/rdma_accept()返回前有效
+ */
+int cm_fill_param(struct rdma_resources *res, uint32_t i, struct cm_con_data_t *local,
+                  struct rdma_conn_param *param);
+
+/**
+ * 从REQ/REP事件中读取对端连接信息
+ */
+int cm_read_private(const struct rdma_cm_event *ev, struct cm_con_data_t *remote);
+
+/**
+ * 按QP数分配cm_id数组，大小不变时复用
+ */
+int cm_alloc_ids(struct cm_link *l, uint32_t num);
+
+#endif /* RDMA_COMMON_CM_H */
@@ -0,0 +1,99 @@
+/**
+ * @file rdma_common_cm_connect.c
+ * @brief rdma_cm主动端：逐个QP解析地址和路由、发起连接
+ *
+ * 只在make RDMACM=1时编译。
+ */
+
+#include "rdma_common_cm.h"
+
+#include <rdma/rdma_cma.h>
+
+/* 取下一个事件，类型不是expected时打印并返回-1；成功时事件由调用者确认 */
+static int cm_wait(struct cm_link *l, enum rdma_cm_event_type expected,
+                   struct rdma_cm_event **ev) {
+    for (;;) {
+        if (rdma_get_cm_event(l->channel, ev)) {
+            fprintf(stderr, "错误: 获取rdma_cm事件失败: %s\n", strerror(errno));
+            return -1;
+        }
+        /* 前一条连接的ESTABLISHED/TIMEWAIT_EXIT与本次等待无关 */
+        if ((*ev)->event == expected || ((*ev)->event != RDMA_CM_EVENT_ESTABLISHED &&
+                                         (*ev)->event != RDMA_CM_EVENT_TIMEWAIT_EXIT)) {
+            break;
+        }
+        rdma_ack_cm_event(*ev);
+    }
+    if ((*ev)->event != expected) {
+        fprintf(stderr, "错误: 期望rdma_cm事件%s，收到%s (status=%d)\n",
+                rdma_event_str(expected), rdma_event_str((*ev)->event), (*ev)->status);
+        rdma_ack_cm_event(*ev);
+        return -1;
+    }
+    return 0;
+}
+
+/* 主动连接QP[i]：解析地址和路由，发REQ，收到REP后迁移QP并发RTU */
+static int cm_connect_one(struct cm_link *l, struct rdma_resources *res, uint32_t i,
+                          struct sockaddr_in *dst) {
+    struct rdma_conn_param param;
+    struct rdma_cm_event *ev;
+    struct cm_con_data_t local;
+    struct cm_con_data_t remote;
+    struct rdma_cm_id *id;
+    int rc;
+
+    if (rdma_create_id(l->channel, &l->ids[i], NULL, RDMA_PS_TCP)) {
+        fprintf(stderr, "错误: 创建cm_id失败: %s\n", strerror(errno));
+        return -1;
+    }
+    id = l->ids[i];
+    if (rdma_resolve_addr(id, NULL, (struct sockaddr *)dst, CM_TIMEOUT_MS) ||
+        cm_wait(l, RDMA_CM_EVENT_ADDR_RESOLVED, &ev)) {
+        return -1;
+    }
+    rdma_ack_cm_event(ev);
+    if (cm_check_device(id, res) || rdma_resolve_route(id, CM_TIMEOUT_MS) ||
+        cm_wait(l, RDMA_CM_EVENT_ROUTE_RESOLVED, &ev)) {
+        return -1;
+    }
+    rdma_ack_cm_event(ev);
+
+    if (cm_fill_param(res, i, &local, &param) || rdma_connect(id, &param) ||
+        cm_wait(l, RDMA_CM_EVENT_CONNECT_RESPONSE, &ev)) {
+        return -1;
+    }
+    rc = cm_read_private(ev, &remote);
+    rdma_ack_cm_event(ev);
+    if (rc || cm_qp_to_rts(id, res, i, &remote)) {
+        return -1;
+    }
+    return rdma_establish(id) ? -1 : 0;
+}
+
+int cm_link_connect(struct cm_link *l, struct rdma_resources *res, const char *server_ip,
+                    int port) {
+    struct sockaddr_in dst;
+    uint32_t i;
+
+    memset(l, 0, sizeof(*l));
+    memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_ip, &dst.sin_addr) <= 0) {
+        fprintf(stderr, "错误: 无效的服务端IP: %s\n", server_ip);
+        return -1;
+    }
+    l->channel = rdma_create_event_channel();
+    if (!l->channel || cm_alloc_ids(l, res->num_qp)) {
+        fprintf(stderr, "错误: 创建rdma_cm事件通道失败\n");
+        return -1;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        if (cm_connect_one(l, res, i, &dst)) {
+            fprintf(stderr, "错误: rdma_cm连接QP[%u]失败\n", i);
+            return -1;
+        }
+    }
+    return 0;
+}
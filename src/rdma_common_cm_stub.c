@@ -0,0 +1,44 @@
+/**
+ * @file rdma_common_cm_stub.c
+ * @brief 未编译librdmacm时的rdma_cm建链桩函数，所有建链接口返回-1并提示
+ *
+ * make RDMACM=1时改为编译rdma_common_cm.c。
+ */
+
+#include "rdma_common_cm.h"
+
+static int cm_unsupported(void) {
+    fprintf(stderr, "错误: 未编译rdma_cm支持，请安装librdmacm后用make RDMACM=1重新编译\n");
+    return -1;
+}
+
+int cm_link_listen(struct cm_link *l, int port) {
+    (void)port;
+    memset(l, 0, sizeof(*l));
+    return cm_unsupported();
+}
+
+int cm_link_accept(struct cm_link *l, struct rdma_resources *res) {
+    (void)l;
+    (void)res;
+    return cm_unsupported();
+}
+
+int cm_link_connect(struct cm_link *l, struct rdma_resources *res, const char *server_ip,
+                    int port) {
+    (void)res;
+    (void)server_ip;
+    (void)port;
+    memset(l, 0, sizeof(*l));
+    return cm_unsupported();
+}
+
+int cm_link_close(struct cm_link *l, struct rdma_resources *res) {
+    (void)l;
+    (void)res;
+    return 0;
+}
+
+void cm_link_destroy(struct cm_link *l) {
+    memset(l, 0, sizeof(*l));
+}
@@ -0,0 +1,96 @@
+/**
+ * @file rdma_common_cpu.c
+ * @brief CPU亲和性实现：cpulist解析、sysfs NUMA查询、pthread_setaffinity_np
+ */
+
+#define _GNU_SOURCE
+#include "rdma_common_cpu.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int cpu_list_parse(const char *str, int *cpus, int max) {
+    const char *p = str;
+    int n = 0;
+
+    while (*p && *p != '\n') {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+
+        if (end == p || lo < 0) {
+            return -1;
+        }
+        p = end;
+        if (*p == '-') {
+            hi = strtol(p + 1, &end, 10);
+            if (end == p + 1 || hi < lo) {
+                return -1;
+            }
+            p = end;
+        }
+        if (hi - lo + 1 > max - n) {
+            return -1;
+        }
+        while (lo <= hi) {
+            cpus[n++] = (int)lo++;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p && *p != '\n') {
+            return -1;
+        }
+    }
+    return n > 0 ? n : -1;
+}
+
+/* 读取sysfs文件的第一行 */
+static int read_line(const char *path, char *buf, int len) {
+    FILE *f = fopen(path, "r");
+    int ok;
+
+    if (!f) {
+        return -1;
+    }
+    ok = fgets(buf, len, f) != NULL;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+int cpu_dev_numa_node(const char *dev_name) {
+    char path[256];
+    char line[32];
+
+    snprintf(path, sizeof(path), "/sys/class/infiniband/%s/device/numa_node", dev_name);
+    if (read_line(path, line, sizeof(line))) {
+        return -1;
+    }
+    /* 未上报节点的设备（rxe、单节点机器）读出-1 */
+    return isdigit((unsigned char)line[0]) ? atoi(line) : -1;
+}
+
+int cpu_node_cpus(int node, int *cpus, int max) {
+    char path[64];
+    char line[4096];
+
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    if (read_line(path, line, sizeof(line))) {
+        return -1;
+    }
+    return cpu_list_parse(line, cpus, max);
+}
+
+int cpu_pin_self(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return -EINVAL;
+    }
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return -pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file rdma_common_cpu.h
+ * @brief CPU亲和性：解析CPU列表、查询网卡所在NUMA节点、绑定线程
+ *
+ * 工作线程绑定到固定核上，避免调度器把轮询线程迁移到别的核上
+ * （迁移会冲掉L1/L2中的QP、CQ状态）。网卡挂在某个NUMA节点的PCIe上，
+ * 在同一节点的核上轮询时，门铃写、CQE读取都不跨节点。
+ *
+ * NUMA信息直接读sysfs，不依赖libnuma：
+ * - /sys/class/infiniband/<设备>/device/numa_node
+ * - /sys/devices/system/node/node<N>/cpulist
+ *
+ * 本模块不依赖libibverbs，可单独链接进单元测试。
+ *
+ * @see rdma_common_cpu.c, rdma_common_worker.h
+ */
+
+#ifndef RDMA_COMMON_CPU_H
+#define RDMA_COMMON_CPU_H
+
+#define CPU_LIST_MAX  1024             /* 一个CPU列表最多包含的CPU数 */
+
+/**
+ * 解析Linux cpulist格式的CPU列表，如"0-3,8,10-11"
+ *
+ * @param[in]  str   CPU列表字符串，允许末尾换行
+ * @param[out] cpus  解析出的CPU编号，按字符串中的顺序
+ * @param[in]  max   cpus数组容量
+ *
+ * @return    成功返回CPU个数，格式错误、范围颠倒或超过max返回-1
+ */
+int cpu_list_parse(const char *str, int *cpus, int max);
+
+/**
+ * 查询RDMA设备所在的NUMA节点
+ *
+ * @param[in] dev_name  设备名，如"mlx5_0"、"rxe0"
+ *
+ * @return    NUMA节点编号，单节点机器、虚拟设备或查询失败返回-1
+ */
+int cpu_dev_numa_node(const char *dev_name);
+
+/**
+ * 读取一个NUMA节点上的CPU列表
+ *
+ * @param[in]  node  NUMA节点编号
+ * @param[out] cpus  CPU编号数组
+ * @param[in]  max   cpus数组容量
+ *
+ * @return    成功返回CPU个数，失败返回-1
+ */
+int cpu_node_cpus(int node, int *cpus, int max);
+
+/**
+ * 把调用线程绑定到一个CPU
+ *
+ * @param[in] cpu  CPU编号
+ *
+ * @return    成功返回0，失败返回负错误码
+ */
+int cpu_pin_self(int cpu);
+
+#endif /* RDMA_COMMON_CPU_H */
@@ -0,0 +1,118 @@
+/**
+ * @file rdma_common_ctx.h
+ * @brief 数据路径运行时类型 - 每QP上下文、完成事件处理函数、wr_id编码
+ *
+ * 本头文件定义struct rdma_resources中按QP区分的运行时状态，
+ * 以及轮询引擎、投递模块共用的类型和宏。
+ * 由rdma_common.h包含，应用程序无需直接包含。
+ *
+ * @see rdma_common.h, rdma_common_poll.h, rdma_common_post.h
+ */
+
+#ifndef RDMA_COMMON_CTX_H
+#define RDMA_COMMON_CTX_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <infiniband/verbs.h>
+
+/**
+ * 完成事件等待模式
+ */
+enum poll_mode {
+    POLL_MODE_BUSY = 0,                /* 忙轮询：CQ为空时继续自旋，延迟最低，独占CPU */
+    POLL_MODE_EVENT,                   /* 事件驱动：arm CQ后阻塞在completion channel上 */
+    POLL_MODE_HYBRID,                  /* 混合：先自旋spin_budget_us，再arm并睡眠 */
+};
+
+/*
+ * wr_id编码：低32位为QP索引，高32位为调用者自定义标签。
+ * 多QP共享CQ时，轮询引擎依靠低32位把完成事件分发到对应QP的处理函数。
+ */
+#define WR_ID_MAKE(qp_idx, tag) ((((uint64_t)(tag)) << 32) | (uint32_t)(qp_idx))
+#define WR_ID_QP(wr_id) ((uint32_t)((wr_id) & 0xffffffffULL))
+#define WR_ID_TAG(wr_id) ((uint32_t)((wr_id) >> 32))
+
+/*
+ * WRITE_WITH_IMM立即数编码：高12位为写入的槽位号，低20位为负载长度。
+ * 接收端按本端的imm_slot_size把槽位号换算成缓冲区偏移，不需要额外的SEND。
+ * 立即数在线路上是网络字节序，编码/解码都针对主机字节序的值。
+ */
+#define IMM_LEN_BITS   20
+#define IMM_SLOT_BITS  12
+#define IMM_LEN_MAX    ((1u << IMM_LEN_BITS) - 1)
+#define IMM_SLOT_MAX   ((1u << IMM_SLOT_BITS) - 1)
+#define IMM_MAKE(slot, len) ((((uint32_t)(slot)) << IMM_LEN_BITS) | ((uint32_t)(len) & IMM_LEN_MAX))
+#define IMM_SLOT(imm) ((uint32_t)(imm) >> IMM_LEN_BITS)
+#define IMM_LEN(imm) ((uint32_t)(imm) & IMM_LEN_MAX)
+
+struct rdma_resources;
+
+/**
+ * 完成事件处理函数类型
+ *
+ * @param res     RDMA资源结构体指针
+ * @param qp_idx  完成事件所属QP索引（由wr_id解码）
+ * @param wc      完成事件，status可能不是IBV_WC_SUCCESS
+ * @param arg     注册时传入的用户参数
+ * @return        0继续轮询，非0终止本次轮询并返回错误
+ */
+typedef int (*wc_handler_t)(struct rdma_resources *res, uint32_t qp_idx,
+                            const struct ibv_wc *wc, void *arg);
+
+/**
+ * 每个QP的运行时上下文
+ * 与qp_list一一对应，保存数据路径上按QP区分的状态。
+ * 发送队列计数每次投递和轮询都会写，按缓存行对齐，分属不同工作线程的相邻QP不共享缓存行
+ */
+struct qp_ctx {
+    wc_handler_t handler;              /* 完成事件处理函数，NULL表示使用默认处理 */
+    void *handler_arg;                 /* 处理函数的用户参数 */
+    struct ibv_cq *cq;                 /* QP绑定的CQ，NULL表示res->cq（见rdma_common_worker.h） */
+
+    /* 发送队列占用统计（选择性signaling），序号均为自由递增计数 */
+    uint32_t sq_posted;                /* 已投递的发送WR总数 */
+    uint32_t sq_completed;             /* 已回收的发送WR总数 */
+    uint32_t sq_unsignaled;            /* 上一个signaled WR之后的未signaled WR数 */
+    uint32_t *sig_ring;                /* 每个未完成signaled WR覆盖的WR数，FIFO */
+    uint32_t sig_head;                 /* sig_ring出队位置 */
+    uint32_t sig_tail;                 /* sig_ring入队位置 */
+
+    /* 对端为该QP开放的单边访问区域，在modify_qp_list_to_rtr()中保存 */
+    uint64_t remote_addr;              /* 远端缓冲区地址 */
+    uint32_t remote_rkey;              /* 远端MR的rkey */
+    uint32_t remote_len;               /* 远端可访问长度，0表示未开放 */
+    uint8_t remote_rd_atomic;          /* 对端作为响应方的READ/原子资源数 */
+    uint8_t rd_atomic;                 /* 协商后本端可同时发出的READ/原子数 */
+
+    /* 起始PSN，首次建链为0，原地恢复时双方重新协商（见rdma_common_recover.h） */
+    uint32_t sq_psn;                   /* 本端发送队列的起始PSN */
+    uint32_t rq_psn;                   /* 对端的起始PSN，即本端期望收到的第一个PSN */
+    enum ibv_wc_status wc_error;       /* 第一个失败完成事件的状态，IBV_WC_SUCCESS表示正常 */
+    uint32_t recoveries;               /* 已执行的原地恢复次数 */
+    uint32_t health;                   /* QP_HEALTH_*位，由异步事件监视线程原子置位 */
+
+    /* WRITE_WITH_IMM通知，槽位大小两端必须一致 */
+    uint32_t imm_slot_size;            /* 槽位大小，槽位号×槽位大小即缓冲区偏移 */
+    uint32_t imm_slot;                 /* 最近一次收到的槽位号 */
+    uint32_t imm_len;                  /* 最近一次收到的负载长度 */
+    uint64_t imm_count;                /* 累计收到的WRITE_WITH_IMM通知数 */
+} __attribute__((aligned(64)));
+
+/**
+ * 分配num个清零的qp_ctx，数组按缓存行对齐，用free()释放
+ *
+ * @return    成功返回数组，失败返回NULL
+ */
+static inline struct qp_ctx *qp_ctx_alloc(uint32_t num) {
+    struct qp_ctx *ctx;
+
+    if (posix_memalign((void **)&ctx, 64, sizeof(struct qp_ctx) * num)) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(struct qp_ctx) * num);
+    return ctx;
+}
+
+#endif /* RDMA_COMMON_CTX_H */
@@ -0,0 +1,182 @@
+/**
+ * @file rdma_common_event.c
+ * @brief 完成事件模块：completion channel、CQ arm、三种等待模式
+ *
+ * 本文件实现CQ为空时的等待策略，包括：
+ * - 忙轮询（低延迟，独占CPU）
+ * - 基于ibv_comp_channel的事件驱动睡眠
+ * - 先自旋固定预算、再arm并睡眠的混合模式
+ * - 供epoll使用的事件fd、arm与事件取走接口
+ * - 睡眠时同时等待异步事件监视线程的唤醒fd，故障不必等到超时
+ */
+
+#include "rdma_common_event.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_async.h"
+
+#include <poll.h>
+
+int set_poll_mode(struct rdma_resources *res, enum poll_mode mode,
+                  uint32_t spin_budget_us) {
+    if (!res) {
+        return -1;
+    }
+    if (mode != POLL_MODE_BUSY && !res->comp_channel) {
+        fprintf(stderr, "错误: 未创建completion channel，无法使用%s模式\n",
+                poll_mode_str(mode));
+        return -1;
+    }
+
+    res->poll_mode = mode;
+    res->spin_budget_us = spin_budget_us;
+    return 0;
+}
+
+int parse_poll_mode(const char *str, enum poll_mode *mode) {
+    if (!str || !mode) {
+        return -1;
+    }
+
+    if (!strcmp(str, "busy")) {
+        *mode = POLL_MODE_BUSY;
+    } else if (!strcmp(str, "event")) {
+        *mode = POLL_MODE_EVENT;
+    } else if (!strcmp(str, "hybrid")) {
+        *mode = POLL_MODE_HYBRID;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char *poll_mode_str(enum poll_mode mode) {
+    switch (mode) {
+        case POLL_MODE_BUSY:
+            return "busy";
+        case POLL_MODE_EVENT:
+            return "event";
+        case POLL_MODE_HYBRID:
+            return "hybrid";
+        default:
+            return "unknown";
+    }
+}
+
+int get_cq_event_fd(const struct rdma_resources *res) {
+    if (!res || !res->comp_channel) {
+        return -1;
+    }
+    return res->comp_channel->fd;
+}
+
+int arm_cq_notify(struct rdma_resources *res) {
+    if (!res || !res->cq) {
+        return -1;
+    }
+    if (res->cq_armed) {
+        return 0;
+    }
+
+    if (ibv_req_notify_cq(res->cq, 0)) {
+        fprintf(stderr, "错误: ibv_req_notify_cq失败\n");
+        return -1;
+    }
+    res->cq_armed = 1;
+    return 0;
+}
+
+int consume_cq_events(struct rdma_resources *res) {
+    struct ibv_cq *ev_cq;
+    void *ev_ctx;
+    int count = 0;
+
+    if (!res || !res->comp_channel) {
+        return -1;
+    }
+
+    /* fd为非阻塞，没有事件时ibv_get_cq_event返回-1且errno为EAGAIN */
+    while (ibv_get_cq_event(res->comp_channel, &ev_cq, &ev_ctx) == 0) {
+        /* 逐个ack，避免销毁CQ时因未ack事件而阻塞 */
+        ibv_ack_cq_events(ev_cq, 1);
+        count++;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        fprintf(stderr, "错误: ibv_get_cq_event失败: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (count > 0) {
+        res->cq_armed = 0;
+    }
+    return count;
+}
+
+/* 睡眠阶段：先arm并让调用者再轮询一次，已arm时才真正睡眠 */
+static int cq_sleep(struct rdma_resources *res, uint64_t deadline) {
+    struct pollfd pfd[2];
+    uint64_t now = monotonic_coarse_ms();
+    uint64_t wake;
+    int nfds = 1;
+    int rc;
+
+    if (now > deadline) {
+        return -1;
+    }
+    if (!res->cq_armed) {
+        return arm_cq_notify(res);
+    }
+
+    pfd[0].fd = res->comp_channel->fd;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    /* 监视线程收到故障事件时写唤醒fd，调用者醒来后通过fault_gen发现故障 */
+    pfd[1].fd = async_wake_fd(res);
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+    if (pfd[1].fd >= 0) {
+        nfds = 2;
+    }
+
+    rc = poll(pfd, nfds, (int)(deadline - now));
+    if (rc < 0 && errno != EINTR) {
+        fprintf(stderr, "错误: 等待completion channel失败: %s\n", strerror(errno));
+        return -1;
+    }
+    if (rc > 0 && pfd[1].revents && read(pfd[1].fd, &wake, sizeof(wake)) < 0) {
+        return -1;
+    }
+    if (rc > 0 && pfd[0].revents && consume_cq_events(res) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int cq_idle_wait(struct rdma_resources *res, struct cq_idle_state *st,
+                 uint64_t deadline) {
+    uint64_t now_us;
+
+    st->empty_polls++;
+
+    if (res->poll_mode == POLL_MODE_EVENT || st->is_sleeping) {
+        return cq_sleep(res, deadline);
+    }
+
+    if (res->poll_mode == POLL_MODE_HYBRID) {
+        if (st->empty_polls % HYBRID_CHECK_INTERVAL) {
+            return 0;
+        }
+        now_us = monotonic_ns() / 1000;
+        if (st->spin_start_us == 0) {
+            st->spin_start_us = now_us;
+        } else if (now_us - st->spin_start_us >= res->spin_budget_us) {
+            /* 自旋预算用完，后续空轮询都走睡眠路径 */
+            st->is_sleeping = 1;
+        }
+    }
+
+    /* 忙轮询：连续空轮询达到间隔才读一次粗粒度时钟 */
+    if (st->empty_polls % res->poll_check_interval) {
+        return 0;
+    }
+    return monotonic_coarse_ms() > deadline ? -1 : 0;
+}
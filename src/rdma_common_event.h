@@ -0,0 +1,113 @@
+/**
+ * @file rdma_common_event.h
+ * @brief 完成事件通道接口 - 忙轮询、事件驱动、自旋后睡眠的混合模式
+ *
+ * init_rdma_resources()为共享CQ创建一个completion channel，
+ * 其fd被设置为非阻塞，可以直接放入epoll/poll中与其他fd一起等待。
+ *
+ * 事件驱动的标准流程（避免丢事件的竞态）：
+ * 1. 轮询CQ直到为空
+ * 2. ibv_req_notify_cq() arm CQ
+ * 3. 再轮询一次CQ，捕获arm之前已经到达的完成事件
+ * 4. 仍为空时才在channel fd上睡眠，被唤醒后取走并ack事件，回到1
+ *
+ * @see rdma_common_event.c
+ */
+
+#ifndef RDMA_COMMON_EVENT_H
+#define RDMA_COMMON_EVENT_H
+
+#include "rdma_common.h"
+
+#define HYBRID_CHECK_INTERVAL 64  /* 混合模式每多少次空轮询读取一次时钟 */
+
+/**
+ * 空轮询等待状态
+ * 由poll_completion_batch()在每次取到完成事件后清零
+ */
+struct cq_idle_state {
+    uint32_t empty_polls;              /* 连续空轮询次数 */
+    uint64_t spin_start_us;            /* 混合模式开始自旋的时间，0表示尚未开始 */
+    int is_sleeping;                   /* 混合模式是否已用完自旋预算 */
+};
+
+/**
+ * 设置CQ为空时的等待模式
+ *
+ * @param[in,out] res             RDMA资源结构体指针，必须非NULL
+ * @param[in]     mode            等待模式
+ * @param[in]     spin_budget_us  混合模式的自旋预算(微秒)，其他模式忽略
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @note      EVENT/HYBRID模式要求res->comp_channel已创建
+ */
+int set_poll_mode(struct rdma_resources *res, enum poll_mode mode,
+                  uint32_t spin_budget_us);
+
+/**
+ * 把字符串解析为等待模式
+ *
+ * @param[in]  str   "busy"、"event"或"hybrid"
+ * @param[out] mode  解析结果，必须非NULL
+ *
+ * @return    成功返回0，无法识别返回-1
+ */
+int parse_poll_mode(const char *str, enum poll_mode *mode);
+
+/**
+ * 返回等待模式的名称
+ *
+ * @param[in] mode  等待模式
+ * @return    模式名称字符串
+ */
+const char *poll_mode_str(enum poll_mode mode);
+
+/**
+ * 获取completion channel的fd
+ *
+ * fd为非阻塞模式，可注册到epoll（EPOLLIN）。fd可读后应依次调用
+ * consume_cq_events()、poll_cq_batch()排空CQ、arm_cq_notify()、
+ * 再调用一次poll_cq_batch()。
+ *
+ * @param[in] res  RDMA资源结构体指针，必须非NULL
+ * @return    成功返回fd，未创建channel返回-1
+ */
+int get_cq_event_fd(const struct rdma_resources *res);
+
+/**
+ * arm CQ，使下一个完成事件在channel上产生通知
+ *
+ * @param[in,out] res  RDMA资源结构体指针，必须非NULL
+ * @return    成功返回0，失败返回-1
+ *
+ * @note      已经arm且事件未取走时直接返回0
+ */
+int arm_cq_notify(struct rdma_resources *res);
+
+/**
+ * 非阻塞地取走并ack channel上所有待处理的CQ事件
+ *
+ * @param[in,out] res  RDMA资源结构体指针，必须非NULL
+ * @return    返回取走的事件数量（可能为0），失败返回-1
+ */
+int consume_cq_events(struct rdma_resources *res);
+
+/**
+ * CQ为空时按res->poll_mode等待一步
+ *
+ * - BUSY：直接返回，每poll_check_interval次检查一次超时
+ * - EVENT：首次调用arm CQ后立即返回（让调用者再轮询一次），
+ *          之后在channel fd上睡眠直到有事件或到达deadline
+ * - HYBRID：自旋spin_budget_us后转为EVENT模式的行为
+ *
+ * @param[in,out] res       RDMA资源结构体指针，必须非NULL
+ * @param[in,out] st        空轮询状态，取到完成事件后由调用者清零
+ * @param[in]     deadline  超时时刻，monotonic_coarse_ms()时间基准
+ *
+ * @return    0表示应再次轮询CQ，-1表示超时或出错
+ */
+int cq_idle_wait(struct rdma_resources *res, struct cq_idle_state *st,
+                 uint64_t deadline);
+
+#endif /* RDMA_COMMON_EVENT_H */
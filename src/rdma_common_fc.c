@@ -0,0 +1,222 @@
+/**
+ * @file rdma_common_fc.c
+ * @brief credit流控实现：RECV预投递与补投、立即数捎带credit、纯credit消息
+ *
+ * 第i个RECV缓冲区固定对应wr_id标签i，完成后原样补投，
+ * 因此接收端不需要额外的缓冲区管理。
+ */
+
+#include "rdma_common_fc.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+
+static uint32_t fc_recv_off(const struct fc_channel *ch, uint32_t qp_idx, uint32_t slot) {
+    return ch->recv_base + (qp_idx * ch->depth + slot) * ch->msg_size;
+}
+
+/* 在第slot个缓冲区上投递RECV */
+static int fc_post_recv(struct fc_channel *ch, uint32_t qp_idx, uint32_t slot) {
+    struct ibv_recv_wr wr;
+    struct ibv_sge sge;
+
+    sge.addr = (uintptr_t)(ch->res->buf + fc_recv_off(ch, qp_idx, slot));
+    sge.length = ch->msg_size;
+    sge.lkey = ch->res->mr->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, slot);
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    return post_recv_chain(ch->res, qp_idx, &wr, 1, NULL);
+}
+
+/* 投递SEND_WITH_IMM，立即数捎带全部待通告credit；len为0时是纯credit消息 */
+static int fc_post_send(struct fc_channel *ch, uint32_t qp_idx,
+                        uint32_t local_off, uint32_t len) {
+    struct fc_qp *q = &ch->qp[qp_idx];
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+    int rc;
+
+    sge.addr = (uintptr_t)(ch->res->buf + local_off);
+    sge.length = len;
+    sge.lkey = ch->res->mr->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, 0);
+    wr.opcode = IBV_WR_SEND_WITH_IMM;
+    wr.sg_list = &sge;
+    wr.num_sge = len ? 1 : 0;
+    wr.imm_data = htonl(q->grant_pending + q->grant_idle);
+
+    rc = post_send_chain(ch->res, qp_idx, &wr, 1, NULL);
+    if (rc == 0) {
+        q->grant_pending = 0;
+        q->grant_idle = 0;
+        q->credits--;
+    }
+    return rc;
+}
+
+static int fc_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                         const struct ibv_wc *wc, void *arg) {
+    struct fc_channel *ch = arg;
+    struct fc_qp *q = &ch->qp[qp_idx];
+    uint32_t slot = WR_ID_TAG(wc->wr_id);
+    int rc;
+
+    if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: QP[%u]完成状态异常: %s\n",
+                qp_idx, ibv_wc_status_str(wc->status));
+        return -1;
+    }
+    if (!(wc->opcode & IBV_WC_RECV)) {
+        return 0;
+    }
+
+    if (wc->wc_flags & IBV_WC_WITH_IMM) {
+        q->credits += ntohl(wc->imm_data);
+    }
+    if (wc->byte_len > 0) {
+        q->received++;
+        if (ch->deliver &&
+            ch->deliver(ch->deliver_arg, qp_idx,
+                        res->buf + fc_recv_off(ch, qp_idx, slot), wc->byte_len)) {
+            return -1;
+        }
+    }
+
+    /* 处理完立即补投同一个缓冲区，记为待通告credit */
+    if (fc_post_recv(ch, qp_idx, slot)) {
+        fprintf(stderr, "错误: QP[%u]补投RECV失败\n", qp_idx);
+        return -1;
+    }
+    /* 纯credit消息补投的RECV不触发回送，否则双方会互相回送纯credit消息 */
+    if (wc->byte_len == 0) {
+        q->grant_idle++;
+        return 0;
+    }
+    q->grant_pending++;
+
+    rc = fc_flush_credits(ch, qp_idx, 0);
+    return rc == 0 || rc == -EAGAIN ? 0 : -1;
+}
+
+int fc_channel_init(struct fc_channel *ch, struct rdma_resources *res,
+                    uint32_t recv_base, uint32_t depth, uint32_t msg_size) {
+    uint64_t end;
+    uint32_t i;
+    uint32_t s;
+
+    if (!ch || !res || !res->qp_ctx || msg_size == 0 ||
+        depth <= FC_RESERVED_CREDITS || depth > res->rq_depth) {
+        fprintf(stderr, "错误: 流控参数无效 (深度%u, 消息大小%u)\n", depth, msg_size);
+        return -1;
+    }
+    end = (uint64_t)recv_base + (uint64_t)res->num_qp * depth * msg_size;
+    if (end > res->buf_size) {
+        fprintf(stderr, "错误: RECV缓冲区需要%llu字节，超过缓冲区%zu\n",
+                (unsigned long long)end, res->buf_size);
+        return -1;
+    }
+
+    memset(ch, 0, sizeof(*ch));
+    ch->qp = calloc(res->num_qp, sizeof(*ch->qp));
+    if (!ch->qp) {
+        fprintf(stderr, "错误: 分配%u个QP的流控状态失败\n", res->num_qp);
+        return -1;
+    }
+    ch->res = res;
+    ch->depth = depth;
+    ch->msg_size = msg_size;
+    ch->recv_base = recv_base;
+    ch->threshold = depth / 2;
+
+    for (i = 0; i < res->num_qp; i++) {
+        ch->qp[i].credits = depth;
+        if (register_wc_handler(res, i, fc_wc_handler, ch)) {
+            return -1;
+        }
+        for (s = 0; s < depth; s++) {
+            if (fc_post_recv(ch, i, s)) {
+                fprintf(stderr, "错误: QP[%u]预投递RECV失败\n", i);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+void fc_channel_destroy(struct fc_channel *ch) {
+    free(ch->qp);
+    ch->qp = NULL;
+}
+
+void fc_set_deliver(struct fc_channel *ch, fc_deliver_t deliver, void *arg) {
+    ch->deliver = deliver;
+    ch->deliver_arg = arg;
+}
+
+int fc_send(struct fc_channel *ch, uint32_t qp_idx, uint32_t local_off, uint32_t len) {
+    struct fc_qp *q;
+    int rc;
+
+    if (!ch || qp_idx >= ch->res->num_qp) {
+        return -EINVAL;
+    }
+    if (len == 0 || len > ch->msg_size) {
+        return -EMSGSIZE;
+    }
+
+    q = &ch->qp[qp_idx];
+    if (q->credits <= FC_RESERVED_CREDITS) {
+        q->stalls++;
+        return -EAGAIN;
+    }
+    rc = fc_post_send(ch, qp_idx, local_off, len);
+    if (rc == 0) {
+        q->sent++;
+    }
+    return rc;
+}
+
+int fc_send_wait(struct fc_channel *ch, uint32_t qp_idx, uint32_t local_off, uint32_t len) {
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint64_t deadline = monotonic_coarse_ms() + ch->res->poll_timeout_ms;
+    uint32_t empty = 0;
+    int rc;
+    int n;
+
+    while ((rc = fc_send(ch, qp_idx, local_off, len)) == -EAGAIN) {
+        n = poll_cq_batch(ch->res, wc, POLL_BATCH_SIZE);
+        if (n < 0) {
+            return -EIO;
+        }
+        if (n > 0) {
+            deadline = monotonic_coarse_ms() + ch->res->poll_timeout_ms;
+        } else if (++empty % ch->res->poll_check_interval == 0 &&
+                   monotonic_coarse_ms() > deadline) {
+            fprintf(stderr, "错误: QP[%u]等待credit超时\n", qp_idx);
+            return -ETIMEDOUT;
+        }
+    }
+    return rc;
+}
+
+int fc_flush_credits(struct fc_channel *ch, uint32_t qp_idx, int force) {
+    struct fc_qp *q = &ch->qp[qp_idx];
+    int rc;
+
+    if (q->grant_pending + q->grant_idle == 0 ||
+        (!force && q->grant_pending < ch->threshold)) {
+        return 0;
+    }
+    if (q->credits == 0) {
+        return -EAGAIN;
+    }
+    rc = fc_post_send(ch, qp_idx, 0, 0);
+    if (rc == 0) {
+        q->credit_msgs++;
+    }
+    return rc;
+}
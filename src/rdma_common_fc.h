@@ -0,0 +1,134 @@
+/**
+ * @file rdma_common_fc.h
+ * @brief 双边SEND/RECV的基于credit的流控
+ *
+ * 没有流控时，发送端不知道对端投递了多少RECV，突发超过对端RECV数就会
+ * 触发RNR NAK，按min_rnr_timer退避（毫秒级）后重传。本模块让发送端只在
+ * 确知对端有空闲RECV时才发送：
+ *
+ * - 每个QP的接收端预投递depth个固定大小的RECV，初始credit即为depth
+ *   （两端depth必须相同）
+ * - 每次SEND消耗一个credit；接收端处理完一个RECV立即在原缓冲区补投，
+ *   并把补投数累计为待通告的credit
+ * - 待通告credit放在SEND_WITH_IMM的立即数里捎带给对端，不占用负载
+ * - 最后一个credit保留给纯credit消息：没有反向流量而待通告数达到阈值时，
+ *   发一个0字节的SEND_WITH_IMM，保证双方都耗尽credit时也不会死锁
+ * - 纯credit消息占用的RECV补投后不计入阈值，只随数据消息或强制通告捎带，
+ *   否则深度较小时双方会在空闲时互相回送纯credit消息
+ *
+ * 接收到的消息通过fc_deliver_t回调交给调用者，回调返回后缓冲区即被补投。
+ *
+ * @see rdma_common_fc.c, rdma_common_post.h
+ */
+
+#ifndef RDMA_COMMON_FC_H
+#define RDMA_COMMON_FC_H
+
+#include "rdma_common.h"
+
+#define FC_RESERVED_CREDITS  1         /* 只用于纯credit消息的credit数 */
+
+/**
+ * 收到一条消息时的回调
+ *
+ * @param arg     fc_channel_init()时传入的用户参数
+ * @param qp_idx  消息所属QP
+ * @param data    消息负载，回调返回后失效
+ * @param len     负载长度
+ * @return        0继续，非0终止本次轮询
+ */
+typedef int (*fc_deliver_t)(void *arg, uint32_t qp_idx, const void *data, uint32_t len);
+
+/**
+ * 单个QP的流控状态
+ */
+struct fc_qp {
+    uint32_t credits;                  /* 可用credit：对端空闲RECV数的下界 */
+    uint32_t grant_pending;            /* 数据消息补投的、尚未通告给对端的RECV数 */
+    uint32_t grant_idle;               /* 纯credit消息补投的、尚未通告的RECV数，不计入阈值 */
+    uint64_t sent;                     /* 已发送的数据消息数 */
+    uint64_t received;                 /* 已收到的数据消息数 */
+    uint64_t credit_msgs;              /* 发出的纯credit消息数 */
+    uint64_t stalls;                   /* 因credit不足返回-EAGAIN的次数 */
+};
+
+/**
+ * 流控通道，覆盖res中的所有QP
+ */
+struct fc_channel {
+    struct rdma_resources *res;
+    uint32_t depth;                    /* 每个QP的RECV数，也是初始credit */
+    uint32_t msg_size;                 /* 每个RECV缓冲区大小，即最大消息长度 */
+    uint32_t recv_base;                /* RECV缓冲区区域在res->buf中的偏移 */
+    uint32_t threshold;                /* 待通告credit达到该值时发纯credit消息 */
+    fc_deliver_t deliver;              /* 消息回调，可为NULL */
+    void *deliver_arg;
+    struct fc_qp *qp;                  /* 每个QP的流控状态，res->num_qp个元素 */
+};
+
+/**
+ * RECV缓冲区区域所需字节数
+ */
+static inline uint32_t fc_region_size(uint32_t num_qp, uint32_t depth, uint32_t msg_size) {
+    return num_qp * depth * msg_size;
+}
+
+/**
+ * 初始化流控通道：为每个QP注册完成事件处理函数并预投递depth个RECV
+ *
+ * @param[out] ch         通道
+ * @param[in]  res        RDMA资源，QP至少处于INIT，rq_depth >= depth
+ * @param[in]  recv_base  RECV缓冲区区域偏移，区域大小见fc_region_size()
+ * @param[in]  depth      每个QP的RECV数，必须 > FC_RESERVED_CREDITS
+ * @param[in]  msg_size   最大消息长度
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @note      必须在对端开始发送之前完成（通常在TCP同步之前）
+ * @note      会覆盖所有QP已注册的完成事件处理函数
+ */
+int fc_channel_init(struct fc_channel *ch, struct rdma_resources *res,
+                    uint32_t recv_base, uint32_t depth, uint32_t msg_size);
+
+/**
+ * 释放流控通道的每QP状态，未初始化（全零）的通道也可调用
+ */
+void fc_channel_destroy(struct fc_channel *ch);
+
+/**
+ * 设置消息回调
+ */
+void fc_set_deliver(struct fc_channel *ch, fc_deliver_t deliver, void *arg);
+
+/**
+ * 在credit允许时发送一条消息，并捎带待通告的credit
+ *
+ * @param[in,out] ch         通道
+ * @param[in]     qp_idx     QP索引
+ * @param[in]     local_off  负载在res->buf中的偏移
+ * @param[in]     len        负载长度，不超过msg_size
+ *
+ * @return    成功返回0
+ * @retval -EAGAIN    credit不足或发送队列已满，需轮询CQ后重试
+ * @retval -EMSGSIZE  len超过msg_size
+ * @retval 其他负值    投递失败
+ */
+int fc_send(struct fc_channel *ch, uint32_t qp_idx, uint32_t local_off, uint32_t len);
+
+/**
+ * 阻塞发送：credit不足时轮询CQ等待对端通告，超过res->poll_timeout_ms返回-ETIMEDOUT
+ *
+ * @return    同fc_send()，不会返回-EAGAIN
+ */
+int fc_send_wait(struct fc_channel *ch, uint32_t qp_idx, uint32_t local_off, uint32_t len);
+
+/**
+ * 数据消息补投的待通告credit达到阈值（force非0时只要有待通告credit）就发一条纯credit消息
+ *
+ * @return    成功或无需发送返回0，credit或发送队列暂时不足返回-EAGAIN，失败返回负错误码
+ *
+ * @note      接收处理中会自动调用，只收不发的一端无需手动调用
+ */
+int fc_flush_credits(struct fc_channel *ch, uint32_t qp_idx, int force);
+
+#endif /* RDMA_COMMON_FC_H */
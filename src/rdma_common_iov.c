@@ -0,0 +1,66 @@
+/**
+ * @file rdma_common_iov.c
+ * @brief 多SGE投递实现：把iov数组转换成ibv_sge数组并投递单个WR
+ */
+
+#include "rdma_common_iov.h"
+#include "rdma_common_post.h"
+
+/* 检查段数并填充SGE数组，返回总长度，失败返回-1 */
+static int64_t iov_to_sge(const struct rdma_resources *res, const struct rdma_iov *iov,
+                          uint32_t iovcnt, struct ibv_sge *sge) {
+    uint64_t total = 0;
+    uint32_t i;
+
+    if (!iov || iovcnt == 0 || iovcnt > res->max_sge) {
+        fprintf(stderr, "错误: SGE数%u超出范围[1-%u]\n", iovcnt, res->max_sge);
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        sge[i].addr = (uintptr_t)iov[i].addr;
+        sge[i].length = iov[i].len;
+        sge[i].lkey = iov[i].lkey;
+        total += iov[i].len;
+    }
+    /* RC消息长度上限为2^31 */
+    if (total > (1ULL << 31)) {
+        fprintf(stderr, "错误: 消息总长度%llu超过2GB\n", (unsigned long long)total);
+        return -1;
+    }
+    return (int64_t)total;
+}
+
+int post_send_iov(struct rdma_resources *res, uint32_t qp_idx, uint64_t wr_id,
+                  const struct rdma_iov *iov, uint32_t iovcnt) {
+    struct ibv_sge sge[MAX_SGE_LIMIT];
+    struct ibv_send_wr wr;
+
+    if (!res || iov_to_sge(res, iov, iovcnt, sge) < 0) {
+        return -EINVAL;
+    }
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = wr_id;
+    wr.opcode = IBV_WR_SEND;
+    wr.sg_list = sge;
+    wr.num_sge = (int)iovcnt;
+
+    return post_send_chain(res, qp_idx, &wr, 1, NULL);
+}
+
+int post_recv_iov(struct rdma_resources *res, uint32_t qp_idx, uint64_t wr_id,
+                  const struct rdma_iov *iov, uint32_t iovcnt) {
+    struct ibv_sge sge[MAX_SGE_LIMIT];
+    struct ibv_recv_wr wr;
+
+    if (!res || iov_to_sge(res, iov, iovcnt, sge) < 0) {
+        return -EINVAL;
+    }
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = wr_id;
+    wr.sg_list = sge;
+    wr.num_sge = (int)iovcnt;
+
+    return post_recv_chain(res, qp_idx, &wr, 1, NULL);
+}
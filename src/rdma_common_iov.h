@@ -0,0 +1,106 @@
+/**
+ * @file rdma_common_iov.h
+ * @brief 多SGE（scatter/gather）零拷贝发送与接收
+ *
+ * 一个WR可以带多个SGE，网卡按顺序从各SGE读取（发送）或写入（接收）数据：
+ * - 发送：协议头放在池槽位里、负载直接引用应用内存（经注册缓存取得lkey），
+ *   一个SEND就能发出，不需要先把负载memcpy到暂存缓冲区
+ * - 接收：第一个SGE接收固定长度的协议头，其余SGE接收负载，
+ *   头和负载天然落在不同的缓冲区里
+ *
+ * SGE数不能超过res->max_sge（创建QP时按设备max_sge裁剪）。
+ * 总长度不超过res->max_inline_data的发送仍会自动走内联路径。
+ *
+ * @see rdma_common_iov.c, rdma_common_pool.h, rdma_common_mrcache.h
+ */
+
+#ifndef RDMA_COMMON_IOV_H
+#define RDMA_COMMON_IOV_H
+
+#include "rdma_common.h"
+#include "rdma_common_pool.h"
+#include "rdma_common_mrcache.h"
+
+/**
+ * 一段已注册的内存
+ */
+struct rdma_iov {
+    void *addr;
+    uint32_t len;
+    uint32_t lkey;
+};
+
+/**
+ * 用池槽位的前len字节填充一段iov
+ */
+static inline void iov_from_slot(struct rdma_iov *iov, const struct pool_slot *slot,
+                                 uint32_t len) {
+    iov->addr = slot->addr;
+    iov->len = len;
+    iov->lkey = slot->lkey;
+}
+
+/**
+ * 用注册缓存返回的区间填充一段iov，addr必须落在该区间内
+ */
+static inline void iov_from_mr(struct rdma_iov *iov, void *addr, uint32_t len,
+                               const struct mr_cache_entry *entry) {
+    iov->addr = addr;
+    iov->len = len;
+    iov->lkey = entry->mr->lkey;
+}
+
+/**
+ * 计算接收到byte_len字节后第idx段iov实际写入的字节数
+ *
+ * 网卡按顺序填满每个SGE，用wc->byte_len即可知道负载在哪几段里。
+ */
+static inline uint32_t iov_filled(const struct rdma_iov *iov, uint32_t iovcnt,
+                                  uint32_t byte_len, uint32_t idx) {
+    uint32_t i;
+
+    for (i = 0; i < idx && i < iovcnt; i++) {
+        byte_len = byte_len > iov[i].len ? byte_len - iov[i].len : 0;
+    }
+    if (idx >= iovcnt) {
+        return 0;
+    }
+    return byte_len < iov[idx].len ? byte_len : iov[idx].len;
+}
+
+/**
+ * 投递一个由多段内存拼成的SEND
+ *
+ * @param[in] res     RDMA资源，QP处于RTS
+ * @param[in] qp_idx  QP索引
+ * @param[in] wr_id   wr_id，通常为WR_ID_MAKE(qp_idx, 标签)
+ * @param[in] iov     内存段数组，按顺序拼接成一条消息
+ * @param[in] iovcnt  段数，1 ~ res->max_sge
+ *
+ * @return    成功返回0，失败返回负错误码
+ * @retval -EINVAL  参数无效或段数超过res->max_sge
+ * @retval -EAGAIN  发送队列已满
+ *
+ * @note      各段内存在发送完成（或被选择性signaling覆盖的CQE到达）前不能修改，
+ *            内联发送除外
+ */
+int post_send_iov(struct rdma_resources *res, uint32_t qp_idx, uint64_t wr_id,
+                  const struct rdma_iov *iov, uint32_t iovcnt);
+
+/**
+ * 投递一个把数据依次分散到多段内存的RECV
+ *
+ * @param[in] res     RDMA资源，QP至少处于INIT且未挂到SRQ
+ * @param[in] qp_idx  QP索引
+ * @param[in] wr_id   wr_id，通常为WR_ID_MAKE(qp_idx, 标签)
+ * @param[in] iov     内存段数组
+ * @param[in] iovcnt  段数，1 ~ res->max_sge
+ *
+ * @return    成功返回0，失败返回负错误码
+ *
+ * @note      完成后用iov_filled()按wc->byte_len计算每段收到的字节数
+ */
+int post_recv_iov(struct rdma_resources *res, uint32_t qp_idx, uint64_t wr_id,
+                  const struct rdma_iov *iov, uint32_t iovcnt);
+
+#endif /* RDMA_COMMON_IOV_H */
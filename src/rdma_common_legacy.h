@@ -0,0 +1,35 @@
+/**
+ * @file rdma_common_legacy.h
+ * @brief 单QP旧接口声明 - 只操作qp_list[0]
+ *
+ * 保留给早期的单QP示例使用，新代码应使用rdma_common.h中的
+ * modify_qp_list_to_*()系列接口。由rdma_common.h包含。
+ *
+ * @deprecated 建议使用多QP接口
+ * @see rdma_common_qp_legacy.c
+ */
+
+#ifndef RDMA_COMMON_LEGACY_H
+#define RDMA_COMMON_LEGACY_H
+
+struct rdma_resources;
+
+/**
+ * 修改QP状态：RTR → RTS (Ready to Send)
+ *
+ * 将单个QP从Ready-To-Receive状态转移到Ready-To-Send状态。
+ * 此函数是modify_qp_list_to_rts()的单QP版本。
+ *
+ * @param[in,out] res  RDMA资源结构体指针，必须非NULL
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @pre       QP处于RTR状态
+ * @post      QP转移到RTS状态
+ *
+ * @deprecated  建议使用modify_qp_list_to_rts()处理多QP
+ * @see       modify_qp_list_to_rts()
+ */
+int modify_qp_to_rts(struct rdma_resources *res);
+
+#endif /* RDMA_COMMON_LEGACY_H */
@@ -0,0 +1,133 @@
+/**
+ * @file rdma_common_mem.c
+ * @brief 数据缓冲区分配实现：MAP_HUGETLB显式大页与透明大页降级
+ */
+
+#include "rdma_common_mem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+static size_t round_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+/* 用指定大小的显式大页映射，失败返回NULL */
+static char *map_hugetlb(size_t size, uint32_t page) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                (page == HUGE_PAGE_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+    void *p = mmap(NULL, round_up(size, page), PROT_READ | PROT_WRITE, flags, -1, 0);
+
+    return p == MAP_FAILED ? NULL : p;
+}
+
+int parse_buf_page_mode(const char *str, enum buf_page_mode *mode) {
+    if (!strcmp(str, "4k")) {
+        *mode = BUF_PAGE_DEFAULT;
+    } else if (!strcmp(str, "auto")) {
+        *mode = BUF_PAGE_AUTO;
+    } else if (!strcmp(str, "2m")) {
+        *mode = BUF_PAGE_2M;
+    } else if (!strcmp(str, "1g")) {
+        *mode = BUF_PAGE_1G;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+char *rdma_buf_alloc(size_t size, enum buf_page_mode mode, uint32_t *page_size) {
+    size_t base = (size_t)sysconf(_SC_PAGESIZE);
+    char *buf;
+
+    if (mode == BUF_PAGE_DEFAULT) {
+        *page_size = 0;
+        return calloc(1, size);
+    }
+
+    /* 匿名映射由内核清零，不需要memset（memset还会提前触发缺页） */
+    if (mode == BUF_PAGE_1G ||
+        (mode == BUF_PAGE_AUTO && buf_auto_huge_page(size) == HUGE_PAGE_1G)) {
+        buf = map_hugetlb(size, HUGE_PAGE_1G);
+        if (buf) {
+            *page_size = HUGE_PAGE_1G;
+            return buf;
+        }
+    }
+    if (mode == BUF_PAGE_AUTO || mode == BUF_PAGE_2M) {
+        buf = map_hugetlb(size, HUGE_PAGE_2M);
+        if (buf) {
+            *page_size = HUGE_PAGE_2M;
+            return buf;
+        }
+    }
+
+    fprintf(stderr, "警告: 无法分配显式大页（未预留或数量不足），改用透明大页\n");
+    buf = mmap(NULL, round_up(size, base), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        return NULL;
+    }
+    /* 内核关闭透明大页时madvise失败，仍可使用普通页；能拿到多少大页要到缺页时才知道 */
+    madvise(buf, round_up(size, base), MADV_HUGEPAGE);
+    *page_size = BUF_PAGE_THP;
+    return buf;
+}
+
+void rdma_buf_free(char *buf, size_t size, uint32_t page_size) {
+    if (!buf) {
+        return;
+    }
+    if (page_size == 0) {
+        free(buf);
+        return;
+    }
+    if (page_size == BUF_PAGE_THP) {
+        page_size = (uint32_t)sysconf(_SC_PAGESIZE);
+    }
+    munmap(buf, round_up(size, page_size));
+}
+
+size_t mem_rss_bytes(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    int n;
+
+    if (!f) {
+        return 0;
+    }
+    n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+const char *buf_page_size_str(uint32_t page_size) {
+    switch (page_size) {
+        case 0:
+            return "malloc";
+        case HUGE_PAGE_1G:
+            return "1GB";
+        case HUGE_PAGE_2M:
+            return "2MB";
+        case BUF_PAGE_THP:
+            return "THP";
+        case 4096:
+            return "4KB";
+        default:
+            return "系统页";
+    }
+}
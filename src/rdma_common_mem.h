@@ -0,0 +1,101 @@
+/**
+ * @file rdma_common_mem.h
+ * @brief 数据缓冲区分配：普通页或大页(2MB/1GB)，不可用时自动降级
+ *
+ * 用malloc分配的大缓冲区由4KB页组成：网卡注册时每页一个MTT表项，
+ * 地址转换缓存容易失效；CPU侧TLB也频繁缺失。改用大页可以：
+ * - 把MTT表项数减少512倍(2MB)或262144倍(1GB)，ibv_reg_mr锁页更快
+ * - 降低网卡地址转换缓存和CPU TLB的缺失率
+ *
+ * 分配顺序：请求的大页（AUTO在缓冲区不小于1GB时先试1GB，否则直接试2MB，
+ * 避免小缓冲区独占一整个1GB页）→ 普通mmap加MADV_HUGEPAGE（透明大页，
+ * 能否拿到、拿到多少由内核在缺页时决定）。
+ * 显式大页需要预留：echo N > /sys/kernel/mm/hugepages/hugepages-2048kB/nr_hugepages
+ *
+ * 缓冲区大小是size_t，可以超过4GB；但SGE长度、对端偏移和cm_con_data_t.len
+ * 都是32位，整缓冲区的SEND/RECV和对端单边访问只覆盖前4GB（见buf_window()）。
+ *
+ * @see rdma_common_mem.c
+ */
+
+#ifndef RDMA_COMMON_MEM_H
+#define RDMA_COMMON_MEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HUGE_PAGE_2M  (2u << 20)
+#define HUGE_PAGE_1G  (1u << 30)
+#define BUF_PAGE_THP  1u               /* 页大小取值：透明大页降级，实际页大小未知 */
+
+/**
+ * 缓冲区页大小请求
+ */
+enum buf_page_mode {
+    BUF_PAGE_DEFAULT = 0,              /* malloc，与原来的行为相同 */
+    BUF_PAGE_AUTO,                     /* 按大小先试1GB或2MB，最后透明大页 */
+    BUF_PAGE_2M,                       /* 2MB大页，失败时透明大页 */
+    BUF_PAGE_1G,                       /* 1GB大页，失败时透明大页 */
+};
+
+/**
+ * AUTO模式首先尝试的显式大页：不小于1GB的缓冲区用1GB页，否则用2MB页
+ */
+static inline uint32_t buf_auto_huge_page(size_t size) {
+    return size >= HUGE_PAGE_1G ? HUGE_PAGE_1G : HUGE_PAGE_2M;
+}
+
+/**
+ * 缓冲区中32位长度/偏移能覆盖的部分：不超过4GB-1
+ */
+static inline uint32_t buf_window(size_t size) {
+    return size > UINT32_MAX ? UINT32_MAX : (uint32_t)size;
+}
+
+/**
+ * 把字符串解析为页大小请求
+ *
+ * @param[in]  str   "4k"、"auto"、"2m"或"1g"
+ * @param[out] mode  解析结果
+ *
+ * @return    成功返回0，无法识别返回-1
+ */
+int parse_buf_page_mode(const char *str, enum buf_page_mode *mode);
+
+/**
+ * 按请求分配缓冲区（内容清零）
+ *
+ * @param[in]  size       缓冲区大小
+ * @param[in]  mode       页大小请求
+ * @param[out] page_size  实际得到的页大小：BUF_PAGE_DEFAULT时为0（malloc），
+ *                        显式大页为2MB/1GB，降级到透明大页时为BUF_PAGE_THP
+ *
+ * @return    缓冲区地址，失败返回NULL
+ */
+char *rdma_buf_alloc(size_t size, enum buf_page_mode mode, uint32_t *page_size);
+
+/**
+ * 释放rdma_buf_alloc()分配的缓冲区
+ *
+ * @param[in] buf        缓冲区地址，可为NULL
+ * @param[in] size       分配时的大小
+ * @param[in] page_size  分配时得到的页大小
+ */
+void rdma_buf_free(char *buf, size_t size, uint32_t page_size);
+
+/**
+ * 页大小的可读名称，如"2MB"，0返回"malloc"，BUF_PAGE_THP返回"THP"
+ */
+const char *buf_page_size_str(uint32_t page_size);
+
+/**
+ * 读取当前进程的常驻内存（/proc/self/statm的resident字段）
+ *
+ * 用于测量创建大量QP前后的内存增量：驱动在用户态分配的队列缓冲区、
+ * 门铃记录和库内的每QP状态都计入RSS。
+ *
+ * @return    常驻内存字节数，读取失败返回0
+ */
+size_t mem_rss_bytes(void);
+
+#endif /* RDMA_COMMON_MEM_H */
@@ -0,0 +1,287 @@
+/**
+ * @file rdma_common_mrcache.c
+ * @brief 内存注册缓存实现：二分查找、重叠合并、LRU淘汰、失效处理
+ *
+ * 有效区间保存在按start排序的指针数组里，合并保证区间互不重叠，
+ * 因此"第一个end大于地址的区间"就是唯一可能覆盖该地址的区间。
+ * 淘汰时线性扫描找最旧的未引用区间，只发生在未命中路径上。
+ */
+
+#include "rdma_common_mrcache.h"
+#include "rdma_common_poll.h"
+
+#include <sys/mman.h>
+
+/* 第一个end > addr的有效区间下标 */
+static uint32_t mr_cache_lower(const struct mr_cache *cache, uintptr_t addr) {
+    uint32_t lo = 0;
+    uint32_t hi = cache->nlive;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (cache->live[mid]->end <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* 注销并释放一个区间（不处理数组和链表） */
+static void mr_cache_free_entry(struct mr_cache *cache, struct mr_cache_entry *e) {
+    cache->pinned -= e->end - e->start;
+    ibv_dereg_mr(e->mr);
+    free(e);
+}
+
+/* 从有效数组中移除下标idx：未引用的直接注销，仍被引用的转入失效链表 */
+static void mr_cache_retire(struct mr_cache *cache, uint32_t idx) {
+    struct mr_cache_entry *e = cache->live[idx];
+
+    memmove(&cache->live[idx], &cache->live[idx + 1],
+            (cache->nlive - idx - 1) * sizeof(cache->live[0]));
+    cache->nlive--;
+    if (e->refs == 0) {
+        mr_cache_free_entry(cache, e);
+        return;
+    }
+    e->stale = 1;
+    e->next_stale = cache->stale;
+    cache->stale = e;
+}
+
+/*
+ * 按LRU注销未引用的区间，直到能再锁定need字节
+ * 与[keep_start, keep_end)重叠的区间即将被合并，不作为淘汰对象
+ */
+static int mr_cache_make_room(struct mr_cache *cache, size_t need,
+                              uintptr_t keep_start, uintptr_t keep_end) {
+    struct mr_cache_entry *e;
+    uint32_t victim;
+    uint32_t i;
+
+    while (cache->pinned + need > cache->budget) {
+        victim = cache->nlive;
+        for (i = 0; i < cache->nlive; i++) {
+            e = cache->live[i];
+            if (e->refs > 0 || mr_cache_overlap(keep_start, keep_end, e->start, e->end)) {
+                continue;
+            }
+            if (victim == cache->nlive || e->last_use < cache->live[victim]->last_use) {
+                victim = i;
+            }
+        }
+        if (victim == cache->nlive) {
+            return -1;
+        }
+        mr_cache_retire(cache, victim);
+        cache->evictions++;
+    }
+    return 0;
+}
+
+/*
+ * 从下标i起把重叠的区间并入[*start, *end)，不改动缓存
+ *
+ * @return  被合并区间中未引用部分的字节数，合并后这部分锁定内存随旧MR一起释放
+ */
+static size_t mr_cache_span(const struct mr_cache *cache, uint32_t i,
+                            uintptr_t *start, uintptr_t *end) {
+    const struct mr_cache_entry *e;
+    size_t reclaim = 0;
+
+    for (; i < cache->nlive; i++) {
+        e = cache->live[i];
+        if (!mr_cache_overlap(*start, *end, e->start, e->end)) {
+            break;
+        }
+        if (e->start < *start) {
+            *start = e->start;
+        }
+        if (e->end > *end) {
+            *end = e->end;
+        }
+        if (e->refs == 0) {
+            reclaim += e->end - e->start;
+        }
+    }
+    return reclaim;
+}
+
+/* 为即将注册的[start, end)腾出预算和数组槽位，失败时被合并的区间保持不变 */
+static int mr_cache_reserve(struct mr_cache *cache, uintptr_t start, uintptr_t end,
+                            size_t reclaim) {
+    size_t len = end - start;
+    struct mr_cache_entry **live;
+    uint32_t cap;
+
+    if (len > cache->budget ||
+        mr_cache_make_room(cache, len > reclaim ? len - reclaim : 0, start, end)) {
+        fprintf(stderr, "错误: 注册%zu字节超出锁定内存预算(已锁定%zu/%zu字节)\n",
+                len, cache->pinned, cache->budget);
+        return -1;
+    }
+    if (cache->nlive == cache->cap) {
+        cap = cache->cap ? cache->cap * 2 : 16;
+        live = realloc(cache->live, cap * sizeof(live[0]));
+        if (!live) {
+            fprintf(stderr, "错误: 扩展注册缓存数组失败\n");
+            return -1;
+        }
+        cache->live = live;
+        cache->cap = cap;
+    }
+    return 0;
+}
+
+/* 新MR已注册：被它覆盖的旧区间退出有效数组，新区间按start插入 */
+static void mr_cache_insert(struct mr_cache *cache, struct mr_cache_entry *e) {
+    uint32_t i = mr_cache_lower(cache, e->start);
+
+    while (i < cache->nlive && cache->live[i]->start < e->end) {
+        mr_cache_retire(cache, i);
+        cache->merges++;
+    }
+    memmove(&cache->live[i + 1], &cache->live[i], (cache->nlive - i) * sizeof(cache->live[0]));
+    cache->live[i] = e;
+    cache->nlive++;
+}
+
+int mr_cache_init(struct mr_cache *cache, struct ibv_pd *pd, size_t budget, int access) {
+    memset(cache, 0, sizeof(*cache));
+    if (!pd) {
+        fprintf(stderr, "错误: 注册缓存需要有效的PD\n");
+        return -1;
+    }
+    cache->pd = pd;
+    cache->access = access;
+    cache->budget = budget ? budget : MR_CACHE_DEFAULT_BUDGET;
+    return 0;
+}
+
+struct mr_cache_entry *mr_cache_get(struct mr_cache *cache, const void *addr, size_t len) {
+    struct mr_cache_entry *e;
+    uintptr_t start;
+    uintptr_t end;
+    size_t reclaim;
+    uint32_t i;
+    uint64_t t0;
+
+    if (len == 0) {
+        return NULL;
+    }
+    mr_cache_align((uintptr_t)addr, len, (size_t)sysconf(_SC_PAGESIZE), &start, &end);
+
+    i = mr_cache_lower(cache, start);
+    if (i < cache->nlive && cache->live[i]->start <= start && cache->live[i]->end >= end) {
+        e = cache->live[i];
+        e->refs++;
+        e->last_use = ++cache->tick;
+        cache->hits++;
+        return e;
+    }
+    cache->misses++;
+
+    /* 先算出合并后的区间并腾出空间，注册成功之后才替换被合并的旧区间 */
+    reclaim = mr_cache_span(cache, i, &start, &end);
+    if (mr_cache_reserve(cache, start, end, reclaim)) {
+        return NULL;
+    }
+    e = calloc(1, sizeof(*e));
+    if (!e) {
+        return NULL;
+    }
+    t0 = monotonic_ns();
+    e->mr = ibv_reg_mr(cache->pd, (void *)start, end - start, cache->access);
+    cache->reg_ns += monotonic_ns() - t0;
+    if (!e->mr) {
+        fprintf(stderr, "错误: 注册内存区间[%p, +%zu)失败: %s\n",
+                (void *)start, (size_t)(end - start), strerror(errno));
+        free(e);
+        return NULL;
+    }
+    e->start = start;
+    e->end = end;
+    e->refs = 1;
+    e->last_use = ++cache->tick;
+    mr_cache_insert(cache, e);
+    cache->pinned += end - start;
+    return e;
+}
+
+void mr_cache_put(struct mr_cache *cache, struct mr_cache_entry *entry) {
+    struct mr_cache_entry **pp;
+
+    if (!entry || entry->refs == 0) {
+        return;
+    }
+    if (--entry->refs > 0 || !entry->stale) {
+        return;
+    }
+    for (pp = &cache->stale; *pp; pp = &(*pp)->next_stale) {
+        if (*pp == entry) {
+            *pp = entry->next_stale;
+            break;
+        }
+    }
+    mr_cache_free_entry(cache, entry);
+}
+
+uint32_t mr_cache_invalidate(struct mr_cache *cache, const void *addr, size_t len) {
+    uintptr_t start;
+    uintptr_t end;
+    uint32_t count = 0;
+    uint32_t i;
+
+    if (len == 0) {
+        return 0;
+    }
+    mr_cache_align((uintptr_t)addr, len, (size_t)sysconf(_SC_PAGESIZE), &start, &end);
+
+    i = mr_cache_lower(cache, start);
+    while (i < cache->nlive && cache->live[i]->start < end) {
+        if (cache->live[i]->refs > 0) {
+            fprintf(stderr, "警告: 失效的区间[%p, +%zu)仍被引用，延后注销\n",
+                    (void *)cache->live[i]->start,
+                    (size_t)(cache->live[i]->end - cache->live[i]->start));
+        }
+        mr_cache_retire(cache, i);
+        count++;
+    }
+    cache->invalidations += count;
+    return count;
+}
+
+int mr_cache_munmap(struct mr_cache *cache, void *addr, size_t len) {
+    mr_cache_invalidate(cache, addr, len);
+    return munmap(addr, len);
+}
+
+void mr_cache_print_stats(const struct mr_cache *cache) {
+    uint64_t lookups = cache->hits + cache->misses;
+
+    printf("注册缓存: 命中%llu/%llu (%.1f%%), 合并%llu, 淘汰%llu, 失效%llu\n",
+           (unsigned long long)cache->hits, (unsigned long long)lookups,
+           lookups ? 100.0 * (double)cache->hits / (double)lookups : 0.0,
+           (unsigned long long)cache->merges, (unsigned long long)cache->evictions,
+           (unsigned long long)cache->invalidations);
+    printf("  - 区间数: %u, 锁定: %zu/%zu字节, 平均注册耗时: %.1fus\n",
+           cache->nlive, cache->pinned, cache->budget,
+           cache->misses ? (double)cache->reg_ns / (double)cache->misses / 1000.0 : 0.0);
+}
+
+void mr_cache_destroy(struct mr_cache *cache) {
+    struct mr_cache_entry *e;
+
+    while (cache->nlive > 0) {
+        mr_cache_free_entry(cache, cache->live[--cache->nlive]);
+    }
+    while ((e = cache->stale) != NULL) {
+        cache->stale = e->next_stale;
+        mr_cache_free_entry(cache, e);
+    }
+    free(cache->live);
+    memset(cache, 0, sizeof(*cache));
+}
@@ -0,0 +1,136 @@
+/**
+ * @file rdma_common_mrcache.h
+ * @brief 内存注册缓存：按地址区间复用MR，支持应用内存零拷贝发送
+ *
+ * init_rdma_resources()只注册库自己分配的res->buf，应用内存必须先拷贝进去才能发送。
+ * 每次ibv_reg_mr都要锁页并建立地址转换表（数十微秒），逐条消息注册不可行。
+ * 本模块按地址区间缓存MR：
+ *
+ * - 区间按页对齐后查找，已有MR完整覆盖时直接复用（命中）
+ * - 未命中时把与新区间重叠的已缓存区间合并成一个更大的区间重新注册，
+ *   缓存中的区间始终互不重叠并按起始地址排序，查找为二分
+ * - 锁定内存总量不超过budget，超出时按LRU注销引用计数为0的区间
+ * - 内存被munmap/free后MR会指向失效的物理页，调用者必须在释放内存前
+ *   调用mr_cache_invalidate()（或用mr_cache_munmap()代替munmap），
+ *   仍被引用的区间先标记为失效，最后一次mr_cache_put()时才注销
+ *
+ * 不使用userfaultfd：UFFD_EVENT_UNMAP要求事先把所有区间注册到uffd并
+ * 由单独的线程监听，对本项目的单线程数据路径来说显式钩子更简单可控。
+ *
+ * @see rdma_common_mrcache.c
+ */
+
+#ifndef RDMA_COMMON_MRCACHE_H
+#define RDMA_COMMON_MRCACHE_H
+
+#include "rdma_common.h"
+
+#define MR_CACHE_DEFAULT_BUDGET  (256u << 20)  /* 默认锁定内存预算(字节) */
+
+/**
+ * 一个已注册的区间
+ */
+struct mr_cache_entry {
+    uintptr_t start;                   /* 页对齐的起始地址 */
+    uintptr_t end;                     /* 页对齐的结束地址（不含） */
+    struct ibv_mr *mr;
+    uint32_t refs;                     /* mr_cache_get()未配对put的次数 */
+    int stale;                         /* 已失效，只等引用归零后注销 */
+    uint64_t last_use;                 /* LRU时间戳 */
+    struct mr_cache_entry *next_stale; /* 失效链表 */
+};
+
+/**
+ * 注册缓存
+ */
+struct mr_cache {
+    struct ibv_pd *pd;
+    int access;                        /* ibv_reg_mr的访问权限 */
+    size_t budget;                     /* 锁定内存上限 */
+    size_t pinned;                     /* 当前锁定的字节数（含失效区间） */
+    struct mr_cache_entry **live;      /* 有效区间，按start排序且互不重叠 */
+    uint32_t nlive;
+    uint32_t cap;
+    struct mr_cache_entry *stale;      /* 仍被引用的失效区间 */
+    uint64_t tick;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t merges;                   /* 合并掉的旧区间数 */
+    uint64_t evictions;                /* 因预算被LRU注销的区间数 */
+    uint64_t invalidations;            /* 被mr_cache_invalidate()命中的区间数 */
+    uint64_t reg_ns;                   /* ibv_reg_mr累计耗时 */
+};
+
+/**
+ * 把[addr, addr+len)扩展到页边界
+ */
+static inline void mr_cache_align(uintptr_t addr, size_t len, size_t page,
+                                  uintptr_t *start, uintptr_t *end) {
+    *start = addr & ~(uintptr_t)(page - 1);
+    *end = (addr + len + page - 1) & ~(uintptr_t)(page - 1);
+}
+
+/**
+ * 判断两个半开区间是否重叠
+ */
+static inline int mr_cache_overlap(uintptr_t s1, uintptr_t e1, uintptr_t s2, uintptr_t e2) {
+    return s1 < e2 && s2 < e1;
+}
+
+/**
+ * 初始化缓存
+ *
+ * @param[out] cache   缓存
+ * @param[in]  pd      注册所用的PD
+ * @param[in]  budget  锁定内存上限，0表示MR_CACHE_DEFAULT_BUDGET
+ * @param[in]  access  访问权限，通常为IBV_ACCESS_LOCAL_WRITE
+ *
+ * @return    成功返回0，失败返回-1
+ */
+int mr_cache_init(struct mr_cache *cache, struct ibv_pd *pd, size_t budget, int access);
+
+/**
+ * 取得覆盖[addr, addr+len)的MR并增加引用
+ *
+ * @return    区间句柄（用entry->mr->lkey构造SGE），失败返回NULL：
+ *            len为0、区间超过预算、无法在预算内腾出空间或注册失败
+ *
+ * @note      句柄在mr_cache_put()之前保持有效；WR完成前不要put
+ */
+struct mr_cache_entry *mr_cache_get(struct mr_cache *cache, const void *addr, size_t len);
+
+/**
+ * 释放mr_cache_get()取得的引用
+ */
+void mr_cache_put(struct mr_cache *cache, struct mr_cache_entry *entry);
+
+/**
+ * 使与[addr, addr+len)重叠的所有区间失效
+ *
+ * 必须在这段内存被munmap/free之前调用。未被引用的区间立即注销，
+ * 仍被引用的区间在最后一次mr_cache_put()时注销。
+ *
+ * @return    失效的区间数
+ */
+uint32_t mr_cache_invalidate(struct mr_cache *cache, const void *addr, size_t len);
+
+/**
+ * 先使区间失效再munmap，用来替换应用中的munmap调用
+ *
+ * @return    同munmap()
+ */
+int mr_cache_munmap(struct mr_cache *cache, void *addr, size_t len);
+
+/**
+ * 打印命中率、注册耗时等统计
+ */
+void mr_cache_print_stats(const struct mr_cache *cache);
+
+/**
+ * 注销所有区间并释放缓存
+ *
+ * @note      必须在所有使用这些MR的WR完成之后调用
+ */
+void mr_cache_destroy(struct mr_cache *cache);
+
+#endif /* RDMA_COMMON_MRCACHE_H */
@@ -3,12 +3,18 @@
  * @brief 网络通信模块：TCP元数据交换、工作请求投递、完成轮询
  *
  * 本文件实现与RDMA网络通信相关的函数，包括：
- * - TCP socket元数据交换
+ * - TCP socket元数据交换（QP号、LID、GID以及单边访问用的addr/rkey/len），
+ *   按对端实际QP数分配接收数组，收发交替进行，双方对称调用也不会互相等待
  * - Send/Receive 工作请求投递
- * - Completion Queue轮询
+ *
+ * @note Completion Queue轮询已移至rdma_common_poll.c
+ * @note 单QP投递复用rdma_common_post.c中的批量构造逻辑
  */
 
 #include "rdma_common.h"
+#include "rdma_common_post.h"
+
+#include <poll.h>
 
 int sock_sync_data(int sock,
                    struct cm_con_data_t *local_con_data,
@@ -39,117 +45,183 @@ int sock_sync_data(int sock,
     return 0;
 }
 
-int sock_sync_data_multi(int sock,
-                         struct cm_con_data_t *local_con_data,
-                         uint32_t local_num_qp,
-                         struct cm_con_data_t *remote_con_data,
-                         uint32_t *remote_num_qp) {
-    int rc;
-    int read_bytes = 0;
-    int total_read_bytes = 0;
+void con_data_fill_qp(const struct rdma_resources *res, uint32_t i,
+                      const union ibv_gid *gid, struct cm_con_data_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->qp_num = res->qp_list[i]->qp_num;
+    out->lid = res->port_attr.lid;
+    memcpy(out->gid, gid, 16);
+    out->addr = (uintptr_t)res->buf;
+    out->rkey = res->mr->rkey;
+    out->len = buf_window(res->buf_size);
+    out->rd_atomic = res->max_dest_rd_atomic;
+}
+
+int fill_local_con_data(struct rdma_resources *res, struct cm_con_data_t *local) {
+    union ibv_gid gid;
     uint32_t i;
-    uint32_t expected_size;
 
-    /* 先发送本地QP数量 */
-    rc = write(sock, &local_num_qp, sizeof(local_num_qp));
-    if (rc != sizeof(local_num_qp)) {
-        fprintf(stderr, "错误: 发送本地QP数量失败\n");
+    if (ibv_query_gid(res->context, res->ib_port, res->gid_idx, &gid)) {
+        fprintf(stderr, "错误: 查询GID失败\n");
         return -1;
     }
-    printf("已发送本地QP数量: %u\n", local_num_qp);
 
-    /* 发送所有本地QP连接信息 */
-    for (i = 0; i < local_num_qp; i++) {
-        rc = write(sock, &local_con_data[i], sizeof(struct cm_con_data_t));
-        if (rc != sizeof(struct cm_con_data_t)) {
-            fprintf(stderr, "错误: 发送QP[%u]连接信息失败\n", i);
-            return -1;
-        }
+    for (i = 0; i < res->num_qp; i++) {
+        con_data_fill_qp(res, i, &gid, &local[i]);
     }
-    printf("已发送 %u 个本地QP的连接信息\n", local_num_qp);
+    return 0;
+}
 
-    /* 接收远端QP数量 */
-    total_read_bytes = 0;
-    while (total_read_bytes < (int)sizeof(*remote_num_qp)) {
-        read_bytes = read(sock, (char *)remote_num_qp + total_read_bytes,
-                         sizeof(*remote_num_qp) - total_read_bytes);
-        if (read_bytes > 0) {
-            total_read_bytes += read_bytes;
-        } else {
-            fprintf(stderr, "错误: 接收远端QP数量失败\n");
+int sock_write_full(int sock, const void *buf, size_t len) {
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < len) {
+        n = write(sock, (const char *)buf + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
             return -1;
         }
+        done += (size_t)n;
     }
-    printf("已接收远端QP数量: %u\n", *remote_num_qp);
+    return 0;
+}
 
-    if (*remote_num_qp > MAX_QP) {
-        fprintf(stderr, "错误: 远端QP数量(%u)超过最大限制(%u)\n",
-                *remote_num_qp, MAX_QP);
-        return -1;
-    }
+int sock_read_full(int sock, void *buf, size_t len) {
+    size_t done = 0;
+    ssize_t n;
 
-    /* 接收所有远端QP连接信息 */
-    expected_size = *remote_num_qp * sizeof(struct cm_con_data_t);
-    total_read_bytes = 0;
-    while (total_read_bytes < (int)expected_size) {
-        read_bytes = read(sock, (char *)remote_con_data + total_read_bytes,
-                         expected_size - total_read_bytes);
-        if (read_bytes > 0) {
-            total_read_bytes += read_bytes;
-        } else {
-            fprintf(stderr, "错误: 接收远端QP连接信息失败\n");
+    while (done < len) {
+        n = read(sock, (char *)buf + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
             return -1;
         }
+        done += (size_t)n;
     }
-    printf("已接收 %u 个远端QP的连接信息\n", *remote_num_qp);
-
     return 0;
 }
 
-int post_receive(struct rdma_resources *res) {
-    struct ibv_recv_wr rr;
-    struct ibv_sge sge;
-    struct ibv_recv_wr *bad_wr;
-
-    memset(&sge, 0, sizeof(sge));
-    sge.addr = (uintptr_t)res->buf;
-    sge.length = res->buf_size;
-    sge.lkey = res->mr->lkey;
-
-    memset(&rr, 0, sizeof(rr));
-    rr.wr_id = 0;
-    rr.sg_list = &sge;
-    rr.num_sge = 1;
-
-    if (ibv_post_recv(res->qp_list[0], &rr, &bad_wr)) {
-        fprintf(stderr, "错误: Post Receive失败\n");
-        return -1;
+/* 交换中一个方向的进度：buf[off, len)尚未读/写 */
+struct sock_xfer {
+    char *buf;
+    size_t len;
+    size_t off;
+};
+
+/* 不阻塞地推进一个方向，内核缓冲区能收多少就写多少：成功或暂时不能继续返回0，出错或对端关闭返回-1 */
+static int sock_xfer_step(int sock, struct sock_xfer *x, int out) {
+    ssize_t n;
+
+    if (out) {
+        n = send(sock, x->buf + x->off, x->len - x->off, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } else {
+        n = recv(sock, x->buf + x->off, x->len - x->off, MSG_DONTWAIT);
+    }
+    if (n > 0) {
+        x->off += (size_t)n;
+        return 0;
     }
+    return n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
 
+/* 读完QP数后分配远端数组，接收方向切换到连接信息表 */
+static int sock_xfer_table(struct sock_xfer *in, uint32_t remote_num,
+                           struct cm_con_data_t **remote) {
+    if (remote_num == 0 || remote_num > MAX_QP) {
+        fprintf(stderr, "错误: 远端QP数量(%u)超出范围[1-%u]\n", remote_num, MAX_QP);
+        return -1;
+    }
+    *remote = malloc(remote_num * sizeof(struct cm_con_data_t));
+    if (!*remote) {
+        return -1;
+    }
+    in->buf = (char *)*remote;
+    in->len = remote_num * sizeof(struct cm_con_data_t);
+    in->off = 0;
     return 0;
 }
 
-int post_receive_qp(struct rdma_resources *res, uint32_t qp_idx) {
-    struct ibv_recv_wr rr;
-    struct ibv_sge sge;
-    struct ibv_recv_wr *bad_wr;
+/*
+ * 同时发送本端表、接收对端表：双方对称调用时，上千个QP的表超过socket缓冲区，
+ * 先写完再读会让两端都阻塞在写上
+ */
+static int sock_xfer_both(int sock, struct sock_xfer *out, uint32_t *remote_num,
+                          struct cm_con_data_t **remote) {
+    struct sock_xfer in = { (char *)remote_num, sizeof(*remote_num), 0 };
+    struct pollfd pfd;
 
-    if (qp_idx >= res->num_qp) {
-        fprintf(stderr, "错误: QP索引[%u]超出范围[0-%u)\n", qp_idx, res->num_qp);
-        return -1;
+    for (;;) {
+        if (in.off == in.len && !*remote && sock_xfer_table(&in, *remote_num, remote)) {
+            return -1;
+        }
+        if (out->off == out->len && in.off == in.len) {
+            return 0;
+        }
+        pfd.fd = sock;
+        pfd.events = (short)((out->off < out->len ? POLLOUT : 0) | (in.off < in.len ? POLLIN : 0));
+        pfd.revents = 0;
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (pfd.revents & POLLNVAL) {
+            return -1;
+        }
+        /* POLLERR/POLLHUP时recv/send会返回错误或0，由sock_xfer_step()报告 */
+        if ((pfd.revents & (POLLIN | POLLERR | POLLHUP)) && in.off < in.len &&
+            sock_xfer_step(sock, &in, 0)) {
+            return -1;
+        }
+        if ((pfd.revents & (POLLOUT | POLLERR)) && out->off < out->len &&
+            sock_xfer_step(sock, out, 1)) {
+            return -1;
+        }
     }
+}
 
-    memset(&sge, 0, sizeof(sge));
-    sge.addr = (uintptr_t)res->buf;
-    sge.length = res->buf_size;
-    sge.lkey = res->mr->lkey;
+int sock_exchange_con_data(int sock, const struct cm_con_data_t *local, uint32_t local_num,
+                           struct cm_con_data_t **remote, uint32_t *remote_num) {
+    size_t len = sizeof(struct cm_con_data_multi_t) + local_num * sizeof(struct cm_con_data_t);
+    struct cm_con_data_multi_t *msg = malloc(len);
+    struct sock_xfer out;
+    int rc;
+
+    *remote = NULL;
+    if (!msg) {
+        return -1;
+    }
+    msg->num_qp = local_num;
+    memcpy(msg->qp_data, local, local_num * sizeof(struct cm_con_data_t));
+    out.buf = (char *)msg;
+    out.len = len;
+    out.off = 0;
+
+    rc = sock_xfer_both(sock, &out, remote_num, remote);
+    free(msg);
+    if (rc) {
+        fprintf(stderr, "错误: 交换连接信息失败 (本端%u个QP，已发送%zu/%zu字节)\n",
+                local_num, out.off, out.len);
+        free(*remote);
+        *remote = NULL;
+        return -1;
+    }
+    return 0;
+}
 
-    memset(&rr, 0, sizeof(rr));
-    rr.wr_id = qp_idx;
-    rr.sg_list = &sge;
-    rr.num_sge = 1;
+int post_receive(struct rdma_resources *res) {
+    return post_receive_qp(res, 0);
+}
 
-    if (ibv_post_recv(res->qp_list[qp_idx], &rr, &bad_wr)) {
+int post_receive_qp(struct rdma_resources *res, uint32_t qp_idx) {
+    /* 单个WR的批量投递，wr_id = WR_ID_MAKE(qp_idx, 0) = qp_idx */
+    if (post_receive_batch(res, qp_idx, 1, NULL)) {
         fprintf(stderr, "错误: Post Receive到QP[%u]失败\n", qp_idx);
         return -1;
     }
@@ -171,97 +243,15 @@ int post_receive_all(struct rdma_resources *res) {
 }
 
 int post_send(struct rdma_resources *res, enum ibv_wr_opcode opcode) {
-    struct ibv_send_wr sr;
-    struct ibv_sge sge;
-    struct ibv_send_wr *bad_wr;
-
-    memset(&sge, 0, sizeof(sge));
-    sge.addr = (uintptr_t)res->buf;
-    sge.length = res->buf_size;
-    sge.lkey = res->mr->lkey;
-
-    memset(&sr, 0, sizeof(sr));
-    sr.wr_id = 0;
-    sr.opcode = opcode;
-    sr.sg_list = &sge;
-    sr.num_sge = 1;
-    sr.send_flags = IBV_SEND_SIGNALED;
-
-    if (ibv_post_send(res->qp_list[0], &sr, &bad_wr)) {
-        fprintf(stderr, "错误: Post Send失败\n");
-        return -1;
-    }
-
-    return 0;
+    /* 单QP旧接口，统一走post_send_qp()以纳入发送队列统计 */
+    return post_send_qp(res, 0, opcode);
 }
 
 int post_send_qp(struct rdma_resources *res, uint32_t qp_idx, enum ibv_wr_opcode opcode) {
-    struct ibv_send_wr sr;
-    struct ibv_sge sge;
-    struct ibv_send_wr *bad_wr;
-
-    if (qp_idx >= res->num_qp) {
-        fprintf(stderr, "错误: QP索引[%u]超出范围[0-%u)\n", qp_idx, res->num_qp);
-        return -1;
-    }
-
-    memset(&sge, 0, sizeof(sge));
-    sge.addr = (uintptr_t)res->buf;
-    sge.length = res->buf_size;
-    sge.lkey = res->mr->lkey;
-
-    memset(&sr, 0, sizeof(sr));
-    sr.wr_id = qp_idx;
-    sr.opcode = opcode;
-    sr.sg_list = &sge;
-    sr.num_sge = 1;
-    sr.send_flags = IBV_SEND_SIGNALED;
-
-    if (ibv_post_send(res->qp_list[qp_idx], &sr, &bad_wr)) {
+    if (post_send_batch(res, qp_idx, opcode, 1, NULL)) {
         fprintf(stderr, "错误: Post Send到QP[%u]失败\n", qp_idx);
         return -1;
     }
 
     return 0;
 }
-
-int poll_completion(struct rdma_resources *res, int expected_completions, int *qp_idx) {
-    struct ibv_wc wc;
-    int poll_result;
-    int total_completions = 0;
-    unsigned long start_time_msec;
-    unsigned long cur_time_msec;
-    struct timeval cur_time;
-
-    gettimeofday(&cur_time, NULL);
-    start_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
-
-    while (total_completions < expected_completions) {
-        poll_result = ibv_poll_cq(res->cq, 1, &wc);
-        if (poll_result < 0) {
-            fprintf(stderr, "错误: Poll CQ失败\n");
-            return -1;
-        }
-
-        if (poll_result > 0) {
-            total_completions++;
-            if (wc.status != IBV_WC_SUCCESS) {
-                fprintf(stderr, "错误: 完成状态异常: %s\n",
-                        ibv_wc_status_str(wc.status));
-                return -1;
-            }
-            if (qp_idx) {
-                *qp_idx = (int)wc.wr_id;
-            }
-        }
-
-        gettimeofday(&cur_time, NULL);
-        cur_time_msec = (cur_time.tv_sec * 1000) + (cur_time.tv_usec / 1000);
-        if ((cur_time_msec - start_time_msec) > 5000) {
-            fprintf(stderr, "错误: Poll CQ超时\n");
-            return -1;
-        }
-    }
-
-    return 0;
-}
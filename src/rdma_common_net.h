@@ -0,0 +1,77 @@
+/**
+ * @file rdma_common_net.h
+ * @brief QP连接信息的TCP交换 - 填充本地信息、按实际QP数收发
+ *
+ * 线路格式：num_qp (uint32_t) + cm_con_data_t[num_qp]，各字段为主机字节序。
+ * 接收端先读出num_qp，校验不超过MAX_QP后再按该数量分配和读取，
+ * 因此交换的数据量只与实际QP数有关。由rdma_common.h包含。
+ *
+ * @see rdma_common_net.c
+ */
+
+#ifndef RDMA_COMMON_NET_H
+#define RDMA_COMMON_NET_H
+
+/**
+ * 多QP连接信息的线路格式（变长，qp_data有num_qp个元素）
+ */
+struct cm_con_data_multi_t {
+    uint32_t num_qp;                   /* QP数量 */
+    struct cm_con_data_t qp_data[];    /* 多个QP的连接信息 */
+} __attribute__((packed));
+
+/**
+ * 填充所有本地QP的连接信息
+ *
+ * 每个QP都开放整个res->buf供远端单边访问（addr/rkey/len）。
+ *
+ * @param[in]  res    RDMA资源结构体指针，QP列表必须已创建
+ * @param[out] local  连接信息数组，至少res->num_qp个元素
+ *
+ * @return    成功返回0，查询GID失败返回-1
+ */
+int fill_local_con_data(struct rdma_resources *res, struct cm_con_data_t *local);
+
+/**
+ * 填充单个QP的连接信息，供逐块发送连接信息的建链流程使用
+ *
+ * @param[in]  res  RDMA资源，QP i必须已创建
+ * @param[in]  i    QP下标
+ * @param[in]  gid  本端GID（调用者查询一次后复用）
+ * @param[out] out  连接信息
+ */
+void con_data_fill_qp(const struct rdma_resources *res, uint32_t i,
+                      const union ibv_gid *gid, struct cm_con_data_t *out);
+
+/**
+ * 写满len字节，处理短写，被信号中断时继续
+ *
+ * @return    成功返回0，出错或对端关闭返回-1
+ */
+int sock_write_full(int sock, const void *buf, size_t len);
+
+/**
+ * 读满len字节，处理短读，被信号中断时继续
+ *
+ * @return    成功返回0，出错或对端关闭返回-1
+ */
+int sock_read_full(int sock, void *buf, size_t len);
+
+/**
+ * 通过TCP socket交换连接信息，按对端实际QP数分配接收数组
+ *
+ * 线路格式见文件头。发送本地表的同时接收对端的表（poll驱动，内核缓冲区能收多少
+ * 就写多少），双方同时调用时即使表超过socket缓冲区也不会都阻塞在写上。
+ *
+ * @param[in]  sock        已连接的TCP socket
+ * @param[in]  local       本地连接信息，local_num个元素
+ * @param[in]  local_num   本地QP数
+ * @param[out] remote      成功时指向malloc分配的远端连接信息，由调用者free()
+ * @param[out] remote_num  远端QP数
+ *
+ * @return    成功返回0，失败返回-1（*remote为NULL）
+ */
+int sock_exchange_con_data(int sock, const struct cm_con_data_t *local, uint32_t local_num,
+                           struct cm_con_data_t **remote, uint32_t *remote_num);
+
+#endif /* RDMA_COMMON_NET_H */
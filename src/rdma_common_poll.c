@@ -0,0 +1,199 @@
+/**
+ * @file rdma_common_poll.c
+ * @brief 完成轮询模块：批量取出WC、按QP分发、低开销超时检查
+ *
+ * 本文件实现完成队列的轮询引擎，包括：
+ * - 单次ibv_poll_cq批量取出多个完成事件
+ * - 按wr_id中的QP索引分发到各QP的处理函数
+ * - 解码WRITE_WITH_IMM的立即数，记录到qp_ctx的imm_*字段
+ * - 发送CQE触发发送队列槽位回收（选择性signaling）
+ * - SRQ上的RECV按qp_num找回QP，处理完后回收槽位
+ * - 工作线程轮询各自的CQ（poll_cq_batch_on()）
+ * - 基于CLOCK_MONOTONIC_COARSE的低频超时检查
+ * - 等待期间收到异步故障事件时立即返回（见rdma_common_async.h）
+ * - CQ为空时按忙轮询/事件驱动/混合模式等待（见rdma_common_event.c）
+ * - 兼容旧接口poll_completion()
+ */
+
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+#include "rdma_common_event.h"
+#include "rdma_common_srq.h"
+#include "rdma_common_async.h"
+
+int register_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                        wc_handler_t handler, void *arg) {
+    if (!res || !res->qp_ctx) {
+        fprintf(stderr, "错误: QP上下文未初始化\n");
+        return -1;
+    }
+    if (qp_idx >= res->num_qp) {
+        fprintf(stderr, "错误: QP索引[%u]超出范围[0-%u)\n", qp_idx, res->num_qp);
+        return -1;
+    }
+
+    res->qp_ctx[qp_idx].handler = handler;
+    res->qp_ctx[qp_idx].handler_arg = arg;
+    return 0;
+}
+
+int poll_dispatch_wc(struct rdma_resources *res, const struct ibv_wc *wc) {
+    uint32_t qp_idx = WR_ID_QP(wc->wr_id);
+    int srq_recv = res->srq && srq_is_recv(wc);
+    struct qp_ctx *ctx;
+    int rc = 0;
+
+    /* SRQ上的RECV不知道会被哪个QP消费，按qp_num找回索引 */
+    if (srq_recv) {
+        qp_idx = srq_qp_index(res, wc->qp_num);
+        res->srq->posted--;
+        res->srq->received++;
+    }
+    if (qp_idx >= res->num_qp) {
+        fprintf(stderr, "错误: 完成事件的QP索引[%u]无效 (wr_id=0x%llx)\n",
+                qp_idx, (unsigned long long)wc->wr_id);
+        if (srq_recv) {
+            srq_recycle(res, WR_ID_TAG(wc->wr_id));
+        }
+        return -1;
+    }
+
+    /* 成功的发送CQE一次性回收它覆盖的所有发送队列槽位 */
+    if (wc->status == IBV_WC_SUCCESS && !(wc->opcode & IBV_WC_RECV)) {
+        sq_reclaim(res, qp_idx);
+    }
+
+    ctx = &res->qp_ctx[qp_idx];
+    /* 任何失败的完成事件都意味着QP已进入ERR，记下第一个原因供恢复流程判断 */
+    if (wc->status != IBV_WC_SUCCESS && ctx->wc_error == IBV_WC_SUCCESS) {
+        ctx->wc_error = wc->status;
+    }
+    if (wc->status == IBV_WC_SUCCESS && wc->opcode == IBV_WC_RECV_RDMA_WITH_IMM) {
+        ctx->imm_slot = IMM_SLOT(ntohl(wc->imm_data));
+        ctx->imm_len = IMM_LEN(ntohl(wc->imm_data));
+        ctx->imm_count++;
+    }
+
+    if (ctx->handler) {
+        rc = ctx->handler(res, qp_idx, wc, ctx->handler_arg);
+    } else if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: QP[%u]完成状态异常: %s\n",
+                qp_idx, ibv_wc_status_str(wc->status));
+        rc = -1;
+    }
+
+    /* 处理函数返回后SRQ缓冲区即可补投 */
+    if (srq_recv && srq_recycle(res, WR_ID_TAG(wc->wr_id))) {
+        return -1;
+    }
+    return rc;
+}
+
+int poll_cq_batch(struct rdma_resources *res, struct ibv_wc *wc, int max_wc) {
+    if (!res) {
+        return -1;
+    }
+    if (res->workers) {
+        fprintf(stderr, "错误: 启用工作线程后QP不在res->cq上，需用poll_cq_batch_on()轮询各线程的CQ\n");
+        return -1;
+    }
+    return poll_cq_batch_on(res, res->cq, wc, max_wc);
+}
+
+int poll_cq_batch_on(struct rdma_resources *res, struct ibv_cq *cq,
+                     struct ibv_wc *wc, int max_wc) {
+    int rc = 0;
+    int n;
+    int i;
+
+    if (!res || !cq || !wc || max_wc <= 0) {
+        return -1;
+    }
+
+    n = ibv_poll_cq(cq, max_wc, wc);
+    if (n < 0) {
+        fprintf(stderr, "错误: Poll CQ失败\n");
+        return -1;
+    }
+
+    /* 已取出的完成事件必须全部分发，否则槽位回收和错误记录会随之丢失 */
+    for (i = 0; i < n; i++) {
+        if (poll_dispatch_wc(res, &wc[i])) {
+            rc = -1;
+        }
+    }
+
+    return rc ? rc : n;
+}
+
+/*
+ * 等待expected个完成事件；wc每批都从头写，last_qp非NULL时记录最后一个完成事件的QP，
+ * 调用者不能用wc[n - 1]推断（最后一批可能不满，之后的元素是更早批次的残留）
+ */
+static int poll_wait(struct rdma_resources *res, int expected, struct ibv_wc *wc,
+                     int max_wc, uint32_t *last_qp) {
+    struct cq_idle_state idle;
+    int total = 0;
+    int n;
+    int want;
+    uint64_t deadline;
+    uint32_t fault_gen;
+
+    if (!res || !wc || max_wc <= 0) {
+        return -1;
+    }
+
+    memset(&idle, 0, sizeof(idle));
+    deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    fault_gen = async_fault_gen(res);
+
+    while (total < expected) {
+        want = expected - total;
+        if (want > max_wc) {
+            want = max_wc;
+        }
+
+        n = poll_cq_batch(res, wc, want);
+        if (n < 0) {
+            return -1;
+        }
+        if (n > 0) {
+            total += n;
+            if (last_qp) {
+                *last_qp = WR_ID_QP(wc[n - 1].wr_id);
+            }
+            memset(&idle, 0, sizeof(idle));
+            continue;
+        }
+
+        /* 未启动监视线程时fault_gen恒为0，这里只多一次原子load */
+        if (async_fault_gen(res) != fault_gen) {
+            fprintf(stderr, "错误: 等待期间收到异步故障事件 (已完成%d/%d)\n", total, expected);
+            return -1;
+        }
+        if (cq_idle_wait(res, &idle, deadline)) {
+            fprintf(stderr, "错误: Poll CQ超时 (已完成%d/%d)\n", total, expected);
+            return -1;
+        }
+    }
+
+    return total;
+}
+
+int poll_completion_batch(struct rdma_resources *res, int expected,
+                          struct ibv_wc *wc, int max_wc) {
+    return poll_wait(res, expected, wc, max_wc, NULL);
+}
+
+int poll_completion(struct rdma_resources *res, int expected_completions, int *qp_idx) {
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    uint32_t last_qp = 0;
+
+    if (poll_wait(res, expected_completions, wc, POLL_BATCH_SIZE, &last_qp) < 0) {
+        return -1;
+    }
+    if (qp_idx && expected_completions > 0) {
+        *qp_idx = (int)last_qp;
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file rdma_common_poll.h
+ * @brief 批量完成轮询引擎接口 - 多WC批量取出、按QP分发、低开销超时检查
+ *
+ * 本头文件声明基于ibv_poll_cq批量模式的轮询接口：
+ * - 单次调用最多取出N个完成事件到调用者提供的数组
+ * - 按wr_id中编码的QP索引，把完成事件分发给各QP注册的处理函数
+ * - 阻塞式等待仅在连续K次空轮询后读取一次单调时钟检查超时
+ *
+ * @note 多QP默认共享init_rdma_resources()创建的单个CQ，启用工作线程时每线程一个CQ
+ * @see rdma_common_poll.c
+ */
+
+#ifndef RDMA_COMMON_POLL_H
+#define RDMA_COMMON_POLL_H
+
+#include "rdma_common.h"
+
+#include <time.h>
+
+/**
+ * 读取粗粒度单调时钟（毫秒）
+ *
+ * CLOCK_MONOTONIC_COARSE通过vDSO读取，开销远低于gettimeofday，
+ * 精度为一个时钟节拍（通常1~4ms），只适合做超时判断。
+ */
+static inline uint64_t monotonic_coarse_ms(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * 读取高精度单调时钟（纳秒）
+ *
+ * CLOCK_MONOTONIC_RAW不受NTP调频影响，通过vDSO读取，开销约20ns，
+ * 用于对单次操作计时。所有模块的耗时统计都用它，不要再各自封装。
+ */
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * 为指定QP注册完成事件处理函数
+ *
+ * 注册后，poll_cq_batch()取出的属于该QP的完成事件都会交给handler处理，
+ * 包括状态异常的完成事件。
+ *
+ * @param[in,out] res      RDMA资源结构体指针，必须非NULL且qp_ctx已分配
+ * @param[in]     qp_idx   QP索引，必须 < res->num_qp
+ * @param[in]     handler  处理函数，NULL表示恢复默认处理
+ * @param[in]     arg      传给处理函数的用户参数
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @note      默认处理：成功的完成事件直接计数，失败的完成事件打印错误并终止轮询
+ */
+int register_wc_handler(struct rdma_resources *res, uint32_t qp_idx,
+                        wc_handler_t handler, void *arg);
+
+/**
+ * 非阻塞批量轮询CQ并分发完成事件
+ *
+ * 调用一次ibv_poll_cq最多取出max_wc个完成事件，存入wc数组，
+ * 然后按wr_id解码出的QP索引逐个分发。
+ *
+ * @param[in]  res     RDMA资源结构体指针，必须非NULL
+ * @param[out] wc      调用者提供的WC数组，至少max_wc个元素
+ * @param[in]  max_wc  本次最多取出的完成事件数量，必须 > 0
+ *
+ * @return    成功返回取出并分发的完成事件数量（可能为0），失败返回-1
+ *
+ * @note      CQ为空时立即返回0，不会阻塞
+ * @note      wr_id中QP索引越界的完成事件视为错误
+ * @note      某个完成事件处理失败时仍分发完本批其余的完成事件，最后返回-1
+ */
+int poll_cq_batch(struct rdma_resources *res, struct ibv_wc *wc, int max_wc);
+
+/**
+ * 在指定CQ上非阻塞批量轮询并分发完成事件
+ *
+ * 与poll_cq_batch()相同，只是轮询的是cq而不是res->cq。
+ * 工作线程用它轮询自己的CQ，见rdma_common_worker.h。
+ *
+ * @param[in]  res     RDMA资源结构体指针，必须非NULL
+ * @param[in]  cq      要轮询的CQ，必须是res中QP绑定的CQ之一
+ * @param[out] wc      调用者提供的WC数组，至少max_wc个元素
+ * @param[in]  max_wc  本次最多取出的完成事件数量，必须 > 0
+ *
+ * @return    成功返回取出并分发的完成事件数量（可能为0），失败返回-1
+ */
+int poll_cq_batch_on(struct rdma_resources *res, struct ibv_cq *cq,
+                     struct ibv_wc *wc, int max_wc);
+
+/**
+ * 分发一个已取出的完成事件
+ *
+ * 与poll_cq_batch()对每个完成事件做的处理相同：SRQ槽位回收、发送队列槽位回收、
+ * 立即数解码、调用QP的处理函数。用于多个rdma_resources共享一个CQ的场景，
+ * 调用者自己ibv_poll_cq，按wc->qp_num找到所属的res后调用本函数。
+ *
+ * @param[in,out] res  完成事件所属QP的RDMA资源
+ * @param[in]     wc   完成事件，wr_id中的QP索引是res内的下标
+ *
+ * @return    0继续，非0表示处理函数要求终止或完成事件无效
+ */
+int poll_dispatch_wc(struct rdma_resources *res, const struct ibv_wc *wc);
+
+/**
+ * 阻塞式批量轮询，直到取得指定数量的完成事件
+ *
+ * 循环调用poll_cq_batch()，每次取出的数量不超过剩余期望数量，
+ * 因此不会多消费属于后续调用的完成事件。
+ * 只有连续res->poll_check_interval次空轮询后才读取一次
+ * CLOCK_MONOTONIC_COARSE检查是否超过res->poll_timeout_ms。
+ * CQ为空时按res->poll_mode忙等、睡眠或先自旋后睡眠，见cq_idle_wait()。
+ *
+ * @param[in]  res       RDMA资源结构体指针，必须非NULL
+ * @param[in]  expected  期望的完成事件数量
+ * @param[out] wc        调用者提供的WC数组，至少max_wc个元素
+ * @param[in]  max_wc    单次ibv_poll_cq最多取出的数量，必须 > 0
+ *
+ * @return    成功返回取得的完成事件数量（等于expected），失败或超时返回-1
+ * @note      每次ibv_poll_cq都从wc[0]开始写，返回后wc中只有最后一批，
+ *            其余元素可能是更早批次的残留；完成事件应在处理函数中消费
+ *
+ * @see       poll_cq_batch()
+ */
+int poll_completion_batch(struct rdma_resources *res, int expected,
+                          struct ibv_wc *wc, int max_wc);
+
+#endif /* RDMA_COMMON_POLL_H */
@@ -0,0 +1,255 @@
+/**
+ * @file rdma_common_pool.c
+ * @brief 缓冲区池实现：按级别划分注册内存、槽位取还、按发送顺序归还
+ *
+ * 所有级别的槽位放在一块页对齐的内存里，只注册一个MR；
+ * 小级别在前、大级别在后，槽位号按同样顺序连续编号。
+ */
+
+#include "rdma_common_pool.h"
+#include "rdma_common_post.h"
+
+/* 划分级别并填充槽位表，返回所需内存大小 */
+static size_t pool_layout(struct buf_pool *pool, uint32_t min_size,
+                          uint32_t max_size, uint32_t per_class) {
+    uint32_t size = pool_class_size(min_size);
+    uint32_t top = pool_class_size(max_size);
+    size_t bytes = 0;
+    uint32_t c;
+
+    for (c = 0; c < POOL_MAX_CLASSES; c++) {
+        pool->cls[c].size = size;
+        pool->cls[c].count = per_class;
+        bytes += (size_t)size * per_class;
+        if (size >= top) {
+            break;
+        }
+        size <<= 1;
+    }
+    pool->nclasses = c < POOL_MAX_CLASSES ? c + 1 : POOL_MAX_CLASSES;
+    pool->nslots = pool->nclasses * per_class;
+    return bytes;
+}
+
+/* 为每个级别建立空闲栈，并为每个槽位记录地址与lkey */
+static int pool_build_slots(struct buf_pool *pool) {
+    size_t offset = 0;
+    uint32_t id = 0;
+    uint32_t c;
+    uint32_t i;
+
+    pool->slots = calloc(pool->nslots, sizeof(struct pool_slot));
+    if (!pool->slots) {
+        return -1;
+    }
+    for (c = 0; c < pool->nclasses; c++) {
+        struct pool_class *pc = &pool->cls[c];
+
+        pc->free = malloc(pc->count * sizeof(uint32_t));
+        if (!pc->free) {
+            return -1;
+        }
+        for (i = 0; i < pc->count; i++, id++) {
+            struct pool_slot *s = &pool->slots[id];
+
+            s->addr = pool->mem + offset;
+            s->lkey = pool->mr->lkey;
+            s->offset = (uint32_t)offset;
+            s->size = pc->size;
+            s->id = id;
+            s->cls = (uint16_t)c;
+            /* 逆序入栈，使低地址的槽位先被取走 */
+            pc->free[pc->count - 1 - i] = id;
+            offset += pc->size;
+        }
+        pc->nfree = pc->count;
+    }
+    return 0;
+}
+
+int pool_init(struct buf_pool *pool, struct rdma_resources *res,
+              uint32_t min_size, uint32_t max_size, uint32_t per_class) {
+    uint32_t i;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->res = res;
+    if (!res || !res->pd || !res->qp_list || per_class == 0 || min_size > max_size) {
+        fprintf(stderr, "错误: 缓冲区池参数无效\n");
+        return -1;
+    }
+
+    pool->mem_size = pool_layout(pool, min_size, max_size, per_class);
+    if (pool->mem_size > UINT32_MAX ||
+        posix_memalign((void **)&pool->mem, (size_t)sysconf(_SC_PAGESIZE), pool->mem_size)) {
+        pool->mem = NULL;
+        fprintf(stderr, "错误: 分配缓冲区池内存失败 (%zu字节)\n", pool->mem_size);
+        return -1;
+    }
+    memset(pool->mem, 0, pool->mem_size);
+
+    pool->mr = ibv_reg_mr(res->pd, pool->mem, pool->mem_size, IBV_ACCESS_LOCAL_WRITE);
+    if (!pool->mr) {
+        fprintf(stderr, "错误: 注册缓冲区池MR失败\n");
+        return -1;
+    }
+
+    pool->sendq = calloc(res->num_qp, sizeof(struct pool_sendq));
+    if (!pool->sendq || pool_build_slots(pool)) {
+        fprintf(stderr, "错误: 分配缓冲区池槽位表失败\n");
+        return -1;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        pool->sendq[i].ids = malloc(res->sq_depth * sizeof(uint32_t));
+        if (!pool->sendq[i].ids) {
+            fprintf(stderr, "错误: 分配QP[%u]的发送槽位队列失败\n", i);
+            return -1;
+        }
+    }
+
+    printf("成功创建缓冲区池 (%u个级别 %u~%u字节, 每级%u个槽位, 共%zu字节, lkey: 0x%x)\n",
+           pool->nclasses, pool->cls[0].size, pool->cls[pool->nclasses - 1].size,
+           per_class, pool->mem_size, pool->mr->lkey);
+    return 0;
+}
+
+struct pool_slot *pool_acquire(struct buf_pool *pool, uint32_t len) {
+    uint32_t c = pool_class_index(pool->cls[0].size, len);
+    struct pool_slot *slot;
+
+    if (pool->nclasses == 0 || len > pool->cls[pool->nclasses - 1].size) {
+        return NULL;
+    }
+
+    /* 本级别用尽时向更大的级别借，浪费一些空间好过让调用者失败 */
+    for (; c < pool->nclasses; c++) {
+        struct pool_class *pc = &pool->cls[c];
+
+        if (pc->nfree > 0) {
+            slot = &pool->slots[pc->free[--pc->nfree]];
+            slot->in_use = 1;
+            return slot;
+        }
+    }
+    pool->acquire_fail++;
+    return NULL;
+}
+
+void pool_release(struct buf_pool *pool, struct pool_slot *slot) {
+    struct pool_class *pc;
+
+    if (!slot || !slot->in_use) {
+        return;
+    }
+    pc = &pool->cls[slot->cls];
+    slot->in_use = 0;
+    pc->free[pc->nfree++] = slot->id;
+}
+
+struct pool_slot *pool_slot_of(struct buf_pool *pool, uint64_t wr_id) {
+    uint32_t id = WR_ID_TAG(wr_id);
+
+    return id < pool->nslots ? &pool->slots[id] : NULL;
+}
+
+int pool_post_send(struct buf_pool *pool, uint32_t qp_idx, enum ibv_wr_opcode opcode,
+                   struct pool_slot *slot, uint32_t len) {
+    struct pool_sendq *q;
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+    int rc;
+
+    if (!slot || !slot->in_use || qp_idx >= pool->res->num_qp) {
+        return -EINVAL;
+    }
+    if (len > slot->size) {
+        return -EMSGSIZE;
+    }
+
+    sge.addr = (uintptr_t)slot->addr;
+    sge.length = len;
+    sge.lkey = slot->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, slot->id);
+    wr.opcode = opcode;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+
+    rc = post_send_chain(pool->res, qp_idx, &wr, 1, NULL);
+    if (rc) {
+        return rc;
+    }
+    /* post_send_chain()保证未完成发送数不超过sq_depth，环形队列不会溢出 */
+    q = &pool->sendq[qp_idx];
+    q->ids[q->tail++ % pool->res->sq_depth] = slot->id;
+    return 0;
+}
+
+int pool_post_recv(struct buf_pool *pool, uint32_t qp_idx, struct pool_slot *slot) {
+    struct ibv_recv_wr wr;
+    struct ibv_sge sge;
+
+    if (!slot || !slot->in_use) {
+        return -EINVAL;
+    }
+
+    sge.addr = (uintptr_t)slot->addr;
+    sge.length = slot->size;
+    sge.lkey = slot->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, slot->id);
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+
+    return post_recv_chain(pool->res, qp_idx, &wr, 1, NULL);
+}
+
+uint32_t pool_send_done(struct buf_pool *pool, uint32_t qp_idx, uint64_t wr_id) {
+    uint32_t target = WR_ID_TAG(wr_id);
+    struct pool_sendq *q;
+    uint32_t released = 0;
+    uint32_t i;
+
+    if (qp_idx >= pool->res->num_qp) {
+        return 0;
+    }
+    q = &pool->sendq[qp_idx];
+
+    /* 先确认目标确实在队列中，避免非池WR的CQE把队列清空 */
+    for (i = q->head; i != q->tail; i++) {
+        if (q->ids[i % pool->res->sq_depth] == target) {
+            break;
+        }
+    }
+    if (i == q->tail) {
+        return 0;
+    }
+
+    while (q->head != i + 1) {
+        pool_release(pool, &pool->slots[q->ids[q->head % pool->res->sq_depth]]);
+        q->head++;
+        released++;
+    }
+    return released;
+}
+
+void pool_destroy(struct buf_pool *pool) {
+    uint32_t i;
+
+    if (pool->sendq) {
+        for (i = 0; i < pool->res->num_qp; i++) {
+            free(pool->sendq[i].ids);
+        }
+        free(pool->sendq);
+    }
+    for (i = 0; i < pool->nclasses; i++) {
+        free(pool->cls[i].free);
+    }
+    free(pool->slots);
+    if (pool->mr) {
+        ibv_dereg_mr(pool->mr);
+    }
+    free(pool->mem);
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,184 @@
+/**
+ * @file rdma_common_pool.h
+ * @brief 已注册的分级缓冲区池：每个WR独占一个槽位，只发送实际使用的字节
+ *
+ * res->buf被所有QP、所有WR共用，并发的消息会互相覆盖，
+ * post_send_qp()还总是发送整个buf_size。本模块提供独立注册的一块内存，
+ * 按2的幂划分成若干大小级别（size class），每个级别有固定数量的槽位：
+ *
+ * - pool_acquire()按长度取最小的够用级别，该级别用尽时向更大的级别借
+ * - 每个槽位记录自己的地址、lkey和在池中的偏移，直接用来构造SGE
+ * - pool_post_send()/pool_post_recv()把槽位号编码进wr_id的标签，
+ *   SGE长度取实际负载长度（发送）或槽位大小（接收）
+ * - 发送队列按FIFO完成，池为每个QP记录已投递发送的槽位顺序，
+ *   pool_send_done()在取到一个发送CQE时释放它及之前的所有槽位，
+ *   选择性signaling下未signaled的WR也能正确归还
+ * - 接收槽位由调用者在处理完数据后pool_release()
+ *
+ * @see rdma_common_pool.c, rdma_common_post.h
+ */
+
+#ifndef RDMA_COMMON_POOL_H
+#define RDMA_COMMON_POOL_H
+
+#include "rdma_common.h"
+
+#define POOL_MIN_CLASS     64             /* 最小级别的槽位大小(字节) */
+#define POOL_MAX_CLASSES   20             /* 级别数上限：64B ~ 32MB */
+
+/**
+ * 一个槽位，初始化后地址、lkey等字段不再变化
+ */
+struct pool_slot {
+    char *addr;                        /* 槽位起始地址 */
+    uint32_t lkey;                     /* 所在MR的lkey */
+    uint32_t offset;                   /* 在池内存中的偏移 */
+    uint32_t size;                     /* 槽位大小，即所属级别的大小 */
+    uint32_t id;                       /* 全局槽位号，编码在wr_id标签中 */
+    uint16_t cls;                      /* 所属级别 */
+    uint16_t in_use;                   /* 是否已被取走 */
+};
+
+/**
+ * 一个大小级别
+ */
+struct pool_class {
+    uint32_t size;                     /* 槽位大小 */
+    uint32_t count;                    /* 槽位数 */
+    uint32_t *free;                    /* 空闲槽位号栈 */
+    uint32_t nfree;                    /* 空闲槽位数 */
+};
+
+/**
+ * 单个QP已投递、尚未完成的发送槽位，按投递顺序排列
+ */
+struct pool_sendq {
+    uint32_t *ids;                     /* 环形数组，容量为res->sq_depth */
+    uint32_t head;
+    uint32_t tail;
+};
+
+/**
+ * 缓冲区池
+ */
+struct buf_pool {
+    struct rdma_resources *res;
+    char *mem;                         /* 页对齐的池内存 */
+    size_t mem_size;
+    struct ibv_mr *mr;                 /* 池内存的MR，与res->mr相互独立 */
+    struct pool_class cls[POOL_MAX_CLASSES];
+    uint32_t nclasses;
+    struct pool_slot *slots;           /* 所有级别的槽位，按级别连续排列 */
+    uint32_t nslots;
+    struct pool_sendq *sendq;          /* 每个QP一个，与res->qp_list对应 */
+    uint64_t acquire_fail;             /* 因槽位耗尽失败的pool_acquire()次数 */
+};
+
+/**
+ * 能容纳len字节的最小级别大小（2的幂，不小于POOL_MIN_CLASS）
+ */
+static inline uint32_t pool_class_size(uint32_t len) {
+    uint32_t size = POOL_MIN_CLASS;
+
+    while (size < len && size < (1u << 31)) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/**
+ * len所属级别相对于最小级别min_size的下标
+ */
+static inline uint32_t pool_class_index(uint32_t min_size, uint32_t len) {
+    uint32_t size = pool_class_size(min_size);
+    uint32_t idx = 0;
+
+    while (size < len && size < (1u << 31)) {
+        size <<= 1;
+        idx++;
+    }
+    return idx;
+}
+
+/**
+ * 创建并注册缓冲区池
+ *
+ * 级别从pool_class_size(min_size)到pool_class_size(max_size)逐级翻倍，
+ * 每个级别per_class个槽位。
+ *
+ * @param[out] pool       池
+ * @param[in]  res        RDMA资源，PD已分配，QP列表已创建（sq_depth已确定）
+ * @param[in]  min_size   最小级别，不足POOL_MIN_CLASS时取POOL_MIN_CLASS
+ * @param[in]  max_size   最大级别
+ * @param[in]  per_class  每个级别的槽位数
+ *
+ * @return    成功返回0，失败返回-1（已分配的部分由pool_destroy()释放）
+ */
+int pool_init(struct buf_pool *pool, struct rdma_resources *res,
+              uint32_t min_size, uint32_t max_size, uint32_t per_class);
+
+/**
+ * 取一个至少len字节的槽位
+ *
+ * @return    槽位指针，len超过最大级别或所有够用的级别都已耗尽时返回NULL
+ */
+struct pool_slot *pool_acquire(struct buf_pool *pool, uint32_t len);
+
+/**
+ * 归还槽位
+ */
+void pool_release(struct buf_pool *pool, struct pool_slot *slot);
+
+/**
+ * 由wr_id找回槽位
+ *
+ * @return    槽位指针，标签不是合法槽位号时返回NULL
+ */
+struct pool_slot *pool_slot_of(struct buf_pool *pool, uint64_t wr_id);
+
+/**
+ * 从槽位发送len字节，槽位在对应的发送完成前归该WR所有
+ *
+ * @param[in] pool    池
+ * @param[in] qp_idx  QP索引
+ * @param[in] opcode  IBV_WR_SEND或IBV_WR_SEND_WITH_IMM等不需要远端地址的操作
+ * @param[in] slot    已取得的槽位
+ * @param[in] len     负载长度，不超过slot->size
+ *
+ * @return    成功返回0，失败返回负错误码（-EAGAIN表示发送队列已满），
+ *            失败时槽位仍归调用者所有
+ */
+int pool_post_send(struct buf_pool *pool, uint32_t qp_idx, enum ibv_wr_opcode opcode,
+                   struct pool_slot *slot, uint32_t len);
+
+/**
+ * 用槽位投递一个RECV，可接收slot->size字节
+ *
+ * @return    成功返回0，失败返回负错误码
+ *
+ * @note      RECV完成后用pool_slot_of(pool, wc->wr_id)找回槽位，处理完后pool_release()
+ */
+int pool_post_recv(struct buf_pool *pool, uint32_t qp_idx, struct pool_slot *slot);
+
+/**
+ * 处理一个发送CQE：释放该WR及之前所有已完成发送的槽位
+ *
+ * @param[in] pool    池
+ * @param[in] qp_idx  QP索引
+ * @param[in] wr_id   发送CQE的wr_id
+ *
+ * @return    释放的槽位数
+ *
+ * @note      发送CQE不是由pool_post_send()投递的WR产生时返回0；同一QP上混用
+ *            其他发送接口时，其wr_id标签不应与池的槽位号相同
+ */
+uint32_t pool_send_done(struct buf_pool *pool, uint32_t qp_idx, uint64_t wr_id);
+
+/**
+ * 注销并释放池
+ *
+ * @note      必须在所有使用池槽位的WR完成或QP销毁之后调用
+ */
+void pool_destroy(struct buf_pool *pool);
+
+#endif /* RDMA_COMMON_POOL_H */
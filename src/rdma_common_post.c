@@ -0,0 +1,294 @@
+/**
+ * @file rdma_common_post.c
+ * @brief 批量投递模块：链式WR构造、单次门铃投递、失败WR定位
+ *
+ * 本文件实现批量工作请求投递，包括：
+ * - 把WR数组链接成链表，每个QP只调用一次ibv_post_send/ibv_post_recv
+ * - 通过bad_wr指针换算出失败WR在数组中的下标
+ * - 在res->buf上批量构造Send/Receive WR
+ * - 选择性signaling与发送队列槽位的批量回收
+ * - 小消息自动使用IBV_SEND_INLINE
+ *
+ * @note post_send_qp()/post_receive_qp()是count为1的特例
+ */
+
+#include "rdma_common_post.h"
+
+/* 检查QP索引，批量接口共用 */
+static int check_qp_idx(struct rdma_resources *res, uint32_t qp_idx) {
+    if (!res || !res->qp_list) {
+        return -EINVAL;
+    }
+    if (qp_idx >= res->num_qp || !res->qp_list[qp_idx]) {
+        fprintf(stderr, "错误: QP索引[%u]超出范围[0-%u)\n", qp_idx, res->num_qp);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* 判断WR能否内联：数据在投递时由CPU拷入WQE，READ和原子操作不适用 */
+static int wr_can_inline(const struct rdma_resources *res,
+                         const struct ibv_send_wr *wr) {
+    uint32_t len = 0;
+    int i;
+
+    if (res->max_inline_data == 0) {
+        return 0;
+    }
+
+    switch (wr->opcode) {
+        case IBV_WR_SEND:
+        case IBV_WR_SEND_WITH_IMM:
+        case IBV_WR_RDMA_WRITE:
+        case IBV_WR_RDMA_WRITE_WITH_IMM:
+            break;
+        default:
+            return 0;
+    }
+
+    for (i = 0; i < wr->num_sge; i++) {
+        len += wr->sg_list[i].length;
+    }
+    return len <= res->max_inline_data;
+}
+
+/* 按signaling间隔和内联阈值为WR设置标志，并检查发送队列是否放得下 */
+static int sq_prepare(struct rdma_resources *res, uint32_t qp_idx,
+                      struct ibv_send_wr *wrs, uint32_t count) {
+    struct qp_ctx *ctx = &res->qp_ctx[qp_idx];
+    uint32_t outstanding = ctx->sq_posted - ctx->sq_completed;
+    uint32_t unsignaled = ctx->sq_unsignaled;
+    uint32_t i;
+
+    if (outstanding + count > res->sq_depth) {
+        return -EAGAIN;
+    }
+
+    for (i = 0; i < count; i++) {
+        outstanding++;
+        unsignaled++;
+        /* 达到间隔或即将写满时必须signaled，否则槽位永远无法回收 */
+        if (unsignaled >= res->signal_interval || outstanding == res->sq_depth) {
+            wrs[i].send_flags |= IBV_SEND_SIGNALED;
+        }
+        if (wrs[i].send_flags & IBV_SEND_SIGNALED) {
+            unsignaled = 0;
+        }
+        if (wr_can_inline(res, &wrs[i])) {
+            wrs[i].send_flags |= IBV_SEND_INLINE;
+        }
+    }
+
+    return 0;
+}
+
+/* 记录已被驱动接受的WR：每个signaled WR入队它覆盖的WR数 */
+static void sq_commit(struct rdma_resources *res, uint32_t qp_idx,
+                      const struct ibv_send_wr *wrs, uint32_t count) {
+    struct qp_ctx *ctx = &res->qp_ctx[qp_idx];
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        ctx->sq_posted++;
+        ctx->sq_unsignaled++;
+        if (wrs[i].send_flags & IBV_SEND_SIGNALED) {
+            ctx->sig_ring[ctx->sig_tail % res->sq_depth] = ctx->sq_unsignaled;
+            ctx->sig_tail++;
+            ctx->sq_unsignaled = 0;
+        }
+    }
+}
+
+int set_signal_interval(struct rdma_resources *res, uint32_t interval) {
+    if (!res) {
+        return -1;
+    }
+    if (interval == 0 || interval > res->sq_depth) {
+        fprintf(stderr, "错误: signaling间隔%u超出范围[1-%u]\n",
+                interval, res->sq_depth);
+        return -1;
+    }
+
+    res->signal_interval = interval;
+    return 0;
+}
+
+uint32_t sq_available(const struct rdma_resources *res, uint32_t qp_idx) {
+    const struct qp_ctx *ctx;
+
+    if (!res || !res->qp_ctx || qp_idx >= res->num_qp) {
+        return 0;
+    }
+
+    ctx = &res->qp_ctx[qp_idx];
+    return res->sq_depth - (ctx->sq_posted - ctx->sq_completed);
+}
+
+uint32_t sq_reclaim(struct rdma_resources *res, uint32_t qp_idx) {
+    struct qp_ctx *ctx = &res->qp_ctx[qp_idx];
+    uint32_t covered;
+
+    /* 未经本模块投递的signaled WR（没有记录）不参与回收 */
+    if (!ctx->sig_ring || ctx->sig_head == ctx->sig_tail) {
+        return 0;
+    }
+
+    covered = ctx->sig_ring[ctx->sig_head % res->sq_depth];
+    ctx->sig_head++;
+    ctx->sq_completed += covered;
+    return covered;
+}
+
+int post_send_chain(struct rdma_resources *res, uint32_t qp_idx,
+                    struct ibv_send_wr *wrs, uint32_t count, uint32_t *bad_idx) {
+    struct ibv_send_wr *bad_wr = NULL;
+    uint32_t i;
+    int ret;
+
+    if (check_qp_idx(res, qp_idx) || (!wrs && count > 0)) {
+        return -EINVAL;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    if (sq_prepare(res, qp_idx, wrs, count)) {
+        if (bad_idx) {
+            *bad_idx = 0;
+        }
+        return -EAGAIN;
+    }
+
+    for (i = 0; i + 1 < count; i++) {
+        wrs[i].next = &wrs[i + 1];
+    }
+    wrs[count - 1].next = NULL;
+
+    ret = ibv_post_send(res->qp_list[qp_idx], wrs, &bad_wr);
+    if (ret) {
+        /* bad_wr指向链表中第一个未被接受的WR，换算回数组下标 */
+        uint32_t accepted = bad_wr ? (uint32_t)(bad_wr - wrs) : 0;
+
+        sq_commit(res, qp_idx, wrs, accepted);
+        if (bad_idx) {
+            *bad_idx = accepted;
+        }
+        return ret > 0 ? -ret : ret;
+    }
+
+    sq_commit(res, qp_idx, wrs, count);
+    return 0;
+}
+
+int post_send_qp_len(struct rdma_resources *res, uint32_t qp_idx,
+                     enum ibv_wr_opcode opcode, uint32_t len) {
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+
+    if (check_qp_idx(res, qp_idx)) {
+        return -EINVAL;
+    }
+    if (len > res->buf_size) {
+        fprintf(stderr, "错误: 发送长度%u超过缓冲区大小%zu\n", len, res->buf_size);
+        return -EMSGSIZE;
+    }
+
+    sge.addr = (uintptr_t)res->buf;
+    sge.length = len;
+    sge.lkey = res->mr->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, 0);
+    wr.opcode = opcode;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+
+    return post_send_chain(res, qp_idx, &wr, 1, NULL);
+}
+
+int post_recv_chain(struct rdma_resources *res, uint32_t qp_idx,
+                    struct ibv_recv_wr *wrs, uint32_t count, uint32_t *bad_idx) {
+    struct ibv_recv_wr *bad_wr = NULL;
+    uint32_t i;
+    int ret;
+
+    if (check_qp_idx(res, qp_idx) || (!wrs && count > 0)) {
+        return -EINVAL;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    for (i = 0; i + 1 < count; i++) {
+        wrs[i].next = &wrs[i + 1];
+    }
+    wrs[count - 1].next = NULL;
+
+    ret = ibv_post_recv(res->qp_list[qp_idx], wrs, &bad_wr);
+    if (ret) {
+        if (bad_idx) {
+            *bad_idx = bad_wr ? (uint32_t)(bad_wr - wrs) : 0;
+        }
+        return ret > 0 ? -ret : ret;
+    }
+
+    return 0;
+}
+
+int post_send_batch(struct rdma_resources *res, uint32_t qp_idx,
+                    enum ibv_wr_opcode opcode, uint32_t count, uint32_t *bad_idx) {
+    struct ibv_send_wr wrs[POST_BATCH_MAX];
+    struct ibv_sge sges[POST_BATCH_MAX];
+    uint32_t i;
+
+    if (check_qp_idx(res, qp_idx)) {
+        return -EINVAL;
+    }
+    if (count == 0 || count > POST_BATCH_MAX) {
+        fprintf(stderr, "错误: 批量数量%u超出范围[1-%d]\n", count, POST_BATCH_MAX);
+        return -EINVAL;
+    }
+
+    /* 只清零实际使用的部分，避免每次清零整个栈数组 */
+    memset(wrs, 0, sizeof(wrs[0]) * count);
+    for (i = 0; i < count; i++) {
+        sges[i].addr = (uintptr_t)res->buf;
+        sges[i].length = buf_window(res->buf_size);
+        sges[i].lkey = res->mr->lkey;
+
+        wrs[i].wr_id = WR_ID_MAKE(qp_idx, i);
+        wrs[i].opcode = opcode;
+        wrs[i].sg_list = &sges[i];
+        wrs[i].num_sge = 1;
+    }
+
+    return post_send_chain(res, qp_idx, wrs, count, bad_idx);
+}
+
+int post_receive_batch(struct rdma_resources *res, uint32_t qp_idx,
+                       uint32_t count, uint32_t *bad_idx) {
+    struct ibv_recv_wr wrs[POST_BATCH_MAX];
+    struct ibv_sge sges[POST_BATCH_MAX];
+    uint32_t i;
+
+    if (check_qp_idx(res, qp_idx)) {
+        return -EINVAL;
+    }
+    if (count == 0 || count > POST_BATCH_MAX) {
+        fprintf(stderr, "错误: 批量数量%u超出范围[1-%d]\n", count, POST_BATCH_MAX);
+        return -EINVAL;
+    }
+
+    memset(wrs, 0, sizeof(wrs[0]) * count);
+    for (i = 0; i < count; i++) {
+        sges[i].addr = (uintptr_t)res->buf;
+        sges[i].length = buf_window(res->buf_size);
+        sges[i].lkey = res->mr->lkey;
+
+        wrs[i].wr_id = WR_ID_MAKE(qp_idx, i);
+        wrs[i].sg_list = &sges[i];
+        wrs[i].num_sge = 1;
+    }
+
+    return post_recv_chain(res, qp_idx, wrs, count, bad_idx);
+}
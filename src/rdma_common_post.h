@@ -0,0 +1,160 @@
+/**
+ * @file rdma_common_post.h
+ * @brief 批量工作请求投递接口 - 链式WR、单次门铃、精确定位失败WR
+ *
+ * 本头文件声明把多个WR链接成一条链表、只调用一次
+ * ibv_post_send/ibv_post_recv（只敲一次门铃）的投递接口：
+ * - post_send_chain()/post_recv_chain()：投递调用者构造好的WR数组
+ * - post_send_batch()/post_receive_batch()：在res->buf上构造并投递N个WR
+ *
+ * 失败时通过bad_idx返回第一个未被接受的WR在数组中的下标，
+ * 该下标之前的WR已经进入队列，之后（含）的WR均未投递。
+ *
+ * 选择性signaling：发送WR每res->signal_interval个才设置一次IBV_SEND_SIGNALED，
+ * 收到signaled WR的CQE时一次性回收它覆盖的所有发送队列槽位。
+ * 投递前检查剩余槽位，不足时返回-EAGAIN而不是让驱动溢出。
+ *
+ * 内联发送：SEND/RDMA WRITE类WR的数据总长度不超过res->max_inline_data时
+ * 自动设置IBV_SEND_INLINE，数据在投递时拷入WQE，投递返回后缓冲区即可复用。
+ *
+ * @see rdma_common_post.c
+ */
+
+#ifndef RDMA_COMMON_POST_H
+#define RDMA_COMMON_POST_H
+
+#include "rdma_common.h"
+
+#define POST_BATCH_MAX 64  /* 单次批量投递的最大WR数量 */
+
+/**
+ * 把WR数组链接成链表并一次性投递到指定QP的发送队列
+ *
+ * @param[in]  res      RDMA资源结构体指针，必须非NULL
+ * @param[in]  qp_idx   QP索引，必须 < res->num_qp
+ * @param[in]  wrs      WR数组，函数会改写每个元素的next字段
+ * @param[in]  count    WR数量，为0时直接返回成功
+ * @param[out] bad_idx  失败时写入第一个失败WR的下标，可为NULL
+ *
+ * @return    成功返回0，失败返回负错误码
+ * @retval -EINVAL  参数无效
+ * @retval -EAGAIN  发送队列剩余槽位不足count个，需先轮询CQ回收
+ * @retval -ENOMEM  发送队列空间不足（由驱动返回）
+ *
+ * @pre       QP已处于RTS状态
+ *
+ * @note      调用者已设置IBV_SEND_SIGNALED的WR保持signaled，
+ *            其余WR按signal_interval决定是否signaled
+ * @note      不超过内联阈值的SEND/WRITE类WR会被自动加上IBV_SEND_INLINE
+ */
+int post_send_chain(struct rdma_resources *res, uint32_t qp_idx,
+                    struct ibv_send_wr *wrs, uint32_t count, uint32_t *bad_idx);
+
+/**
+ * 从res->buf起始处发送len字节
+ *
+ * 与post_send_qp()不同，只发送实际使用的字节数，
+ * len不超过res->max_inline_data时走内联路径，不需要lkey和DMA读取。
+ *
+ * @param[in] res     RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx  QP索引，必须 < res->num_qp
+ * @param[in] opcode  操作码 (IBV_WR_SEND等)
+ * @param[in] len     发送字节数，必须 <= res->buf_size
+ *
+ * @return    成功返回0，失败返回负错误码
+ * @retval -EMSGSIZE  len超过缓冲区大小
+ *
+ * @see       post_send_chain()
+ */
+int post_send_qp_len(struct rdma_resources *res, uint32_t qp_idx,
+                     enum ibv_wr_opcode opcode, uint32_t len);
+
+/**
+ * 把WR数组链接成链表并一次性投递到指定QP的接收队列
+ *
+ * @param[in]  res      RDMA资源结构体指针，必须非NULL
+ * @param[in]  qp_idx   QP索引，必须 < res->num_qp
+ * @param[in]  wrs      WR数组，函数会改写每个元素的next字段
+ * @param[in]  count    WR数量，为0时直接返回成功
+ * @param[out] bad_idx  失败时写入第一个失败WR的下标，可为NULL
+ *
+ * @return    成功返回0，失败返回负错误码
+ *
+ * @pre       QP已处于INIT或之后的状态
+ */
+int post_recv_chain(struct rdma_resources *res, uint32_t qp_idx,
+                    struct ibv_recv_wr *wrs, uint32_t count, uint32_t *bad_idx);
+
+/**
+ * 构造count个指向res->buf的发送WR并一次投递
+ *
+ * 第i个WR的wr_id为WR_ID_MAKE(qp_idx, i)，是否signaled由signal_interval决定。
+ *
+ * @param[in]  res      RDMA资源结构体指针，必须非NULL
+ * @param[in]  qp_idx   QP索引，必须 < res->num_qp
+ * @param[in]  opcode   操作码
+ * @param[in]  count    WR数量，1 ~ POST_BATCH_MAX
+ * @param[out] bad_idx  失败时写入第一个失败WR的下标，可为NULL
+ *
+ * @return    成功返回0，失败返回负错误码
+ *
+ * @see       post_send_chain()
+ */
+int post_send_batch(struct rdma_resources *res, uint32_t qp_idx,
+                    enum ibv_wr_opcode opcode, uint32_t count, uint32_t *bad_idx);
+
+/**
+ * 构造count个指向res->buf的接收WR并一次投递
+ *
+ * 第i个WR的wr_id为WR_ID_MAKE(qp_idx, i)。
+ *
+ * @param[in]  res      RDMA资源结构体指针，必须非NULL
+ * @param[in]  qp_idx   QP索引，必须 < res->num_qp
+ * @param[in]  count    WR数量，1 ~ POST_BATCH_MAX
+ * @param[out] bad_idx  失败时写入第一个失败WR的下标，可为NULL
+ *
+ * @return    成功返回0，失败返回负错误码
+ *
+ * @see       post_recv_chain()
+ */
+int post_receive_batch(struct rdma_resources *res, uint32_t qp_idx,
+                       uint32_t count, uint32_t *bad_idx);
+
+/**
+ * 设置选择性signaling间隔
+ *
+ * @param[in,out] res       RDMA资源结构体指针，必须非NULL
+ * @param[in]     interval  每interval个发送WR产生一个CQE，1 ~ res->sq_depth
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @note      可在任意时刻调用，新间隔从下一个投递的WR开始生效
+ * @note      发送队列即将写满时总会强制signaled，保证槽位可以被回收
+ */
+int set_signal_interval(struct rdma_resources *res, uint32_t interval);
+
+/**
+ * 查询指定QP发送队列的剩余槽位
+ *
+ * @param[in] res     RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx  QP索引，必须 < res->num_qp
+ *
+ * @return    剩余可投递的发送WR数量
+ */
+uint32_t sq_available(const struct rdma_resources *res, uint32_t qp_idx);
+
+/**
+ * 回收一个signaled发送WR覆盖的发送队列槽位
+ *
+ * 发送队列按FIFO完成，因此每个成功的发送CQE对应sig_ring队首的一项。
+ *
+ * @param[in,out] res     RDMA资源结构体指针，必须非NULL
+ * @param[in]     qp_idx  QP索引，必须 < res->num_qp
+ *
+ * @return    本次回收的WR数量
+ *
+ * @note      由轮询引擎在取到成功的发送CQE时自动调用，应用无需直接调用
+ */
+uint32_t sq_reclaim(struct rdma_resources *res, uint32_t qp_idx);
+
+#endif /* RDMA_COMMON_POST_H */
@@ -5,272 +5,292 @@
  * 本文件实现Queue Pair的生命周期管理，包括：
  * - QP创建和配置
  * - QP状态转移（RESET → INIT → RTR → RTS）
- * - 多QP的批量操作
+ * - 多QP的批量操作，以及供并行建链引擎调用的单QP步骤
+ * - 启用SRQ时QP共享接收队列
+ * - 启用工作线程时QP绑定到所属线程的CQ
+ * - 按QP数×队列深度扩容共享CQ，统计创建QP的内存开销
+ * - RDMA READ/原子操作深度协商（max_rd_atomic / max_dest_rd_atomic）
+ *
+ * @note 只操作qp_list[0]的旧接口见rdma_common_qp_legacy.c
+ */
+
+#include "rdma_common_srq.h"
+#include "rdma_common_bringup.h"
+
+#define QP_LOG_ALL  64  /* QP数超过该值时逐QP日志只打印首尾几个 */
+
+static int qp_log(const struct rdma_resources *res, uint32_t i) {
+    return res->num_qp <= QP_LOG_ALL || i < 4 || i + 1 == res->num_qp;
+}
+
+/* 创建单个RC QP，设备不支持请求的内联容量时退回到不使用内联 */
+static struct ibv_qp *create_rc_qp(struct rdma_resources *res, uint32_t idx,
+                                   struct ibv_qp_init_attr *qp_init_attr) {
+    struct ibv_cq *cq = res->qp_ctx[idx].cq ? res->qp_ctx[idx].cq : res->cq;
+    struct ibv_qp *qp;
+
+    memset(qp_init_attr, 0, sizeof(*qp_init_attr));
+    qp_init_attr->qp_type = IBV_QPT_RC;
+    /* 由每个WR自行决定是否signaled，以支持选择性signaling */
+    qp_init_attr->sq_sig_all = 0;
+    qp_init_attr->send_cq = cq;
+    qp_init_attr->recv_cq = cq;
+    qp_init_attr->cap.max_send_wr = res->sq_depth;
+    qp_init_attr->cap.max_recv_wr = res->rq_depth;
+    qp_init_attr->cap.max_send_sge = res->max_sge;
+    qp_init_attr->cap.max_recv_sge = res->max_sge;
+    qp_init_attr->cap.max_inline_data = res->max_inline_req;
+    /* 挂到SRQ上的QP没有自己的接收队列 */
+    if (res->srq) {
+        qp_init_attr->srq = res->srq->srq;
+        qp_init_attr->cap.max_recv_wr = 0;
+        qp_init_attr->cap.max_recv_sge = 0;
+    }
+
+    qp = ibv_create_qp(res->pd, qp_init_attr);
+    if (qp || res->max_inline_req == 0) {
+        return qp;
+    }
+
+    fprintf(stderr, "警告: 设备不支持%u字节内联数据，改为不使用内联\n",
+            res->max_inline_req);
+    qp_init_attr->cap.max_inline_data = 0;
+    return ibv_create_qp(res->pd, qp_init_attr);
+}
+
+/*
+ * 共享CQ按最坏情况扩容：每个QP的发送和接收队列同时填满。
+ * CQ溢出会让所有QP进入错误状态，宁可多占一些内存。
  */
+static int reserve_shared_cq(struct rdma_resources *res) {
+    uint64_t need = (uint64_t)res->num_qp * res->sq_depth;
+
+    if (res->workers) {
+        return 0;
+    }
+    need += res->srq ? res->srq->depth : (uint64_t)res->num_qp * res->rq_depth;
+    if (need > (uint64_t)res->dev_attr.max_cqe) {
+        fprintf(stderr, "警告: 需要%llu个CQE，超过设备上限%d，队列同时填满时CQ可能溢出\n",
+                (unsigned long long)need, res->dev_attr.max_cqe);
+        need = (uint64_t)res->dev_attr.max_cqe;
+    }
+    if (need <= (uint64_t)res->cq->cqe) {
+        return 0;
+    }
+    if (ibv_resize_cq(res->cq, (int)need)) {
+        fprintf(stderr, "错误: CQ扩容到%llu失败\n", (unsigned long long)need);
+        return -1;
+    }
+    printf("  - CQ扩容: %d\n", res->cq->cqe);
+    return 0;
+}
+
+int qp_list_prepare(struct rdma_resources *res) {
+    printf("创建 %u 个QP...\n", res->num_qp);
+    if (res->srq) {
+        printf("  - 队列深度: SQ=%u, RQ=共享SRQ(%u)\n", res->sq_depth, res->srq->depth);
+    } else {
+        printf("  - 队列深度: SQ=%u, RQ=%u\n", res->sq_depth, res->rq_depth);
+    }
+    printf("  - Signaling间隔: 每%u个发送WR一个CQE\n", res->signal_interval);
+
+    /* 多SGE接口在栈上构造SGE数组，上限为MAX_SGE_LIMIT */
+    if (res->max_sge > (uint32_t)res->dev_attr.max_sge) {
+        res->max_sge = (uint32_t)res->dev_attr.max_sge;
+    }
+    if (res->max_sge > MAX_SGE_LIMIT) {
+        res->max_sge = MAX_SGE_LIMIT;
+    }
+    if (res->max_sge == 0) {
+        res->max_sge = MAX_SGE;
+    }
+    printf("  - 每个WR的SGE数: %u (设备上限%d)\n", res->max_sge, res->dev_attr.max_sge);
 
-#include "rdma_common.h"
+    res->max_inline_data = res->max_inline_req;
+    return reserve_shared_cq(res);
+}
 
-int create_qp(struct rdma_resources *res) {
+int qp_create_one(struct rdma_resources *res, uint32_t i, uint32_t *inline_cap) {
     struct ibv_qp_init_attr qp_init_attr;
 
-    printf("\n========== 步骤8: 创建Queue Pair ==========\n");
-
-    memset(&qp_init_attr, 0, sizeof(qp_init_attr));
-    qp_init_attr.qp_type = IBV_QPT_RC;
-    qp_init_attr.sq_sig_all = 1;
-    qp_init_attr.send_cq = res->cq;
-    qp_init_attr.recv_cq = res->cq;
-    qp_init_attr.cap.max_send_wr = MAX_WR;
-    qp_init_attr.cap.max_recv_wr = MAX_WR;
-    qp_init_attr.cap.max_send_sge = MAX_SGE;
-    qp_init_attr.cap.max_recv_sge = MAX_SGE;
-
-    res->qp_list[0] = ibv_create_qp(res->pd, &qp_init_attr);
-    if (!res->qp_list[0]) {
-        fprintf(stderr, "错误: 创建QP失败\n");
+    res->qp_list[i] = create_rc_qp(res, i, &qp_init_attr);
+    if (!res->qp_list[i]) {
+        fprintf(stderr, "错误: 创建QP[%u]失败\n", i);
         return -1;
     }
-    printf("成功创建QP\n");
-    printf("  - QP号: 0x%06x\n", res->qp_list[0]->qp_num);
-    printf("  - QP类型: RC (Reliable Connection)\n");
+    /* ibv_create_qp会把实际授予的容量写回cap */
+    *inline_cap = qp_init_attr.cap.max_inline_data;
 
+    /* 每个signaled WR最多占一项，容量等于发送队列深度即可 */
+    res->qp_ctx[i].sig_ring = calloc(res->sq_depth, sizeof(uint32_t));
+    if (!res->qp_ctx[i].sig_ring) {
+        fprintf(stderr, "错误: 分配QP[%u]的signaling记录失败\n", i);
+        return -1;
+    }
     return 0;
 }
 
 int create_qp_list(struct rdma_resources *res) {
-    struct ibv_qp_init_attr qp_init_attr;
+    size_t rss0 = mem_rss_bytes();
+    size_t rss1;
+    uint32_t cap;
     uint32_t i;
 
     printf("\n========== 步骤9: 创建多个Queue Pair ==========\n");
-    printf("创建 %u 个QP...\n", res->num_qp);
-
+    if (qp_list_prepare(res)) {
+        return -1;
+    }
     for (i = 0; i < res->num_qp; i++) {
-        memset(&qp_init_attr, 0, sizeof(qp_init_attr));
-        qp_init_attr.qp_type = IBV_QPT_RC;
-        qp_init_attr.sq_sig_all = 1;
-        qp_init_attr.send_cq = res->cq;
-        qp_init_attr.recv_cq = res->cq;
-        qp_init_attr.cap.max_send_wr = MAX_WR;
-        qp_init_attr.cap.max_recv_wr = MAX_WR;
-        qp_init_attr.cap.max_send_sge = MAX_SGE;
-        qp_init_attr.cap.max_recv_sge = MAX_SGE;
-
-        res->qp_list[i] = ibv_create_qp(res->pd, &qp_init_attr);
-        if (!res->qp_list[i]) {
-            fprintf(stderr, "错误: 创建QP[%u]失败\n", i);
+        if (qp_create_one(res, i, &cap)) {
             return -1;
         }
-        printf("  QP[%u]: 0x%06x\n", i, res->qp_list[i]->qp_num);
+        /* 取所有QP的最小值作为内联阈值 */
+        if (cap < res->max_inline_data) {
+            res->max_inline_data = cap;
+        }
+        if (qp_log(res, i)) {
+            printf("  QP[%u]: 0x%06x\n", i, res->qp_list[i]->qp_num);
+        }
     }
 
+    rss1 = mem_rss_bytes();
+    res->qp_mem_bytes = rss1 > rss0 ? rss1 - rss0 : 0;
     printf("成功创建 %u 个QP\n", res->num_qp);
+    printf("  - 内存: 常驻增加%zu KB (每QP约%zu字节，含驱动队列缓冲区)\n",
+           res->qp_mem_bytes >> 10, res->qp_mem_bytes / res->num_qp);
+    printf("  - 内联数据: 请求%u字节, 实际%u字节\n",
+           res->max_inline_req, res->max_inline_data);
     return 0;
 }
 
-int modify_qp_to_init(struct rdma_resources *res) {
+int qp_modify_init(struct rdma_resources *res, uint32_t i) {
     struct ibv_qp_attr attr;
-    int flags;
-
-    printf("\n========== 步骤9: 修改QP状态 RESET->INIT ==========\n");
 
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_INIT;
     attr.port_num = res->ib_port;
-    attr.pkey_index = 0;
-    attr.qp_access_flags = IBV_ACCESS_LOCAL_WRITE |
-                           IBV_ACCESS_REMOTE_READ |
-                           IBV_ACCESS_REMOTE_WRITE;
-
-    flags = IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT | IBV_QP_ACCESS_FLAGS;
+    /* 与MR一致，否则对端发来的原子操作以远端访问错误完成 */
+    attr.qp_access_flags = rdma_access_flags(res->dev_attr.atomic_cap);
 
-    if (ibv_modify_qp(res->qp_list[0], &attr, flags)) {
-        fprintf(stderr, "错误: 修改QP到INIT状态失败\n");
+    if (ibv_modify_qp(res->qp_list[i], &attr,
+                      IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT | IBV_QP_ACCESS_FLAGS)) {
+        fprintf(stderr, "错误: 修改QP[%u]到INIT状态失败\n", i);
         return -1;
     }
-    printf("QP状态: RESET -> INIT\n");
-
     return 0;
 }
 
 int modify_qp_list_to_init(struct rdma_resources *res) {
-    struct ibv_qp_attr attr;
-    int flags;
     uint32_t i;
 
     printf("\n========== 步骤10: 修改多个QP状态 RESET->INIT ==========\n");
-
-    memset(&attr, 0, sizeof(attr));
-    attr.qp_state = IBV_QPS_INIT;
-    attr.port_num = res->ib_port;
-    attr.pkey_index = 0;
-    attr.qp_access_flags = IBV_ACCESS_LOCAL_WRITE |
-                           IBV_ACCESS_REMOTE_READ |
-                           IBV_ACCESS_REMOTE_WRITE;
-
-    flags = IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT | IBV_QP_ACCESS_FLAGS;
-
     for (i = 0; i < res->num_qp; i++) {
-        if (ibv_modify_qp(res->qp_list[i], &attr, flags)) {
-            fprintf(stderr, "错误: 修改QP[%u]到INIT状态失败\n", i);
+        if (qp_modify_init(res, i)) {
             return -1;
         }
-        printf("  QP[%u]: RESET -> INIT\n", i);
+        if (qp_log(res, i)) {
+            printf("  QP[%u]: RESET -> INIT\n", i);
+        }
     }
 
     printf("成功修改 %u 个QP到INIT状态\n", res->num_qp);
     return 0;
 }
 
-int modify_qp_to_rtr(struct rdma_resources *res,
-                     struct cm_con_data_t *remote_con_data) {
+int qp_modify_rtr(struct rdma_resources *res, uint32_t i, const struct cm_con_data_t *remote) {
     struct ibv_qp_attr attr;
     int flags;
-    union ibv_gid remote_gid;
-
-    printf("\n========== 步骤10: 修改QP状态 INIT->RTR ==========\n");
 
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_RTR;
     attr.path_mtu = res->port_attr.active_mtu;
-    attr.dest_qp_num = remote_con_data->qp_num;
-    attr.rq_psn = 0;
+    attr.dest_qp_num = remote->qp_num;
+    attr.rq_psn = res->qp_ctx[i].rq_psn;
 
-    attr.ah_attr.dlid = remote_con_data->lid;
-    attr.ah_attr.sl = 0;
-    attr.ah_attr.src_path_bits = 0;
+    /* SL、flow_label、traffic_class等未赋值的字段保持memset后的0 */
+    attr.ah_attr.dlid = remote->lid;
     attr.ah_attr.port_num = res->ib_port;
 
     attr.ah_attr.is_global = 1;
-    memcpy(&remote_gid, remote_con_data->gid, 16);
-    attr.ah_attr.grh.dgid = remote_gid;
-    attr.ah_attr.grh.flow_label = 0;
+    memcpy(&attr.ah_attr.grh.dgid, remote->gid, 16);
     attr.ah_attr.grh.hop_limit = 1;
     attr.ah_attr.grh.sgid_index = res->gid_idx;
-    attr.ah_attr.grh.traffic_class = 0;
 
-    attr.max_dest_rd_atomic = 1;
+    /* 本端作为响应方能同时处理的READ/原子数，已按设备上限裁剪 */
+    attr.max_dest_rd_atomic = res->max_dest_rd_atomic;
     attr.min_rnr_timer = 12;
 
     flags = IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU | IBV_QP_DEST_QPN |
             IBV_QP_RQ_PSN | IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER;
 
-    if (ibv_modify_qp(res->qp_list[0], &attr, flags)) {
-        fprintf(stderr, "错误: 修改QP到RTR状态失败: %s (errno=%d)\n",
-                strerror(errno), errno);
-        fprintf(stderr, "调试提示:\n");
-        fprintf(stderr, "  - 远端QP号: 0x%06x\n", remote_con_data->qp_num);
-        fprintf(stderr, "  - 远端LID: 0x%04x\n", remote_con_data->lid);
-        fprintf(stderr, "  - GID索引: %d\n", res->gid_idx);
-        fprintf(stderr, "  - 远端GID: ");
-        print_gid(&remote_gid);
-        fprintf(stderr, "\n");
-        fprintf(stderr, "请检查: 1) GID配置 2) 端口状态 3) 连接信息交换是否正确\n");
+    if (ibv_modify_qp(res->qp_list[i], &attr, flags)) {
+        fprintf(stderr, "错误: 修改QP[%u]到RTR状态失败\n", i);
         return -1;
     }
-    printf("QP状态: INIT -> RTR (Ready to Receive)\n");
-    printf("  - 远端QP号: 0x%06x\n", remote_con_data->qp_num);
-    printf("  - 远端LID: 0x%04x\n", remote_con_data->lid);
 
+    res->qp_ctx[i].remote_addr = remote->addr;
+    res->qp_ctx[i].remote_rkey = remote->rkey;
+    res->qp_ctx[i].remote_len = remote->len;
+    res->qp_ctx[i].remote_rd_atomic = remote->rd_atomic;
     return 0;
 }
 
 int modify_qp_list_to_rtr(struct rdma_resources *res,
                           struct cm_con_data_t *remote_con_data) {
-    struct ibv_qp_attr attr;
-    int flags;
-    union ibv_gid remote_gid;
     uint32_t i;
 
     printf("\n========== 步骤11: 修改多个QP状态 INIT->RTR ==========\n");
-
     for (i = 0; i < res->num_qp; i++) {
-        memset(&attr, 0, sizeof(attr));
-        attr.qp_state = IBV_QPS_RTR;
-        attr.path_mtu = res->port_attr.active_mtu;
-        attr.dest_qp_num = remote_con_data[i].qp_num;
-        attr.rq_psn = 0;
-
-        attr.ah_attr.dlid = remote_con_data[i].lid;
-        attr.ah_attr.sl = 0;
-        attr.ah_attr.src_path_bits = 0;
-        attr.ah_attr.port_num = res->ib_port;
-
-        attr.ah_attr.is_global = 1;
-        memcpy(&remote_gid, remote_con_data[i].gid, 16);
-        attr.ah_attr.grh.dgid = remote_gid;
-        attr.ah_attr.grh.flow_label = 0;
-        attr.ah_attr.grh.hop_limit = 1;
-        attr.ah_attr.grh.sgid_index = res->gid_idx;
-        attr.ah_attr.grh.traffic_class = 0;
-
-        attr.max_dest_rd_atomic = 1;
-        attr.min_rnr_timer = 12;
-
-        flags = IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU | IBV_QP_DEST_QPN |
-                IBV_QP_RQ_PSN | IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER;
-
-        if (ibv_modify_qp(res->qp_list[i], &attr, flags)) {
-            fprintf(stderr, "错误: 修改QP[%u]到RTR状态失败\n", i);
+        if (qp_modify_rtr(res, i, &remote_con_data[i])) {
             return -1;
         }
-        printf("  QP[%u]: INIT -> RTR (远端QP: 0x%06x, 远端LID: 0x%04x)\n",
-               i, remote_con_data[i].qp_num, remote_con_data[i].lid);
+        if (qp_log(res, i)) {
+            printf("  QP[%u]: INIT -> RTR (远端QP: 0x%06x, 远端LID: 0x%04x)\n",
+                   i, remote_con_data[i].qp_num, remote_con_data[i].lid);
+        }
     }
 
     printf("成功修改 %u 个QP到RTR状态\n", res->num_qp);
     return 0;
 }
 
-int modify_qp_to_rts(struct rdma_resources *res) {
+int qp_modify_rts(struct rdma_resources *res, uint32_t i) {
     struct ibv_qp_attr attr;
-    int flags;
-
-    printf("\n========== 步骤11: 修改QP状态 RTR->RTS ==========\n");
 
     memset(&attr, 0, sizeof(attr));
     attr.qp_state = IBV_QPS_RTS;
     attr.timeout = 14;
     attr.retry_cnt = 7;
     attr.rnr_retry = 7;
-    attr.sq_psn = 0;
-    attr.max_rd_atomic = 1;
-
-    flags = IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
-            IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN | IBV_QP_MAX_QP_RD_ATOMIC;
+    attr.sq_psn = res->qp_ctx[i].sq_psn;
 
-    if (ibv_modify_qp(res->qp_list[0], &attr, flags)) {
-        fprintf(stderr, "错误: 修改QP到RTS状态失败\n");
+    /* 发起端深度不能超过对端的响应资源，否则多出的READ只会在对端排队 */
+    attr.max_rd_atomic = res->max_rd_atomic;
+    if (res->qp_ctx[i].remote_rd_atomic < attr.max_rd_atomic) {
+        attr.max_rd_atomic = res->qp_ctx[i].remote_rd_atomic;
+    }
+    if (ibv_modify_qp(res->qp_list[i], &attr,
+                      IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
+                      IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN | IBV_QP_MAX_QP_RD_ATOMIC)) {
+        fprintf(stderr, "错误: 修改QP[%u]到RTS状态失败\n", i);
         return -1;
     }
-    printf("QP状态: RTR -> RTS (Ready to Send)\n");
-
+    res->qp_ctx[i].rd_atomic = attr.max_rd_atomic;
     return 0;
 }
 
 int modify_qp_list_to_rts(struct rdma_resources *res) {
-    struct ibv_qp_attr attr;
-    int flags;
     uint32_t i;
 
     printf("\n========== 步骤12: 修改多个QP状态 RTR->RTS ==========\n");
-
-    memset(&attr, 0, sizeof(attr));
-    attr.qp_state = IBV_QPS_RTS;
-    attr.timeout = 14;
-    attr.retry_cnt = 7;
-    attr.rnr_retry = 7;
-    attr.sq_psn = 0;
-    attr.max_rd_atomic = 1;
-
-    flags = IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
-            IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN | IBV_QP_MAX_QP_RD_ATOMIC;
-
     for (i = 0; i < res->num_qp; i++) {
-        if (ibv_modify_qp(res->qp_list[i], &attr, flags)) {
-            fprintf(stderr, "错误: 修改QP[%u]到RTS状态失败\n", i);
+        if (qp_modify_rts(res, i)) {
             return -1;
         }
-        printf("  QP[%u]: RTR -> RTS\n", i);
+        if (qp_log(res, i)) {
+            printf("  QP[%u]: RTR -> RTS (未完成READ/原子深度: %u)\n",
+                   i, res->qp_ctx[i].rd_atomic);
+        }
     }
 
     printf("成功修改 %u 个QP到RTS状态\n", res->num_qp);
@@ -0,0 +1,155 @@
+/**
+ * @file rdma_common_rdma.c
+ * @brief 单边RDMA操作模块：远端范围检查、WRITE/WRITE_WITH_IMM/READ投递、READ深度协商
+ *
+ * 单边WR与SEND一样经过post_send_chain()，
+ * 因此同样参与选择性signaling和发送队列槽位统计。
+ */
+
+#include "rdma_common_rdma.h"
+#include "rdma_common_post.h"
+
+/* 一次单边操作涉及的本地与远端区域，imm只用于WRITE_WITH_IMM */
+struct rdma_span {
+    uint32_t local_off;
+    uint32_t remote_off;
+    uint32_t len;
+    uint32_t imm;
+};
+
+int check_one_sided(const struct rdma_resources *res, uint32_t qp_idx,
+                    uint32_t local_off, uint32_t remote_off, uint32_t len) {
+    struct rdma_span sp = { local_off, remote_off, len, 0 };
+    const struct qp_ctx *ctx;
+
+    if (!res || !res->qp_ctx || qp_idx >= res->num_qp) {
+        return -EINVAL;
+    }
+
+    ctx = &res->qp_ctx[qp_idx];
+    if (ctx->remote_len == 0) {
+        fprintf(stderr, "错误: QP[%u]的对端未开放单边访问\n", qp_idx);
+        return -EINVAL;
+    }
+    if ((uint64_t)sp.local_off + sp.len > res->buf_size ||
+        (uint64_t)sp.remote_off + sp.len > ctx->remote_len) {
+        fprintf(stderr, "错误: QP[%u]单边操作越界 (本地%u+%u/%zu, 远端%u+%u/%u)\n",
+                qp_idx, sp.local_off, sp.len, res->buf_size,
+                sp.remote_off, sp.len, ctx->remote_len);
+        return -ERANGE;
+    }
+    return 0;
+}
+
+/* 构造并投递一个单边WR */
+static int post_one_sided(struct rdma_resources *res, uint32_t qp_idx,
+                          enum ibv_wr_opcode opcode, const struct rdma_span *sp) {
+    struct ibv_send_wr wr;
+    struct ibv_sge sge;
+    int rc;
+
+    rc = check_one_sided(res, qp_idx, sp->local_off, sp->remote_off, sp->len);
+    if (rc) {
+        return rc;
+    }
+
+    sge.addr = (uintptr_t)(res->buf + sp->local_off);
+    sge.length = sp->len;
+    sge.lkey = res->mr->lkey;
+
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = WR_ID_MAKE(qp_idx, 0);
+    wr.opcode = opcode;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    wr.wr.rdma.remote_addr = res->qp_ctx[qp_idx].remote_addr + sp->remote_off;
+    wr.wr.rdma.rkey = res->qp_ctx[qp_idx].remote_rkey;
+    if (opcode == IBV_WR_RDMA_WRITE_WITH_IMM) {
+        wr.imm_data = htonl(sp->imm);
+    }
+
+    return post_send_chain(res, qp_idx, &wr, 1, NULL);
+}
+
+/* 取三者中的最小值，结果不超过uint8_t */
+static uint8_t clamp_rd_atomic(uint32_t want, int dev_max) {
+    uint32_t v = want;
+
+    if (dev_max >= 0 && v > (uint32_t)dev_max) {
+        v = (uint32_t)dev_max;
+    }
+    return v > UINT8_MAX ? UINT8_MAX : (uint8_t)v;
+}
+
+int set_rd_atomic_depth(struct rdma_resources *res, uint32_t depth) {
+    if (!res || depth == 0) {
+        return -1;
+    }
+
+    res->max_rd_atomic = clamp_rd_atomic(depth, res->dev_attr.max_qp_init_rd_atom);
+    res->max_dest_rd_atomic = clamp_rd_atomic(depth, res->dev_attr.max_qp_rd_atom);
+    printf("READ/原子深度: 请求%u, 发起端%u (设备上限%d), 响应端%u (设备上限%d)\n",
+           depth, res->max_rd_atomic, res->dev_attr.max_qp_init_rd_atom,
+           res->max_dest_rd_atomic, res->dev_attr.max_qp_rd_atom);
+    return 0;
+}
+
+int post_write_qp(struct rdma_resources *res, uint32_t qp_idx,
+                  uint32_t local_off, uint32_t remote_off, uint32_t len) {
+    struct rdma_span sp = { local_off, remote_off, len, 0 };
+
+    return post_one_sided(res, qp_idx, IBV_WR_RDMA_WRITE, &sp);
+}
+
+int post_read_qp(struct rdma_resources *res, uint32_t qp_idx,
+                 uint32_t local_off, uint32_t remote_off, uint32_t len) {
+    struct rdma_span sp = { local_off, remote_off, len, 0 };
+
+    return post_one_sided(res, qp_idx, IBV_WR_RDMA_READ, &sp);
+}
+
+int set_imm_slot_size(struct rdma_resources *res, uint32_t slot_size) {
+    uint32_t i;
+
+    if (!res || !res->qp_ctx || slot_size == 0) {
+        return -1;
+    }
+    /* 最大槽位号的偏移必须能用32位表示 */
+    if ((uint64_t)IMM_SLOT_MAX * slot_size > UINT32_MAX) {
+        fprintf(stderr, "错误: 槽位大小%u过大，%u号槽位的偏移超过4GB\n",
+                slot_size, IMM_SLOT_MAX);
+        return -1;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        res->qp_ctx[i].imm_slot_size = slot_size;
+    }
+    return 0;
+}
+
+int post_write_imm_qp(struct rdma_resources *res, uint32_t qp_idx,
+                      uint32_t local_off, uint32_t slot, uint32_t len) {
+    struct rdma_span sp = { local_off, 0, len, IMM_MAKE(slot, len) };
+    const struct qp_ctx *ctx;
+    uint32_t slot_size;
+    uint64_t off;
+
+    if (!res || !res->qp_ctx || qp_idx >= res->num_qp) {
+        return -EINVAL;
+    }
+    slot_size = res->qp_ctx[qp_idx].imm_slot_size;
+    if (slot_size == 0 || slot > IMM_SLOT_MAX || len > IMM_LEN_MAX || len > slot_size) {
+        fprintf(stderr, "错误: QP[%u]立即数写参数无效 (槽位%u, 长度%u, 槽位大小%u)\n",
+                qp_idx, slot, len, slot_size);
+        return -EINVAL;
+    }
+    /* 按64位计算，回绕后的偏移会通过范围检查而写到错误的槽位；未开放的情况交给下面检查 */
+    ctx = &res->qp_ctx[qp_idx];
+    off = (uint64_t)slot * slot_size;
+    if (ctx->remote_len > 0 && off + len > ctx->remote_len) {
+        fprintf(stderr, "错误: QP[%u]槽位%u超出对端区域 (偏移%llu+%u/%u)\n",
+                qp_idx, slot, (unsigned long long)off, len, ctx->remote_len);
+        return -ERANGE;
+    }
+    sp.remote_off = (uint32_t)off;
+    return post_one_sided(res, qp_idx, IBV_WR_RDMA_WRITE_WITH_IMM, &sp);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file rdma_common_rdma.h
+ * @brief 单边RDMA操作接口 - 基于交换得到的addr/rkey直接访问远端内存
+ *
+ * 建链时fill_local_con_data()把每个QP可访问的缓冲区地址、rkey和长度
+ * 放进cm_con_data_t，经sock_exchange_con_data()交换后，
+ * modify_qp_list_to_rtr()把对端的信息保存到res->qp_ctx[i].remote_*。
+ *
+ * 单边操作不消耗对端的接收WR，也不产生对端CQE，
+ * 因此没有RNR等待，对端CPU完全不参与数据搬运。
+ *
+ * RDMA READ的吞吐取决于每个QP能同时挂起多少个READ：
+ * - 发起端深度max_rd_atomic受ibv_device_attr.max_qp_init_rd_atom限制
+ * - 响应端资源max_dest_rd_atomic受ibv_device_attr.max_qp_rd_atom限制
+ * - 建链时交换响应端资源，发起端深度取两者较小值
+ * 超过协商深度的READ不会失败，但会在网卡内排队等待。
+ *
+ * 所有偏移都相对于各自缓冲区的起始位置，投递前检查两端范围是否越界。
+ *
+ * WRITE_WITH_IMM把数据写进对端缓冲区的同时消耗对端一个RECV WR，
+ * 立即数按IMM_MAKE(槽位, 长度)编码。接收端的轮询引擎把解码结果记录在
+ * qp_ctx的imm_slot/imm_len/imm_count，处理函数也可以直接解码wc->imm_data。
+ *
+ * @see rdma_common_rdma.c
+ */
+
+#ifndef RDMA_COMMON_RDMA_H
+#define RDMA_COMMON_RDMA_H
+
+#include "rdma_common.h"
+
+/**
+ * 检查QP已获得对端访问信息，且本地与远端区域都不越界
+ *
+ * @param[in] res         RDMA资源结构体指针
+ * @param[in] qp_idx      QP索引
+ * @param[in] local_off   本地res->buf中的起始偏移
+ * @param[in] remote_off  远端缓冲区中的起始偏移
+ * @param[in] len         区域长度
+ *
+ * @return    合法返回0，QP无效或对端未开放返回-EINVAL，越界返回-ERANGE
+ */
+int check_one_sided(const struct rdma_resources *res, uint32_t qp_idx,
+                    uint32_t local_off, uint32_t remote_off, uint32_t len);
+
+/**
+ * 把本地缓冲区的一段RDMA WRITE到远端缓冲区
+ *
+ * @param[in] res         RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx      QP索引，必须 < res->num_qp
+ * @param[in] local_off   本地res->buf中的起始偏移
+ * @param[in] remote_off  远端缓冲区中的起始偏移
+ * @param[in] len         写入字节数
+ *
+ * @return    成功返回0，失败返回负错误码
+ * @retval -EINVAL    QP索引无效或对端未开放单边访问
+ * @retval -ERANGE    本地或远端范围越界
+ * @retval -EAGAIN    发送队列已满，需先轮询CQ回收
+ *
+ * @pre       QP已处于RTS状态
+ * @note      len不超过res->max_inline_data时自动内联
+ * @note      wr_id为WR_ID_MAKE(qp_idx, 0)，是否signaled由signal_interval决定
+ */
+int post_write_qp(struct rdma_resources *res, uint32_t qp_idx,
+                  uint32_t local_off, uint32_t remote_off, uint32_t len);
+
+/**
+ * 从远端缓冲区RDMA READ一段数据到本地缓冲区
+ *
+ * @param[in] res         RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx      QP索引，必须 < res->num_qp
+ * @param[in] local_off   本地res->buf中的目标偏移
+ * @param[in] remote_off  远端缓冲区中的起始偏移
+ * @param[in] len         读取字节数
+ *
+ * @return    成功返回0，失败返回负错误码，含义同post_write_qp()
+ *
+ * @pre       QP已处于RTS状态
+ * @note      数据在READ的CQE到达后才可用；未signaled的READ要等
+ *            之后某个signaled WR完成才能确认
+ */
+int post_read_qp(struct rdma_resources *res, uint32_t qp_idx,
+                 uint32_t local_off, uint32_t remote_off, uint32_t len);
+
+/**
+ * 设置每个QP的READ/原子操作深度
+ *
+ * 分别按设备的发起端、响应端上限裁剪后写入res->max_rd_atomic和
+ * res->max_dest_rd_atomic。init_rdma_resources_cfg()已按rdma_config.rd_atomic
+ * 调用过一次。
+ *
+ * @param[in,out] res    RDMA资源结构体指针，dev_attr必须已查询
+ * @param[in]     depth  期望深度，必须 > 0
+ *
+ * @return    成功返回0，参数无效返回-1
+ *
+ * @pre       必须在fill_local_con_data()和QP转到RTR之前调用
+ */
+int set_rd_atomic_depth(struct rdma_resources *res, uint32_t depth);
+
+/**
+ * 设置所有QP的WRITE_WITH_IMM槽位大小
+ *
+ * 对端缓冲区被看作若干个slot_size字节的槽位，两端必须设置相同的值。
+ *
+ * @param[in,out] res        RDMA资源结构体指针，qp_ctx必须已分配
+ * @param[in]     slot_size  槽位大小，必须 > 0，且IMM_SLOT_MAX×slot_size不超过UINT32_MAX
+ *
+ * @return    成功返回0，参数无效返回-1
+ */
+int set_imm_slot_size(struct rdma_resources *res, uint32_t slot_size);
+
+/**
+ * 把本地缓冲区的一段RDMA WRITE到对端第slot个槽位，并携带立即数通知对端
+ *
+ * @param[in] res        RDMA资源结构体指针，必须非NULL
+ * @param[in] qp_idx     QP索引，必须 < res->num_qp
+ * @param[in] local_off  本地res->buf中的起始偏移
+ * @param[in] slot       对端槽位号，不超过IMM_SLOT_MAX
+ * @param[in] len        写入字节数，不超过槽位大小和IMM_LEN_MAX，可以为0（纯通知）
+ *
+ * @return    成功返回0，失败返回负错误码，含义同post_write_qp()
+ * @retval -ERANGE  槽位超出对端开放的区域
+ *
+ * @pre       已调用set_imm_slot_size()，对端已为该QP投递RECV
+ * @note      对端RECV完成事件的opcode为IBV_WC_RECV_RDMA_WITH_IMM，
+ *            RECV的缓冲区不会被写入
+ */
+int post_write_imm_qp(struct rdma_resources *res, uint32_t qp_idx,
+                      uint32_t local_off, uint32_t slot, uint32_t len);
+
+#endif /* RDMA_COMMON_RDMA_H */
@@ -0,0 +1,202 @@
+/**
+ * @file rdma_common_recover.c
+ * @brief QP原地恢复实现：信标冲刷、发送队列记账、单QP复位与PSN重新协商
+ */
+
+#include "rdma_common_recover.h"
+#include "rdma_common_bringup.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_async.h"
+
+/**
+ * 排空期间替换出错QP的处理函数，统计信标和冲刷出的完成事件
+ */
+struct recover_drain {
+    wc_handler_t handler;              /* QP原来的处理函数 */
+    void *arg;                         /* 原处理函数的参数 */
+    uint32_t beacons;                  /* 尚未返回的信标数 */
+    uint32_t flushed;                  /* 冲刷出的失败完成事件数 */
+};
+
+static int recover_on_wc(struct rdma_resources *res, uint32_t qp_idx,
+                         const struct ibv_wc *wc, void *arg) {
+    struct recover_drain *d = arg;
+
+    if (WR_ID_TAG(wc->wr_id) == QP_RECOVER_TAG) {
+        d->beacons--;
+        return 0;
+    }
+    if (wc->status != IBV_WC_SUCCESS) {
+        d->flushed++;
+    }
+    /* 冲刷是预期结果，原处理函数报错也不中止排空 */
+    if (d->handler) {
+        d->handler(res, qp_idx, wc, d->arg);
+    }
+    return 0;
+}
+
+/* 投递0字节的信标：which为0时投到发送队列，为1时投到接收队列 */
+static int recover_post_beacon(struct rdma_resources *res, uint32_t i, uint32_t which) {
+    struct ibv_send_wr swr;
+    struct ibv_recv_wr rwr;
+    struct ibv_send_wr *bad_swr;
+    struct ibv_recv_wr *bad_rwr;
+
+    if (which == 1) {
+        memset(&rwr, 0, sizeof(rwr));
+        rwr.wr_id = WR_ID_MAKE(i, QP_RECOVER_TAG);
+        return ibv_post_recv(res->qp_list[i], &rwr, &bad_rwr);
+    }
+    memset(&swr, 0, sizeof(swr));
+    swr.wr_id = WR_ID_MAKE(i, QP_RECOVER_TAG);
+    swr.opcode = IBV_WR_SEND;
+    swr.send_flags = IBV_SEND_SIGNALED;
+    return ibv_post_send(res->qp_list[i], &swr, &bad_swr);
+}
+
+int qp_in_error(struct rdma_resources *res, uint32_t i) {
+    struct ibv_qp_attr attr;
+    struct ibv_qp_init_attr init_attr;
+
+    if (res->qp_ctx[i].wc_error != IBV_WC_SUCCESS || (qp_health(res, i) & QP_HEALTH_QP_FATAL)) {
+        return 1;
+    }
+    if (ibv_query_qp(res->qp_list[i], &attr, IBV_QP_STATE, &init_attr)) {
+        fprintf(stderr, "错误: 查询QP[%u]状态失败\n", i);
+        return -1;
+    }
+    return attr.qp_state == IBV_QPS_ERR || attr.qp_state == IBV_QPS_SQE;
+}
+
+int qp_flush(struct rdma_resources *res, uint32_t i, struct qp_recover_stats *st) {
+    struct qp_ctx *ctx = &res->qp_ctx[i];
+    struct ibv_cq *cq = ctx->cq ? ctx->cq : res->cq;
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    struct ibv_qp_attr attr;
+    struct recover_drain d;
+    /* SRQ上的RECV不属于任何QP，QP出错时留在SRQ里，不需要接收信标 */
+    uint32_t want = res->srq ? 1 : 2;
+    uint32_t posted = 0;
+    uint64_t t0 = monotonic_ns();
+    uint64_t deadline;
+    int n;
+    int k;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_ERR;
+    if (ibv_modify_qp(res->qp_list[i], &attr, IBV_QP_STATE)) {
+        fprintf(stderr, "错误: 修改QP[%u]到ERR状态失败\n", i);
+        return -1;
+    }
+
+    d.handler = ctx->handler;
+    d.arg = ctx->handler_arg;
+    d.beacons = want;
+    d.flushed = 0;
+    ctx->handler = recover_on_wc;
+    ctx->handler_arg = &d;
+    deadline = monotonic_coarse_ms() + res->poll_timeout_ms;
+    while (d.beacons > 0 && monotonic_coarse_ms() <= deadline) {
+        /* 队列已满时信标投递失败，取走完成事件腾出槽位后重试 */
+        while (posted < want && recover_post_beacon(res, i, posted) == 0) {
+            posted++;
+        }
+        n = ibv_poll_cq(cq, POLL_BATCH_SIZE, wc);
+        for (k = 0; k < n; k++) {
+            if (wc[k].qp_num != res->qp_list[i]->qp_num) {
+                st->other_wc++;
+            }
+            /* 其他QP的失败由轮询引擎记入各自的wc_error，这里不中止 */
+            poll_dispatch_wc(res, &wc[k]);
+        }
+        if (n < 0) {
+            fprintf(stderr, "错误: Poll CQ失败\n");
+            break;
+        }
+    }
+    ctx->handler = d.handler;
+    ctx->handler_arg = d.arg;
+    if (d.beacons > 0) {
+        fprintf(stderr, "错误: 冲刷QP[%u]超时 (已投递信标%u/%u，未返回%u)\n",
+                i, posted, want, d.beacons);
+        return -1;
+    }
+
+    /* 出错后发送CQE不再成功返回，sig_ring记录的槽位只能整体作废 */
+    st->flushed += d.flushed;
+    st->send_lost += ctx->sq_posted - ctx->sq_completed;
+    ctx->sq_completed = ctx->sq_posted;
+    ctx->sq_unsignaled = 0;
+    ctx->sig_head = ctx->sig_tail;
+    st->flush_us += (monotonic_ns() - t0) / 1000;
+    return 0;
+}
+
+int qp_reconnect(struct rdma_resources *res, uint32_t i, int sock, struct qp_recover_stats *st) {
+    struct qp_ctx *ctx = &res->qp_ctx[i];
+    struct qp_recover_msg local;
+    struct qp_recover_msg remote;
+    struct ibv_qp_attr attr;
+    union ibv_gid gid;
+    uint64_t t0 = monotonic_ns();
+    char ready = 'R';
+
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_RESET;
+    if (ibv_modify_qp(res->qp_list[i], &attr, IBV_QP_STATE) || qp_modify_init(res, i)) {
+        fprintf(stderr, "错误: 复位QP[%u]失败\n", i);
+        return -1;
+    }
+    if (ibv_query_gid(res->context, res->ib_port, res->gid_idx, &gid)) {
+        fprintf(stderr, "错误: 查询GID失败\n");
+        return -1;
+    }
+
+    memset(&local, 0, sizeof(local));
+    local.qp_idx = i;
+    local.psn = qp_psn_make(t0, res->qp_list[i]->qp_num);
+    con_data_fill_qp(res, i, &gid, &local.con);
+    /* 双方都先写后读，消息远小于socket缓冲区，不会互相等待 */
+    if (sock_write_full(sock, &local, sizeof(local)) ||
+        sock_read_full(sock, &remote, sizeof(remote))) {
+        fprintf(stderr, "错误: 交换QP[%u]的恢复信息失败\n", i);
+        return -1;
+    }
+    if (remote.qp_idx != i) {
+        fprintf(stderr, "错误: 对端恢复的是QP[%u]，本端是QP[%u]\n", remote.qp_idx, i);
+        return -1;
+    }
+
+    ctx->sq_psn = local.psn;
+    ctx->rq_psn = remote.psn & QP_PSN_MASK;
+    /* 双方都到RTR后再转RTS，避免对端仍在INIT时收到报文而走超时重传 */
+    if (qp_modify_rtr(res, i, &remote.con) || sock_write_full(sock, &ready, 1) ||
+        sock_read_full(sock, &ready, 1) || qp_modify_rts(res, i)) {
+        fprintf(stderr, "错误: QP[%u]重新建链失败\n", i);
+        return -1;
+    }
+    ctx->wc_error = IBV_WC_SUCCESS;
+    __atomic_and_fetch(&ctx->health, ~QP_HEALTH_RECOVERABLE, __ATOMIC_RELEASE);
+    ctx->recoveries++;
+    st->reconnect_us += (monotonic_ns() - t0) / 1000;
+    return 0;
+}
+
+int qp_recover(struct rdma_resources *res, uint32_t i, int sock, struct qp_recover_stats *st) {
+    struct qp_recover_stats tmp;
+
+    if (!res || !res->qp_ctx || i >= res->num_qp) {
+        fprintf(stderr, "错误: 要恢复的QP索引无效\n");
+        return -1;
+    }
+    if (!st) {
+        memset(&tmp, 0, sizeof(tmp));
+        st = &tmp;
+    }
+    if (qp_flush(res, i, st) || qp_reconnect(res, i, sock, st)) {
+        fprintf(stderr, "错误: 原地恢复QP[%u]失败\n", i);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file rdma_common_recover.h
+ * @brief QP原地恢复：冲刷出错QP的未完成WR，只把这一个QP重新建链
+ *
+ * 任何失败的完成事件都会让QP进入ERR状态，此后该QP上的WR全部以
+ * IBV_WC_WR_FLUSH_ERR完成，但同一PD下的其他QP和已注册的MR不受影响。
+ * 因此出错后不必cleanup_rdma_resources()重建全部资源，只需：
+ *
+ * 1. 冲刷：QP转ERR，在发送/接收队列末尾各投递一个信标WR，
+ *    队列按FIFO完成，信标的完成事件到达即说明之前的WR都已冲刷出来；
+ *    排空期间取到的其他QP的完成事件照常分发
+ * 2. 记账：冲刷出的完成事件交给QP原有的处理函数（应用据此重投或丢弃），
+ *    发送队列统计清零，未完成的发送WR数记入统计
+ * 3. 复位：RESET -> INIT，QP号不变
+ * 4. 交换：通过控制通道（TCP）与对端交换新的起始PSN和连接信息，
+ *    新PSN随机选取，旧连接残留在网络中的报文因PSN不匹配被丢弃
+ * 5. 重连：INIT -> RTR，双方同步一次确认都已RTR，再RTR -> RTS
+ *
+ * 双方必须对同一个QP下标各调用一次qp_recover()（通常由发现错误的一端通过
+ * 控制通道通知对端），本端出错而对端QP仍处于RTS时，对端同样需要复位以对齐PSN。
+ *
+ * @note 恢复后RQ为空，调用者负责重新投递RECV；对端的RNR重试(rnr_retry=7)
+ *       会等待到RECV投递完成
+ * @note 启用工作线程时QP的CQ由工作线程轮询，恢复必须在该线程上执行
+ * @see rdma_common_recover.c, rdma_bench_recover.c
+ */
+
+#ifndef RDMA_COMMON_RECOVER_H
+#define RDMA_COMMON_RECOVER_H
+
+#include "rdma_common.h"
+
+#define QP_RECOVER_TAG   0xffffffffu       /* 冲刷信标WR的wr_id标签，应用不应使用 */
+#define QP_PSN_MASK      0xffffffu         /* PSN为24位 */
+
+/**
+ * 恢复统计，各字段在多次恢复间累加
+ */
+struct qp_recover_stats {
+    uint32_t flushed;                  /* 冲刷出的失败完成事件数（不含信标） */
+    uint32_t send_lost;                /* 未完成的发送WR数（含未signaled的WR） */
+    uint32_t other_wc;                 /* 排空时顺带分发的其他QP完成事件数 */
+    uint64_t flush_us;                 /* 转ERR到信标全部返回的耗时 */
+    uint64_t reconnect_us;             /* 复位、交换、迁移到RTS的耗时 */
+};
+
+/**
+ * 恢复时在控制通道上交换的信息，各字段为主机字节序
+ */
+struct qp_recover_msg {
+    uint32_t qp_idx;                   /* QP下标，双方必须一致 */
+    uint32_t psn;                      /* 发送方新的起始PSN */
+    struct cm_con_data_t con;          /* 发送方的连接信息（QP号不变，MR不变） */
+} __attribute__((packed));
+
+/**
+ * 由随机种子和QP号生成24位起始PSN
+ *
+ * 乘以奇数常数把QP号打散，同一时刻恢复的多个QP也得到不同的PSN。
+ */
+static inline uint32_t qp_psn_make(uint64_t seed, uint32_t qp_num) {
+    return (uint32_t)(seed ^ (seed >> 24) ^ ((uint64_t)qp_num * 2654435761u)) & QP_PSN_MASK;
+}
+
+/**
+ * 判断QP是否需要恢复
+ *
+ * 先看轮询引擎记录的失败完成事件（res->qp_ctx[i].wc_error）和
+ * 异步事件监视线程置位的QP_HEALTH_QP_FATAL，都没有时再用ibv_query_qp()
+ * 查询状态（ERR或SQE）。
+ *
+ * @return    需要恢复返回1，正常返回0，查询失败返回-1
+ */
+int qp_in_error(struct rdma_resources *res, uint32_t i);
+
+/**
+ * 冲刷QP i：转ERR并等待所有未完成的WR以失败状态返回
+ *
+ * 冲刷出的完成事件交给QP注册的处理函数（可能为NULL），之后清零发送队列统计。
+ *
+ * @param[in,out] st  统计，累加flushed/send_lost/other_wc/flush_us
+ *
+ * @return    成功返回0，信标投递失败或超过res->poll_timeout_ms返回-1
+ * @pre       QP所在的CQ只被res中的QP使用（与其他rdma_resources共享CQ时，
+ *            其他QP的完成事件无法在这里正确分发）
+ * @post      QP处于ERR状态，发送队列统计为空
+ */
+int qp_flush(struct rdma_resources *res, uint32_t i, struct qp_recover_stats *st);
+
+/**
+ * 把已冲刷的QP i重新建链：RESET -> INIT，交换PSN，INIT -> RTR -> RTS
+ *
+ * @param[in]     sock  与对端的控制连接（TCP），对端同时对同一QP调用本函数
+ * @param[in,out] st    统计，累加reconnect_us
+ *
+ * @return    成功返回0，失败返回-1（QP停在失败的步骤，可再次qp_recover()）
+ * @post      QP处于RTS，res->qp_ctx[i]的PSN、对端缓冲区信息已更新，wc_error清零，
+ *            health中的QP_HEALTH_RECOVERABLE位清除
+ */
+int qp_reconnect(struct rdma_resources *res, uint32_t i, int sock, struct qp_recover_stats *st);
+
+/**
+ * 原地恢复QP i：qp_flush() + qp_reconnect()
+ *
+ * 其他QP、CQ、PD、MR均保持不变。
+ *
+ * @param[in,out] st  统计，可为NULL
+ *
+ * @return    成功返回0，失败返回-1
+ */
+int qp_recover(struct rdma_resources *res, uint32_t i, int sock, struct qp_recover_stats *st);
+
+#endif /* RDMA_COMMON_RECOVER_H */
@@ -0,0 +1,213 @@
+/**
+ * @file rdma_common_ring.c
+ * @brief 远端环形缓冲区实现：记录组装与WRITE、内存轮询、懒惰credit返还
+ *
+ * 所有位置都是自由递增的字节数，与(size - 1)相与得到环内偏移。
+ */
+
+#include "rdma_common_ring.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_rdma.h"
+
+#define RING_MIN_SIZE  64
+
+static inline uint32_t ring_mask(const struct ring_channel *ch, uint64_t pos) {
+    return (uint32_t)(pos & (ch->size - 1));
+}
+
+static inline uint32_t rx_off(const struct ring_channel *ch, uint32_t pos) {
+    return ch->base_off + pos;
+}
+
+static inline uint32_t mirror_off(const struct ring_channel *ch, uint32_t pos) {
+    return ch->base_off + ch->size + pos;
+}
+
+static inline uint32_t credit_in_off(const struct ring_channel *ch) {
+    return ch->base_off + 2 * ch->size;
+}
+
+static inline uint32_t credit_out_off(const struct ring_channel *ch) {
+    return credit_in_off(ch) + (uint32_t)sizeof(uint64_t);
+}
+
+static inline uint32_t next_seq(uint32_t seq) {
+    return seq + 1 ? seq + 1 : 1;
+}
+
+/* WRITE一段本地区域到对端同布局的偏移，发送队列满时轮询一次CQ后重试 */
+static int ring_post_write(struct ring_channel *ch, uint32_t local_off,
+                           uint32_t remote_off, uint32_t len) {
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    int rc;
+
+    rc = post_write_qp(ch->res, ch->qp_idx, local_off, remote_off, len);
+    if (rc != -EAGAIN) {
+        return rc;
+    }
+    if (poll_cq_batch(ch->res, wc, POLL_BATCH_SIZE) < 0) {
+        return -EIO;
+    }
+    return post_write_qp(ch->res, ch->qp_idx, local_off, remote_off, len);
+}
+
+int ring_channel_init(struct ring_channel *ch, struct rdma_resources *res,
+                      uint32_t qp_idx, uint32_t base_off, uint32_t size) {
+    uint64_t end = (uint64_t)base_off + ring_region_size(size);
+
+    if (!ch || !res || !res->qp_ctx || qp_idx >= res->num_qp ||
+        size < RING_MIN_SIZE || (size & (size - 1)) || (base_off & (RING_ALIGN - 1))) {
+        fprintf(stderr, "错误: 环形通道参数无效 (QP %u, 偏移%u, 大小%u)\n",
+                qp_idx, base_off, size);
+        return -1;
+    }
+    if (end > res->buf_size || end > res->qp_ctx[qp_idx].remote_len) {
+        fprintf(stderr, "错误: 环形通道需要%llu字节，本端%zu/对端%u放不下\n",
+                (unsigned long long)end, res->buf_size, res->qp_ctx[qp_idx].remote_len);
+        return -1;
+    }
+
+    memset(ch, 0, sizeof(*ch));
+    ch->res = res;
+    ch->qp_idx = qp_idx;
+    ch->base_off = base_off;
+    ch->size = size;
+    ch->credit_threshold = size / 4;
+    ch->tx_seq = 1;
+    ch->rx_seq = 1;
+    memset(res->buf + base_off, 0, ring_region_size(size));
+    return 0;
+}
+
+/* 在发送镜像的pos处组装头部，返回头部指针 */
+static struct ring_hdr *ring_put_hdr(struct ring_channel *ch, uint32_t pos, uint32_t len) {
+    struct ring_hdr *hdr = (struct ring_hdr *)(ch->res->buf + mirror_off(ch, pos));
+
+    hdr->ack = ch->head;
+    hdr->len = len;
+    hdr->seq = ch->tx_seq;
+    return hdr;
+}
+
+int ring_send(struct ring_channel *ch, const void *data, uint32_t len) {
+    uint32_t rec = ring_record_size(len);
+    uint64_t credit = *(volatile uint64_t *)(ch->res->buf + credit_in_off(ch));
+    uint32_t pos = ring_mask(ch, ch->tail);
+    uint32_t skip = 0;
+    struct ring_hdr *hdr;
+    int rc;
+
+    if (rec > ch->size / 2) {
+        return -EMSGSIZE;
+    }
+    if (credit > ch->peer_head) {
+        ch->peer_head = credit;
+    }
+    if (ch->size - pos < rec) {
+        skip = ch->size - pos;
+    }
+    if (ch->tail + skip + rec - ch->peer_head > ch->size) {
+        return -EAGAIN;
+    }
+
+    /* 环尾放不下：能放下头部时写跳转头，否则双方隐式跳转 */
+    if (skip >= sizeof(struct ring_hdr)) {
+        ring_put_hdr(ch, pos, RING_WRAP);
+        rc = ring_post_write(ch, mirror_off(ch, pos), rx_off(ch, pos),
+                             (uint32_t)sizeof(struct ring_hdr));
+        if (rc) {
+            return rc;
+        }
+        ch->tx_seq = next_seq(ch->tx_seq);
+    }
+    ch->tail += skip;
+    pos = ring_mask(ch, ch->tail);
+
+    hdr = ring_put_hdr(ch, pos, len);
+    memcpy(hdr + 1, data, len);
+    *(uint64_t *)((char *)hdr + rec - RING_TRAILER_SIZE) = hdr->seq;
+    rc = ring_post_write(ch, mirror_off(ch, pos), rx_off(ch, pos), rec);
+    if (rc) {
+        return rc;
+    }
+
+    ch->tail += rec;
+    ch->tx_seq = next_seq(ch->tx_seq);
+    ch->head_reported = ch->head;
+    return 0;
+}
+
+int ring_peek(struct ring_channel *ch, const void **data, uint32_t *len) {
+    volatile struct ring_hdr *hdr;
+    uint32_t pos;
+    uint32_t rec;
+
+    for (;;) {
+        pos = ring_mask(ch, ch->head);
+        if (ch->size - pos < sizeof(struct ring_hdr)) {
+            ch->head += ch->size - pos;
+            continue;
+        }
+
+        hdr = (volatile struct ring_hdr *)(ch->res->buf + rx_off(ch, pos));
+        if (hdr->seq != ch->rx_seq) {
+            return 0;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (hdr->ack > ch->peer_head) {
+            ch->peer_head = hdr->ack;
+        }
+        if (hdr->len != RING_WRAP) {
+            break;
+        }
+        memset((void *)hdr, 0, sizeof(*hdr));
+        ch->head += ch->size - pos;
+        ch->rx_seq = next_seq(ch->rx_seq);
+    }
+
+    rec = ring_record_size(hdr->len);
+    if (rec > ch->size - pos) {
+        fprintf(stderr, "错误: 环形通道记录长度%u非法 (位置%u)\n", hdr->len, pos);
+        return -1;
+    }
+    if (*(volatile uint64_t *)((char *)hdr + rec - RING_TRAILER_SIZE) != ch->rx_seq) {
+        return 0;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    *data = (const void *)(hdr + 1);
+    *len = hdr->len;
+    ch->rx_pending = rec;
+    return 1;
+}
+
+int ring_release(struct ring_channel *ch) {
+    uint32_t pos = ring_mask(ch, ch->head);
+    int rc;
+
+    if (ch->rx_pending == 0) {
+        return 0;
+    }
+    memset(ch->res->buf + rx_off(ch, pos), 0, ch->rx_pending);
+    ch->head += ch->rx_pending;
+    ch->rx_pending = 0;
+    ch->rx_seq = next_seq(ch->rx_seq);
+
+    rc = ring_credit_flush(ch, 0);
+    return rc == -EAGAIN ? 0 : rc;
+}
+
+int ring_credit_flush(struct ring_channel *ch, int force) {
+    uint64_t unreported = ch->head - ch->head_reported;
+    int rc;
+
+    if (unreported == 0 || (!force && unreported < ch->credit_threshold)) {
+        return 0;
+    }
+    *(uint64_t *)(ch->res->buf + credit_out_off(ch)) = ch->head;
+    rc = ring_post_write(ch, credit_out_off(ch), credit_in_off(ch), sizeof(uint64_t));
+    if (rc == 0) {
+        ch->head_reported = ch->head;
+    }
+    return rc;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file rdma_common_ring.h
+ * @brief 基于RDMA WRITE的单生产者/单消费者远端环形缓冲区
+ *
+ * 生产者用RDMA WRITE把记录直接写进消费者已注册的环里，消费者自旋检查
+ * 内存而不是轮询CQ，一条消息只需要一次单边写，是RDMA上延迟最低的消息模式。
+ *
+ * 每个ring_channel对应一个QP上的双向通道，两端在各自缓冲区的base_off处
+ * 使用相同的布局（size为环大小）：
+ *
+ *   [0, size)            接收环：对端写入、本端消费
+ *   [size, 2*size)       发送镜像：本端组装记录后WRITE到对端接收环的同一偏移
+ *   [2*size, +8)         credit_in：对端写回的消费位置（本端发送环的head）
+ *   [2*size+8, +8)       credit_out：本端消费位置的暂存，作为credit WRITE的源
+ *
+ * 记录格式（8字节对齐）：struct ring_hdr | 负载 | 填充 | 8字节尾标
+ * - 消费者先等待头部seq等于期望序号，再按len等待尾标等于同一序号
+ * - 依赖网卡按地址递增顺序写入单个WRITE的数据（主流RoCE/IB网卡均满足）
+ * - 消费后把记录所占区域清零，保证下一圈的尾标检测不会误判
+ * - 环尾不足一条记录时写一个len为RING_WRAP的跳转头，不足一个头部时双方隐式跳转
+ *
+ * 流控：生产者只在 tail - peer_head + 记录大小 <= size 时写入。消费位置通过两种
+ * 方式懒惰返还：反向记录头部的ack字段捎带，或未返还字节超过阈值时单独WRITE一次
+ * 8字节的credit。捎带的消费位置要等对端ring_peek()读到该记录时才生效，
+ * 双向使用时双方都应持续消费各自的接收环。
+ *
+ * @see rdma_common_ring.c, rdma_common_rdma.h
+ */
+
+#ifndef RDMA_COMMON_RING_H
+#define RDMA_COMMON_RING_H
+
+#include "rdma_common.h"
+
+#define RING_ALIGN         8                  /* 记录对齐 */
+#define RING_TRAILER_SIZE  8                  /* 尾标大小 */
+#define RING_WRAP          0xffffffffu        /* 跳转头的len，表示从下一圈开头继续 */
+
+/**
+ * 记录头部，seq放在最后，头部整体可见时seq最后到达
+ */
+struct ring_hdr {
+    uint64_t ack;                      /* 发送方作为消费者的消费位置（捎带credit） */
+    uint32_t len;                      /* 负载长度，或RING_WRAP */
+    uint32_t seq;                      /* 记录序号，从1开始，0表示空 */
+};
+
+/**
+ * 一个QP上的双向环形通道
+ */
+struct ring_channel {
+    struct rdma_resources *res;
+    uint32_t qp_idx;                   /* 使用的QP */
+    uint32_t base_off;                 /* 布局在两端缓冲区中的起始偏移 */
+    uint32_t size;                     /* 环大小，2的幂 */
+    uint32_t credit_threshold;         /* 未返还字节超过该值时单独WRITE credit */
+
+    /* 生产者状态，位置均为自由递增的字节数 */
+    uint64_t tail;                     /* 已写入对端的字节数 */
+    uint64_t peer_head;                /* 对端已消费的字节数（缓存） */
+    uint32_t tx_seq;                   /* 下一条记录的序号 */
+
+    /* 消费者状态 */
+    uint64_t head;                     /* 已消费的字节数 */
+    uint64_t head_reported;            /* 已返还给对端的消费位置 */
+    uint32_t rx_seq;                   /* 期望的下一条记录序号 */
+    uint32_t rx_pending;               /* ring_peek()返回、尚未释放的记录大小 */
+};
+
+/**
+ * 通道在缓冲区中占用的字节数
+ */
+static inline uint32_t ring_region_size(uint32_t size) {
+    return 2 * size + 2 * (uint32_t)sizeof(uint64_t);
+}
+
+/**
+ * 负载为len字节的记录在环中占用的字节数
+ */
+static inline uint32_t ring_record_size(uint32_t len) {
+    return (uint32_t)sizeof(struct ring_hdr) +
+           ((len + RING_ALIGN - 1) & ~(uint32_t)(RING_ALIGN - 1)) + RING_TRAILER_SIZE;
+}
+
+/**
+ * 初始化通道并清零本端布局区域
+ *
+ * @param[out] ch        通道
+ * @param[in]  res       RDMA资源，QP必须已处于RTS且已交换远端addr/rkey
+ * @param[in]  qp_idx    使用的QP索引
+ * @param[in]  base_off  布局在两端缓冲区中的偏移，8字节对齐
+ * @param[in]  size      环大小，2的幂且至少64字节
+ *
+ * @return    成功返回0，参数无效或两端缓冲区放不下返回-1
+ *
+ * @note      两端必须用相同的base_off和size初始化，并在开始发送前同步一次
+ */
+int ring_channel_init(struct ring_channel *ch, struct rdma_resources *res,
+                      uint32_t qp_idx, uint32_t base_off, uint32_t size);
+
+/**
+ * 发送一条记录（一次RDMA WRITE）
+ *
+ * @param[in,out] ch    通道
+ * @param[in]     data  负载
+ * @param[in]     len   负载长度
+ *
+ * @return    成功返回0
+ * @retval -EAGAIN    对端环空间不足或发送队列已满，稍后重试
+ * @retval -EMSGSIZE  记录超过环大小的一半
+ * @retval 其他负值    投递失败
+ *
+ * @note      记录头部捎带本端的消费位置
+ */
+int ring_send(struct ring_channel *ch, const void *data, uint32_t len);
+
+/**
+ * 检查接收环中是否有完整到达的下一条记录（零拷贝）
+ *
+ * @param[in,out] ch    通道
+ * @param[out]    data  指向环内负载，ring_release()之前有效
+ * @param[out]    len   负载长度
+ *
+ * @return    有记录返回1，暂时没有返回0，头部长度非法（数据损坏）返回-1
+ *
+ * @note      只读内存，不轮询CQ；同一时刻最多一条未释放的记录
+ */
+int ring_peek(struct ring_channel *ch, const void **data, uint32_t *len);
+
+/**
+ * 释放ring_peek()返回的记录，清零其所占区域并推进消费位置
+ *
+ * @param[in,out] ch  通道
+ *
+ * @return    成功返回0，credit WRITE投递失败返回负错误码
+ *
+ * @note      未返还字节超过credit_threshold时顺带调用ring_credit_flush()
+ */
+int ring_release(struct ring_channel *ch);
+
+/**
+ * 把本端消费位置WRITE回对端的credit_in
+ *
+ * @param[in,out] ch     通道
+ * @param[in]     force  非0时只要有未返还字节就写，否则超过阈值才写
+ *
+ * @return    成功（或无需返还）返回0，发送队列满返回-EAGAIN（下次再试），
+ *            其他失败返回负错误码
+ *
+ * @note      ring_send()和本函数遇到发送队列满时会先轮询一次CQ回收槽位再重试，
+ *            只读内存的消费者也因此能回收credit WRITE占用的发送槽位
+ */
+int ring_credit_flush(struct ring_channel *ch, int force);
+
+#endif /* RDMA_COMMON_RING_H */
@@ -0,0 +1,94 @@
+/**
+ * @file rdma_common_session.c
+ * @brief 会话资源实现：借用共享设备/PD/CQ创建QP和缓冲区
+ */
+
+#include "rdma_common_session.h"
+#include "rdma_common_bringup.h"
+
+int session_res_init(struct rdma_resources *sess, const struct rdma_resources *shared,
+                     struct ibv_cq *cq, uint32_t num_qp, uint32_t buf_size) {
+    uint32_t cap;
+    uint32_t i;
+
+    memset(sess, 0, sizeof(*sess));
+    if (num_qp == 0 || num_qp > MAX_QP || !cq) {
+        fprintf(stderr, "错误: 会话QP数%u无效\n", num_qp);
+        return -1;
+    }
+
+    /* 借用共享资源，dev_list保持NULL */
+    sess->ib_dev = shared->ib_dev;
+    sess->context = shared->context;
+    sess->pd = shared->pd;
+    sess->dev_attr = shared->dev_attr;
+    sess->port_attr = shared->port_attr;
+    sess->ib_port = shared->ib_port;
+    sess->gid_idx = shared->gid_idx;
+    sess->comp_channel = shared->comp_channel;
+    sess->cq = cq;
+
+    /* 继承QP参数 */
+    sess->num_qp = num_qp;
+    sess->sq_depth = shared->sq_depth;
+    sess->rq_depth = shared->rq_depth;
+    sess->signal_interval = shared->signal_interval;
+    sess->max_inline_req = shared->max_inline_req;
+    sess->max_inline_data = shared->max_inline_req;
+    sess->max_sge = shared->max_sge;
+    if (sess->max_sge > (uint32_t)sess->dev_attr.max_sge) {
+        sess->max_sge = (uint32_t)sess->dev_attr.max_sge;
+    }
+    sess->max_rd_atomic = shared->max_rd_atomic;
+    sess->max_dest_rd_atomic = shared->max_dest_rd_atomic;
+    sess->poll_timeout_ms = shared->poll_timeout_ms;
+    sess->poll_check_interval = shared->poll_check_interval;
+    sess->poll_mode = POLL_MODE_BUSY;
+
+    sess->buf_size = buf_size;
+    sess->buf = rdma_buf_alloc(buf_size, BUF_PAGE_DEFAULT, &sess->buf_page_size);
+    if (!sess->buf) {
+        fprintf(stderr, "错误: 分配会话缓冲区失败\n");
+        return -1;
+    }
+    sess->mr = ibv_reg_mr(sess->pd, sess->buf, buf_size,
+                          rdma_access_flags(sess->dev_attr.atomic_cap));
+    sess->qp_list = calloc(num_qp, sizeof(struct ibv_qp *));
+    sess->qp_ctx = qp_ctx_alloc(num_qp);
+    if (!sess->mr || !sess->qp_list || !sess->qp_ctx) {
+        fprintf(stderr, "错误: 注册会话缓冲区或分配QP列表失败\n");
+        return -1;
+    }
+
+    for (i = 0; i < num_qp; i++) {
+        if (qp_create_one(sess, i, &cap) || qp_modify_init(sess, i)) {
+            return -1;
+        }
+        if (cap < sess->max_inline_data) {
+            sess->max_inline_data = cap;
+        }
+    }
+    return 0;
+}
+
+void session_res_cleanup(struct rdma_resources *sess) {
+    uint32_t i;
+
+    for (i = 0; sess->qp_list && i < sess->num_qp; i++) {
+        if (sess->qp_list[i]) {
+            ibv_destroy_qp(sess->qp_list[i]);
+        }
+    }
+    for (i = 0; sess->qp_ctx && i < sess->num_qp; i++) {
+        free(sess->qp_ctx[i].sig_ring);
+    }
+    free(sess->qp_list);
+    free(sess->qp_ctx);
+    if (sess->mr) {
+        ibv_dereg_mr(sess->mr);
+    }
+    if (sess->buf) {
+        rdma_buf_free(sess->buf, sess->buf_size, sess->buf_page_size);
+    }
+    memset(sess, 0, sizeof(*sess));
+}
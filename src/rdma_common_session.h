@@ -0,0 +1,169 @@
+/**
+ * @file rdma_common_session.h
+ * @brief 共享设备的会话资源：多个连接共用设备上下文、PD和CQ，各自拥有QP和缓冲区
+ *
+ * 一个服务端进程服务多个客户端时，每个客户端都打开设备、分配PD和CQ既慢又浪费。
+ * 会话资源是一个借用共享资源的struct rdma_resources：
+ * - context、pd、comp_channel从共享资源复制指针，cq由调用者从CQ池中指定
+ * - qp_list、qp_ctx、buf、mr为会话独有
+ * - dev_list为NULL，误调用cleanup_rdma_resources()也不会关闭共享设备，
+ *   但共享的PD/CQ会被释放，因此必须用session_res_cleanup()释放
+ *
+ * 会话资源可以直接交给post_*、register_wc_handler()、qp_modify_*()等接口。
+ * 多个会话共享一个CQ时，调用者自己ibv_poll_cq，用qpn_map按wc->qp_num
+ * 找到所属会话，再调用poll_dispatch_wc()。
+ *
+ * @see rdma_common_session.c, rdma_server.h
+ */
+
+#ifndef RDMA_COMMON_SESSION_H
+#define RDMA_COMMON_SESSION_H
+
+#include "rdma_common.h"
+
+/**
+ * 基于共享资源创建会话：分配并注册缓冲区，创建num_qp个QP并迁移到INIT
+ *
+ * @param[out] sess      会话资源
+ * @param[in]  shared    已由init_rdma_resources_cfg()初始化的共享资源，
+ *                       sq_depth/rq_depth/signal_interval等参数被会话继承
+ * @param[in]  cq        会话所有QP使用的CQ，必须由shared->context创建
+ * @param[in]  num_qp    QP数，1 ~ MAX_QP
+ * @param[in]  buf_size  会话缓冲区大小
+ *
+ * @return    成功返回0，失败返回-1（已分配的部分由session_res_cleanup()释放）
+ *
+ * @note      不打印逐QP日志，适合在事件循环中为每个新连接调用
+ */
+int session_res_init(struct rdma_resources *sess, const struct rdma_resources *shared,
+                     struct ibv_cq *cq, uint32_t num_qp, uint32_t buf_size);
+
+/**
+ * 释放会话独有的QP、缓冲区和MR，不触碰共享的设备、PD和CQ
+ */
+void session_res_cleanup(struct rdma_resources *sess);
+
+/* ========== qp_num到会话的映射 ========== */
+
+/**
+ * qp_num -> 会话编号的开放寻址哈希表（线性探测，删除时回移）
+ *
+ * qp_num 0是IB保留的SMI QP，RC QP不会用到，因此用0表示空位。
+ */
+struct qpn_map {
+    uint32_t *keys;                    /* qp_num，0表示空 */
+    uint32_t *vals;                    /* 会话编号 */
+    uint32_t mask;                     /* 容量-1，容量为2的幂 */
+    uint32_t count;                    /* 已用项数 */
+};
+
+static inline uint32_t qpn_map_slot(const struct qpn_map *m, uint32_t qpn) {
+    /* qp_num通常连续分配，乘法散列把相邻的号打散 */
+    return (qpn * 2654435761u) & m->mask;
+}
+
+/**
+ * 查找qp_num对应的会话编号
+ *
+ * @return    找到返回0并写入*val，不存在返回-1
+ */
+static inline int qpn_map_get(const struct qpn_map *m, uint32_t qpn, uint32_t *val) {
+    uint32_t i = qpn_map_slot(m, qpn);
+
+    while (m->keys[i]) {
+        if (m->keys[i] == qpn) {
+            *val = m->vals[i];
+            return 0;
+        }
+        i = (i + 1) & m->mask;
+    }
+    return -1;
+}
+
+/**
+ * 释放映射表
+ */
+static inline void qpn_map_destroy(struct qpn_map *m) {
+    free(m->keys);
+    free(m->vals);
+    memset(m, 0, sizeof(*m));
+}
+
+/**
+ * 创建映射表，容量取不小于2×max_entries的2的幂，装载因子不超过1/2
+ *
+ * @return    成功返回0，失败返回-1
+ */
+static inline int qpn_map_init(struct qpn_map *m, uint32_t max_entries) {
+    uint32_t cap = 16;
+
+    while (cap < 2 * max_entries) {
+        cap <<= 1;
+    }
+    m->keys = calloc(cap, sizeof(uint32_t));
+    m->vals = calloc(cap, sizeof(uint32_t));
+    m->mask = cap - 1;
+    m->count = 0;
+    if (!m->keys || !m->vals) {
+        qpn_map_destroy(m);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * 插入或更新一项
+ *
+ * @return    成功返回0，qpn为0或表已满返回-1
+ */
+static inline int qpn_map_put(struct qpn_map *m, uint32_t qpn, uint32_t val) {
+    uint32_t i = qpn_map_slot(m, qpn);
+
+    if (qpn == 0) {
+        return -1;
+    }
+    while (m->keys[i] && m->keys[i] != qpn) {
+        i = (i + 1) & m->mask;
+    }
+    if (!m->keys[i]) {
+        /* 至少留一个空位，保证查找总能终止 */
+        if (m->count + 1 > m->mask) {
+            return -1;
+        }
+        m->keys[i] = qpn;
+        m->count++;
+    }
+    m->vals[i] = val;
+    return 0;
+}
+
+/**
+ * 删除一项，不存在时什么也不做
+ */
+static inline void qpn_map_del(struct qpn_map *m, uint32_t qpn) {
+    uint32_t i = qpn_map_slot(m, qpn);
+    uint32_t j;
+    uint32_t home;
+
+    while (m->keys[i] != qpn) {
+        if (!m->keys[i]) {
+            return;
+        }
+        i = (i + 1) & m->mask;
+    }
+
+    /* 回移删除：把后面探测链上的项挪进空位，不留墓碑 */
+    for (j = (i + 1) & m->mask; m->keys[j]; j = (j + 1) & m->mask) {
+        home = qpn_map_slot(m, m->keys[j]);
+        /* home不在(i, j]区间内时，j上的项可以挪到i */
+        if (((j - home) & m->mask) >= ((j - i) & m->mask)) {
+            m->keys[i] = m->keys[j];
+            m->vals[i] = m->vals[j];
+            i = j;
+        }
+    }
+    m->keys[i] = 0;
+    m->count--;
+}
+
+#endif /* RDMA_COMMON_SESSION_H */
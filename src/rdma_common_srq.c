@@ -0,0 +1,276 @@
+/**
+ * @file rdma_common_srq.c
+ * @brief 共享接收队列实现：创建、低水位arm、批量补投、异步事件处理
+ *
+ * 槽位状态只有两种：挂在SRQ中（计入posted），或已消费等待补投
+ * （在free_slots中）。处理函数运行期间槽位两者都不是，缓冲区归处理函数所有。
+ */
+
+#include "rdma_common_srq.h"
+
+#include <fcntl.h>
+
+/* 重新arm低水位，设备不支持时退化为轮询路径补投 */
+static void srq_arm_limit(struct srq_ctx *s) {
+    struct ibv_srq_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.srq_limit = s->limit;
+    s->limit_armed = ibv_modify_srq(s->srq, &attr, IBV_SRQ_LIMIT) == 0;
+}
+
+int srq_init(struct rdma_resources *res, uint32_t recv_base,
+             uint32_t depth, uint32_t msg_size) {
+    struct ibv_srq_init_attr init_attr;
+    struct srq_ctx *s;
+    uint32_t i;
+    int flags;
+
+    if (!res || !res->pd || !res->mr || res->srq || depth < 2 || msg_size == 0) {
+        fprintf(stderr, "错误: SRQ参数无效\n");
+        return -1;
+    }
+    if (res->qp_list && res->qp_list[0]) {
+        fprintf(stderr, "错误: SRQ必须在创建QP之前初始化\n");
+        return -1;
+    }
+    if (res->dev_attr.max_srq == 0) {
+        fprintf(stderr, "错误: 设备不支持SRQ\n");
+        return -1;
+    }
+    if (depth > (uint32_t)res->dev_attr.max_srq_wr) {
+        printf("SRQ深度%u超过设备上限，裁剪为%d\n", depth, res->dev_attr.max_srq_wr);
+        depth = (uint32_t)res->dev_attr.max_srq_wr;
+    }
+    if ((uint64_t)recv_base + (uint64_t)depth * msg_size > res->buf_size) {
+        fprintf(stderr, "错误: SRQ缓冲区区域越界 (偏移%u, %u×%u字节, 缓冲区%zu字节)\n",
+                recv_base, depth, msg_size, res->buf_size);
+        return -1;
+    }
+
+    s = calloc(1, sizeof(*s));
+    if (!s || !(s->free_slots = malloc(depth * sizeof(uint32_t)))) {
+        fprintf(stderr, "错误: 分配SRQ状态失败\n");
+        free(s);
+        return -1;
+    }
+    res->srq = s;
+    s->depth = depth;
+    s->limit = depth / SRQ_LIMIT_DIVISOR ? depth / SRQ_LIMIT_DIVISOR : 1;
+    s->msg_size = msg_size;
+    s->recv_base = recv_base;
+    for (i = 0; i < depth; i++) {
+        s->free_slots[i] = depth - 1 - i;
+    }
+    s->nfree = depth;
+
+    memset(&init_attr, 0, sizeof(init_attr));
+    init_attr.attr.max_wr = depth;
+    init_attr.attr.max_sge = MAX_SGE;
+    s->srq = ibv_create_srq(res->pd, &init_attr);
+    if (!s->srq) {
+        fprintf(stderr, "错误: 创建SRQ失败\n");
+        return -1;
+    }
+
+    /* LIMIT_REACHED通过async_fd通知，非阻塞读取才能在数据路径上顺带检查 */
+    flags = fcntl(res->context->async_fd, F_GETFL);
+    if (flags < 0 || fcntl(res->context->async_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        fprintf(stderr, "错误: 设置异步事件fd为非阻塞失败\n");
+        return -1;
+    }
+
+    if (srq_refill(res) < 0) {
+        return -1;
+    }
+    srq_arm_limit(s);
+    printf("成功创建SRQ (深度: %u, 缓冲区: %u字节, 低水位: %u%s)\n",
+           depth, msg_size, s->limit, s->limit_armed ? "" : ", 设备不支持低水位事件");
+    return 0;
+}
+
+int srq_set_limit(struct rdma_resources *res, uint32_t limit) {
+    struct srq_ctx *s = res ? res->srq : NULL;
+
+    if (!s || limit == 0 || limit >= s->depth) {
+        fprintf(stderr, "错误: SRQ低水位无效\n");
+        return -1;
+    }
+    s->limit = limit;
+    srq_arm_limit(s);
+    if (!s->limit_armed) {
+        fprintf(stderr, "警告: 设备不支持SRQ低水位事件，改为在轮询路径上补投\n");
+    }
+    return 0;
+}
+
+int srq_refill(struct rdma_resources *res) {
+    struct srq_ctx *s = res->srq;
+    struct ibv_recv_wr wrs[SRQ_REFILL_BATCH];
+    struct ibv_sge sges[SRQ_REFILL_BATCH];
+    struct ibv_recv_wr *bad_wr = NULL;
+    uint32_t total = 0;
+    uint32_t n;
+    uint32_t i;
+
+    while (s->nfree > 0) {
+        n = s->nfree < SRQ_REFILL_BATCH ? s->nfree : SRQ_REFILL_BATCH;
+        memset(wrs, 0, sizeof(wrs[0]) * n);
+        for (i = 0; i < n; i++) {
+            uint32_t slot = s->free_slots[s->nfree - 1 - i];
+
+            sges[i].addr = (uintptr_t)(res->buf + srq_slot_off(s, slot));
+            sges[i].length = s->msg_size;
+            sges[i].lkey = res->mr->lkey;
+            wrs[i].wr_id = WR_ID_MAKE(SRQ_WR_QP, slot);
+            wrs[i].sg_list = &sges[i];
+            wrs[i].num_sge = 1;
+            wrs[i].next = i + 1 < n ? &wrs[i + 1] : NULL;
+        }
+        if (ibv_post_srq_recv(s->srq, wrs, &bad_wr)) {
+            /* bad_wr之前的WR已进入SRQ */
+            n = bad_wr ? (uint32_t)(bad_wr - wrs) : 0;
+            s->nfree -= n;
+            s->posted += n;
+            fprintf(stderr, "错误: 向SRQ投递RECV失败\n");
+            return -1;
+        }
+        s->nfree -= n;
+        s->posted += n;
+        total += n;
+    }
+    if (total > 0) {
+        s->refills++;
+    }
+    return (int)total;
+}
+
+int srq_recycle(struct rdma_resources *res, uint32_t slot) {
+    struct srq_ctx *s = res->srq;
+
+    if (slot >= s->depth) {
+        fprintf(stderr, "错误: SRQ槽位%u无效\n", slot);
+        return -1;
+    }
+    s->free_slots[s->nfree++] = slot;
+    if (!s->limit_armed && s->posted < s->limit) {
+        return srq_refill(res) < 0 ? -1 : 0;
+    }
+    return 0;
+}
+
+static int srq_qpn_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* 建立qp_num到QP索引的有序表，高32位为qp_num，排序后即按qp_num有序 */
+static int srq_build_qpn_map(const struct rdma_resources *res, struct srq_ctx *s) {
+    uint32_t i;
+
+    free(s->qpn_map);
+    s->qpn_count = 0;
+    s->qpn_map = malloc(res->num_qp * sizeof(uint64_t));
+    if (!s->qpn_map) {
+        return -1;
+    }
+    for (i = 0; i < res->num_qp; i++) {
+        if (res->qp_list[i]) {
+            s->qpn_map[s->qpn_count++] = ((uint64_t)res->qp_list[i]->qp_num << 32) | i;
+        }
+    }
+    qsort(s->qpn_map, s->qpn_count, sizeof(uint64_t), srq_qpn_cmp);
+    return 0;
+}
+
+uint32_t srq_qp_index(const struct rdma_resources *res, uint32_t qp_num) {
+    struct srq_ctx *s = res->srq;
+    uint32_t lo = 0;
+    uint32_t hi;
+
+    if (s->qpn_count != res->num_qp && srq_build_qpn_map(res, s)) {
+        return SRQ_WR_QP;
+    }
+    hi = s->qpn_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t qpn = (uint32_t)(s->qpn_map[mid] >> 32);
+
+        if (qpn == qp_num) {
+            return (uint32_t)s->qpn_map[mid];
+        }
+        if (qpn < qp_num) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return SRQ_WR_QP;
+}
+
+/* 处理n个低水位事件：一次补投所有已消费的槽位并重新arm */
+static int srq_on_limit(struct rdma_resources *res, uint32_t n) {
+    struct srq_ctx *s = res->srq;
+
+    s->limit_events += n;
+    s->limit_armed = 0;
+    if (srq_refill(res) < 0) {
+        return -1;
+    }
+    srq_arm_limit(s);
+    return 0;
+}
+
+int srq_poll_events(struct rdma_resources *res) {
+    struct ibv_async_event event;
+    struct srq_ctx *s = res->srq;
+    uint32_t pending;
+    int handled = 0;
+
+    /* 监视线程独占async_fd，只取走它转交的低水位事件 */
+    if (res->async) {
+        pending = s ? __atomic_exchange_n(&s->limit_pending, 0, __ATOMIC_ACQ_REL) : 0;
+        if (pending && srq_on_limit(res, pending)) {
+            return -1;
+        }
+        return (int)pending;
+    }
+    while (ibv_get_async_event(res->context, &event) == 0) {
+        handled++;
+        if (event.event_type == IBV_EVENT_SRQ_LIMIT_REACHED &&
+            s && event.element.srq == s->srq) {
+            ibv_ack_async_event(&event);
+            if (srq_on_limit(res, 1)) {
+                return -1;
+            }
+            continue;
+        }
+        fprintf(stderr, "警告: 异步事件: %s\n", ibv_event_type_str(event.event_type));
+        ibv_ack_async_event(&event);
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        fprintf(stderr, "错误: 读取异步事件失败: %s\n", strerror(errno));
+        return -1;
+    }
+    return handled;
+}
+
+void srq_destroy(struct rdma_resources *res) {
+    struct srq_ctx *s = res->srq;
+
+    if (!s) {
+        return;
+    }
+    if (s->srq) {
+        ibv_destroy_srq(s->srq);
+        printf("销毁SRQ (收到%llu个RECV, 低水位事件%llu次, 补投%llu次)\n",
+               (unsigned long long)s->received, (unsigned long long)s->limit_events,
+               (unsigned long long)s->refills);
+    }
+    free(s->free_slots);
+    free(s->qpn_map);
+    free(s);
+    res->srq = NULL;
+}
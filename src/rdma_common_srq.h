@@ -0,0 +1,144 @@
+/**
+ * @file rdma_common_srq.h
+ * @brief 共享接收队列(SRQ)：所有QP共用一组RECV缓冲区，低水位事件驱动补投
+ *
+ * 每个QP独立的接收队列需要num_qp × rq_depth个RECV缓冲区，
+ * 空闲QP上的缓冲区长期闲置，QP数上百时接收内存成为瓶颈。
+ * 启用SRQ后，res->qp_list中的所有QP从同一个ibv_srq取RECV：
+ *
+ * - 接收内存为depth × msg_size，只与流量有关，与QP数无关
+ * - RECV的wr_id为WR_ID_MAKE(SRQ_WR_QP, 槽位号)，轮询引擎按wc->qp_num
+ *   找回QP索引后照常分发，处理函数返回后槽位进入待补投列表
+ * - SRQ中剩余RECV数低于limit时设备产生IBV_EVENT_SRQ_LIMIT_REACHED，
+ *   srq_poll_events()收到后一次补投所有已消费的槽位并重新arm低水位
+ *   （该事件是一次性的，每次触发后limit被设备清零）
+ * - 设备不支持低水位时退化为在轮询路径上低于limit即补投
+ *
+ * 必须在create_qp_list()之前调用srq_init()，QP创建时会自动挂到SRQ上，
+ * 此后不能再对这些QP调用post_receive_qp()/post_recv_chain()。
+ *
+ * @see rdma_common_srq.c, rdma_common_poll.c
+ */
+
+#ifndef RDMA_COMMON_SRQ_H
+#define RDMA_COMMON_SRQ_H
+
+#include "rdma_common.h"
+
+#define SRQ_WR_QP           0xffffffffu    /* SRQ RECV的wr_id中QP索引位置的标记 */
+#define SRQ_LIMIT_DIVISOR   4              /* 默认低水位为depth / SRQ_LIMIT_DIVISOR */
+#define SRQ_REFILL_BATCH    32             /* 单次ibv_post_srq_recv链接的最大WR数 */
+
+/**
+ * SRQ运行时状态，由srq_init()创建并挂在res->srq上
+ */
+struct srq_ctx {
+    struct ibv_srq *srq;
+    uint32_t depth;                    /* RECV缓冲区总数（已按设备上限裁剪） */
+    uint32_t limit;                    /* 低水位：SRQ中剩余RECV数低于该值时补投 */
+    uint32_t msg_size;                 /* 每个RECV缓冲区大小 */
+    uint32_t recv_base;                /* 缓冲区区域在res->buf中的偏移 */
+    uint32_t posted;                   /* 当前挂在SRQ中的RECV数 */
+    uint32_t *free_slots;              /* 已消费、等待补投的槽位 */
+    uint32_t nfree;                    /* free_slots中的槽位数 */
+    int limit_armed;                   /* 低水位是否已arm；设备不支持时恒为0 */
+    uint64_t received;                 /* 累计收到的RECV完成数 */
+    uint64_t limit_events;             /* 收到的SRQ_LIMIT_REACHED事件数 */
+    uint32_t limit_pending;            /* 监视线程转交、尚未处理的低水位事件数（原子访问） */
+    uint64_t refills;                  /* 补投次数 */
+    uint64_t *qpn_map;                 /* (qp_num << 32 | QP索引)按qp_num排序，首次查找时建立 */
+    uint32_t qpn_count;                /* qpn_map的元素数 */
+};
+
+/**
+ * SRQ缓冲区区域所需字节数
+ */
+static inline uint32_t srq_region_size(uint32_t depth, uint32_t msg_size) {
+    return depth * msg_size;
+}
+
+/**
+ * 槽位在res->buf中的偏移
+ */
+static inline uint32_t srq_slot_off(const struct srq_ctx *s, uint32_t slot) {
+    return s->recv_base + slot * s->msg_size;
+}
+
+/**
+ * 判断完成事件是否来自SRQ上的RECV
+ */
+static inline int srq_is_recv(const struct ibv_wc *wc) {
+    return WR_ID_QP(wc->wr_id) == SRQ_WR_QP;
+}
+
+/**
+ * 创建SRQ并投递全部RECV，低水位默认为depth / SRQ_LIMIT_DIVISOR
+ *
+ * @param[in,out] res        RDMA资源，PD和MR已创建，QP尚未创建
+ * @param[in]     recv_base  缓冲区区域偏移，区域大小见srq_region_size()
+ * @param[in]     depth      RECV缓冲区数，超过设备max_srq_wr时裁剪
+ * @param[in]     msg_size   每个RECV缓冲区大小，即最大接收消息长度
+ *
+ * @return    成功返回0，设备不支持SRQ、区域越界或创建失败返回-1
+ *
+ * @post      res->srq非NULL，之后create_qp_list()创建的QP都使用该SRQ
+ * @note      会把async_fd设为非阻塞，供srq_poll_events()读取
+ */
+int srq_init(struct rdma_resources *res, uint32_t recv_base,
+             uint32_t depth, uint32_t msg_size);
+
+/**
+ * 修改低水位并重新arm
+ *
+ * @param[in,out] res    RDMA资源，已调用srq_init()
+ * @param[in]     limit  新的低水位，1 ~ depth-1
+ *
+ * @return    成功返回0，参数无效返回-1；设备不支持低水位时打印警告并返回0
+ */
+int srq_set_limit(struct rdma_resources *res, uint32_t limit);
+
+/**
+ * 把所有已消费的槽位补投回SRQ
+ *
+ * @return    补投的RECV数，失败返回-1
+ */
+int srq_refill(struct rdma_resources *res);
+
+/**
+ * 回收一个已处理完的RECV槽位，由轮询引擎在处理函数返回后调用
+ *
+ * @param[in,out] res   RDMA资源
+ * @param[in]     slot  槽位号，即WR_ID_TAG(wc->wr_id)
+ *
+ * @return    成功返回0，补投失败返回-1
+ */
+int srq_recycle(struct rdma_resources *res, uint32_t slot);
+
+/**
+ * 按wc->qp_num查找QP索引
+ *
+ * @return    QP索引，不属于res->qp_list时返回SRQ_WR_QP
+ *
+ * @note      首次调用时按qp_num建立有序表（所有QP必须已创建），之后二分查找，
+ *            上千个QP时每个RECV完成的查找代价为O(log num_qp)
+ */
+uint32_t srq_qp_index(const struct rdma_resources *res, uint32_t qp_num);
+
+/**
+ * 处理所有待处理的异步事件（非阻塞）
+ *
+ * IBV_EVENT_SRQ_LIMIT_REACHED触发补投和重新arm，其他事件打印后确认。
+ * 可在CQ空闲时调用，或把res->context->async_fd放入epoll后在可读时调用。
+ * 已启动异步事件监视线程（res->async非NULL）时不读async_fd，
+ * 只处理监视线程转交的低水位事件（见rdma_common_async.h）。
+ *
+ * @return    处理的事件数，读取失败返回-1
+ */
+int srq_poll_events(struct rdma_resources *res);
+
+/**
+ * 销毁SRQ并释放状态，必须在所有QP销毁之后调用
+ */
+void srq_destroy(struct rdma_resources *res);
+
+#endif /* RDMA_COMMON_SRQ_H */
@@ -0,0 +1,181 @@
+/**
+ * @file rdma_common_worker.c
+ * @brief 工作线程组实现：每线程CQ创建、QP分块、CPU绑定、同时起跑
+ */
+
+#include "rdma_common_worker.h"
+#include "rdma_common_cpu.h"
+
+#include <sched.h>
+
+/* 按CPU列表字符串给各线程分配CPU，cpus为NULL时全部不绑定 */
+static int worker_assign_cpus(struct rdma_resources *res, struct worker_group *g,
+                              const char *cpus) {
+    int *list;
+    int n;
+    uint32_t w;
+
+    for (w = 0; w < g->count; w++) {
+        g->workers[w].cpu = -1;
+    }
+    if (!cpus) {
+        return 0;
+    }
+
+    list = malloc(sizeof(int) * CPU_LIST_MAX);
+    if (!list) {
+        return -1;
+    }
+    if (!strcmp(cpus, "numa")) {
+        n = g->numa_node >= 0 ? cpu_node_cpus(g->numa_node, list, CPU_LIST_MAX) : -1;
+        if (n < 0) {
+            fprintf(stderr, "警告: 无法确定%s所在NUMA节点的CPU，工作线程不绑核\n",
+                    ibv_get_device_name(res->ib_dev));
+            n = 0;
+        }
+    } else {
+        n = cpu_list_parse(cpus, list, CPU_LIST_MAX);
+        if (n < 0) {
+            fprintf(stderr, "错误: 无效的CPU列表: %s\n", cpus);
+            free(list);
+            return -1;
+        }
+    }
+    for (w = 0; n > 0 && w < g->count; w++) {
+        g->workers[w].cpu = list[w % (uint32_t)n];
+    }
+    free(list);
+    return 0;
+}
+
+int worker_init(struct rdma_resources *res, uint32_t count, const char *cpus) {
+    struct worker_group *g;
+    uint32_t per_qp = res->sq_depth + res->rq_depth;
+    uint32_t w;
+    uint32_t i;
+
+    if (count == 0 || count > res->num_qp || count > WORKER_MAX) {
+        fprintf(stderr, "错误: 工作线程数%u超出范围[1-%u]\n", count,
+                res->num_qp < WORKER_MAX ? res->num_qp : WORKER_MAX);
+        return -1;
+    }
+    if (res->srq) {
+        fprintf(stderr, "错误: 工作线程与SRQ不能同时使用\n");
+        return -1;
+    }
+
+    g = calloc(1, sizeof(*g));
+    if (!g) {
+        return -1;
+    }
+    res->workers = g;
+    g->count = count;
+    g->numa_node = cpu_dev_numa_node(ibv_get_device_name(res->ib_dev));
+    if (posix_memalign((void **)&g->workers, 64, sizeof(struct rdma_worker) * count)) {
+        g->workers = NULL;
+        return -1;
+    }
+    memset(g->workers, 0, sizeof(struct rdma_worker) * count);
+    if (worker_assign_cpus(res, g, cpus)) {
+        return -1;
+    }
+
+    /* 第一个线程QP最多，CQ按它的需要统一分配 */
+    worker_split(res->num_qp, count, 0, &i, &w);
+    g->cq_size = w * per_qp;
+    if (g->cq_size > (uint32_t)res->dev_attr.max_cqe) {
+        g->cq_size = (uint32_t)res->dev_attr.max_cqe;
+    }
+
+    printf("\n========== 创建%u个工作线程的CQ ==========\n", count);
+    printf("网卡NUMA节点: %d, 每个CQ容量: %u\n", g->numa_node, g->cq_size);
+    for (w = 0; w < count; w++) {
+        struct rdma_worker *wk = &g->workers[w];
+
+        wk->id = w;
+        wk->res = res;
+        worker_split(res->num_qp, count, w, &wk->qp_first, &wk->qp_count);
+        wk->cq = ibv_create_cq(res->context, (int)g->cq_size, NULL, NULL, 0);
+        if (!wk->cq) {
+            fprintf(stderr, "错误: 创建工作线程[%u]的CQ失败\n", w);
+            return -1;
+        }
+        for (i = wk->qp_first; i < wk->qp_first + wk->qp_count; i++) {
+            res->qp_ctx[i].cq = wk->cq;
+        }
+        printf("  线程[%u]: QP[%u-%u], CPU %d\n", w, wk->qp_first,
+               wk->qp_first + wk->qp_count - 1, wk->cpu);
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    struct rdma_worker *w = arg;
+    struct worker_group *g = w->res->workers;
+    int rc;
+
+    if (w->cpu >= 0) {
+        rc = cpu_pin_self(w->cpu);
+        if (rc) {
+            fprintf(stderr, "警告: 线程[%u]绑定CPU %d失败: %s\n", w->id, w->cpu, strerror(-rc));
+        }
+    }
+    /* 等所有线程创建完成后同时起跑，主线程创建失败时放弃执行 */
+    while ((rc = __atomic_load_n(&g->go, __ATOMIC_ACQUIRE)) == 0) {
+        sched_yield();
+    }
+    w->rc = rc > 0 ? w->fn(w->res, w, w->arg) : -1;
+    return NULL;
+}
+
+int worker_run(struct rdma_resources *res, worker_fn_t fn, void *arg) {
+    struct worker_group *g = res->workers;
+    uint32_t started;
+    uint32_t w;
+    int rc = 0;
+
+    if (!g || !fn) {
+        return -1;
+    }
+    g->go = 0;
+    for (started = 0; started < g->count; started++) {
+        struct rdma_worker *wk = &g->workers[started];
+
+        wk->fn = fn;
+        wk->arg = arg;
+        wk->rc = 0;
+        if (pthread_create(&wk->thread, NULL, worker_main, wk)) {
+            fprintf(stderr, "错误: 创建工作线程[%u]失败\n", started);
+            break;
+        }
+    }
+    __atomic_store_n(&g->go, started == g->count ? 1 : -1, __ATOMIC_RELEASE);
+    if (started < g->count) {
+        rc = -1;
+    }
+    for (w = 0; w < started; w++) {
+        pthread_join(g->workers[w].thread, NULL);
+        if (g->workers[w].rc) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+void worker_destroy(struct rdma_resources *res) {
+    struct worker_group *g = res->workers;
+    uint32_t w;
+
+    if (!g) {
+        return;
+    }
+    for (w = 0; g->workers && w < g->count; w++) {
+        if (g->workers[w].cq) {
+            ibv_destroy_cq(g->workers[w].cq);
+        }
+    }
+    free(g->workers);
+    free(g);
+    res->workers = NULL;
+    printf("销毁工作线程CQ\n");
+}
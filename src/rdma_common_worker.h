@@ -0,0 +1,130 @@
+/**
+ * @file rdma_common_worker.h
+ * @brief 多线程数据路径：每个工作线程独占一组QP和一个CQ，绑定到固定CPU
+ *
+ * 单线程时所有QP共享res->cq，吞吐受一个核的投递/轮询能力限制。
+ * 启用工作线程后：
+ * - QP按下标连续分块，线程w独占第w块（前num_qp % count个线程多分一个）
+ * - 每个线程一个CQ，该线程的QP的发送和接收完成都进这个CQ，
+ *   轮询、sq_reclaim、处理函数都只接触本线程的QP，热路径上没有锁和共享写
+ * - 线程按CPU列表依次绑定；列表为"numa"时取网卡所在NUMA节点的CPU
+ *
+ * 调用顺序：init_rdma_resources_cfg() → 设置sq_depth/rq_depth →
+ * worker_init() → create_qp_list() → ... → worker_run()（可多次） →
+ * cleanup_rdma_resources()（其中调用worker_destroy()）。
+ *
+ * 限制：与SRQ互斥（SRQ的槽位表是共享状态）；每线程CQ没有completion
+ * channel，只能忙轮询（poll_cq_batch_on()）。
+ *
+ * @see rdma_common_worker.c, rdma_common_cpu.h
+ */
+
+#ifndef RDMA_COMMON_WORKER_H
+#define RDMA_COMMON_WORKER_H
+
+#include "rdma_common.h"
+
+#include <pthread.h>
+
+#define WORKER_MAX  64                 /* 工作线程数上限 */
+
+struct rdma_worker;
+
+/**
+ * 工作线程主函数，在绑定CPU、所有线程都创建完成之后调用
+ *
+ * @return    0成功，非0表示失败，worker_run()汇总后返回-1
+ */
+typedef int (*worker_fn_t)(struct rdma_resources *res, struct rdma_worker *w, void *arg);
+
+/**
+ * 单个工作线程的状态，按缓存行对齐，线程之间不共享缓存行
+ */
+struct rdma_worker {
+    uint32_t id;                       /* 线程序号 */
+    int cpu;                           /* 绑定的CPU，-1表示不绑定 */
+    struct ibv_cq *cq;                 /* 本线程QP共用的CQ */
+    uint32_t qp_first;                 /* 第一个QP的下标 */
+    uint32_t qp_count;                 /* 拥有的QP数 */
+    pthread_t thread;
+    worker_fn_t fn;                    /* 本次worker_run()的主函数 */
+    void *arg;
+    int rc;                            /* 主函数返回值 */
+    struct rdma_resources *res;
+} __attribute__((aligned(64)));
+
+/**
+ * 工作线程组，由worker_init()创建并挂在res->workers上
+ */
+struct worker_group {
+    uint32_t count;                    /* 线程数 */
+    uint32_t cq_size;                  /* 每个CQ的容量 */
+    int numa_node;                     /* 网卡所在NUMA节点，-1表示未知 */
+    struct rdma_worker *workers;       /* count个元素，64字节对齐 */
+    int go;                            /* 起跑标志：0等待，1执行，-1放弃（线程创建失败） */
+};
+
+/**
+ * 计算线程w拥有的QP区间（连续分块，余数分给前面的线程）
+ */
+static inline void worker_split(uint32_t num_qp, uint32_t count, uint32_t w,
+                                uint32_t *first, uint32_t *n) {
+    uint32_t base = num_qp / count;
+    uint32_t extra = num_qp % count;
+
+    *first = w * base + (w < extra ? w : extra);
+    *n = base + (w < extra ? 1 : 0);
+}
+
+/**
+ * QP下标对应的线程序号，与worker_split()互逆
+ */
+static inline uint32_t worker_index(uint32_t num_qp, uint32_t count, uint32_t qp) {
+    uint32_t base = num_qp / count;
+    uint32_t extra = num_qp % count;
+    uint32_t big = extra * (base + 1);
+
+    return qp < big ? qp / (base + 1) : extra + (qp - big) / base;
+}
+
+/**
+ * QP所属的线程序号，未启用工作线程时为0
+ */
+static inline uint32_t worker_of_qp(const struct rdma_resources *res, uint32_t qp) {
+    return res->workers ? worker_index(res->num_qp, res->workers->count, qp) : 0;
+}
+
+/**
+ * 创建工作线程组：为每个线程创建CQ并把QP分配给线程
+ *
+ * @param[in,out] res    RDMA资源，QP尚未创建，sq_depth/rq_depth已确定
+ * @param[in]     count  线程数，1 ~ min(res->num_qp, WORKER_MAX)
+ * @param[in]     cpus   CPU列表（如"2-5,8"），"numa"表示网卡所在节点的CPU，
+ *                       NULL表示不绑定；CPU少于线程数时循环使用
+ *
+ * @return    成功返回0，失败返回-1
+ *
+ * @post      res->qp_ctx[i].cq指向QP i所属线程的CQ，create_qp_list()据此创建QP
+ * @note      CQ容量为该线程QP数×(sq_depth + rq_depth)，按设备max_cqe裁剪
+ */
+int worker_init(struct rdma_resources *res, uint32_t count, const char *cpus);
+
+/**
+ * 启动所有工作线程执行fn并等待全部结束
+ *
+ * @param[in] res  RDMA资源，已调用worker_init()
+ * @param[in] fn   线程主函数
+ * @param[in] arg  传给fn的参数
+ *
+ * @return    所有线程都返回0时返回0，否则返回-1
+ */
+int worker_run(struct rdma_resources *res, worker_fn_t fn, void *arg);
+
+/**
+ * 销毁工作线程组的CQ并释放状态，res->workers为NULL时什么也不做
+ *
+ * @note      必须在QP销毁之后、设备关闭之前调用，cleanup_rdma_resources()已包含
+ */
+void worker_destroy(struct rdma_resources *res);
+
+#endif /* RDMA_COMMON_WORKER_H */
@@ -1,302 +1,299 @@
 /**
  * @file rdma_server.c
- * @brief RDMA服务端应用程序
+ * @brief RDMA服务端应用程序（常驻、多客户端）
  *
- * 本程序实现RDMA通信的服务端，主要功能包括：
- * - 初始化RDMA资源（设备、PD、CQ、QP列表、MR）
- * - 创建TCP监听套接字
- * - 等待并接受客户端TCP连接
- * - 与客户端交换QP连接信息（QP号、LID、GID）
- * - 转移QP状态（INIT → RTR → RTS）
- * - 投递接收请求到RQ
- * - 轮询CQ等待接收完成
- * - 打印接收的数据
+ * 本程序实现常驻的多客户端服务端，工作流程：
+ * 1. 初始化共享资源（设备、PD、completion channel）和CQ池
+ * 2. 非阻塞监听指定端口（默认18515），backlog为SOMAXCONN
+ * 3. 事件循环：
+ *    - 监听socket可读：accept所有排队的连接
+ *    - 客户端socket可读/可写：推进握手，为客户端创建独立的QP和缓冲区
+ *    - completion channel可读：轮询CQ池并按qp_num分发给客户端
+ * 4. 收到SIGINT/SIGTERM后关闭所有客户端并清理资源
  *
- * 工作流程：
- * 1. 初始化RDMA资源和多个QP
- * 2. 创建TCP服务器监听指定端口（默认18515）
- * 3. 等待客户端连接
- * 4. 在TCP连接上交换QP元数据
- * 5. 修改QP状态到RTR和RTS
- * 6. 投递接收请求
- * 7. 轮询CQ等待数据到达
- * 8. 清理资源并关闭连接
- *
- * @note 支持多QP模式，使用默认QP数量（可通过命令行修改）
- * @see rdma_common.h, rdma_common.c
+ * @note 客户端协议与单客户端版本相同，rdma_client无需修改
+ * @see rdma_server.h, rdma_server_conn.c
  *
  * @author AI Programming Assistant
  * @date 2024
  */
 
-#include "rdma_common.h"
+#include "rdma_server.h"
+#include "rdma_common_event.h"
 
-int main(int argc, char *argv[]) {
-    struct rdma_resources res;
-    struct cm_con_data_t *local_con_data;
-    struct cm_con_data_t *remote_con_data;
-    union ibv_gid my_gid;
-    int rc = 0;
-    int sock = -1;
-    int listen_sock = -1;
-    int port = DEFAULT_PORT;
-    char *dev_name = NULL;
-    uint8_t ib_port = 1;
-    int gid_idx = 1;
-    uint32_t num_qp = DEFAULT_NUM_QP;
-    uint32_t remote_num_qp = 0;
+#include <signal.h>
+#include <sys/epoll.h>
+
+#define SRV_MAX_QP_LIMIT   256     /* 每客户端QP上限参数的最大值 */
+#define SRV_EPOLL_EVENTS   256     /* 每次epoll_wait取回的事件数 */
+#define SRV_POLL_BATCH     64      /* 每次ibv_poll_cq取回的完成事件数 */
+
+static volatile sig_atomic_t g_stop;
+
+static void srv_on_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+/* 创建CQ池，各CQ分散到不同的完成向量（中断）上 */
+static int srv_create_cq_pool(struct rdma_server *srv, uint32_t num_cq) {
+    struct ibv_context *ctx = srv->shared.context;
+    int cqe = SRV_CQ_ENTRIES;
+    int nvec = ctx->num_comp_vectors > 0 ? ctx->num_comp_vectors : 1;
     uint32_t i;
 
-    /* 解析命令行参数 */
-    if (argc >= 2) {
-        dev_name = argv[1];
-    }
-    if (argc >= 3) {
-        port = atoi(argv[2]);
-    }
-    if (argc >= 4) {
-        gid_idx = atoi(argv[3]);
+    if (cqe > srv->shared.dev_attr.max_cqe) {
+        cqe = srv->shared.dev_attr.max_cqe;
     }
-    if (argc >= 5) {
-        num_qp = atoi(argv[4]);
+    for (i = 0; i < num_cq; i++) {
+        srv->cqs[i].cq = ibv_create_cq(ctx, cqe, NULL, srv->shared.comp_channel, (int)i % nvec);
+        if (!srv->cqs[i].cq || ibv_req_notify_cq(srv->cqs[i].cq, 0)) {
+            fprintf(stderr, "错误: 创建池CQ[%u]失败\n", i);
+            return -1;
+        }
+        srv->cqs[i].cqe = (uint32_t)srv->cqs[i].cq->cqe;
+        srv->num_cq++;
     }
+    printf("CQ池: %u个CQ，每个%d项\n", num_cq, cqe);
+    return 0;
+}
 
-    printf("========================================\n");
-    printf("   RDMA服务端 - RoCEv2多QP学习程序\n");
-    printf("========================================\n");
-    printf("设备: %s\n", dev_name ? dev_name : "默认设备");
-    printf("TCP端口: %d\n", port);
-    printf("GID索引: %d\n", gid_idx);
-    printf("QP数量: %u\n", num_qp);
-    printf("========================================\n");
+/* 创建非阻塞监听socket并和completion channel一起加入epoll */
+static int srv_listen(struct rdma_server *srv, int port) {
+    struct sockaddr_in sin;
+    struct epoll_event ev;
+    int optval = 1;
 
-    /* ===== 第一阶段: 初始化RDMA资源 ===== */
-    if (init_rdma_resources(&res, dev_name, ib_port, gid_idx, num_qp)) {
-        fprintf(stderr, "初始化RDMA资源失败\n");
-        return 1;
+    srv->listen_sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (srv->listen_sock < 0) {
+        fprintf(stderr, "错误: 创建socket失败\n");
+        return -1;
     }
+    setsockopt(srv->listen_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
 
-    /* 创建多个QP */
-    if (create_qp_list(&res)) {
-        fprintf(stderr, "创建多个QP失败\n");
-        rc = 1;
-        goto cleanup;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = INADDR_ANY;
+    sin.sin_port = htons(port);
+    if (bind(srv->listen_sock, (struct sockaddr *)&sin, sizeof(sin)) < 0 ||
+        listen(srv->listen_sock, SOMAXCONN) < 0) {
+        fprintf(stderr, "错误: 绑定/监听端口%d失败: %s\n", port, strerror(errno));
+        return -1;
     }
 
-    /* 修改多个QP状态到INIT */
-    if (modify_qp_list_to_init(&res)) {
-        fprintf(stderr, "修改多个QP到INIT失败\n");
-        rc = 1;
-        goto cleanup;
+    srv->epfd = epoll_create1(0);
+    if (srv->epfd < 0) {
+        fprintf(stderr, "错误: 创建epoll失败\n");
+        return -1;
     }
-
-    /* 打印各QP的INIT状态 */
-    for (i = 0; i < res.num_qp; i++) {
-        print_qp_state(&res, i, "INIT状态");
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = SRV_EV_LISTEN;
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->listen_sock, &ev)) {
+        return -1;
     }
+    ev.data.u32 = SRV_EV_CQ;
+    return epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->shared.comp_channel->fd, &ev);
+}
 
-    /* ===== 第二阶段: 准备连接信息 ===== */
-    printf("\n========== 准备本地连接信息 ==========\n");
+/* 清空一个池CQ，返回取到的完成事件数 */
+static int srv_drain_cq(struct rdma_server *srv, struct ibv_cq *cq) {
+    struct ibv_wc wc[SRV_POLL_BATCH];
+    int total = 0;
+    int n;
+    int i;
 
-    /* 分配本地和远端连接信息数组 */
-    local_con_data = malloc(sizeof(struct cm_con_data_t) * num_qp);
-    remote_con_data = malloc(sizeof(struct cm_con_data_t) * MAX_QP);
-    if (!local_con_data || !remote_con_data) {
-        fprintf(stderr, "分配连接信息数组失败\n");
-        rc = 1;
-        goto cleanup;
+    while ((n = ibv_poll_cq(cq, SRV_POLL_BATCH, wc)) > 0) {
+        for (i = 0; i < n; i++) {
+            srv_dispatch_wc(srv, &wc[i]);
+        }
+        total += n;
     }
-
-    /* 获取本地GID */
-    if (ibv_query_gid(res.context, res.ib_port, gid_idx, &my_gid)) {
-        fprintf(stderr, "查询GID失败\n");
-        rc = 1;
-        goto cleanup;
+    if (n < 0) {
+        fprintf(stderr, "错误: 轮询池CQ失败\n");
     }
+    return total;
+}
 
-    /* 填充所有本地QP的连接信息 */
-    for (i = 0; i < res.num_qp; i++) {
-        memset(&local_con_data[i], 0, sizeof(struct cm_con_data_t));
-        local_con_data[i].qp_num = res.qp_list[i]->qp_num;
-        local_con_data[i].lid = res.port_attr.lid;
-        memcpy(local_con_data[i].gid, &my_gid, 16);
-
-        printf("本地QP[%u]连接信息:\n", i);
-        printf("  - QP号: 0x%06x\n", local_con_data[i].qp_num);
-        printf("  - LID: 0x%04x\n", local_con_data[i].lid);
-        printf("  - GID: ");
-        print_gid(&my_gid);
-        printf("\n");
+/* completion channel可读：取出所有事件，每个CQ先清空再重新武装再清空，避免丢通知 */
+static int srv_handle_cq_events(struct rdma_server *srv) {
+    struct ibv_cq *cq;
+    void *ctx;
+    int total = 0;
+
+    while (ibv_get_cq_event(srv->shared.comp_channel, &cq, &ctx) == 0) {
+        ibv_ack_cq_events(cq, 1);
+        total += srv_drain_cq(srv, cq);
+        ibv_req_notify_cq(cq, 0);
+        total += srv_drain_cq(srv, cq);
     }
+    return total;
+}
 
-    /* ===== 第三阶段: TCP连接，交换多QP信息 ===== */
-    printf("\n========== TCP连接阶段 ==========\n");
+static int srv_poll_all(struct rdma_server *srv) {
+    int total = 0;
+    uint32_t i;
 
-    /* 创建TCP监听socket */
-    listen_sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (listen_sock < 0) {
-        fprintf(stderr, "创建socket失败\n");
-        rc = 1;
-        goto cleanup;
+    for (i = 0; i < srv->num_cq; i++) {
+        total += srv_drain_cq(srv, srv->cqs[i].cq);
     }
+    return total;
+}
 
-    /* 设置socket选项，允许地址重用 */
-    int optval = 1;
-    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
-
-    /* 绑定端口 */
-    struct sockaddr_in sin;
-    memset(&sin, 0, sizeof(sin));
-    sin.sin_family = AF_INET;
-    sin.sin_addr.s_addr = INADDR_ANY;
-    sin.sin_port = htons(port);
+/* 事件循环，收到停止信号或监听socket出错时返回 */
+static int srv_run(struct rdma_server *srv) {
+    struct epoll_event evs[SRV_EPOLL_EVENTS];
+    uint64_t last_active = monotonic_ns() / 1000;
+    int timeout;
+    int n;
+    int i;
+
+    while (!g_stop) {
+        /* busy不睡眠；event直接阻塞；hybrid在最近有活动的自旋预算内不睡眠 */
+        timeout = -1;
+        if (srv->poll_mode == POLL_MODE_BUSY ||
+            (srv->poll_mode == POLL_MODE_HYBRID &&
+             monotonic_ns() / 1000 - last_active < DEFAULT_SPIN_BUDGET_US)) {
+            timeout = 0;
+        }
 
-    if (bind(listen_sock, (struct sockaddr *)&sin, sizeof(sin)) < 0) {
-        fprintf(stderr, "绑定端口失败\n");
-        rc = 1;
-        goto cleanup;
+        n = epoll_wait(srv->epfd, evs, SRV_EPOLL_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "错误: epoll_wait失败: %s\n", strerror(errno));
+            return -1;
+        }
+        for (i = 0; i < n; i++) {
+            if (evs[i].data.u32 == SRV_EV_LISTEN) {
+                if (srv_accept(srv)) {
+                    return -1;
+                }
+            } else if (evs[i].data.u32 == SRV_EV_CQ) {
+                srv_handle_cq_events(srv);
+            } else {
+                srv_client_io(srv, evs[i].data.u32, evs[i].events);
+            }
+        }
+        /* 不睡眠的轮次直接轮询CQ，不依赖完成通知 */
+        if ((timeout == 0 && srv_poll_all(srv) > 0) || n > 0) {
+            last_active = monotonic_ns() / 1000;
+        }
+        srv_reap(srv);
     }
+    return 0;
+}
 
-    /* 监听连接 */
-    listen(listen_sock, 1);
-    printf("等待客户端连接 (端口: %d)...\n", port);
+static void srv_cleanup(struct rdma_server *srv) {
+    uint32_t i;
 
-    /* 接受连接 */
-    sock = accept(listen_sock, NULL, NULL);
-    if (sock < 0) {
-        fprintf(stderr, "接受连接失败\n");
-        rc = 1;
-        goto cleanup;
+    for (i = 0; i < SRV_MAX_CLIENTS; i++) {
+        if (srv->clients[i]) {
+            srv_client_close(srv, srv->clients[i]);
+        }
     }
-    printf("客户端已连接\n");
-
-    /* 通过TCP交换多QP连接信息 */
-    printf("\n========== 交换多QP连接信息 ==========\n");
-    if (sock_sync_data_multi(sock, local_con_data, res.num_qp, 
-                             remote_con_data, &remote_num_qp)) {
-        fprintf(stderr, "交换连接信息失败\n");
-        rc = 1;
-        goto cleanup;
+    for (i = 0; i < srv->num_cq; i++) {
+        ibv_destroy_cq(srv->cqs[i].cq);
     }
-
-    if (remote_num_qp != res.num_qp) {
-        fprintf(stderr, "警告: 远端QP数量(%u)与本端不匹配(%u)\n", 
-                remote_num_qp, res.num_qp);
+    qpn_map_destroy(&srv->qpns);
+    if (srv->epfd >= 0) {
+        close(srv->epfd);
     }
-
-    for (i = 0; i < remote_num_qp; i++) {
-        printf("远端QP[%u]连接信息:\n", i);
-        printf("  - QP号: 0x%06x\n", remote_con_data[i].qp_num);
-        printf("  - LID: 0x%04x\n", remote_con_data[i].lid);
-        printf("  - GID: ");
-        union ibv_gid remote_gid;
-        memcpy(&remote_gid, remote_con_data[i].gid, 16);
-        print_gid(&remote_gid);
-        printf("\n");
+    if (srv->listen_sock >= 0) {
+        close(srv->listen_sock);
     }
+    cleanup_rdma_resources(&srv->shared);
+}
 
-    /* ===== 第四阶段: 建立多个RDMA连接 ===== */
-    /* 修改多个QP状态: INIT -> RTR */
-    if (modify_qp_list_to_rtr(&res, remote_con_data)) {
-        fprintf(stderr, "修改多个QP到RTR失败\n");
-        rc = 1;
-        goto cleanup;
-    }
+int main(int argc, char *argv[]) {
+    static struct rdma_server srv;
+    struct rdma_config cfg;
+    struct sigaction sa;
+    int port = DEFAULT_PORT;
+    uint32_t max_qp = 64;
+    uint32_t num_cq = SRV_CQ_POOL_DEFAULT;
+    uint32_t i;
+    int rc = 0;
 
-    /* 打印各QP的RTR状态 */
-    for (i = 0; i < res.num_qp; i++) {
-        print_qp_state(&res, i, "RTR状态");
-    }
+    rdma_config_init(&cfg);
+    /* 共享资源只提供设备、PD和completion channel，自带的1个QP不使用 */
+    cfg.num_qp = 1;
+    cfg.max_sge = 1;
+    /* 服务端大部分时间空闲，默认先短暂自旋再睡眠，避免空转占满CPU */
+    srv.poll_mode = POLL_MODE_HYBRID;
 
-    /* 修改多个QP状态: RTR -> RTS */
-    if (modify_qp_list_to_rts(&res)) {
-        fprintf(stderr, "修改多个QP到RTS失败\n");
-        rc = 1;
-        goto cleanup;
+    /* 解析命令行参数: [设备] [端口] [GID] [每客户端QP上限] [轮询模式] [CQ数] */
+    if (argc >= 2) {
+        cfg.dev_name = argv[1];
     }
-
-    printf("\n========== 多个RDMA连接已建立 ==========\n");
-
-    /* 打印各QP的RTS状态 */
-    for (i = 0; i < res.num_qp; i++) {
-        print_qp_state(&res, i, "RTS状态（RDMA连接已建立）");
+    if (argc >= 3) {
+        port = atoi(argv[2]);
+    }
+    if (argc >= 4) {
+        cfg.gid_idx = atoi(argv[3]);
+    }
+    if (argc >= 5) {
+        max_qp = (uint32_t)atoi(argv[4]);
+    }
+    if (argc >= 6 && parse_poll_mode(argv[5], &srv.poll_mode)) {
+        fprintf(stderr, "无效的轮询模式: %s (可选: busy|event|hybrid)\n", argv[5]);
+        return 1;
+    }
+    if (argc >= 7) {
+        num_cq = (uint32_t)atoi(argv[6]);
+    }
+    if (max_qp == 0 || max_qp > SRV_MAX_QP_LIMIT || num_cq == 0 || num_cq > SRV_CQ_POOL_MAX) {
+        fprintf(stderr, "错误: 每客户端QP上限须在[1-%d]，CQ数须在[1-%d]\n",
+                SRV_MAX_QP_LIMIT, SRV_CQ_POOL_MAX);
+        return 1;
     }
 
-    /* ===== 第五阶段: 多QP RDMA数据传输 ===== */
-    printf("\n========== 开始多QP RDMA数据传输 ==========\n");
+    printf("========== RDMA服务端 - RoCEv2多客户端学习程序 ==========\n");
+    printf("设备: %s\n", cfg.dev_name ? cfg.dev_name : "默认设备");
+    printf("TCP端口: %d\n", port);
+    printf("GID索引: %d\n", cfg.gid_idx);
+    printf("每客户端QP上限: %u\n", max_qp);
+    printf("轮询模式: %s\n", poll_mode_str(srv.poll_mode));
+    printf("========================================\n");
 
-    /* 预先投递所有QP的Receive请求 */
-    printf("投递所有QP的Receive请求到RQ...\n");
-    if (post_receive_all(&res)) {
-        fprintf(stderr, "Post Receive失败\n");
-        rc = 1;
-        goto cleanup;
+    srv.epfd = -1;
+    srv.listen_sock = -1;
+    srv.max_qp = max_qp;
+    for (i = 0; i < SRV_MAX_CLIENTS; i++) {
+        srv.free_slots[i] = SRV_MAX_CLIENTS - 1 - i;
     }
+    srv.num_free = SRV_MAX_CLIENTS;
 
-    /* 通过TCP同步，确保客户端准备好发送 */
-    char temp = 'R';
-    if (write(sock, &temp, 1) != 1) {
-        fprintf(stderr, "TCP同步失败\n");
-        rc = 1;
-        goto cleanup;
+    if (init_rdma_resources_cfg(&srv.shared, &cfg)) {
+        fprintf(stderr, "初始化RDMA资源失败\n");
+        return 1;
     }
-    printf("通知客户端：服务端已准备好接收\n");
+    /* 每个客户端QP只承载一收一发，浅队列让CQ池容纳更多客户端 */
+    srv.shared.sq_depth = SRV_QP_DEPTH;
+    srv.shared.rq_depth = SRV_QP_DEPTH;
 
-    /* 等待接收所有QP的完成 */
-    printf("等待接收 %u 个QP的数据...\n", res.num_qp);
-    if (poll_completion(&res, res.num_qp, NULL)) {
-        fprintf(stderr, "等待接收完成失败\n");
+    if (srv_create_cq_pool(&srv, num_cq) ||
+        qpn_map_init(&srv.qpns, SRV_MAX_CLIENTS * max_qp) || srv_listen(&srv, port)) {
         rc = 1;
         goto cleanup;
     }
 
-    printf("\n========== 接收成功 ==========\n");
-    printf("接收到的数据: %s\n", res.buf);
-    printf("数据长度: %zu 字节\n", strlen(res.buf));
-
-    /* 准备回复数据 */
-    snprintf(res.buf, res.buf_size, "服务端收到，这是回复消息！");
-    printf("\n准备发送回复: %s\n", res.buf);
-
-    /* 发送回复到所有QP */
-    printf("投递所有QP的Send请求...\n");
-    for (i = 0; i < res.num_qp; i++) {
-        if (post_send_qp(&res, i, IBV_WR_SEND)) {
-            fprintf(stderr, "Post Send到QP[%u]失败\n", i);
-            rc = 1;
-            goto cleanup;
-        }
-    }
+    /* 不设SA_RESTART，信号到来时epoll_wait返回EINTR */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = srv_on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
 
-    /* 等待所有发送完成 */
-    if (poll_completion(&res, res.num_qp, NULL)) {
-        fprintf(stderr, "等待发送完成失败\n");
+    printf("等待客户端连接 (端口: %d)，Ctrl+C退出...\n", port);
+    if (srv_run(&srv)) {
         rc = 1;
-        goto cleanup;
     }
 
-    printf("\n========== 发送成功 ==========\n");
-    printf("多QP RDMA通信完成！\n");
-
 cleanup:
-    /* 清理资源 */
-    if (local_con_data) {
-        free(local_con_data);
-    }
-    if (remote_con_data) {
-        free(remote_con_data);
-    }
-    if (sock >= 0) {
-        close(sock);
-    }
-    if (listen_sock >= 0) {
-        close(listen_sock);
-    }
-    cleanup_rdma_resources(&res);
-
-    printf("\n========================================\n");
-    printf("   服务端程序结束\n");
-    printf("========================================\n");
-
+    printf("\n累计接受连接: %llu，完成服务: %llu\n",
+           (unsigned long long)srv.accepted, (unsigned long long)srv.served);
+    srv_cleanup(&srv);
+    printf("\n========== 服务端程序结束 ==========\n");
     return rc;
 }
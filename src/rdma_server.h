@@ -0,0 +1,157 @@
+/**
+ * @file rdma_server.h
+ * @brief 多客户端RDMA服务端：epoll事件循环、非阻塞握手、共享设备的每客户端会话
+ *
+ * 服务端常驻运行，一个epoll实例同时等待三类fd：
+ * - 非阻塞监听socket：可读时循环accept直到EAGAIN，backlog为SOMAXCONN
+ * - 每个客户端的非阻塞TCP socket：按状态机推进握手，读写都可能只完成一部分
+ * - 共享completion channel：CQ池中任一CQ有完成事件时可读
+ *
+ * 所有客户端共享一个设备上下文、PD和completion channel（srv.shared），
+ * CQ池中的每个CQ由多个客户端共用，新客户端放到剩余容量最多的CQ上；
+ * 每个客户端拥有自己的QP和缓冲区（见rdma_common_session.h）。
+ * 完成事件按wc->qp_num在qpn_map中找到所属客户端，再交给poll_dispatch_wc()。
+ *
+ * 单个客户端的协议与rdma_client.c一致：
+ * 1. 客户端发送 num_qp + cm_con_data_t[num_qp]
+ * 2. 服务端创建同样数量的QP并迁移到RTS、投递RECV，回复
+ *    num_qp + cm_con_data_t[num_qp] + 就绪字节'R'
+ * 3. 客户端在每个QP上SEND一条消息，服务端全部收到后在每个QP上回复
+ * 4. 回复全部完成后服务端释放该客户端的QP和缓冲区并关闭连接
+ *
+ * @see rdma_server.c, rdma_server_conn.c, rdma_server_session.c
+ */
+
+#ifndef RDMA_SERVER_H
+#define RDMA_SERVER_H
+
+#include "rdma_common.h"
+#include "rdma_common_session.h"
+#include "rdma_common_poll.h"
+
+#define SRV_MAX_CLIENTS      1024          /* 同时服务的客户端数上限 */
+#define SRV_CQ_POOL_DEFAULT  4             /* 默认CQ池大小 */
+#define SRV_CQ_POOL_MAX      64            /* CQ池大小上限 */
+#define SRV_CQ_ENTRIES       16384         /* 每个池CQ的容量，按设备max_cqe裁剪 */
+#define SRV_QP_DEPTH         4             /* 每个客户端QP的发送/接收队列深度 */
+#define SRV_EV_LISTEN        0xffffffffu   /* epoll数据：监听socket */
+#define SRV_EV_CQ            0xfffffffeu   /* epoll数据：completion channel */
+
+/**
+ * 客户端状态
+ */
+enum srv_client_state {
+    SRV_CLIENT_RECV_HDR = 0,           /* 读取客户端QP数 */
+    SRV_CLIENT_RECV_QP,                /* 读取客户端QP连接信息 */
+    SRV_CLIENT_SEND,                   /* 发送本端连接信息和就绪字节 */
+    SRV_CLIENT_ACTIVE,                 /* 等待RDMA收发完成 */
+    SRV_CLIENT_DONE                    /* 已完成或出错，等待回收 */
+};
+
+/**
+ * CQ池中的一个CQ
+ */
+struct srv_cq {
+    struct ibv_cq *cq;
+    uint32_t cqe;                      /* 容量 */
+    uint32_t reserved;                 /* 已预留给客户端的CQE数 */
+};
+
+struct rdma_server;
+
+/**
+ * 一个客户端连接
+ */
+struct srv_client {
+    struct rdma_server *srv;
+    uint32_t slot;                     /* 在srv->clients中的下标，也是qpn_map的值 */
+    int sock;                          /* 非阻塞TCP socket */
+    enum srv_client_state state;
+    uint32_t num_qp;                   /* 客户端的QP数（RECV_HDR阶段读入） */
+    char *io_buf;                      /* RECV_QP阶段的接收缓冲区或SEND阶段的发送缓冲区 */
+    uint32_t io_len;                   /* io_buf中本阶段要读/写的字节数 */
+    uint32_t io_off;                   /* 本阶段已读/写的字节数 */
+    int want_out;                      /* 已在epoll中关注EPOLLOUT */
+    struct rdma_resources res;         /* 本客户端的QP和缓冲区，设备/PD/CQ借用 */
+    struct srv_cq *cq;                 /* 所在的池CQ，NULL表示尚未建链 */
+    uint32_t cqe;                      /* 在cq上预留的CQE数 */
+    uint32_t recvs;                    /* 已收到的消息数 */
+    uint32_t sends;                    /* 已完成的回复数 */
+    uint64_t accept_us;                /* accept时刻，用于统计握手耗时 */
+};
+
+/**
+ * 服务端状态
+ */
+struct rdma_server {
+    struct rdma_resources shared;      /* 共享的设备上下文、PD和completion channel */
+    int epfd;
+    int listen_sock;
+    uint32_t max_qp;                   /* 每个客户端的QP数上限 */
+    enum poll_mode poll_mode;          /* busy: epoll不睡眠；event: 阻塞；hybrid: 先自旋再阻塞 */
+    struct srv_cq cqs[SRV_CQ_POOL_MAX];
+    uint32_t num_cq;
+    struct qpn_map qpns;               /* qp_num -> 客户端slot */
+    struct srv_client *clients[SRV_MAX_CLIENTS];
+    uint32_t free_slots[SRV_MAX_CLIENTS];
+    uint32_t num_free;
+    uint32_t reap[SRV_MAX_CLIENTS];    /* 本轮事件处理中进入DONE的客户端 */
+    uint32_t num_reap;
+    uint64_t accepted;                 /* 累计接受的连接数 */
+    uint64_t served;                   /* 累计完成的客户端数 */
+};
+
+/**
+ * 标记客户端结束并放入回收列表，本轮事件处理结束后由srv_reap()释放
+ */
+static inline void srv_client_done(struct rdma_server *srv, struct srv_client *c) {
+    if (c->state != SRV_CLIENT_DONE) {
+        c->state = SRV_CLIENT_DONE;
+        srv->reap[srv->num_reap++] = c->slot;
+    }
+}
+
+/**
+ * 接受所有排队的连接，直到accept返回EAGAIN
+ *
+ * @return    成功返回0，监听socket出错返回-1
+ */
+int srv_accept(struct rdma_server *srv);
+
+/**
+ * 推进客户端的握手状态机
+ *
+ * @param[in] srv     服务端
+ * @param[in] slot    客户端slot
+ * @param[in] events  epoll事件
+ *
+ * @note      出错或对端关闭时客户端进入DONE，由srv_reap()回收
+ */
+void srv_client_io(struct rdma_server *srv, uint32_t slot, uint32_t events);
+
+/**
+ * 收齐客户端连接信息（c->io_buf）后建立会话
+ *
+ * 从CQ池中选剩余容量最多的CQ，创建num_qp个QP并迁移到RTS、投递RECV，
+ * 把本端连接信息和就绪字节放入c->io_buf，状态切换为SEND。
+ *
+ * @return    成功返回0，失败返回-1（已分配的部分由srv_client_close()释放）
+ */
+int srv_client_connect(struct rdma_server *srv, struct srv_client *c);
+
+/**
+ * 分发池CQ上的一个完成事件，不属于任何在线客户端的完成事件被丢弃
+ */
+void srv_dispatch_wc(struct rdma_server *srv, const struct ibv_wc *wc);
+
+/**
+ * 回收本轮进入DONE状态的客户端
+ */
+void srv_reap(struct rdma_server *srv);
+
+/**
+ * 关闭并释放一个客户端（释放QP、缓冲区、CQ预留、slot）
+ */
+void srv_client_close(struct rdma_server *srv, struct srv_client *c);
+
+#endif /* RDMA_SERVER_H */
@@ -0,0 +1,186 @@
+/**
+ * @file rdma_server_conn.c
+ * @brief 服务端的客户端连接管理：accept、非阻塞TCP握手状态机、客户端回收
+ */
+
+#define _GNU_SOURCE
+#include "rdma_server.h"
+
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+
+static int srv_epoll_ctl(struct rdma_server *srv, struct srv_client *c, int op, uint32_t events) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u32 = c->slot;
+    return epoll_ctl(srv->epfd, op, c->sock, &ev);
+}
+
+int srv_accept(struct rdma_server *srv) {
+    struct srv_client *c;
+    int one = 1;
+    int sock;
+
+    for (;;) {
+        sock = accept4(srv->listen_sock, NULL, NULL, SOCK_NONBLOCK);
+        if (sock < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            fprintf(stderr, "警告: accept失败: %s\n", strerror(errno));
+            return errno == EMFILE || errno == ENFILE ? 0 : -1;
+        }
+        if (srv->num_free == 0 || !(c = calloc(1, sizeof(*c)))) {
+            fprintf(stderr, "警告: 客户端数已达上限%d，拒绝新连接\n", SRV_MAX_CLIENTS);
+            close(sock);
+            continue;
+        }
+        /* 握手是几个小包的来回，关闭Nagle避免等待合并 */
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        c->srv = srv;
+        c->sock = sock;
+        c->slot = srv->free_slots[--srv->num_free];
+        c->state = SRV_CLIENT_RECV_HDR;
+        c->io_len = sizeof(c->num_qp);
+        c->accept_us = monotonic_ns() / 1000;
+        srv->clients[c->slot] = c;
+        srv->accepted++;
+
+        if (srv_epoll_ctl(srv, c, EPOLL_CTL_ADD, EPOLLIN)) {
+            srv_client_close(srv, c);
+        }
+    }
+}
+
+/* 一个阶段的读/写完成后进入下一阶段 */
+static int srv_client_next(struct rdma_server *srv, struct srv_client *c) {
+    switch (c->state) {
+        case SRV_CLIENT_RECV_HDR:
+            if (c->num_qp == 0 || c->num_qp > srv->max_qp) {
+                fprintf(stderr, "错误: 客户端[%u]请求%u个QP，超出范围[1-%u]\n",
+                        c->slot, c->num_qp, srv->max_qp);
+                return -1;
+            }
+            c->io_len = c->num_qp * sizeof(struct cm_con_data_t);
+            c->io_off = 0;
+            c->io_buf = malloc(c->io_len);
+            c->state = SRV_CLIENT_RECV_QP;
+            return c->io_buf ? 0 : -1;
+        case SRV_CLIENT_RECV_QP:
+            return srv_client_connect(srv, c);
+        case SRV_CLIENT_SEND:
+            free(c->io_buf);
+            c->io_buf = NULL;
+            c->state = SRV_CLIENT_ACTIVE;
+            printf("客户端[%u]: 已建立%u个QP (握手%llu us, 在线%u)\n", c->slot, c->num_qp,
+                   (unsigned long long)(monotonic_ns() / 1000 - c->accept_us),
+                   SRV_MAX_CLIENTS - srv->num_free);
+            return c->want_out ? srv_epoll_ctl(srv, c, EPOLL_CTL_MOD, EPOLLIN) : 0;
+        default:
+            return -1;
+    }
+}
+
+/* 非阻塞地推进本阶段的读/写：1完成，0等待fd就绪，-1出错或对端关闭 */
+static int srv_client_xfer(struct srv_client *c) {
+    char *buf = c->state == SRV_CLIENT_RECV_HDR ? (char *)&c->num_qp : c->io_buf;
+    ssize_t n;
+
+    while (c->io_off < c->io_len) {
+        if (c->state == SRV_CLIENT_SEND) {
+            n = send(c->sock, buf + c->io_off, c->io_len - c->io_off, MSG_NOSIGNAL);
+        } else {
+            n = recv(c->sock, buf + c->io_off, c->io_len - c->io_off, 0);
+        }
+        if (n > 0) {
+            c->io_off += (uint32_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+    }
+    return 1;
+}
+
+void srv_client_io(struct rdma_server *srv, uint32_t slot, uint32_t events) {
+    struct srv_client *c = slot < SRV_MAX_CLIENTS ? srv->clients[slot] : NULL;
+    ssize_t n;
+    char byte;
+    int rc;
+
+    if (!c || c->state == SRV_CLIENT_DONE) {
+        return;
+    }
+    /* 握手完成后客户端不再发TCP数据，可读只意味着对端关闭 */
+    if (c->state == SRV_CLIENT_ACTIVE || (events & EPOLLERR)) {
+        n = (events & EPOLLERR) ? -1 : recv(c->sock, &byte, 1, 0);
+        if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EINTR))) {
+            return;
+        }
+        if (c->recvs == c->num_qp && !(events & EPOLLERR)) {
+            /* 客户端收到回复就会关闭连接，本端SEND完成可能稍后才到，不再关注该fd */
+            epoll_ctl(srv->epfd, EPOLL_CTL_DEL, c->sock, NULL);
+            return;
+        }
+        fprintf(stderr, "警告: 客户端[%u]在RDMA收发完成前断开\n", c->slot);
+        srv_client_done(srv, c);
+        return;
+    }
+
+    while ((rc = srv_client_xfer(c)) == 1) {
+        if (srv_client_next(srv, c)) {
+            rc = -1;
+            break;
+        }
+        if (c->state == SRV_CLIENT_ACTIVE) {
+            return;
+        }
+    }
+    if (rc < 0) {
+        srv_client_done(srv, c);
+    } else if (c->state == SRV_CLIENT_SEND && !c->want_out) {
+        /* 发送缓冲区满了才关注EPOLLOUT，避免每个连接都多一次epoll_ctl */
+        c->want_out = 1;
+        if (srv_epoll_ctl(srv, c, EPOLL_CTL_MOD, EPOLLIN | EPOLLOUT)) {
+            srv_client_done(srv, c);
+        }
+    }
+}
+
+void srv_client_close(struct rdma_server *srv, struct srv_client *c) {
+    uint32_t i;
+
+    for (i = 0; c->res.qp_list && i < c->res.num_qp; i++) {
+        if (c->res.qp_list[i]) {
+            qpn_map_del(&srv->qpns, c->res.qp_list[i]->qp_num);
+        }
+    }
+    session_res_cleanup(&c->res);
+    if (c->cq) {
+        c->cq->reserved -= c->cqe;
+    }
+    /* close()同时把fd从epoll中移除 */
+    close(c->sock);
+    free(c->io_buf);
+    srv->clients[c->slot] = NULL;
+    srv->free_slots[srv->num_free++] = c->slot;
+    free(c);
+}
+
+void srv_reap(struct rdma_server *srv) {
+    uint32_t i;
+
+    for (i = 0; i < srv->num_reap; i++) {
+        if (srv->clients[srv->reap[i]]) {
+            srv_client_close(srv, srv->clients[srv->reap[i]]);
+        }
+    }
+    srv->num_reap = 0;
+}
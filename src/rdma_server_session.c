@@ -0,0 +1,123 @@
+/**
+ * @file rdma_server_session.c
+ * @brief 服务端的客户端会话：CQ池分配、QP建链、完成事件分发和回复
+ */
+
+#include "rdma_server.h"
+#include "rdma_common_bringup.h"
+#include "rdma_common_poll.h"
+#include "rdma_common_post.h"
+
+/* 选剩余容量最多的池CQ，容量不足时返回NULL */
+static struct srv_cq *srv_pick_cq(struct rdma_server *srv, uint32_t need) {
+    struct srv_cq *best = NULL;
+    uint32_t i;
+
+    for (i = 0; i < srv->num_cq; i++) {
+        struct srv_cq *q = &srv->cqs[i];
+
+        if (q->cqe - q->reserved >= need &&
+            (!best || q->cqe - q->reserved > best->cqe - best->reserved)) {
+            best = q;
+        }
+    }
+    return best;
+}
+
+/* 收齐所有QP的消息后在每个QP上回复，回复全部完成后客户端结束 */
+static void srv_client_reply(struct rdma_server *srv, struct srv_client *c) {
+    uint32_t i;
+
+    printf("客户端[%u]: 收到 %s\n", c->slot, c->res.buf);
+    snprintf(c->res.buf, c->res.buf_size, "服务端收到，这是回复消息！");
+    for (i = 0; i < c->num_qp; i++) {
+        if (post_send_qp_len(&c->res, i, IBV_WR_SEND, strlen(c->res.buf) + 1)) {
+            fprintf(stderr, "错误: 客户端[%u] Post Send到QP[%u]失败\n", c->slot, i);
+            srv_client_done(srv, c);
+            return;
+        }
+    }
+}
+
+/* 客户端QP的完成事件处理函数，错误只结束该客户端，不中断其他客户端的轮询 */
+static int srv_on_wc(struct rdma_resources *res, uint32_t qp_idx,
+                     const struct ibv_wc *wc, void *arg) {
+    struct srv_client *c = arg;
+
+    (void)res;
+    if (c->state == SRV_CLIENT_DONE) {
+        return 0;
+    }
+    if (wc->status != IBV_WC_SUCCESS) {
+        fprintf(stderr, "错误: 客户端[%u] QP[%u]完成状态异常: %s\n",
+                c->slot, qp_idx, ibv_wc_status_str(wc->status));
+        srv_client_done(c->srv, c);
+    } else if (wc->opcode & IBV_WC_RECV) {
+        if (++c->recvs == c->num_qp) {
+            srv_client_reply(c->srv, c);
+        }
+    } else if (++c->sends == c->num_qp) {
+        c->srv->served++;
+        srv_client_done(c->srv, c);
+    }
+    return 0;
+}
+
+int srv_client_connect(struct rdma_server *srv, struct srv_client *c) {
+    const struct cm_con_data_t *remote = (const struct cm_con_data_t *)c->io_buf;
+    uint32_t need = c->num_qp * (srv->shared.sq_depth + srv->shared.rq_depth);
+    struct cm_con_data_multi_t *msg;
+    uint32_t len = sizeof(*msg) + c->num_qp * sizeof(struct cm_con_data_t) + 1;
+    uint32_t i;
+
+    c->cq = srv_pick_cq(srv, need);
+    if (!c->cq) {
+        fprintf(stderr, "错误: CQ池容量不足，拒绝客户端[%u]的%u个QP\n", c->slot, c->num_qp);
+        return -1;
+    }
+    c->cq->reserved += need;
+    c->cqe = need;
+
+    msg = malloc(len);
+    if (!msg || session_res_init(&c->res, &srv->shared, c->cq->cq, c->num_qp, DEFAULT_MSG_SIZE) ||
+        fill_local_con_data(&c->res, msg->qp_data)) {
+        free(msg);
+        return -1;
+    }
+    for (i = 0; i < c->num_qp; i++) {
+        if (qpn_map_put(&srv->qpns, c->res.qp_list[i]->qp_num, c->slot) ||
+            register_wc_handler(&c->res, i, srv_on_wc, c) ||
+            qp_modify_rtr(&c->res, i, &remote[i]) || qp_modify_rts(&c->res, i)) {
+            free(msg);
+            return -1;
+        }
+    }
+    if (post_receive_all(&c->res)) {
+        free(msg);
+        return -1;
+    }
+
+    /* 连接信息之后紧跟就绪字节，客户端读完连接信息后直接读到它 */
+    msg->num_qp = c->num_qp;
+    ((char *)msg)[len - 1] = 'R';
+    free(c->io_buf);
+    c->io_buf = (char *)msg;
+    c->io_len = len;
+    c->io_off = 0;
+    c->state = SRV_CLIENT_SEND;
+    return 0;
+}
+
+void srv_dispatch_wc(struct rdma_server *srv, const struct ibv_wc *wc) {
+    struct srv_client *c;
+    uint32_t slot;
+
+    /* 查不到的是已关闭客户端在QP销毁前残留的完成事件 */
+    if (qpn_map_get(&srv->qpns, wc->qp_num, &slot)) {
+        return;
+    }
+    c = srv->clients[slot];
+    if (c && c->state != SRV_CLIENT_DONE && poll_dispatch_wc(&c->res, wc)) {
+        srv_client_done(srv, c);
+    }
+}
@@ -0,0 +1,257 @@
+/**
+ * @file fake_verbs.h
+ * @brief 单元测试用的假设备：通过ibv_context_ops接管ibv_poll_cq/ibv_post_send/ibv_post_recv
+ * @details ibv_poll_cq()、ibv_post_send()等是verbs.h中的内联函数，经
+ *          context->ops函数指针分发，把ops指向这里的实现即可在没有RDMA设备时
+ *          驱动真实的轮询/投递代码。每个测试程序一个全局假设备。
+ *          ibv_reg_mr()/ibv_create_qp()/ibv_modify_qp()等是库函数，这里直接提供
+ *          同名定义，链接时优先于libibverbs中的版本。只能被每个测试程序的一个源文件包含。
+ */
+
+#ifndef FAKE_VERBS_H
+#define FAKE_VERBS_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <infiniband/verbs.h>
+#include "../src/rdma_common.h"
+
+#define FAKE_CQ_DEPTH    64            /* 假CQ能排队的完成事件数 */
+#define FAKE_MAX_CHUNKS  8             /* 可预设的分批返回次数 */
+#define FAKE_MAX_QP      4
+#define FAKE_MAX_SENT    16            /* 记录的发送/接收WR数 */
+#define FAKE_SQ_DEPTH    8             /* 假QP的发送队列深度 */
+
+struct fake_dev {
+    struct ibv_context ctx;
+    struct ibv_pd pd;
+    struct ibv_cq cq;
+    struct ibv_qp qp[FAKE_MAX_QP];
+    int nqp;                           /* ibv_create_qp()已分出的QP数 */
+    int destroyed;                     /* ibv_destroy_qp()调用次数 */
+
+    /* 完成队列：[head, tail)待取出 */
+    struct ibv_wc wc[FAKE_CQ_DEPTH];
+    int head;
+    int tail;
+    int chunk[FAKE_MAX_CHUNKS];        /* 第k次非空ibv_poll_cq最多返回chunk[k]个，0表示不限 */
+    int nchunk;
+    int polls;                         /* 返回非空的ibv_poll_cq次数 */
+
+    /* 发送队列：记录每个WR及其SGE列表 */
+    struct ibv_send_wr sent[FAKE_MAX_SENT];
+    struct ibv_sge sent_sge[FAKE_MAX_SENT][MAX_SGE_LIMIT];
+    int nsent;
+    struct ibv_recv_wr recv[FAKE_MAX_SENT];
+    struct ibv_sge recv_sge[FAKE_MAX_SENT][MAX_SGE_LIMIT];
+    int nrecv;
+
+    uint32_t sig_ring[FAKE_MAX_QP][FAKE_SQ_DEPTH];
+
+    /* 每个QP迁移到各状态时最后一次传入的属性，按qp_state下标 */
+    struct ibv_qp_attr qp_attr[FAKE_MAX_QP][IBV_QPS_UNKNOWN + 1];
+};
+
+static struct fake_dev fake;
+
+/* 假MR注册：只分配ibv_mr并编号，不访问内存 */
+struct fake_mr_state {
+    int regs;                          /* 成功注册次数 */
+    int deregs;                        /* 注销次数 */
+    int fail;                          /* 非0时注册失败 */
+    uint32_t next_key;
+};
+
+static struct fake_mr_state fake_mr;
+
+struct ibv_mr *ibv_reg_mr_iova2(struct ibv_pd *pd, void *addr, size_t length,
+                                uint64_t iova, unsigned int access) {
+    struct ibv_mr *mr;
+
+    (void)iova;
+    (void)access;
+    if (fake_mr.fail || !(mr = calloc(1, sizeof(*mr)))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    mr->pd = pd;
+    mr->addr = addr;
+    mr->length = length;
+    mr->lkey = ++fake_mr.next_key;
+    mr->rkey = mr->lkey;
+    fake_mr.regs++;
+    return mr;
+}
+
+/* 括号阻止verbs.h中同名宏展开 */
+struct ibv_mr *(ibv_reg_mr)(struct ibv_pd *pd, void *addr, size_t length, int access) {
+    return ibv_reg_mr_iova2(pd, addr, length, (uintptr_t)addr, (unsigned int)access);
+}
+
+int ibv_dereg_mr(struct ibv_mr *mr) {
+    fake_mr.deregs++;
+    free(mr);
+    return 0;
+}
+
+/* 依次分出fake.qp[]，容量按请求原样授予 */
+struct ibv_qp *ibv_create_qp(struct ibv_pd *pd, struct ibv_qp_init_attr *qp_init_attr) {
+    struct ibv_qp *qp;
+
+    if (fake.nqp == FAKE_MAX_QP) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    qp = &fake.qp[fake.nqp++];
+    qp->pd = pd;
+    qp->send_cq = qp_init_attr->send_cq;
+    qp->recv_cq = qp_init_attr->recv_cq;
+    qp->qp_type = qp_init_attr->qp_type;
+    qp->state = IBV_QPS_RESET;
+    return qp;
+}
+
+int ibv_destroy_qp(struct ibv_qp *qp) {
+    (void)qp;
+    fake.destroyed++;
+    return 0;
+}
+
+/* QP状态迁移只记录属性，qp->state随之变化 */
+int ibv_modify_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr, int attr_mask) {
+    (void)attr_mask;
+    fake.qp_attr[qp - fake.qp][attr->qp_state] = *attr;
+    qp->state = attr->qp_state;
+    return 0;
+}
+
+int ibv_query_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr, int attr_mask,
+                 struct ibv_qp_init_attr *init_attr) {
+    (void)attr_mask;
+    (void)init_attr;
+    attr->qp_state = qp->state;
+    return 0;
+}
+
+int ibv_query_gid(struct ibv_context *context, uint8_t port_num, int index,
+                  union ibv_gid *gid) {
+    (void)context;
+    (void)port_num;
+    memset(gid, 0, sizeof(*gid));
+    gid->raw[15] = (uint8_t)index;
+    return 0;
+}
+
+static inline int fake_poll_cq(struct ibv_cq *cq, int num, struct ibv_wc *wc) {
+    int n = fake.tail - fake.head;
+    int limit;
+    int i;
+
+    (void)cq;
+    if (n > num) {
+        n = num;
+    }
+    limit = fake.polls < fake.nchunk ? fake.chunk[fake.polls] : 0;
+    if (limit > 0 && n > limit) {
+        n = limit;
+    }
+    for (i = 0; i < n; i++) {
+        wc[i] = fake.wc[fake.head++];
+    }
+    if (n > 0) {
+        fake.polls++;
+    }
+    return n;
+}
+
+static inline int fake_post_send(struct ibv_qp *qp, struct ibv_send_wr *wr,
+                                 struct ibv_send_wr **bad) {
+    int i;
+
+    (void)qp;
+    for (; wr; wr = wr->next) {
+        if (fake.nsent == FAKE_MAX_SENT || wr->num_sge > MAX_SGE_LIMIT) {
+            *bad = wr;
+            return -1;
+        }
+        fake.sent[fake.nsent] = *wr;
+        for (i = 0; i < wr->num_sge; i++) {
+            fake.sent_sge[fake.nsent][i] = wr->sg_list[i];
+        }
+        fake.sent[fake.nsent].sg_list = fake.sent_sge[fake.nsent];
+        fake.sent[fake.nsent].next = NULL;
+        fake.nsent++;
+    }
+    return 0;
+}
+
+static inline int fake_post_recv(struct ibv_qp *qp, struct ibv_recv_wr *wr,
+                                 struct ibv_recv_wr **bad) {
+    int i;
+
+    (void)qp;
+    for (; wr; wr = wr->next) {
+        if (fake.nrecv == FAKE_MAX_SENT || wr->num_sge > MAX_SGE_LIMIT) {
+            *bad = wr;
+            return -1;
+        }
+        fake.recv[fake.nrecv] = *wr;
+        for (i = 0; i < wr->num_sge; i++) {
+            fake.recv_sge[fake.nrecv][i] = wr->sg_list[i];
+        }
+        fake.recv[fake.nrecv].sg_list = fake.recv_sge[fake.nrecv];
+        fake.recv[fake.nrecv].next = NULL;
+        fake.nrecv++;
+    }
+    return 0;
+}
+
+/* 清空假设备，把res的PD、CQ和QP指向它 */
+static inline void fake_reset(struct rdma_resources *res, struct ibv_qp **qp_list,
+                              struct qp_ctx *qp_ctx, uint32_t num_qp) {
+    uint32_t i;
+
+    memset(&fake, 0, sizeof(fake));
+    fake.ctx.ops.poll_cq = fake_poll_cq;
+    fake.ctx.ops.post_send = fake_post_send;
+    fake.ctx.ops.post_recv = fake_post_recv;
+    fake.pd.context = &fake.ctx;
+    fake.cq.context = &fake.ctx;
+    for (i = 0; i < FAKE_MAX_QP; i++) {
+        fake.qp[i].context = &fake.ctx;
+        fake.qp[i].qp_num = 0x100 + i;
+    }
+
+    memset(res, 0, sizeof(*res));
+    memset(qp_ctx, 0, num_qp * sizeof(*qp_ctx));
+    for (i = 0; i < num_qp; i++) {
+        qp_list[i] = &fake.qp[i];
+        qp_ctx[i].sig_ring = fake.sig_ring[i];
+    }
+    res->context = &fake.ctx;
+    res->pd = &fake.pd;
+    res->cq = &fake.cq;
+    res->qp_list = qp_list;
+    res->qp_ctx = qp_ctx;
+    res->num_qp = num_qp;
+    res->poll_timeout_ms = 100;
+    res->poll_check_interval = 1;
+    res->poll_mode = POLL_MODE_BUSY;
+    res->signal_interval = 1;
+    res->sq_depth = FAKE_SQ_DEPTH;
+    res->max_sge = MAX_SGE_LIMIT;
+}
+
+/* 向假CQ追加一个成功的完成事件 */
+static inline void fake_push_wc(uint32_t qp_idx, uint32_t tag, enum ibv_wc_opcode opcode) {
+    struct ibv_wc *wc = &fake.wc[fake.tail++];
+
+    memset(wc, 0, sizeof(*wc));
+    wc->wr_id = WR_ID_MAKE(qp_idx, tag);
+    wc->status = IBV_WC_SUCCESS;
+    wc->opcode = opcode;
+    wc->qp_num = fake.qp[qp_idx].qp_num;
+}
+
+#endif /* FAKE_VERBS_H */
@@ -0,0 +1,97 @@
+/**
+ * @file test_rdma_bench_hist.c
+ * @brief rdma_bench_hist 模块单元测试
+ * @details 测试对数分桶直方图的桶映射、百分位和平均值计算
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../src/rdma_bench_hist.h"
+
+/**
+ * 测试套件：桶映射
+ */
+void test_hist_buckets(void)
+{
+    printf("\n--- 测试桶映射 ---\n");
+
+    /* 精确区间内每个值一个桶 */
+    ASSERT_EQ(0, hist_bucket_index(0), "0应落在第0个桶");
+    ASSERT_EQ(HIST_EXACT - 1, hist_bucket_index(HIST_EXACT - 1), "精确区间上界应一一对应");
+    ASSERT_EQ(HIST_EXACT, hist_bucket_index(HIST_EXACT), "第一个对数桶紧接精确区间");
+
+    /* 最大值不越界 */
+    ASSERT_EQ(HIST_BUCKETS - 1, hist_bucket_index(UINT64_MAX), "UINT64_MAX应落在最后一个桶");
+
+    /* 下界反查：每个桶的下界都应映射回该桶 */
+    int ok = 1;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        if (hist_bucket_index(hist_bucket_lower(i)) != i) {
+            ok = 0;
+            break;
+        }
+    }
+    ASSERT_TRUE(ok, "所有桶的下界都应映射回自身");
+
+    /* 相对误差不超过1/HIST_SUB_COUNT */
+    uint64_t v = 1234567;
+    uint64_t lo = hist_bucket_lower(hist_bucket_index(v));
+    ASSERT_TRUE(lo <= v && (v - lo) * HIST_SUB_COUNT <= v, "量化误差应在1/64以内");
+}
+
+/**
+ * 测试套件：统计量
+ */
+void test_hist_stats(void)
+{
+    printf("\n--- 测试百分位和平均值 ---\n");
+
+    struct bench_hist *h = malloc(sizeof(*h));
+    ASSERT_NOT_NULL(h, "直方图应可分配");
+    if (!h) {
+        return;
+    }
+
+    hist_reset(h);
+    ASSERT_EQ(0, hist_percentile(h, 50.0), "空直方图百分位应为0");
+
+    /* 1..100 精确区间，百分位应精确 */
+    for (uint64_t i = 1; i <= 100; i++) {
+        hist_record(h, i);
+    }
+    ASSERT_EQ(100, h->total, "样本数应为100");
+    ASSERT_EQ(1, h->min, "最小值应为1");
+    ASSERT_EQ(100, h->max, "最大值应为100");
+    ASSERT_EQ(50, hist_percentile(h, 50.0), "p50应为50");
+    ASSERT_EQ(99, hist_percentile(h, 99.0), "p99应为99");
+    ASSERT_EQ(100, hist_percentile(h, 99.9), "p99.9应为100");
+    ASSERT_TRUE(hist_mean(h) > 50.49 && hist_mean(h) < 50.51, "平均值应为50.5");
+
+    /* 单一大值：百分位被限制在[min, max]内 */
+    hist_reset(h);
+    hist_record(h, 1000000);
+    ASSERT_EQ(1000000, hist_percentile(h, 50.0), "单样本的百分位应等于样本值");
+
+    free(h);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_bench_hist 模块单元测试         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_hist_buckets();
+    test_hist_stats();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
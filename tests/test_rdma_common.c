@@ -7,8 +7,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "../tests/utest.h"
 #include "../src/rdma_common.h"
+#include "../src/rdma_common_atomic.h"
+#include "../src/rdma_common_ring.h"
+#include "../src/rdma_common_srq.h"
 
 /**
  * 测试套件：RDMA资源初始化
@@ -40,8 +44,8 @@ void test_qp_parameters(void)
     ASSERT_TRUE(DEFAULT_NUM_QP > 0, "默认QP数应大于0");
     ASSERT_TRUE(DEFAULT_NUM_QP <= MAX_QP, "默认QP数不应超过最大值");
     
-    /* 测试最大QP数限制 */
-    ASSERT_EQ(16, MAX_QP, "最大QP数应为16");
+    /* 测试最大QP数限制：只用于参数校验，应支持上千个QP */
+    ASSERT_TRUE(MAX_QP >= 1024, "最大QP数应支持上千个QP");
     
     /* 测试CQ配置 */
     ASSERT_TRUE(CQ_SIZE > 0, "CQ大小应大于0");
@@ -70,7 +74,7 @@ void test_constants(void)
     /* 测试端口和默认参数 */
     ASSERT_EQ(18515, DEFAULT_PORT, "默认端口应为18515");
     ASSERT_EQ(4, DEFAULT_NUM_QP, "默认QP数应为4");
-    ASSERT_EQ(16, MAX_QP, "最大QP数应为16");
+    ASSERT_EQ(4, sizeof(struct cm_con_data_multi_t), "变长连接信息头部只有QP数");
     
     /* 测试缓冲区大小 */
     ASSERT_TRUE(DEFAULT_MSG_SIZE > 0, "消息大小应大于0");
@@ -105,6 +109,135 @@ void test_function_declarations(void)
     ASSERT_TRUE(1, "modify_qp_list_to_rts函数应被声明");
 }
 
+/**
+ * 测试套件：wr_id编码
+ */
+void test_wr_id_encoding(void)
+{
+    printf("\n--- 测试wr_id编码 ---\n");
+
+    uint64_t wr_id = WR_ID_MAKE(7, 0x1234);
+    ASSERT_EQ(7, WR_ID_QP(wr_id), "wr_id低32位应解码出QP索引");
+    ASSERT_EQ(0x1234, WR_ID_TAG(wr_id), "wr_id高32位应解码出标签");
+
+    /* 旧代码直接用qp_idx作为wr_id，编码后应保持兼容 */
+    ASSERT_TRUE(WR_ID_MAKE(3, 0) == 3, "标签为0时wr_id应等于QP索引");
+    ASSERT_EQ(0xffffffffu, WR_ID_TAG(WR_ID_MAKE(0, 0xffffffffu)), "标签应支持完整32位");
+
+    /* WRITE_WITH_IMM立即数：槽位号与长度互不干扰 */
+    uint32_t imm = IMM_MAKE(IMM_SLOT_MAX, IMM_LEN_MAX);
+    ASSERT_EQ(IMM_SLOT_MAX, IMM_SLOT(imm), "立即数应解码出最大槽位号");
+    ASSERT_EQ(IMM_LEN_MAX, IMM_LEN(imm), "立即数应解码出最大长度");
+    ASSERT_EQ(5, IMM_SLOT(IMM_MAKE(5, 4096)), "槽位号应独立于长度");
+    ASSERT_EQ(4096, IMM_LEN(IMM_MAKE(5, 4096)), "长度应独立于槽位号");
+    ASSERT_EQ(32, IMM_SLOT_BITS + IMM_LEN_BITS, "立即数应用满32位");
+
+    /* 轮询参数 */
+    ASSERT_TRUE(POLL_BATCH_SIZE > 1, "批量轮询大小应大于1");
+    ASSERT_TRUE(POLL_CHECK_INTERVAL > 0, "超时检查间隔应大于0");
+}
+
+/**
+ * 测试套件：连接信息布局
+ */
+void test_con_data_layout(void)
+{
+    printf("\n--- 测试连接信息布局 ---\n");
+
+    /* packed结构体直接按字节在TCP上传输，两端布局必须一致 */
+    ASSERT_EQ(39, sizeof(struct cm_con_data_t), "连接信息应为39字节(含addr/rkey/len/rd_atomic)");
+
+    struct cm_con_data_t con;
+    memset(&con, 0, sizeof(con));
+    con.addr = 0x123456789abcULL;
+    con.rkey = 0xdeadbeef;
+    con.len = 4096;
+    ASSERT_TRUE(con.addr == 0x123456789abcULL, "addr应能保存64位地址");
+    ASSERT_EQ(0xdeadbeefu, con.rkey, "rkey应完整保存");
+
+    /* 未交换前remote_len为0，表示对端未开放单边访问 */
+    struct qp_ctx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ASSERT_EQ(0, ctx.remote_len, "初始remote_len应为0");
+}
+
+/**
+ * 测试套件：原子槽位划分
+ */
+void test_atomic_slots(void)
+{
+    printf("\n--- 测试原子槽位划分 ---\n");
+
+    uint32_t base = 0;
+    ASSERT_EQ(0, atomic_slots_carve(4096, 4, &base), "4096字节应能放下4个槽位");
+    ASSERT_EQ(4064, base, "槽位应从缓冲区末尾划出");
+    ASSERT_EQ(4072, atomic_slot_off(base, 1), "相邻槽位间隔8字节");
+
+    /* 缓冲区大小不是8的倍数时向下对齐 */
+    ASSERT_EQ(0, atomic_slots_carve(4100, 2, &base), "4100字节应能放下2个槽位");
+    ASSERT_EQ(0, base % ATOMIC_SLOT_SIZE, "槽位起始偏移应8字节对齐");
+    ASSERT_TRUE(base + 2 * ATOMIC_SLOT_SIZE <= 4100, "槽位不应越过缓冲区末尾");
+
+    ASSERT_EQ(-1, atomic_slots_carve(8, 2, &base), "缓冲区不足时应失败");
+    ASSERT_EQ(-1, atomic_slots_carve(4096, 0, &base), "槽位数为0时应失败");
+
+    /* MR和QP的访问权限：支持原子操作时两者都要带REMOTE_ATOMIC */
+    int rw = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+    ASSERT_EQ(rw, rdma_access_flags(IBV_ATOMIC_NONE), "不支持原子操作时只有本地写和远端读写");
+    ASSERT_EQ(rw | IBV_ACCESS_REMOTE_ATOMIC, rdma_access_flags(IBV_ATOMIC_HCA),
+              "HCA级原子时开放远端原子");
+    ASSERT_EQ(rw | IBV_ACCESS_REMOTE_ATOMIC, rdma_access_flags(IBV_ATOMIC_GLOB),
+              "全局原子时开放远端原子");
+}
+
+/**
+ * 测试套件：环形通道记录布局
+ */
+void test_ring_layout(void)
+{
+    printf("\n--- 测试环形通道记录布局 ---\n");
+
+    /* 头部seq在最后，消费者读到seq时整个头部已写完 */
+    ASSERT_EQ(16, sizeof(struct ring_hdr), "记录头部应为16字节");
+    ASSERT_EQ(12, offsetof(struct ring_hdr, seq), "seq应位于头部末尾");
+
+    ASSERT_EQ(24, ring_record_size(0), "空记录为头部加尾标");
+    ASSERT_EQ(32, ring_record_size(1), "负载应按8字节对齐");
+    ASSERT_EQ(32, ring_record_size(8), "8字节负载无需填充");
+    ASSERT_EQ(0, ring_record_size(13) % RING_ALIGN, "记录大小应8字节对齐");
+
+    /* 接收环 + 发送镜像 + credit_in + credit_out */
+    ASSERT_EQ(2 * 4096 + 16, ring_region_size(4096), "布局区域大小");
+}
+
+/**
+ * 测试套件：共享接收队列的wr_id标记与槽位布局
+ */
+void test_srq_layout(void)
+{
+    printf("\n--- 测试SRQ布局 ---\n");
+
+    /* SRQ标记不能与任何合法QP索引冲突 */
+    ASSERT_TRUE(SRQ_WR_QP >= MAX_QP, "SRQ标记应超出QP索引范围");
+
+    struct ibv_wc wc;
+    memset(&wc, 0, sizeof(wc));
+    wc.wr_id = WR_ID_MAKE(SRQ_WR_QP, 7);
+    ASSERT_TRUE(srq_is_recv(&wc), "SRQ RECV应被识别");
+    ASSERT_EQ(7, WR_ID_TAG(wc.wr_id), "标签应保存槽位号");
+    wc.wr_id = WR_ID_MAKE(MAX_QP - 1, 7);
+    ASSERT_FALSE(srq_is_recv(&wc), "普通QP的完成事件不应被识别为SRQ");
+
+    /* 接收内存只与SRQ深度有关，与QP数无关 */
+    ASSERT_EQ(64 * 4096, srq_region_size(64, 4096), "区域为深度×消息大小");
+
+    struct srq_ctx s;
+    memset(&s, 0, sizeof(s));
+    s.recv_base = 8192;
+    s.msg_size = 1024;
+    ASSERT_EQ(8192 + 3 * 1024, srq_slot_off(&s, 3), "槽位偏移应按消息大小递增");
+}
+
 /**
  * 主测试函数
  */
@@ -122,6 +255,11 @@ int main(void)
     test_constants();
     test_error_codes();
     test_function_declarations();
+    test_wr_id_encoding();
+    test_con_data_layout();
+    test_atomic_slots();
+    test_ring_layout();
+    test_srq_layout();
     
     /* 打印测试统计 */
     print_test_summary();
@@ -0,0 +1,68 @@
+/**
+ * @file test_rdma_common_bringup.c
+ * @brief 并行建链与rdma_cm建链单元测试
+ * @details 只测分块和私有数据布局，都是内联函数，不链接源文件
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common_bringup.h"
+#include "../src/rdma_common_cm.h"
+
+/**
+ * 测试套件：并行建链的分块
+ */
+void test_qp_bringup_chunk(void)
+{
+    uint32_t first;
+    uint32_t n;
+
+    printf("\n--- 测试并行建链分块 ---\n");
+
+    ASSERT_EQ(1, qp_bringup_chunks(1), "单个QP也是一块");
+    ASSERT_EQ(1, qp_bringup_chunks(QP_BRINGUP_CHUNK), "正好一块");
+    ASSERT_EQ(2, qp_bringup_chunks(QP_BRINGUP_CHUNK + 1), "多出的QP另起一块");
+
+    qp_bringup_chunk(100, 1, &first, &n);
+    ASSERT_EQ(QP_BRINGUP_CHUNK, first, "第二块紧接第一块");
+    ASSERT_EQ(QP_BRINGUP_CHUNK, n, "中间的块是满的");
+    qp_bringup_chunk(100, qp_bringup_chunks(100) - 1, &first, &n);
+    ASSERT_EQ(100, first + n, "最后一块到最后一个QP为止");
+}
+
+/**
+ * 测试rdma_cm私有数据
+ */
+void test_cm_private_data(void)
+{
+    printf("\n--- 测试rdma_cm私有数据 ---\n");
+
+    /* 连接信息整体放进REQ报文的私有数据，超过上限rdma_connect()会失败 */
+    ASSERT_TRUE(sizeof(struct cm_con_data_t) <= CM_REQ_PRIVATE_MAX, "连接信息应能放入REQ私有数据");
+#ifdef HAVE_RDMACM
+    ASSERT_EQ(1, cm_supported(), "RDMACM=1编译时支持rdma_cm");
+#else
+    ASSERT_EQ(0, cm_supported(), "默认编译不支持rdma_cm");
+#endif
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   建链模块单元测试                    ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_qp_bringup_chunk();
+    test_cm_private_data();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file test_rdma_common_cpu.c
+ * @brief rdma_common_cpu 模块单元测试
+ * @details 测试cpulist解析、不存在设备的NUMA查询，以及绑定到当前可用的CPU
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common_cpu.h"
+
+/**
+ * 测试套件：cpulist解析
+ */
+void test_cpu_list_parse(void)
+{
+    int cpus[16];
+
+    printf("\n--- 测试CPU列表解析 ---\n");
+
+    ASSERT_EQ(7, cpu_list_parse("0-3,8,10-11", cpus, 16), "区间和单个CPU混合");
+    ASSERT_EQ(0, cpus[0], "第一个CPU");
+    ASSERT_EQ(3, cpus[3], "区间末尾");
+    ASSERT_EQ(8, cpus[4], "单个CPU");
+    ASSERT_EQ(11, cpus[6], "最后一个CPU");
+    ASSERT_EQ(2, cpu_list_parse("4-5\n", cpus, 16), "允许sysfs末尾的换行");
+    ASSERT_EQ(3, cpu_list_parse("5,1,3", cpus, 16), "保持给定顺序");
+    ASSERT_EQ(1, cpus[1], "顺序不被排序");
+
+    ASSERT_EQ(-1, cpu_list_parse("", cpus, 16), "空列表无效");
+    ASSERT_EQ(-1, cpu_list_parse("3-1", cpus, 16), "区间颠倒无效");
+    ASSERT_EQ(-1, cpu_list_parse("1,a", cpus, 16), "非数字无效");
+    ASSERT_EQ(-1, cpu_list_parse("0-31", cpus, 16), "超过数组容量无效");
+}
+
+/**
+ * 测试套件：NUMA查询与绑核
+ */
+void test_cpu_affinity(void)
+{
+    cpu_set_t set;
+    int cpu = -1;
+    int i;
+
+    printf("\n--- 测试NUMA查询与绑核 ---\n");
+
+    ASSERT_EQ(-1, cpu_dev_numa_node("no_such_dev"), "不存在的设备返回-1");
+    ASSERT_TRUE(cpu_pin_self(-1) < 0, "负CPU编号应被拒绝");
+
+    /* 绑定到当前允许集合中的第一个CPU，容器内也应成功 */
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set), "读取当前亲和性");
+    for (i = 0; i < CPU_SETSIZE && cpu < 0; i++) {
+        if (CPU_ISSET(i, &set)) {
+            cpu = i;
+        }
+    }
+    ASSERT_EQ(0, cpu_pin_self(cpu), "绑定到允许的CPU");
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(set), &set), "再次读取亲和性");
+    ASSERT_EQ(1, CPU_COUNT(&set), "绑定后只剩一个CPU");
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_cpu 模块单元测试         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_cpu_list_parse();
+    test_cpu_affinity();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
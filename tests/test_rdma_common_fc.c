@@ -0,0 +1,162 @@
+/**
+ * @file test_rdma_common_fc.c
+ * @brief rdma_common_fc 模块单元测试
+ * @details 链接真实的流控、轮询和投递源文件，完成事件经poll_dispatch_wc()交给
+ *          流控处理函数，发出的SEND_WITH_IMM由fake_verbs.h记录
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_common_fc.h"
+#include "../src/rdma_common_poll.h"
+
+#define TEST_DEPTH     4
+#define TEST_MSG_SIZE  64
+
+static char test_buf[4096];
+static struct ibv_mr test_mr;
+static uint32_t delivered;
+
+static int count_deliver(void *arg, uint32_t qp_idx, const void *data, uint32_t len) {
+    (void)arg;
+    (void)qp_idx;
+    (void)data;
+    (void)len;
+    delivered++;
+    return 0;
+}
+
+/* 单QP的假设备和流控通道，每个QP预投递depth个RECV */
+static void fc_setup(struct rdma_resources *res, struct ibv_qp **qp_list,
+                     struct qp_ctx *qp_ctx, struct fc_channel *ch, uint32_t depth) {
+    fake_reset(res, qp_list, qp_ctx, 1);
+    res->rq_depth = depth;
+    res->buf = test_buf;
+    res->buf_size = sizeof(test_buf);
+    res->mr = &test_mr;
+    delivered = 0;
+    ASSERT_EQ(0, fc_channel_init(ch, res, 0, depth, TEST_MSG_SIZE), "初始化流控通道");
+    fc_set_deliver(ch, count_deliver, NULL);
+}
+
+/* 对端的一条消息到达第slot个RECV：len为0时是纯credit消息，imm为捎带的credit */
+static void fc_recv(struct rdma_resources *res, uint32_t slot, uint32_t len, uint32_t imm) {
+    struct ibv_wc wc;
+
+    memset(&wc, 0, sizeof(wc));
+    wc.wr_id = WR_ID_MAKE(0, slot);
+    wc.status = IBV_WC_SUCCESS;
+    wc.opcode = IBV_WC_RECV;
+    wc.byte_len = len;
+    wc.wc_flags = IBV_WC_WITH_IMM;
+    wc.imm_data = htonl(imm);
+    wc.qp_num = fake.qp[0].qp_num;
+    ASSERT_EQ(0, poll_dispatch_wc(res, &wc), "接收完成事件处理成功");
+}
+
+/**
+ * 测试套件：发送消耗credit，最后一个credit保留
+ */
+void test_fc_send_credits(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[1];
+    struct qp_ctx qp_ctx[1];
+    struct fc_channel ch;
+    uint32_t i;
+
+    printf("\n--- 测试发送端credit ---\n");
+
+    ASSERT_EQ(4 * 16 * 1024, fc_region_size(4, 16, 1024), "RECV区域为QP数×深度×消息大小");
+    fc_setup(&res, qp_list, qp_ctx, &ch, TEST_DEPTH);
+    ASSERT_EQ(TEST_DEPTH, fake.nrecv, "预投递depth个RECV");
+    ASSERT_EQ(TEST_DEPTH, ch.qp[0].credits, "初始credit为depth");
+    ASSERT_EQ(TEST_DEPTH / 2, ch.threshold, "通告阈值为depth的一半");
+
+    for (i = 0; i < TEST_DEPTH - FC_RESERVED_CREDITS; i++) {
+        ASSERT_EQ(0, fc_send(&ch, 0, 0, 8), "credit充足时发送成功");
+    }
+    ASSERT_EQ(-EAGAIN, fc_send(&ch, 0, 0, 8), "只剩保留credit时返回-EAGAIN");
+    ASSERT_EQ(1, ch.qp[0].stalls, "记录一次credit不足");
+    ASSERT_EQ(TEST_DEPTH - FC_RESERVED_CREDITS, fake.nsent, "被拒绝的消息没有投递");
+    ASSERT_EQ(IBV_WR_SEND_WITH_IMM, fake.sent[0].opcode, "数据消息用SEND_WITH_IMM");
+    ASSERT_EQ(-EMSGSIZE, fc_send(&ch, 0, 0, TEST_MSG_SIZE + 1), "超过消息大小返回-EMSGSIZE");
+
+    /* 保留的credit仍可用于纯credit消息 */
+    fc_recv(&res, 0, 8, 0);
+    ASSERT_EQ(0, fc_flush_credits(&ch, 0, 1), "强制通告成功");
+    ASSERT_EQ(0, fake.sent[fake.nsent - 1].num_sge, "纯credit消息没有负载");
+    ASSERT_EQ(0, ch.qp[0].credits, "纯credit消息用掉保留credit");
+    fc_channel_destroy(&ch);
+}
+
+/**
+ * 测试套件：接收端按阈值通告credit，纯credit消息不触发回送
+ */
+void test_fc_grant(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[1];
+    struct qp_ctx qp_ctx[1];
+    struct fc_channel ch;
+
+    printf("\n--- 测试接收端credit通告 ---\n");
+
+    fc_setup(&res, qp_list, qp_ctx, &ch, TEST_DEPTH);
+    fc_recv(&res, 0, 8, 0);
+    ASSERT_EQ(1, delivered, "数据消息交给回调");
+    ASSERT_EQ(TEST_DEPTH + 1, fake.nrecv, "处理完立即补投");
+    ASSERT_EQ(0, fake.nsent, "未达阈值不通告");
+    fc_recv(&res, 1, 8, 0);
+    ASSERT_EQ(1, fake.nsent, "达到阈值发纯credit消息");
+    ASSERT_EQ(2, ntohl(fake.sent[0].imm_data), "立即数携带2个credit");
+    ASSERT_EQ(1, ch.qp[0].credit_msgs, "统计1条纯credit消息");
+    ASSERT_EQ(0, ch.qp[0].grant_pending, "通告后待通告数清零");
+
+    /* 对端的纯credit消息：恢复credit，补投的RECV不计入阈值 */
+    fc_recv(&res, 2, 0, 3);
+    fc_recv(&res, 3, 0, 0);
+    ASSERT_EQ(TEST_DEPTH - 1 + 3, ch.qp[0].credits, "立即数中的credit累加");
+    ASSERT_EQ(2, delivered, "纯credit消息不交给回调");
+    ASSERT_EQ(2, ch.qp[0].grant_idle, "纯credit消息补投的RECV单独计数");
+    ASSERT_EQ(1, fake.nsent, "纯credit消息不触发纯credit回复");
+    ASSERT_EQ(0, fc_flush_credits(&ch, 0, 0), "非强制通告不发送");
+    ASSERT_EQ(1, fake.nsent, "空闲时不回送");
+
+    /* 单独计数的credit随下一条数据消息捎带 */
+    ASSERT_EQ(0, fc_send(&ch, 0, 0, 8), "发送数据消息");
+    ASSERT_EQ(2, ntohl(fake.sent[1].imm_data), "数据消息捎带空闲补投的credit");
+    ASSERT_EQ(0, ch.qp[0].grant_idle, "捎带后清零");
+    fc_channel_destroy(&ch);
+
+    /* 深度2时阈值为1，纯credit消息也不会来回弹 */
+    fc_setup(&res, qp_list, qp_ctx, &ch, 2);
+    fc_recv(&res, 0, 0, 1);
+    ASSERT_EQ(0, fake.nsent, "阈值为1时纯credit消息也不触发回复");
+    ASSERT_EQ(0, fc_flush_credits(&ch, 0, 1), "强制通告成功");
+    ASSERT_EQ(1, ntohl(fake.sent[0].imm_data), "强制通告带出空闲补投的credit");
+    fc_channel_destroy(&ch);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_fc 模块单元测试          ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_fc_send_credits();
+    test_fc_grant();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
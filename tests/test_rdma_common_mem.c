@@ -0,0 +1,115 @@
+/**
+ * @file test_rdma_common_mem.c
+ * @brief rdma_common_mem 模块单元测试
+ * @details 测试页大小参数解析，以及大页不可用时的降级分配
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common_mem.h"
+
+/**
+ * 测试套件：参数解析与名称
+ */
+void test_page_mode_parse(void)
+{
+    enum buf_page_mode mode = BUF_PAGE_DEFAULT;
+
+    printf("\n--- 测试页大小参数 ---\n");
+
+    ASSERT_EQ(0, parse_buf_page_mode("2m", &mode), "应能解析2m");
+    ASSERT_EQ(BUF_PAGE_2M, mode, "2m对应BUF_PAGE_2M");
+    ASSERT_EQ(0, parse_buf_page_mode("1g", &mode), "应能解析1g");
+    ASSERT_EQ(BUF_PAGE_1G, mode, "1g对应BUF_PAGE_1G");
+    ASSERT_EQ(0, parse_buf_page_mode("auto", &mode), "应能解析auto");
+    ASSERT_EQ(BUF_PAGE_AUTO, mode, "auto对应BUF_PAGE_AUTO");
+    ASSERT_EQ(0, parse_buf_page_mode("4k", &mode), "应能解析4k");
+    ASSERT_EQ(BUF_PAGE_DEFAULT, mode, "4k对应默认malloc");
+    ASSERT_EQ(-1, parse_buf_page_mode("3m", &mode), "无效值应返回-1");
+
+    ASSERT_TRUE(!strcmp("2MB", buf_page_size_str(HUGE_PAGE_2M)), "2MB页名称");
+    ASSERT_TRUE(!strcmp("1GB", buf_page_size_str(HUGE_PAGE_1G)), "1GB页名称");
+    ASSERT_TRUE(!strcmp("malloc", buf_page_size_str(0)), "malloc分配的名称");
+    ASSERT_TRUE(!strcmp("THP", buf_page_size_str(BUF_PAGE_THP)), "透明大页降级的名称");
+
+    /* 小于1GB的缓冲区不能占用整个1GB页 */
+    ASSERT_EQ(HUGE_PAGE_2M, buf_auto_huge_page(4096), "小缓冲区先试2MB");
+    ASSERT_EQ(HUGE_PAGE_2M, buf_auto_huge_page(HUGE_PAGE_1G - 1), "不足1GB先试2MB");
+    ASSERT_EQ(HUGE_PAGE_1G, buf_auto_huge_page(HUGE_PAGE_1G), "1GB起先试1GB");
+    ASSERT_TRUE(buf_auto_huge_page((size_t)6 << 30) == HUGE_PAGE_1G, "多GB缓冲区用1GB页");
+
+    /* 超过4GB的缓冲区只有前4GB能用32位长度/偏移访问 */
+    ASSERT_TRUE(buf_window(4096) == 4096, "小缓冲区整体可访问");
+    ASSERT_TRUE(buf_window((size_t)6 << 30) == UINT32_MAX, "多GB缓冲区的访问窗口截到4GB");
+}
+
+/**
+ * 测试套件：分配与降级
+ */
+void test_buf_alloc(void)
+{
+    const size_t size = 3u << 20;
+    uint32_t page_size = 1;
+    char *buf;
+
+    printf("\n--- 测试缓冲区分配 ---\n");
+
+    buf = rdma_buf_alloc(size, BUF_PAGE_DEFAULT, &page_size);
+    ASSERT_NOT_NULL(buf, "默认模式应能分配");
+    ASSERT_EQ(0, page_size, "默认模式报告malloc");
+    rdma_buf_free(buf, size, page_size);
+
+    /* 没有预留大页的环境会降级，但无论如何都应拿到清零的可写内存 */
+    buf = rdma_buf_alloc(size, BUF_PAGE_AUTO, &page_size);
+    ASSERT_NOT_NULL(buf, "自动模式总能分配（必要时降级）");
+    ASSERT_TRUE(page_size == HUGE_PAGE_2M || page_size == BUF_PAGE_THP, "3MB缓冲区不使用1GB页");
+    ASSERT_TRUE(buf[0] == 0 && buf[size - 1] == 0, "内存应已清零");
+    buf[size - 1] = 1;
+    rdma_buf_free(buf, size, page_size);
+}
+
+/**
+ * 测试套件：常驻内存统计
+ */
+void test_rss(void)
+{
+    const size_t size = 8u << 20;
+    size_t before;
+    size_t after;
+    char *buf;
+
+    printf("\n--- 测试常驻内存统计 ---\n");
+
+    before = mem_rss_bytes();
+    ASSERT_TRUE(before > 0, "应能读取当前进程的常驻内存");
+
+    /* 写满后这些页必然常驻，增量至少接近缓冲区大小 */
+    buf = malloc(size);
+    ASSERT_NOT_NULL(buf, "分配测试缓冲区");
+    memset(buf, 1, size);
+    after = mem_rss_bytes();
+    ASSERT_TRUE(after >= before + size / 2, "写入的页应计入常驻内存");
+    free(buf);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_mem 模块单元测试         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_page_mode_parse();
+    test_buf_alloc();
+    test_rss();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file test_rdma_common_mrcache.c
+ * @brief rdma_common_mrcache 模块单元测试
+ * @details 链接真实的缓存实现，ibv_reg_mr/ibv_dereg_mr由fake_verbs.h提供
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_common_mrcache.h"
+
+#define TEST_PAGES 16
+
+static char *test_buf;
+static size_t test_page;
+
+/* 初始化预算为budget_pages页的缓存，清零假注册计数 */
+static void cache_setup(struct mr_cache *cache, struct ibv_pd *pd, size_t budget_pages)
+{
+    memset(&fake_mr, 0, sizeof(fake_mr));
+    mr_cache_init(cache, pd, budget_pages * test_page, IBV_ACCESS_LOCAL_WRITE);
+}
+
+/**
+ * 测试套件：注册缓存的区间对齐与重叠判断
+ */
+void test_mr_cache_ranges(void)
+{
+    uintptr_t start;
+    uintptr_t end;
+
+    printf("\n--- 测试注册缓存区间 ---\n");
+
+    mr_cache_align(0x1010, 0x20, 4096, &start, &end);
+    ASSERT_EQ(0x1000, start, "起始地址向下对齐到页");
+    ASSERT_EQ(0x2000, end, "结束地址向上对齐到页");
+
+    mr_cache_align(0x1ff0, 0x20, 4096, &start, &end);
+    ASSERT_EQ(0x3000 - 0x1000, end - start, "跨页的小区间覆盖两页");
+
+    ASSERT_TRUE(mr_cache_overlap(0x1000, 0x3000, 0x2000, 0x4000), "部分重叠");
+    ASSERT_TRUE(mr_cache_overlap(0x1000, 0x4000, 0x2000, 0x3000), "包含关系也算重叠");
+    ASSERT_FALSE(mr_cache_overlap(0x1000, 0x2000, 0x2000, 0x3000), "首尾相接不算重叠");
+}
+
+/**
+ * 测试套件：命中与LRU淘汰
+ */
+void test_mr_cache_hit_evict(void)
+{
+    struct mr_cache cache;
+    struct ibv_pd pd;
+    struct mr_cache_entry *a;
+    struct mr_cache_entry *b;
+    struct mr_cache_entry *c;
+
+    printf("\n--- 测试命中与LRU淘汰 ---\n");
+
+    cache_setup(&cache, &pd, 4);
+    a = mr_cache_get(&cache, test_buf, 2 * test_page);
+    ASSERT_NOT_NULL(a, "首次访问注册[0,2)页");
+    ASSERT_EQ(1, cache.misses, "首次访问未命中");
+    ASSERT_PTR_EQ(a, mr_cache_get(&cache, test_buf + test_page + 8, 100), "区间内的子区间命中");
+    ASSERT_EQ(1, cache.hits, "命中计数");
+    ASSERT_EQ(2, a->refs, "命中增加引用");
+    ASSERT_EQ(1, fake_mr.regs, "命中不重新注册");
+    mr_cache_put(&cache, a);
+    mr_cache_put(&cache, a);
+    ASSERT_EQ(0, a->refs, "put归还引用");
+
+    b = mr_cache_get(&cache, test_buf + 8 * test_page, 2 * test_page);
+    ASSERT_NOT_NULL(b, "注册[8,10)页");
+    mr_cache_put(&cache, b);
+
+    /* 预算4页已用满：再注册2页要淘汰最久未用的a */
+    c = mr_cache_get(&cache, test_buf + 12 * test_page, 2 * test_page);
+    ASSERT_NOT_NULL(c, "淘汰后注册[12,14)页");
+    ASSERT_EQ(1, cache.evictions, "淘汰1个区间");
+    ASSERT_EQ(2, cache.nlive, "仍有2个区间");
+    ASSERT_EQ(1, cache.live[0] == b, "b比a更新，保留b");
+    ASSERT_EQ(4 * test_page, cache.pinned, "锁定字节数不超过预算");
+
+    /* 被引用的区间不能淘汰：b、c都被引用时新注册失败 */
+    ASSERT_PTR_EQ(b, mr_cache_get(&cache, test_buf + 8 * test_page, 1), "再次引用b");
+    ASSERT_NULL(mr_cache_get(&cache, test_buf, test_page), "没有可淘汰的区间时失败");
+    ASSERT_EQ(2, cache.nlive, "被引用的区间保留");
+    mr_cache_put(&cache, b);
+    mr_cache_put(&cache, c);
+    mr_cache_destroy(&cache);
+    ASSERT_EQ(fake_mr.regs, fake_mr.deregs, "销毁后注册与注销次数相等");
+}
+
+/**
+ * 测试套件：失效区间延后到最后一次put时注销
+ */
+void test_mr_cache_invalidate(void)
+{
+    struct mr_cache cache;
+    struct ibv_pd pd;
+    struct mr_cache_entry *a;
+    struct mr_cache_entry *b;
+
+    printf("\n--- 测试区间失效 ---\n");
+
+    cache_setup(&cache, &pd, TEST_PAGES);
+    a = mr_cache_get(&cache, test_buf, 2 * test_page);
+    b = mr_cache_get(&cache, test_buf + 4 * test_page, 2 * test_page);
+    mr_cache_put(&cache, b);
+
+    ASSERT_EQ(2, mr_cache_invalidate(&cache, test_buf, 6 * test_page), "两个区间都失效");
+    ASSERT_EQ(0, cache.nlive, "有效区间已清空");
+    ASSERT_EQ(1, fake_mr.deregs, "未引用的区间立即注销");
+    ASSERT_PTR_EQ(a, cache.stale, "被引用的区间转入失效链表");
+    ASSERT_EQ(2 * test_page, cache.pinned, "失效区间仍计入锁定内存");
+
+    /* 同一地址再次get必须重新注册，不能复用失效的MR */
+    b = mr_cache_get(&cache, test_buf, test_page);
+    ASSERT_NOT_NULL(b, "失效后重新注册");
+    ASSERT_EQ(1, b != a, "不复用失效区间");
+    mr_cache_put(&cache, a);
+    ASSERT_NULL(cache.stale, "最后一次put后移出失效链表");
+    ASSERT_EQ(2, fake_mr.deregs, "最后一次put时注销");
+    ASSERT_EQ(test_page, cache.pinned, "只剩新注册的1页");
+    mr_cache_put(&cache, b);
+    mr_cache_destroy(&cache);
+}
+
+/**
+ * 测试套件：合并失败时保留旧区间
+ */
+void test_mr_cache_merge_failure(void)
+{
+    struct mr_cache cache;
+    struct ibv_pd pd;
+    struct mr_cache_entry *a;
+    struct mr_cache_entry *b;
+    struct mr_cache_entry *m;
+
+    printf("\n--- 测试合并失败不丢失已缓存区间 ---\n");
+
+    cache_setup(&cache, &pd, TEST_PAGES);
+    a = mr_cache_get(&cache, test_buf, 2 * test_page);
+    b = mr_cache_get(&cache, test_buf + 4 * test_page, 2 * test_page);
+    ASSERT_NOT_NULL(a, "注册[0,2)页");
+    ASSERT_NOT_NULL(b, "注册[4,6)页");
+    mr_cache_put(&cache, a);
+    mr_cache_put(&cache, b);
+
+    /* [1,5)页与两个区间都重叠，注册失败时两个旧区间都应保留 */
+    fake_mr.fail = 1;
+    ASSERT_NULL(mr_cache_get(&cache, test_buf + test_page, 4 * test_page), "注册失败返回NULL");
+    ASSERT_EQ(2, cache.nlive, "失败后仍有2个区间");
+    ASSERT_EQ(0, fake_mr.deregs, "失败时不应注销旧MR");
+    ASSERT_EQ(4 * test_page, cache.pinned, "锁定字节数不变");
+    ASSERT_PTR_EQ(a, mr_cache_get(&cache, test_buf, test_page), "旧区间仍能命中");
+    mr_cache_put(&cache, a);
+
+    /* 超出预算同样不能先退掉旧区间 */
+    fake_mr.fail = 0;
+    ASSERT_NULL(mr_cache_get(&cache, test_buf, (TEST_PAGES + 1) * test_page), "超出预算失败");
+    ASSERT_EQ(2, cache.nlive, "超出预算后仍有2个区间");
+
+    /* 注册成功后才替换：合并成[0,6)页，两个旧MR注销 */
+    m = mr_cache_get(&cache, test_buf + test_page, 4 * test_page);
+    ASSERT_NOT_NULL(m, "合并注册成功");
+    ASSERT_EQ(1, cache.nlive, "合并后只剩1个区间");
+    ASSERT_EQ(6 * test_page, m->end - m->start, "合并区间覆盖[0,6)页");
+    ASSERT_EQ(2, cache.merges, "合并了2个旧区间");
+    ASSERT_EQ(2, fake_mr.deregs, "两个旧MR已注销");
+    ASSERT_EQ(6 * test_page, cache.pinned, "锁定字节数为合并区间大小");
+    mr_cache_put(&cache, m);
+    mr_cache_destroy(&cache);
+}
+
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_mrcache 模块单元测试     ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_page = (size_t)sysconf(_SC_PAGESIZE);
+    if (posix_memalign((void **)&test_buf, test_page, TEST_PAGES * test_page)) {
+        return 1;
+    }
+
+    test_mr_cache_ranges();
+    test_mr_cache_hit_evict();
+    test_mr_cache_invalidate();
+    test_mr_cache_merge_failure();
+
+    free(test_buf);
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file test_rdma_common_net.c
+ * @brief rdma_common_net 模块单元测试
+ * @details 连接信息交换走socketpair，对端在另一个线程里对称调用
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common.h"
+
+/* 远大于socket缓冲区的表：先写完再读的实现会让双方都阻塞在写上 */
+#define TEST_BIG_QP  20000
+
+struct peer_arg {
+    int sock;
+    uint32_t num;
+    uint32_t base;                     /* 本端第i个QP的qp_num为base+i */
+    struct cm_con_data_t *remote;
+    uint32_t remote_num;
+    int rc;
+};
+
+static struct cm_con_data_t *make_table(uint32_t num, uint32_t base) {
+    struct cm_con_data_t *t = calloc(num, sizeof(*t));
+    uint32_t i;
+
+    for (i = 0; t && i < num; i++) {
+        t[i].qp_num = base + i;
+        t[i].len = i;
+    }
+    return t;
+}
+
+static void *peer_exchange(void *arg) {
+    struct peer_arg *p = arg;
+    struct cm_con_data_t *local = make_table(p->num, p->base);
+
+    p->rc = local ? sock_exchange_con_data(p->sock, local, p->num, &p->remote,
+                                           &p->remote_num) : -1;
+    free(local);
+    return NULL;
+}
+
+/**
+ * 测试套件：双方同时交换超过socket缓冲区的连接信息表
+ */
+void test_exchange_symmetric(void)
+{
+    struct peer_arg a;
+    struct peer_arg b;
+    pthread_t ta;
+    pthread_t tb;
+    int sv[2];
+
+    printf("\n--- 测试对称交换大量连接信息 ---\n");
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv), "创建socketpair");
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    a.sock = sv[0];
+    a.num = TEST_BIG_QP;
+    a.base = 0x1000;
+    b.sock = sv[1];
+    b.num = TEST_BIG_QP / 2;
+    b.base = 0x80000;
+    pthread_create(&ta, NULL, peer_exchange, &a);
+    pthread_create(&tb, NULL, peer_exchange, &b);
+    pthread_join(ta, NULL);
+    pthread_join(tb, NULL);
+
+    ASSERT_EQ(0, a.rc, "A端交换成功");
+    ASSERT_EQ(0, b.rc, "B端交换成功");
+    ASSERT_EQ(TEST_BIG_QP / 2, a.remote_num, "A端收到B端的QP数");
+    ASSERT_EQ(TEST_BIG_QP, b.remote_num, "B端收到A端的QP数");
+    ASSERT_TRUE(a.remote && a.remote[TEST_BIG_QP / 2 - 1].qp_num == 0x80000 + TEST_BIG_QP / 2 - 1,
+                "A端收到的最后一项完整");
+    ASSERT_TRUE(b.remote && b.remote[TEST_BIG_QP - 1].len == TEST_BIG_QP - 1,
+                "B端收到的最后一项完整");
+    free(a.remote);
+    free(b.remote);
+
+    /* 对端提前关闭时失败，不返回半张表 */
+    close(sv[1]);
+    a.remote = NULL;
+    a.num = 4;
+    peer_exchange(&a);
+    ASSERT_EQ(-1, a.rc, "对端关闭时交换失败");
+    ASSERT_NULL(a.remote, "失败时不返回远端数组");
+    close(sv[0]);
+}
+
+static void on_alarm(int sig) {
+    (void)sig;
+}
+
+/* 在信号之后才写入，期间读被中断 */
+static void *late_writer(void *arg) {
+    int sock = *(int *)arg;
+    uint32_t v = 0x12345678;
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+    usleep(100 * 1000);
+    sock_write_full(sock, &v, sizeof(v));
+    return NULL;
+}
+
+/**
+ * 测试套件：读写被信号中断时继续
+ */
+void test_rw_eintr(void)
+{
+    struct itimerval it;
+    struct sigaction sa;
+    uint32_t v = 0;
+    pthread_t t;
+    int sv[2];
+
+    printf("\n--- 测试信号中断后继续读 ---\n");
+
+    /* 不设SA_RESTART，阻塞的read会返回EINTR */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_alarm;
+    sigaction(SIGALRM, &sa, NULL);
+    memset(&it, 0, sizeof(it));
+    it.it_value.tv_usec = 20 * 1000;
+
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv), "创建socketpair");
+    pthread_create(&t, NULL, late_writer, &sv[1]);
+    setitimer(ITIMER_REAL, &it, NULL);
+    ASSERT_EQ(0, sock_read_full(sv[0], &v, sizeof(v)), "被信号中断后仍读满");
+    ASSERT_EQ(0x12345678, v, "读到对端写入的数据");
+    pthread_join(t, NULL);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_net 模块单元测试         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_exchange_symmetric();
+    test_rw_eintr();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file test_rdma_common_pool.c
+ * @brief rdma_common_pool 模块单元测试
+ * @details 链接真实的池和投递源文件，池MR的注册和发出的WR由fake_verbs.h记录
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_common_pool.h"
+
+/**
+ * 测试套件：缓冲区池的大小级别划分
+ */
+void test_pool_classes(void)
+{
+    uint64_t wr_id;
+
+    printf("\n--- 测试缓冲区池级别 ---\n");
+
+    ASSERT_EQ(POOL_MIN_CLASS, pool_class_size(1), "小消息取最小级别");
+    ASSERT_EQ(POOL_MIN_CLASS, pool_class_size(POOL_MIN_CLASS), "恰好等于级别大小时不升级");
+    ASSERT_EQ(128, pool_class_size(POOL_MIN_CLASS + 1), "超过一个字节即升一级");
+    ASSERT_EQ(4096, pool_class_size(3000), "级别为2的幂");
+
+    ASSERT_EQ(0, pool_class_index(64, 10), "最小级别下标为0");
+    ASSERT_EQ(2, pool_class_index(64, 256), "256字节在64字节起始的第2级");
+    ASSERT_EQ(1, pool_class_index(1, 100), "min_size不足最小级别时按最小级别计");
+
+    /* 槽位号放在wr_id标签里，与QP索引互不干扰 */
+    wr_id = WR_ID_MAKE(3, 1234);
+    ASSERT_EQ(3, WR_ID_QP(wr_id), "QP索引不受槽位号影响");
+    ASSERT_EQ(1234, WR_ID_TAG(wr_id), "槽位号可从wr_id还原");
+}
+
+/**
+ * 测试套件：池槽位经wr_id归属WR，发送完成按FIFO归还
+ */
+void test_pool_slots(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct buf_pool pool;
+    struct pool_slot *s[4];
+
+    printf("\n--- 测试缓冲区池槽位 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    memset(&fake_mr, 0, sizeof(fake_mr));
+    res.signal_interval = 2;
+    ASSERT_EQ(0, pool_init(&pool, &res, 64, 256, 2), "创建64~256字节、每级2个槽位的池");
+    ASSERT_EQ(3, pool.nclasses, "应有3个级别");
+
+    /* 100字节取128字节级别，用尽后向256字节级别借 */
+    s[0] = pool_acquire(&pool, 100);
+    s[1] = pool_acquire(&pool, 100);
+    s[2] = pool_acquire(&pool, 100);
+    ASSERT_NOT_NULL(s[0], "取得第一个槽位");
+    ASSERT_EQ(128, s[0]->size, "取最小的够用级别");
+    ASSERT_EQ(1, s[0]->addr < s[1]->addr, "低地址槽位先被取走");
+    ASSERT_EQ(256, s[2]->size, "级别用尽时向更大的级别借");
+    ASSERT_NULL(pool_acquire(&pool, 300), "超过最大级别返回NULL");
+
+    /* 发送只带实际长度，wr_id标签是槽位号 */
+    ASSERT_EQ(-EMSGSIZE, pool_post_send(&pool, 1, IBV_WR_SEND, s[0], 200), "超过槽位大小");
+    ASSERT_EQ(0, pool_post_send(&pool, 1, IBV_WR_SEND, s[0], 50), "投递第一个发送");
+    ASSERT_EQ(0, pool_post_send(&pool, 1, IBV_WR_SEND, s[1], 60), "投递第二个发送");
+    ASSERT_EQ(0, pool_post_send(&pool, 1, IBV_WR_SEND, s[2], 70), "投递第三个发送");
+    ASSERT_EQ(50, fake.sent[0].sg_list[0].length, "SGE长度为负载长度");
+    ASSERT_EQ(1, fake.sent[0].sg_list[0].addr == (uintptr_t)s[0]->addr, "SGE地址为槽位地址");
+    ASSERT_EQ(pool.mr->lkey, fake.sent[0].sg_list[0].lkey, "SGE使用池MR的lkey");
+    ASSERT_PTR_EQ(s[1], pool_slot_of(&pool, fake.sent[1].wr_id), "由wr_id找回槽位");
+    ASSERT_EQ(1, WR_ID_QP(fake.sent[1].wr_id), "wr_id编码QP索引");
+    ASSERT_NULL(pool_slot_of(&pool, WR_ID_MAKE(1, pool.nslots)), "非法槽位号返回NULL");
+
+    /* 第二个WR是signaled的，它的CQE同时归还未signaled的第一个 */
+    ASSERT_EQ(0, fake.sent[0].send_flags & IBV_SEND_SIGNALED, "第一个发送未signaled");
+    ASSERT_EQ(0, pool_send_done(&pool, 0, fake.sent[1].wr_id), "其他QP的CQE不归还槽位");
+    ASSERT_EQ(2, pool_send_done(&pool, 1, fake.sent[1].wr_id), "归还前两个槽位");
+    ASSERT_EQ(0, s[0]->in_use, "第一个槽位已归还");
+    ASSERT_EQ(1, s[2]->in_use, "第三个槽位仍归WR所有");
+    ASSERT_EQ(0, pool_send_done(&pool, 1, fake.sent[1].wr_id), "重复的CQE不再归还");
+    ASSERT_EQ(1, pool_send_done(&pool, 1, fake.sent[2].wr_id), "归还第三个槽位");
+    ASSERT_PTR_EQ(s[1], pool_acquire(&pool, 100), "归还的槽位可再次取得");
+
+    /* 接收按槽位大小投递，处理完由调用者归还 */
+    s[3] = pool_acquire(&pool, 64);
+    ASSERT_EQ(0, pool_post_recv(&pool, 2, s[3]), "投递接收");
+    ASSERT_EQ(64, fake.recv[0].sg_list[0].length, "接收长度为槽位大小");
+    ASSERT_PTR_EQ(s[3], pool_slot_of(&pool, fake.recv[0].wr_id), "由接收wr_id找回槽位");
+    pool_release(&pool, s[3]);
+    pool_release(&pool, s[3]);
+    ASSERT_EQ(2, pool.cls[0].nfree, "重复归还不会重复入栈");
+
+    pool_destroy(&pool);
+    ASSERT_EQ(1, fake_mr.deregs, "销毁时注销池MR");
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_pool 模块单元测试       ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_pool_classes();
+    test_pool_slots();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
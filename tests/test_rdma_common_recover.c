@@ -0,0 +1,255 @@
+/**
+ * @file test_rdma_common_recover.c
+ * @brief rdma_common_recover 模块单元测试
+ * @details 链接真实的恢复、轮询和建链源文件，QP状态迁移由fake_verbs.h记录，
+ *          控制通道用socketpair，对端的消息预先写入
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_common_recover.h"
+#include "../src/rdma_common_async.h"
+#include "../src/rdma_common_post.h"
+
+static uint32_t handler_calls;
+static uint32_t handler_failed;
+
+/* 应用的处理函数：统计冲刷交给它的完成事件 */
+static int count_handler(struct rdma_resources *res, uint32_t qp_idx,
+                         const struct ibv_wc *wc, void *arg) {
+    (void)res;
+    (void)qp_idx;
+    (void)arg;
+    handler_calls++;
+    handler_failed += wc->status != IBV_WC_SUCCESS;
+    return 0;
+}
+
+/* 向假CQ追加一个冲刷出的失败完成事件 */
+static void push_flushed(uint32_t qp_idx, uint32_t tag) {
+    fake_push_wc(qp_idx, tag, IBV_WC_SEND);
+    fake.wc[fake.tail - 1].status = IBV_WC_WR_FLUSH_ERR;
+}
+
+/**
+ * 测试套件：冲刷与发送队列记账
+ */
+void test_qp_flush(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct qp_recover_stats st;
+    struct qp_ctx *ctx = &qp_ctx[1];
+
+    printf("\n--- 测试QP冲刷 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    memset(&st, 0, sizeof(st));
+    handler_calls = 0;
+    handler_failed = 0;
+    ctx->handler = count_handler;
+    ctx->sq_posted = 10;
+    ctx->sq_completed = 4;
+    ctx->sq_unsignaled = 2;
+    ctx->sig_head = 1;
+    ctx->sig_tail = 3;
+
+    /* 3个冲刷出的WR、1个其他QP的完成事件，最后是两个信标 */
+    push_flushed(1, 5);
+    push_flushed(1, 6);
+    fake_push_wc(2, 0, IBV_WC_RECV);
+    push_flushed(1, 7);
+    fake_push_wc(1, QP_RECOVER_TAG, IBV_WC_SEND);
+    fake_push_wc(1, QP_RECOVER_TAG, IBV_WC_RECV);
+
+    ASSERT_EQ(0, qp_flush(&res, 1, &st), "冲刷成功");
+    ASSERT_EQ(IBV_QPS_ERR, fake.qp[1].state, "QP已转ERR");
+    ASSERT_EQ(1, fake.nsent, "投递了发送信标");
+    ASSERT_EQ(1, fake.nrecv, "投递了接收信标");
+    ASSERT_EQ(3, st.flushed, "统计3个冲刷出的完成事件");
+    ASSERT_EQ(1, st.other_wc, "统计1个其他QP的完成事件");
+    ASSERT_EQ(6, st.send_lost, "未完成的6个发送WR记为丢失");
+    ASSERT_EQ(3, handler_calls, "冲刷出的完成事件交给原处理函数，信标不交");
+    ASSERT_EQ(3, handler_failed, "交给处理函数的都是失败状态");
+    ASSERT_EQ(IBV_WC_WR_FLUSH_ERR, ctx->wc_error, "记录失败原因");
+    ASSERT_EQ(10, ctx->sq_completed, "发送队列统计清零");
+    ASSERT_EQ(0, ctx->sq_unsignaled, "未signaled计数清零");
+    ASSERT_EQ(ctx->sig_tail, ctx->sig_head, "sig_ring整体作废");
+    ASSERT_EQ(1, ctx->handler == count_handler, "恢复原处理函数");
+    ASSERT_EQ(res.sq_depth, sq_available(&res, 1), "发送队列全部可用");
+
+    /* 信标一直不返回时按poll_timeout_ms超时，仍恢复原处理函数 */
+    fake.head = fake.tail;
+    ASSERT_EQ(-1, qp_flush(&res, 1, &st), "信标未返回时超时失败");
+    ASSERT_EQ(1, ctx->handler == count_handler, "超时后恢复原处理函数");
+}
+
+/* 把对端的恢复消息和RTR确认预先写入控制通道 */
+static void peer_send(int sock, uint32_t qp_idx, uint32_t psn) {
+    struct qp_recover_msg msg;
+    char ready = 'R';
+
+    memset(&msg, 0, sizeof(msg));
+    msg.qp_idx = qp_idx;
+    msg.psn = psn;
+    msg.con.qp_num = 0x777;
+    msg.con.addr = 0x10000;
+    msg.con.rkey = 0x55;
+    msg.con.len = 4096;
+    msg.con.rd_atomic = 2;
+    if (sock_write_full(sock, &msg, sizeof(msg)) || sock_write_full(sock, &ready, 1)) {
+        printf("  ✗ 写入对端消息失败\n");
+    }
+}
+
+/**
+ * 测试套件：重新建链与PSN协商
+ */
+void test_qp_reconnect(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct qp_recover_stats st;
+    struct qp_recover_msg local;
+    struct ibv_mr mr;
+    struct qp_ctx *ctx = &qp_ctx[1];
+    int sv[2];
+
+    printf("\n--- 测试QP重新建链 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    memset(&st, 0, sizeof(st));
+    memset(&mr, 0, sizeof(mr));
+    res.mr = &mr;
+    res.max_rd_atomic = 8;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+        ASSERT_TRUE(0, "创建socketpair");
+        return;
+    }
+    ctx->wc_error = IBV_WC_WR_FLUSH_ERR;
+    ctx->health = QP_HEALTH_QP_FATAL | QP_HEALTH_LAST_WQE | QP_HEALTH_CQ_ERR;
+
+    /* 对端PSN的高8位必须被截掉 */
+    peer_send(sv[1], 1, 0xab123456);
+    ASSERT_EQ(0, qp_reconnect(&res, 1, sv[0], &st), "重新建链成功");
+    ASSERT_EQ(0, sock_read_full(sv[1], &local, sizeof(local)), "对端收到本端消息");
+    ASSERT_EQ(1, local.qp_idx, "消息带QP下标");
+    ASSERT_EQ(fake.qp[1].qp_num, local.con.qp_num, "QP号不变");
+    ASSERT_TRUE(local.psn <= QP_PSN_MASK, "本端PSN为24位");
+    ASSERT_EQ(local.psn, ctx->sq_psn, "sq_psn为本端发出的PSN");
+    ASSERT_EQ(0x123456, ctx->rq_psn, "rq_psn为对端PSN的低24位");
+    ASSERT_EQ(0x123456, fake.qp_attr[1][IBV_QPS_RTR].rq_psn, "RTR使用新的rq_psn");
+    ASSERT_EQ(local.psn, fake.qp_attr[1][IBV_QPS_RTS].sq_psn, "RTS使用新的sq_psn");
+    ASSERT_EQ(0x777, fake.qp_attr[1][IBV_QPS_RTR].dest_qp_num, "RTR指向对端QP");
+    ASSERT_EQ(2, fake.qp_attr[1][IBV_QPS_RTS].max_rd_atomic, "READ深度取两端较小值");
+    ASSERT_EQ(IBV_QPS_RTS, fake.qp[1].state, "QP回到RTS");
+    ASSERT_EQ(1, ctx->remote_addr == 0x10000, "更新对端地址");
+    ASSERT_EQ(0x55, ctx->remote_rkey, "更新对端rkey");
+    ASSERT_EQ(IBV_WC_SUCCESS, ctx->wc_error, "清除失败原因");
+    ASSERT_EQ(QP_HEALTH_CQ_ERR, ctx->health, "只清除可原地恢复的位");
+    ASSERT_EQ(1, ctx->recoveries, "恢复次数加1");
+    ASSERT_EQ(0, qp_ctx[0].sq_psn | qp_ctx[2].rq_psn, "其他QP不受影响");
+
+    /* 双方恢复的不是同一个QP时失败 */
+    peer_send(sv[1], 2, 1);
+    ASSERT_EQ(-1, qp_reconnect(&res, 1, sv[0], &st), "QP下标不一致时失败");
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/**
+ * 测试QP恢复的PSN生成和交换格式
+ */
+void test_qp_recover_psn(void)
+{
+    uint32_t ok = 1;
+    uint32_t qpn;
+    uint64_t seed = 0x123456789abcdefULL;
+
+    printf("\n--- 测试QP恢复PSN ---\n");
+
+    /* PSN只有24位，高位不能泄漏到ibv_qp_attr的sq_psn/rq_psn */
+    for (qpn = 0; qpn < 1000; qpn++) {
+        ok &= qp_psn_make(seed + qpn * 7919, qpn) <= QP_PSN_MASK;
+    }
+    ASSERT_TRUE(ok, "PSN不超过24位");
+    ASSERT_TRUE(qp_psn_make(seed, 0x11) != qp_psn_make(seed, 0x12), "同一时刻不同QP的PSN不同");
+    ASSERT_TRUE(qp_psn_make(seed, 0x11) != qp_psn_make(seed + 1, 0x11), "不同时刻同一QP的PSN不同");
+
+    /* 交换消息是packed的：下标 + PSN + 完整连接信息 */
+    ASSERT_EQ(8 + sizeof(struct cm_con_data_t), sizeof(struct qp_recover_msg),
+              "恢复消息为8字节头加连接信息");
+    ASSERT_TRUE(WR_ID_TAG(WR_ID_MAKE(3, QP_RECOVER_TAG)) == QP_RECOVER_TAG, "信标标签可解码");
+}
+
+/**
+ * 测试套件：异步事件健康状态
+ */
+void test_async_health(void)
+{
+    struct qp_ctx ctx;
+    struct rdma_resources res;
+
+    printf("\n--- 测试异步事件健康状态 ---\n");
+
+    /* 三种QP错误都表示QP已进入ERR，映射到同一位 */
+    ASSERT_EQ(QP_HEALTH_QP_FATAL, async_event_health(IBV_EVENT_QP_FATAL), "QP_FATAL");
+    ASSERT_EQ(QP_HEALTH_QP_FATAL, async_event_health(IBV_EVENT_QP_REQ_ERR), "QP_REQ_ERR");
+    ASSERT_EQ(QP_HEALTH_QP_FATAL, async_event_health(IBV_EVENT_QP_ACCESS_ERR), "QP_ACCESS_ERR");
+    ASSERT_EQ(QP_HEALTH_PORT_DOWN, async_event_health(IBV_EVENT_PORT_ERR), "PORT_ERR");
+    ASSERT_EQ(QP_HEALTH_CQ_ERR, async_event_health(IBV_EVENT_CQ_ERR), "CQ_ERR");
+    ASSERT_EQ(QP_HEALTH_DEV_FATAL, async_event_health(IBV_EVENT_DEVICE_FATAL), "DEVICE_FATAL");
+
+    /* 恢复性和通知性事件不置位 */
+    ASSERT_EQ(0, async_event_health(IBV_EVENT_PORT_ACTIVE), "PORT_ACTIVE不置位");
+    ASSERT_EQ(0, async_event_health(IBV_EVENT_SRQ_LIMIT_REACHED), "SRQ_LIMIT不置位");
+    ASSERT_EQ(0, async_event_health(IBV_EVENT_COMM_EST), "COMM_EST不置位");
+
+    /* 作用范围决定按element的哪个成员匹配QP */
+    ASSERT_EQ(ASYNC_SCOPE_QP, async_event_scope(IBV_EVENT_QP_LAST_WQE_REACHED), "LAST_WQE按QP匹配");
+    ASSERT_EQ(ASYNC_SCOPE_CQ, async_event_scope(IBV_EVENT_CQ_ERR), "CQ_ERR按CQ匹配");
+    ASSERT_EQ(ASYNC_SCOPE_SRQ, async_event_scope(IBV_EVENT_SRQ_LIMIT_REACHED), "SRQ_LIMIT按SRQ匹配");
+    ASSERT_EQ(ASYNC_SCOPE_PORT, async_event_scope(IBV_EVENT_PORT_ACTIVE), "PORT_ACTIVE按端口匹配");
+    ASSERT_EQ(ASYNC_SCOPE_DEVICE, async_event_scope(IBV_EVENT_DEVICE_FATAL), "DEVICE_FATAL影响全部");
+
+    /* LAST_WQE只记录状态，不中止等待；原地恢复能清除QP级的位 */
+    ASSERT_EQ(QP_HEALTH_LAST_WQE, async_event_health(IBV_EVENT_QP_LAST_WQE_REACHED), "LAST_WQE");
+    ASSERT_FALSE(QP_HEALTH_FAULT_MASK & QP_HEALTH_LAST_WQE, "LAST_WQE不是故障");
+    ASSERT_TRUE(QP_HEALTH_RECOVERABLE & QP_HEALTH_QP_FATAL, "QP错误可原地恢复");
+    ASSERT_FALSE(QP_HEALTH_RECOVERABLE & QP_HEALTH_CQ_ERR, "CQ错误不可原地恢复");
+
+    /* 未启动监视时健康状态和故障计数为0，数据路径的检查恒为正常 */
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&res, 0, sizeof(res));
+    res.qp_ctx = &ctx;
+    res.num_qp = 1;
+    ASSERT_EQ(0, qp_health(&res, 0), "初始健康状态为0");
+    ASSERT_EQ(0, async_fault_gen(&res), "初始故障计数为0");
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_recover 模块单元测试     ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_qp_recover_psn();
+    test_qp_flush();
+    test_qp_reconnect();
+    test_async_health();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file test_rdma_common_session.c
+ * @brief rdma_common_session 模块单元测试
+ * @details qpn_map是内联实现，不链接源文件
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common_session.h"
+
+/**
+ * 测试套件：qp_num映射表
+ */
+void test_qpn_map(void)
+{
+    struct qpn_map m;
+    uint32_t val = 0;
+    uint32_t qpn;
+    int ok = 1;
+
+    printf("\n--- 测试qp_num映射表 ---\n");
+
+    ASSERT_EQ(0, qpn_map_init(&m, 8), "创建映射表");
+    ASSERT_EQ(15, m.mask, "容量取2的幂且至少16");
+    ASSERT_EQ(-1, qpn_map_put(&m, 0, 1), "qp_num 0被拒绝");
+
+    /* 连续的qp_num填到半满，必然有冲突 */
+    for (qpn = 0x100; qpn < 0x108; qpn++) {
+        ok &= qpn_map_put(&m, qpn, qpn - 0x100) == 0;
+    }
+    ASSERT_TRUE(ok, "插入8项");
+    ASSERT_EQ(8, m.count, "计数");
+    ASSERT_EQ(0, qpn_map_put(&m, 0x103, 42), "重复插入更新值");
+    ASSERT_EQ(8, m.count, "更新不增加计数");
+    qpn_map_get(&m, 0x103, &val);
+    ASSERT_EQ(42, val, "读到更新后的值");
+
+    /* 删掉一半后其余项仍能找到（回移删除不能切断探测链） */
+    for (qpn = 0x100; qpn < 0x108; qpn += 2) {
+        qpn_map_del(&m, qpn);
+    }
+    qpn_map_del(&m, 0x999);
+    ASSERT_EQ(4, m.count, "删除4项，删除不存在的项无影响");
+    for (qpn = 0x101; qpn < 0x108; qpn += 2) {
+        ok &= qpn_map_get(&m, qpn, &val) == 0 && qpn_map_get(&m, qpn - 1, &val) == -1;
+    }
+    ASSERT_TRUE(ok, "剩余项可查，已删项查不到");
+    qpn_map_destroy(&m);
+
+    /* 装满到上限后交错删除，检查回移删除后所有剩余项仍可查 */
+    qpn_map_init(&m, 1000);
+    for (qpn = 1; qpn <= 1000; qpn++) {
+        ok &= qpn_map_put(&m, qpn * 7, qpn) == 0;
+    }
+    for (qpn = 1; qpn <= 1000; qpn += 3) {
+        qpn_map_del(&m, qpn * 7);
+    }
+    for (qpn = 1; qpn <= 1000; qpn++) {
+        ok &= (qpn_map_get(&m, qpn * 7, &val) == 0) == (qpn % 3 != 1);
+        ok &= qpn % 3 == 1 || val == qpn;
+    }
+    ASSERT_TRUE(ok, "1000项交错删除后查找正确");
+    ASSERT_EQ(666, m.count, "剩余666项");
+    qpn_map_destroy(&m);
+    ASSERT_NULL(m.keys, "释放后清零");
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_session 模块单元测试    ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_qpn_map();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file test_rdma_common_worker.c
+ * @brief rdma_common_worker 模块单元测试
+ * @details QP分块和上下文分配都是内联函数，不链接源文件
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../src/rdma_common_worker.h"
+
+/**
+ * 测试套件：工作线程的QP分块
+ */
+void test_worker_split(void)
+{
+    struct qp_ctx *ctx;
+    uint32_t first;
+    uint32_t n;
+    uint32_t qp;
+    int ok = 1;
+
+    printf("\n--- 测试工作线程QP分块 ---\n");
+
+    worker_split(10, 4, 0, &first, &n);
+    ASSERT_EQ(0, first, "线程0从QP0开始");
+    ASSERT_EQ(3, n, "余数分给前面的线程");
+    worker_split(10, 4, 3, &first, &n);
+    ASSERT_EQ(8, first, "最后一个线程的起点");
+    ASSERT_EQ(2, n, "最后一个线程的QP数");
+
+    for (qp = 0; qp < 10; qp++) {
+        worker_split(10, 4, worker_index(10, 4, qp), &first, &n);
+        ok &= qp >= first && qp < first + n;
+    }
+    ASSERT_TRUE(ok, "worker_index与worker_split互逆");
+    ASSERT_EQ(15, worker_index(16, 16, 15), "每线程一个QP");
+    ASSERT_EQ(0, sizeof(struct rdma_worker) % 64, "线程状态按缓存行对齐");
+
+    /* 分块边界两侧的QP属于不同线程，它们的上下文不能共享缓存行 */
+    ctx = qp_ctx_alloc(3);
+    ASSERT_EQ(0, sizeof(struct qp_ctx) % 64, "QP上下文按缓存行对齐");
+    ASSERT_TRUE(ctx && ((uintptr_t)&ctx[1] & 63) == 0, "QP上下文数组按缓存行对齐");
+    ASSERT_TRUE(ctx && ctx[2].sq_posted == 0 && ctx[2].handler == NULL, "QP上下文已清零");
+    free(ctx);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_common_worker 模块单元测试     ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_worker_split();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
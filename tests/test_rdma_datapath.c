@@ -0,0 +1,232 @@
+/**
+ * @file test_rdma_datapath.c
+ * @brief 数据路径模块单元测试
+ * @details 链接真实的轮询/投递源文件，用fake_verbs.h中的假CQ/QP代替设备
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_common_poll.h"
+#include "../src/rdma_common_iov.h"
+#include "../src/rdma_common_post.h"
+#include "../src/rdma_common_rdma.h"
+
+/**
+ * 测试套件：一批完成事件分多次ibv_poll_cq取出
+ */
+void test_poll_partial_batches(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    int qp_idx = -1;
+    int i;
+
+    printf("\n--- 测试分批到达的完成事件 ---\n");
+
+    /*
+     * 40个完成事件：先整批取出32个，剩余8个分3个、5个两次到达，最后一个属于QP[3]。
+     * 后两次只写wc[0..4]，按总数取wc[7]读到的是第一批残留的QP[1]
+     */
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    for (i = 0; i < 39; i++) {
+        fake_push_wc((uint32_t)(i % 3), 0, IBV_WC_RECV);
+    }
+    fake_push_wc(3, 0, IBV_WC_RECV);
+    fake.chunk[1] = 3;
+    fake.chunk[2] = 5;
+    fake.nchunk = 3;
+
+    ASSERT_EQ(0, poll_completion(&res, 40, &qp_idx), "40个完成事件应全部取到");
+    ASSERT_EQ(3, fake.polls, "应分三次取出");
+    ASSERT_EQ(3, qp_idx, "qp_idx应为最后一个完成事件的QP");
+
+    /* poll_completion_batch只取期望的数量，剩余的留给下一次调用 */
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    for (i = 0; i < 6; i++) {
+        fake_push_wc((uint32_t)i % FAKE_MAX_QP, 0, IBV_WC_RECV);
+    }
+    fake.chunk[0] = 1;
+    fake.nchunk = 1;
+    ASSERT_EQ(4, poll_completion_batch(&res, 4, wc, POLL_BATCH_SIZE), "应返回期望的4个");
+    ASSERT_EQ(2, fake.tail - fake.head, "不应多消费后续的完成事件");
+    ASSERT_EQ(2, poll_completion_batch(&res, 2, wc, 2), "剩余2个由下一次取出");
+    ASSERT_EQ(1, wc[1].wr_id == WR_ID_MAKE(1, 0), "最后一批的第二个属于QP[1]");
+
+    /* CQ一直为空时按poll_timeout_ms超时 */
+    ASSERT_EQ(-1, poll_completion(&res, 1, &qp_idx), "没有完成事件时应超时失败");
+}
+
+/**
+ * 测试套件：一批中有失败的完成事件时其余的仍被分发
+ */
+void test_poll_batch_error(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct ibv_wc wc[POLL_BATCH_SIZE];
+    struct rdma_iov iov;
+    static char payload[64];
+
+    printf("\n--- 测试批内失败的完成事件 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    iov.addr = payload;
+    iov.len = sizeof(payload);
+    iov.lkey = 0x11;
+    ASSERT_EQ(0, post_send_iov(&res, 2, WR_ID_MAKE(2, 0), &iov, 1), "QP[2]投递一个发送");
+    ASSERT_EQ(FAKE_SQ_DEPTH - 1, sq_available(&res, 2), "发送队列占用一项");
+
+    /* 失败的完成事件排在最前，后面是QP[2]的发送完成和QP[3]的另一个失败 */
+    fake_push_wc(1, 0, IBV_WC_SEND);
+    fake.wc[fake.tail - 1].status = IBV_WC_REM_ACCESS_ERR;
+    fake_push_wc(2, 0, IBV_WC_SEND);
+    fake_push_wc(3, 0, IBV_WC_RECV);
+    fake.wc[fake.tail - 1].status = IBV_WC_WR_FLUSH_ERR;
+
+    ASSERT_EQ(-1, poll_cq_batch(&res, wc, POLL_BATCH_SIZE), "批内有失败时返回-1");
+    ASSERT_EQ(fake.tail, fake.head, "整批都已取出");
+    ASSERT_EQ(FAKE_SQ_DEPTH, sq_available(&res, 2), "失败之后的发送完成仍回收槽位");
+    ASSERT_EQ(IBV_WC_REM_ACCESS_ERR, qp_ctx[1].wc_error, "记录QP[1]的失败原因");
+    ASSERT_EQ(IBV_WC_WR_FLUSH_ERR, qp_ctx[3].wc_error, "记录后续QP[3]的失败原因");
+}
+
+/**
+ * 测试套件：WRITE_WITH_IMM的槽位偏移按64位计算
+ */
+void test_write_imm_slot(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    static struct ibv_mr mr;
+    static char buf[4096];
+
+    printf("\n--- 测试立即数写槽位偏移 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    res.buf = buf;
+    res.buf_size = sizeof(buf);
+    res.mr = &mr;
+    qp_ctx[0].remote_addr = 0x10000000;
+    qp_ctx[0].remote_len = 64u << 20;
+
+    ASSERT_EQ(-1, set_imm_slot_size(&res, 2u << 20), "最大槽位偏移超过4GB的槽位大小被拒绝");
+    ASSERT_EQ(0, set_imm_slot_size(&res, 1u << 20), "1MB槽位可用");
+    ASSERT_EQ(0, post_write_imm_qp(&res, 0, 0, 3, 16), "写第3个槽位");
+    ASSERT_EQ(1, fake.sent[0].wr.rdma.remote_addr == 0x10000000 + (3u << 20),
+              "远端地址为槽位号×槽位大小");
+    ASSERT_EQ(IMM_MAKE(3, 16), ntohl(fake.sent[0].imm_data), "立即数携带槽位号和长度");
+    ASSERT_EQ(-ERANGE, post_write_imm_qp(&res, 0, 0, 64, 16), "超出对端区域的槽位被拒绝");
+
+    /* 2048×2MB在32位下回绕为0，不能落到0号槽位 */
+    qp_ctx[0].imm_slot_size = 2u << 20;
+    ASSERT_EQ(-ERANGE, post_write_imm_qp(&res, 0, 0, 2048, 16), "回绕的偏移被拒绝");
+    ASSERT_EQ(1, fake.nsent, "被拒绝的写没有投递");
+}
+
+/**
+ * 测试套件：多SGE接收时各段的填充长度
+ */
+void test_iov_filled(void)
+{
+    char hdr[16];
+    char payload[4096];
+    struct rdma_iov iov[2] = {
+        { hdr, sizeof(hdr), 0 },
+        { payload, sizeof(payload), 0 },
+    };
+
+    printf("\n--- 测试多SGE分散接收 ---\n");
+
+    ASSERT_TRUE(DEFAULT_MAX_SGE >= 2, "默认至少能把头和负载分开");
+    ASSERT_TRUE(DEFAULT_MAX_SGE <= MAX_SGE_LIMIT, "默认值不应超过接口上限");
+
+    ASSERT_EQ(16, iov_filled(iov, 2, 1016, 0), "头部段先被填满");
+    ASSERT_EQ(1000, iov_filled(iov, 2, 1016, 1), "剩余字节落在负载段");
+    ASSERT_EQ(10, iov_filled(iov, 2, 10, 0), "短消息只写入头部段");
+    ASSERT_EQ(0, iov_filled(iov, 2, 10, 1), "短消息不触及负载段");
+    ASSERT_EQ(0, iov_filled(iov, 2, 1016, 2), "越界的段返回0");
+}
+
+/**
+ * 测试套件：多段iov转换成一个WR的SGE列表
+ */
+void test_iov_post(void)
+{
+    struct rdma_resources res;
+    struct ibv_qp *qp_list[FAKE_MAX_QP];
+    struct qp_ctx qp_ctx[FAKE_MAX_QP];
+    struct rdma_iov iov[MAX_SGE_LIMIT + 1];
+    static char hdr[16];
+    static char payload[4096];
+    uint32_t i;
+
+    printf("\n--- 测试多SGE投递 ---\n");
+
+    fake_reset(&res, qp_list, qp_ctx, FAKE_MAX_QP);
+    res.max_sge = 3;
+    res.max_inline_data = 64;
+    iov[0].addr = hdr;
+    iov[0].len = sizeof(hdr);
+    iov[0].lkey = 0x11;
+    iov[1].addr = payload;
+    iov[1].len = 1000;
+    iov[1].lkey = 0x22;
+    iov[2].addr = payload + 2048;
+    iov[2].len = 2048;
+    iov[2].lkey = 0x33;
+
+    ASSERT_EQ(0, post_send_iov(&res, 2, WR_ID_MAKE(2, 7), iov, 3), "三段拼成一个SEND");
+    ASSERT_EQ(1, fake.nsent, "只投递一个WR");
+    ASSERT_EQ(3, fake.sent[0].num_sge, "SGE数等于段数");
+    ASSERT_EQ(IBV_WR_SEND, fake.sent[0].opcode, "操作码为SEND");
+    ASSERT_EQ(1, fake.sent[0].wr_id == WR_ID_MAKE(2, 7), "wr_id原样传递");
+    for (i = 0; i < 3; i++) {
+        ASSERT_EQ(1, fake.sent[0].sg_list[i].addr == (uintptr_t)iov[i].addr, "SGE地址按段顺序");
+        ASSERT_EQ(iov[i].len, fake.sent[0].sg_list[i].length, "SGE长度等于段长度");
+        ASSERT_EQ(iov[i].lkey, fake.sent[0].sg_list[i].lkey, "SGE使用段的lkey");
+    }
+    ASSERT_EQ(0, fake.sent[0].send_flags & IBV_SEND_INLINE, "总长超过内联阈值不内联");
+
+    /* 总长不超过max_inline_data时仍走内联 */
+    iov[1].len = 16;
+    ASSERT_EQ(0, post_send_iov(&res, 2, WR_ID_MAKE(2, 8), iov, 2), "两段小消息");
+    ASSERT_EQ(IBV_SEND_INLINE, fake.sent[1].send_flags & IBV_SEND_INLINE, "小消息自动内联");
+
+    /* 段数超过res->max_sge或为0时不投递 */
+    ASSERT_EQ(-EINVAL, post_send_iov(&res, 2, 0, iov, 4), "段数超过max_sge");
+    ASSERT_EQ(-EINVAL, post_recv_iov(&res, 2, 0, iov, 0), "段数为0");
+    ASSERT_EQ(2, fake.nsent, "失败时不调用ibv_post_send");
+
+    /* 接收：头部段在前，负载段在后 */
+    ASSERT_EQ(0, post_recv_iov(&res, 1, WR_ID_MAKE(1, 3), iov, 3), "三段RECV");
+    ASSERT_EQ(1, fake.nrecv, "只投递一个接收WR");
+    ASSERT_EQ(3, fake.recv[0].num_sge, "接收SGE数等于段数");
+    ASSERT_EQ(1, fake.recv[0].sg_list[0].addr == (uintptr_t)hdr, "第一个SGE接收头部");
+    ASSERT_EQ(0x33, fake.recv[0].sg_list[2].lkey, "最后一个SGE使用负载段的lkey");
+}
+
+int main(void)
+{
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   数据路径模块单元测试                 ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    test_poll_partial_batches();
+    test_poll_batch_error();
+    test_write_imm_slot();
+    test_iov_filled();
+    test_iov_post();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}
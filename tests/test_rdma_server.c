@@ -9,6 +9,7 @@
 #include <string.h>
 #include "../tests/utest.h"
 #include "../src/rdma_common.h"
+#include "../src/rdma_server.h"
 
 /**
  * 测试套件：服务端参数解析
@@ -47,6 +48,32 @@ void test_tcp_listen_setup(void)
     ASSERT_NOT_NULL(&server_addr, "服务端地址结构应可正常初始化");
 }
 
+/**
+ * 测试套件：多客户端服务端的容量和回收
+ */
+void test_server_multi_client(void)
+{
+    static struct rdma_server srv;
+    struct srv_client c;
+
+    printf("\n--- 测试多客户端服务端 ---\n");
+
+    ASSERT_TRUE(SRV_MAX_CLIENTS >= 256, "支持数百个并发客户端");
+    ASSERT_TRUE(SRV_EV_CQ >= SRV_MAX_CLIENTS && SRV_EV_LISTEN >= SRV_MAX_CLIENTS,
+                "epoll标记不与客户端slot冲突");
+    ASSERT_TRUE(SRV_CQ_POOL_DEFAULT <= SRV_CQ_POOL_MAX, "默认CQ池大小不超过上限");
+
+    memset(&c, 0, sizeof(c));
+    c.slot = 7;
+    c.state = SRV_CLIENT_ACTIVE;
+    srv_client_done(&srv, &c);
+    srv_client_done(&srv, &c);
+    ASSERT_EQ(SRV_CLIENT_DONE, c.state, "客户端进入DONE");
+    ASSERT_EQ(1, srv.num_reap, "重复结束只回收一次");
+    ASSERT_EQ(7, srv.reap[0], "回收列表记录slot");
+    ASSERT_TRUE(monotonic_ns() > 0, "单调时钟可用");
+}
+
 /**
  * 测试套件：QP配置参数
  */
@@ -152,6 +179,7 @@ int main(void)
     /* 运行所有测试套件 */
     test_server_parameters();
     test_tcp_listen_setup();
+    test_server_multi_client();
     test_server_qp_config();
     test_connection_info_format();
     test_communication_flow();
@@ -0,0 +1,236 @@
+/**
+ * @file test_rdma_server_conn.c
+ * @brief 服务端客户端连接与slot管理单元测试
+ * @details 链接真实的rdma_server_conn.c/rdma_server_session.c，客户端走回环TCP，
+ *          QP由fake_verbs.h分配；覆盖accept → 握手建会话 → 按qp_num分发完成事件 → 回收
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "../tests/utest.h"
+#include "../tests/fake_verbs.h"
+#include "../src/rdma_server.h"
+
+#define TEST_NUM_QP    2
+#define TEST_MAX_QP    FAKE_MAX_QP
+#define TEST_POOL_CQE  64
+
+static struct rdma_server srv;
+static struct ibv_qp *shared_qp[1];
+static struct qp_ctx shared_ctx[1];
+
+/* 初始化服务端：假设备做共享资源，一个池CQ，回环端口监听 */
+static int srv_setup(struct sockaddr_in *sin) {
+    socklen_t len = sizeof(*sin);
+    uint32_t i;
+
+    memset(&srv, 0, sizeof(srv));
+    fake_reset(&srv.shared, shared_qp, shared_ctx, 0);
+    srv.shared.sq_depth = SRV_QP_DEPTH;
+    srv.shared.rq_depth = SRV_QP_DEPTH;
+    srv.shared.dev_attr.max_sge = 1;
+    srv.max_qp = TEST_MAX_QP;
+    for (i = 0; i < SRV_MAX_CLIENTS; i++) {
+        srv.free_slots[i] = SRV_MAX_CLIENTS - 1 - i;
+    }
+    srv.num_free = SRV_MAX_CLIENTS;
+    srv.cqs[0].cq = &fake.cq;
+    srv.cqs[0].cqe = TEST_POOL_CQE;
+    srv.num_cq = 1;
+
+    memset(sin, 0, sizeof(*sin));
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    srv.epfd = epoll_create1(0);
+    srv.listen_sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (srv.epfd < 0 || srv.listen_sock < 0 || qpn_map_init(&srv.qpns, 64) ||
+        bind(srv.listen_sock, (struct sockaddr *)sin, sizeof(*sin)) < 0 ||
+        listen(srv.listen_sock, SOMAXCONN) < 0 ||
+        getsockname(srv.listen_sock, (struct sockaddr *)sin, &len) < 0) {
+        perror("srv_setup");
+        return -1;
+    }
+    return 0;
+}
+
+static void srv_teardown(void) {
+    qpn_map_destroy(&srv.qpns);
+    close(srv.listen_sock);
+    close(srv.epfd);
+}
+
+/* 客户端建立TCP连接，服务端accept后返回分到的slot */
+static int client_connect(const struct sockaddr_in *sin, uint32_t *slot) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (sock < 0 || connect(sock, (const struct sockaddr *)sin, sizeof(*sin)) < 0) {
+        perror("client_connect");
+        exit(1);
+    }
+    *slot = srv.free_slots[srv.num_free - 1];
+    ASSERT_EQ(0, srv_accept(&srv), "accept成功");
+    return sock;
+}
+
+/* 向服务端分发一个客户端QP上的完成事件 */
+static void dispatch(struct srv_client *c, uint32_t qp_idx, enum ibv_wc_opcode opcode) {
+    struct ibv_wc wc;
+
+    memset(&wc, 0, sizeof(wc));
+    wc.wr_id = WR_ID_MAKE(qp_idx, 0);
+    wc.status = IBV_WC_SUCCESS;
+    wc.opcode = opcode;
+    wc.qp_num = c->res.qp_list[qp_idx]->qp_num;
+    srv_dispatch_wc(&srv, &wc);
+}
+
+/* 客户端读服务端的回复：num_qp + 连接信息 + 就绪字节 */
+static void client_read_reply(int sock, const uint32_t *qpn) {
+    struct cm_con_data_t reply[TEST_NUM_QP];
+    uint32_t num_qp = 0;
+    char ready = 0;
+
+    ASSERT_EQ(0, sock_read_full(sock, &num_qp, sizeof(num_qp)), "客户端读回复QP数");
+    ASSERT_EQ(TEST_NUM_QP, num_qp, "回复的QP数与请求一致");
+    ASSERT_EQ(0, sock_read_full(sock, reply, sizeof(reply)), "客户端读回复连接信息");
+    ASSERT_EQ(qpn[1], reply[1].qp_num, "回复携带服务端QP号");
+    ASSERT_EQ(0, sock_read_full(sock, &ready, 1), "客户端读就绪字节");
+    ASSERT_EQ('R', ready, "就绪字节为'R'");
+}
+
+/**
+ * 测试套件：一个客户端的完整生命周期
+ */
+void test_client_lifecycle(const struct sockaddr_in *sin)
+{
+    struct cm_con_data_t peer[TEST_NUM_QP];
+    uint32_t num_qp = TEST_NUM_QP;
+    uint32_t qpn[TEST_NUM_QP];
+    struct srv_client *c;
+    struct ibv_wc wc;
+    uint32_t slot;
+    uint32_t val;
+    uint32_t i;
+    int sock;
+
+    printf("\n--- 测试客户端生命周期 ---\n");
+
+    sock = client_connect(sin, &slot);
+    c = srv.clients[slot];
+    ASSERT_NOT_NULL(c, "accept后占用slot");
+    ASSERT_EQ(SRV_MAX_CLIENTS - 1, srv.num_free, "空闲slot减1");
+    ASSERT_EQ(1, srv.accepted, "累计接受1个连接");
+    ASSERT_EQ(SRV_CLIENT_RECV_HDR, c->state, "初始状态为RECV_HDR");
+
+    /* 先只写QP数，握手停在RECV_QP等待剩余数据 */
+    ASSERT_EQ(0, sock_write_full(sock, &num_qp, sizeof(num_qp)), "客户端写QP数");
+    srv_client_io(&srv, slot, EPOLLIN);
+    ASSERT_EQ(SRV_CLIENT_RECV_QP, c->state, "读到QP数后进入RECV_QP");
+
+    memset(peer, 0, sizeof(peer));
+    for (i = 0; i < TEST_NUM_QP; i++) {
+        peer[i].qp_num = 0x900 + i;
+    }
+    ASSERT_EQ(0, sock_write_full(sock, peer, sizeof(peer)), "客户端写连接信息");
+    srv_client_io(&srv, slot, EPOLLIN);
+    ASSERT_EQ(SRV_CLIENT_ACTIVE, c->state, "回复发送完毕后进入ACTIVE");
+    ASSERT_PTR_EQ(&srv.cqs[0], c->cq, "会话挂在池CQ上");
+    ASSERT_EQ(TEST_NUM_QP * 2 * SRV_QP_DEPTH, srv.cqs[0].reserved, "按QP数预留CQE");
+    ASSERT_EQ(TEST_NUM_QP, fake.nrecv, "每个QP投递了RECV");
+
+    for (i = 0; i < TEST_NUM_QP; i++) {
+        qpn[i] = c->res.qp_list[i]->qp_num;
+        ASSERT_EQ(IBV_QPS_RTS, c->res.qp_list[i]->state, "QP已迁移到RTS");
+        ASSERT_EQ(0, qpn_map_get(&srv.qpns, qpn[i], &val), "qpn_map中能查到QP");
+        ASSERT_EQ(slot, val, "qpn_map指向客户端slot");
+    }
+
+    client_read_reply(sock, qpn);
+
+    /* 收齐所有QP的消息后才回复，回复全部完成后客户端结束 */
+    dispatch(c, 0, IBV_WC_RECV);
+    ASSERT_EQ(0, fake.nsent, "只收到部分消息时不回复");
+    dispatch(c, 1, IBV_WC_RECV);
+    ASSERT_EQ(TEST_NUM_QP, fake.nsent, "收齐后在每个QP上回复");
+    dispatch(c, 0, IBV_WC_SEND);
+    ASSERT_EQ(SRV_CLIENT_ACTIVE, c->state, "回复未全部完成时保持ACTIVE");
+    dispatch(c, 1, IBV_WC_SEND);
+    ASSERT_EQ(SRV_CLIENT_DONE, c->state, "回复全部完成后进入DONE");
+    ASSERT_EQ(1, srv.served, "累计完成1个客户端");
+    ASSERT_EQ(1, srv.num_reap, "进入回收列表");
+
+    srv_reap(&srv);
+    ASSERT_NULL(srv.clients[slot], "回收后释放slot");
+    ASSERT_EQ(SRV_MAX_CLIENTS, srv.num_free, "空闲slot归还");
+    ASSERT_EQ(0, srv.num_reap, "回收列表清空");
+    ASSERT_EQ(0, srv.cqs[0].reserved, "归还CQE预留");
+    ASSERT_EQ(TEST_NUM_QP, fake.destroyed, "销毁了所有QP");
+    ASSERT_EQ(-1, qpn_map_get(&srv.qpns, qpn[0], &val), "qpn_map中已删除QP");
+
+    /* 已关闭客户端残留的完成事件被丢弃 */
+    memset(&wc, 0, sizeof(wc));
+    wc.opcode = IBV_WC_RECV;
+    wc.qp_num = qpn[1];
+    srv_dispatch_wc(&srv, &wc);
+    ASSERT_EQ(TEST_NUM_QP, fake.nsent, "残留完成事件不触发回复");
+    close(sock);
+}
+
+/**
+ * 测试套件：QP数超出上限的客户端被拒绝
+ */
+void test_client_reject(const struct sockaddr_in *sin)
+{
+    uint32_t num_qp = TEST_MAX_QP + 1;
+    uint32_t slot;
+    int sock;
+
+    printf("\n--- 测试拒绝超限客户端 ---\n");
+
+    fake_reset(&srv.shared, shared_qp, shared_ctx, 0);
+    srv.shared.sq_depth = SRV_QP_DEPTH;
+    srv.shared.rq_depth = SRV_QP_DEPTH;
+    srv.shared.dev_attr.max_sge = 1;
+
+    sock = client_connect(sin, &slot);
+    ASSERT_EQ(0, sock_write_full(sock, &num_qp, sizeof(num_qp)), "客户端写QP数");
+    srv_client_io(&srv, slot, EPOLLIN);
+    ASSERT_EQ(SRV_CLIENT_DONE, srv.clients[slot]->state, "QP数超限时进入DONE");
+    ASSERT_NULL(srv.clients[slot]->cq, "未占用池CQ");
+    ASSERT_EQ(0, fake.nqp, "未创建QP");
+
+    srv_reap(&srv);
+    ASSERT_NULL(srv.clients[slot], "回收后释放slot");
+    ASSERT_EQ(SRV_MAX_CLIENTS, srv.num_free, "空闲slot归还");
+    close(sock);
+}
+
+/**
+ * 主测试函数
+ */
+int main(void)
+{
+    struct sockaddr_in sin;
+
+    printf("\n");
+    printf("╔════════════════════════════════════════╗\n");
+    printf("║   rdma_server 连接管理单元测试         ║\n");
+    printf("╚════════════════════════════════════════╝\n");
+
+    if (srv_setup(&sin)) {
+        return 1;
+    }
+    test_client_lifecycle(&sin);
+    test_client_reject(&sin);
+    srv_teardown();
+
+    print_test_summary();
+
+    test_stats_t stats = get_test_stats();
+    return stats.failed == 0 ? 0 : 1;
+}